@@ -0,0 +1,288 @@
+import * as fs from 'fs';
+import * as os from 'os';
+import * as Path from 'path';
+import * as yargs from 'yargs';
+import { hideBin } from 'yargs/helpers';
+import type { BufferedOstrichStore, QueryIterator } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+import type { Cardinality, IDatasetOptions, IPattern } from './dataset';
+import { DatasetGenerator } from './dataset';
+
+type QueryType = 'versionMaterialized' | 'deltaMaterialized' | 'version';
+
+/**
+ * A single query of the benchmark, of which the versions depend on its type.
+ */
+interface IQuery {
+  type: QueryType;
+  cardinality: Cardinality;
+  pattern: IPattern;
+  version?: number;
+  versionStart?: number;
+  versionEnd?: number;
+}
+
+/**
+ * The latencies of a group of queries in milliseconds.
+ */
+interface ILatencies {
+  mean: number;
+  p50: number;
+  p90: number;
+  p99: number;
+  max: number;
+}
+
+/**
+ * The measurements of all queries of one type and cardinality.
+ */
+interface IGroupResult {
+  type: QueryType;
+  cardinality: Cardinality;
+  queries: number;
+  results: number;
+  /**
+   * The number of queries and results per second, over the total time of all queries.
+   */
+  queriesPerSecond: number;
+  resultsPerSecond: number;
+  latency: ILatencies;
+}
+
+interface IRunResult {
+  bindings: 'ostrich' | 'ostrich-buffered';
+  bufferSize?: number;
+  groups: IGroupResult[];
+}
+
+/**
+ * Executes a query and returns its number of results.
+ */
+type QueryExecutor = (query: IQuery) => Promise<number>;
+
+(async function() {
+  const args = await yargs(hideBin(process.argv))
+    .options({
+      archive: {
+        alias: 'a',
+        type: 'string',
+        describe: 'An archive of an earlier run with the same dataset options, which is generated if it is empty',
+      },
+      triples: { type: 'number', describe: 'The number of triples in each version', default: 20_000 },
+      versions: { type: 'number', describe: 'The number of versions', default: 10 },
+      changeRate: { type: 'number', describe: 'The fraction of triples that changes in every version', default: 0.05 },
+      queries: { type: 'number', describe: 'The number of query patterns per cardinality', default: 3 },
+      seed: { type: 'number', describe: 'The seed of the dataset', default: 42 },
+      iterations: { type: 'number', describe: 'The number of measured executions of every query', default: 10 },
+      warmup: { type: 'number', describe: 'The number of unmeasured executions of every query', default: 2 },
+      bufferSizes: {
+        type: 'string',
+        describe: 'The comma-separated buffer sizes of the buffered bindings',
+        default: '100,1000,10000',
+      },
+      output: { alias: 'o', type: 'string', describe: 'A file to write the JSON report to instead of stdout' },
+    })
+    .strict()
+    .version(false)
+    .example(`$0 --triples 100000 --versions 50 --output report.json`, '')
+    .help()
+    .parse();
+
+  const datasetOptions: IDatasetOptions = {
+    triples: args.triples,
+    versions: args.versions,
+    changeRate: args.changeRate,
+    queries: args.queries,
+    seed: args.seed,
+  };
+  const generator = new DatasetGenerator(datasetOptions);
+  const archive = args.archive || fs.mkdtempSync(Path.join(os.tmpdir(), 'ostrich-bench-'));
+  const removeArchive = !args.archive;
+  if (!fs.existsSync(archive)) {
+    fs.mkdirSync(archive);
+  }
+
+  try {
+    // Generate the archive unless it exists already
+    if (fs.readdirSync(archive).length === 0) {
+      log(`Generating ${args.versions} versions of ${args.triples} triples in ${archive}`);
+      const store = await fromPath(archive, { readOnly: false });
+      await generator.appendTo(store, (version, changes) => log(`  Version ${version}: ${changes} changes`));
+      await store.close();
+    }
+    const queries = createQueries(generator.generatePatterns(), args.versions);
+
+    const runs: IRunResult[] = [];
+    log('Running ostrich');
+    const store = await fromPath(archive, { readOnly: true });
+    runs.push({
+      bindings: 'ostrich',
+      groups: await run(queries, executeUnbuffered(store), args.warmup, args.iterations),
+    });
+    await store.close();
+    for (const bufferSize of args.bufferSizes.split(',').map(size => Number.parseInt(size, 10))) {
+      log(`Running ostrich-buffered with a buffer size of ${bufferSize}`);
+      const bufferedStore = await fromPathBuffered(archive, bufferSize, { readOnly: true, prefetch: false });
+      runs.push({
+        bindings: 'ostrich-buffered',
+        bufferSize,
+        groups: await run(queries, executeBuffered(bufferedStore), args.warmup, args.iterations),
+      });
+      await bufferedStore.close();
+    }
+
+    const report = JSON.stringify({ dataset: datasetOptions, iterations: args.iterations, runs }, null, 2);
+    if (args.output) {
+      fs.writeFileSync(args.output, `${report}\n`);
+    } else {
+      process.stdout.write(`${report}\n`);
+    }
+  } finally {
+    if (removeArchive) {
+      fs.rmSync(archive, { recursive: true, force: true });
+    }
+  }
+})()
+  .then(() => {
+    // Do nothing
+  })
+  .catch(error => {
+    process.stderr.write(`${error.stack}\n`);
+    // eslint-disable-next-line unicorn/no-process-exit
+    process.exit(1);
+  });
+
+// Progress is logged to stderr, so that the report can be piped from stdout
+function log(message: string): void {
+  process.stderr.write(`${message}\n`);
+}
+
+/**
+ * Creates VM queries over the first, middle and last version,
+ * DM queries from the first version to the middle and last version and from the middle to the last version,
+ * and VQ queries, for every pattern.
+ */
+function createQueries(patterns: Record<Cardinality, IPattern[]>, versions: number): IQuery[] {
+  const last = versions - 1;
+  const middle = Math.floor(last / 2);
+  const queries: IQuery[] = [];
+  for (const cardinality of <Cardinality[]> [ 'low', 'medium', 'high' ]) {
+    for (const pattern of patterns[cardinality]) {
+      for (const version of new Set([ 0, middle, last ])) {
+        queries.push({ type: 'versionMaterialized', cardinality, pattern, version });
+      }
+      for (const [ versionStart, versionEnd ] of [[ 0, middle ], [ 0, last ], [ middle, last ]]) {
+        if (versionStart < versionEnd) {
+          queries.push({ type: 'deltaMaterialized', cardinality, pattern, versionStart, versionEnd });
+        }
+      }
+      queries.push({ type: 'version', cardinality, pattern });
+    }
+  }
+  return queries;
+}
+
+function executeUnbuffered(store: OstrichStore): QueryExecutor {
+  return async query => {
+    const { subject, predicate, object } = query.pattern;
+    switch (query.type) {
+      case 'versionMaterialized':
+        return (await store.searchTriplesVersionMaterialized(subject, predicate, object, { version: query.version }))
+          .triples.length;
+      case 'deltaMaterialized':
+        return (await store.searchTriplesDeltaMaterialized(subject, predicate, object, {
+          versionStart: query.versionStart!,
+          versionEnd: query.versionEnd!,
+        })).triples.length;
+      case 'version':
+        return (await store.searchTriplesVersion(subject, predicate, object)).triples.length;
+    }
+  };
+}
+
+function executeBuffered(store: BufferedOstrichStore): QueryExecutor {
+  return async query => {
+    const { subject, predicate, object } = query.pattern;
+    switch (query.type) {
+      case 'versionMaterialized':
+        return count(store.searchTriplesVersionMaterialized(subject, predicate, object, { version: query.version }));
+      case 'deltaMaterialized':
+        return count(store.searchTriplesDeltaMaterialized(subject, predicate, object, {
+          versionStart: query.versionStart!,
+          versionEnd: query.versionEnd!,
+        }));
+      case 'version':
+        return count(store.searchTriplesVersion(subject, predicate, object));
+    }
+  };
+}
+
+async function count(iterator: QueryIterator): Promise<number> {
+  let results = 0;
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    results += batch.length;
+    done = batchDone;
+  }
+  return results;
+}
+
+/**
+ * Executes every query sequentially, and groups their measurements per type and cardinality.
+ */
+async function run(
+  queries: IQuery[],
+  execute: QueryExecutor,
+  warmup: number,
+  iterations: number,
+): Promise<IGroupResult[]> {
+  const groups = new Map<string, { query: IQuery; latencies: number[]; results: number }>();
+  for (const query of queries) {
+    for (let i = 0; i < warmup; i++) {
+      await execute(query);
+    }
+    const key = `${query.type} ${query.cardinality}`;
+    if (!groups.has(key)) {
+      groups.set(key, { query, latencies: [], results: 0 });
+    }
+    const group = groups.get(key)!;
+    for (let i = 0; i < iterations; i++) {
+      const start = process.hrtime();
+      group.results += await execute(query);
+      const [ seconds, nanoseconds ] = process.hrtime(start);
+      group.latencies.push(seconds * 1000 + nanoseconds / 1e6);
+    }
+  }
+  return [ ...groups.values() ].map(({ query, latencies, results }) => {
+    const total = latencies.reduce((sum, latency) => sum + latency, 0);
+    return {
+      type: query.type,
+      cardinality: query.cardinality,
+      queries: latencies.length,
+      results,
+      queriesPerSecond: round(latencies.length / (total / 1000)),
+      resultsPerSecond: round(results / (total / 1000)),
+      latency: summarize(latencies),
+    };
+  });
+}
+
+function summarize(latencies: number[]): ILatencies {
+  const sorted = [ ...latencies ].sort((left, right) => left - right);
+  const percentile = (fraction: number): number =>
+    round(sorted[Math.min(sorted.length - 1, Math.ceil(fraction * sorted.length) - 1)]);
+  return {
+    mean: round(sorted.reduce((sum, latency) => sum + latency, 0) / sorted.length),
+    p50: percentile(0.5),
+    p90: percentile(0.9),
+    p99: percentile(0.99),
+    max: round(sorted[sorted.length - 1]),
+  };
+}
+
+function round(value: number): number {
+  return Math.round(value * 1000) / 1000;
+}
@@ -0,0 +1,181 @@
+import type * as RDF from '@rdfjs/types';
+import { DataFactory } from 'rdf-data-factory';
+import type { OstrichStore } from '../lib/OstrichStore';
+import type { IQuadDelta } from '../lib/utils';
+import { quadDelta } from '../lib/utils';
+
+const DF = new DataFactory();
+const PREFIX = 'http://example.org/';
+
+/**
+ * The shape of a synthetic versioned dataset, in the style of the BEAR benchmark.
+ */
+export interface IDatasetOptions {
+  /**
+   * The number of triples in each version.
+   */
+  triples: number;
+  /**
+   * The number of versions, including the initial snapshot.
+   */
+  versions: number;
+  /**
+   * The fraction of triples that is deleted and replaced by new triples in every version.
+   */
+  changeRate: number;
+  /**
+   * The number of query patterns per cardinality.
+   */
+  queries: number;
+  /**
+   * The seed of the random generator, so that equal options result in equal datasets.
+   */
+  seed: number;
+}
+
+/**
+ * The cardinalities of query patterns:
+ * low patterns bind a subject, medium patterns bind a rare predicate, and high patterns bind a common predicate.
+ */
+export type Cardinality = 'low' | 'medium' | 'high';
+
+export interface IPattern {
+  subject: RDF.Term | null;
+  predicate: RDF.Term | null;
+  object: RDF.Term | null;
+}
+
+// The number of common predicates, which together occur in COMMON_PREDICATE_SHARE of all triples
+const COMMON_PREDICATES = 3;
+const COMMON_PREDICATE_SHARE = 0.4;
+// The number of rare predicates, which share the remaining triples
+const RARE_PREDICATES = 100;
+// The average number of triples per subject, and the share of objects that are literals
+const TRIPLES_PER_SUBJECT = 4;
+const LITERAL_SHARE = 0.2;
+
+/**
+ * A deterministic random generator (mulberry32).
+ */
+export class Random {
+  private state: number;
+
+  public constructor(seed: number) {
+    this.state = seed >>> 0;
+  }
+
+  /**
+   * A number in [0, 1).
+   */
+  public next(): number {
+    this.state = (this.state + 0x6D2B79F5) >>> 0;
+    let value = this.state;
+    value = Math.imul(value ^ (value >>> 15), value | 1);
+    value ^= value + Math.imul(value ^ (value >>> 7), value | 61);
+    return ((value ^ (value >>> 14)) >>> 0) / 4_294_967_296;
+  }
+
+  /**
+   * An integer in [0, max).
+   */
+  public nextInt(max: number): number {
+    return Math.floor(this.next() * max);
+  }
+}
+
+/**
+ * Generates the triples and changes of a synthetic dataset,
+ * of which the predicates follow a skewed distribution so that patterns of different cardinalities exist.
+ */
+export class DatasetGenerator {
+  private readonly random: Random;
+  private readonly subjects: number;
+  private readonly objects: number;
+  private readonly triples: RDF.Quad[] = [];
+  private readonly keys = new Set<string>();
+
+  public constructor(private readonly options: IDatasetOptions) {
+    this.random = new Random(options.seed);
+    this.subjects = Math.max(1, Math.round(options.triples / TRIPLES_PER_SUBJECT));
+    this.objects = Math.max(1, Math.round(options.triples / 2));
+  }
+
+  /**
+   * Appends all versions of the dataset to the given store.
+   * @param store An empty store.
+   * @param onVersion A callback that is invoked after each version was appended.
+   */
+  public async appendTo(store: OstrichStore, onVersion?: (version: number, changes: number) => void): Promise<void> {
+    for (let version = 0; version < this.options.versions; version++) {
+      const changes = version === 0 ? this.generateSnapshot() : this.generateChanges();
+      await store.append(changes, version);
+      if (onVersion) {
+        onVersion(version, changes.length);
+      }
+    }
+  }
+
+  /**
+   * Selects the query patterns of each cardinality.
+   * Every subject has about TRIPLES_PER_SUBJECT triples, and every rare predicate about 0.6% of all triples.
+   */
+  public generatePatterns(): Record<Cardinality, IPattern[]> {
+    const random = new Random(this.options.seed + 1);
+    const patterns: Record<Cardinality, IPattern[]> = { low: [], medium: [], high: []};
+    for (let i = 0; i < this.options.queries; i++) {
+      const subject = DF.namedNode(`${PREFIX}s${random.nextInt(this.subjects)}`);
+      patterns.low.push({ subject, predicate: null, object: null });
+      const rarePredicate = DF.namedNode(`${PREFIX}p${random.nextInt(RARE_PREDICATES)}`);
+      patterns.medium.push({ subject: null, predicate: rarePredicate, object: null });
+      const commonPredicate = DF.namedNode(`${PREFIX}c${i % COMMON_PREDICATES}`);
+      patterns.high.push({ subject: null, predicate: commonPredicate, object: null });
+    }
+    return patterns;
+  }
+
+  private generateSnapshot(): IQuadDelta[] {
+    const changes: IQuadDelta[] = [];
+    while (this.triples.length < this.options.triples) {
+      changes.push(quadDelta(this.addTriple(), true));
+    }
+    return changes;
+  }
+
+  private generateChanges(): IQuadDelta[] {
+    const count = Math.round(this.triples.length * this.options.changeRate);
+    const changes: IQuadDelta[] = [];
+    for (let i = 0; i < count; i++) {
+      // Deleted triples are swapped with the last triple, so that they can be removed in constant time
+      const index = this.random.nextInt(this.triples.length);
+      const deleted = this.triples[index];
+      this.triples[index] = this.triples[this.triples.length - 1];
+      this.triples.pop();
+      this.keys.delete(`${deleted.subject.value} ${deleted.predicate.value} ${deleted.object.value}`);
+      changes.push(quadDelta(DF.quad(deleted.subject, deleted.predicate, deleted.object), false));
+    }
+    for (let i = 0; i < count; i++) {
+      changes.push(quadDelta(this.addTriple(), true));
+    }
+    return changes;
+  }
+
+  private addTriple(): RDF.Quad {
+    for (;;) {
+      const subject = DF.namedNode(`${PREFIX}s${this.random.nextInt(this.subjects)}`);
+      const predicate = this.random.next() < COMMON_PREDICATE_SHARE ?
+        DF.namedNode(`${PREFIX}c${this.random.nextInt(COMMON_PREDICATES)}`) :
+        DF.namedNode(`${PREFIX}p${this.random.nextInt(RARE_PREDICATES)}`);
+      const objectId = this.random.nextInt(this.objects);
+      const object = this.random.next() < LITERAL_SHARE ?
+        DF.literal(`value ${objectId}`) :
+        DF.namedNode(`${PREFIX}o${objectId}`);
+      const key = `${subject.value} ${predicate.value} ${object.value}`;
+      if (!this.keys.has(key)) {
+        this.keys.add(key);
+        const triple = DF.quad(subject, predicate, object);
+        this.triples.push(triple);
+        return triple;
+      }
+    }
+  }
+}
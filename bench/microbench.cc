@@ -0,0 +1,403 @@
+// Microbenchmarks of the native costs of the bindings that do not depend on storage or on V8:
+// literal conversion, dictionary decoding, copying query results to the heap, and encoding appended triples.
+// Run with: ostrich-microbench [--option value]..., which writes a JSON report to stdout.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <HDTManager.hpp>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "BulkLoader.h"
+#include "ExternalSorter.h"
+#include "LiteralsUtils.h"
+#include "PatchElementStream.h"
+#include "TermCache.h"
+
+// The shape of the generated data, and how often every benchmark is repeated
+struct Options {
+    // The number of triples in the snapshot
+    size_t triples = 100000;
+    // The average number of triples per subject
+    size_t triples_per_subject = 4;
+    // The number of distinct objects, relative to the number of triples
+    double distinct_objects = 0.5;
+    // The approximate length of IRIs in characters
+    size_t term_length = 40;
+    // The share of objects that are literals, and the shares of those literals with a datatype or language
+    double literals = 0.2;
+    double datatypes = 0.5;
+    double languages = 0.25;
+    // The fraction of triples that is deleted and replaced by new triples in an append
+    double change_rate = 0.05;
+    // The number of versions of every triple in version query results
+    size_t versions = 10;
+    // The capacity of the term cache, where 0 disables caching
+    size_t cache_size = TERM_CACHE_DEFAULT_CAPACITY;
+    size_t iterations = 10;
+    size_t warmup = 2;
+    unsigned seed = 42;
+};
+
+// The measurements of a single benchmark
+struct Result {
+    std::string name;
+    // The number of operations per iteration, such as the number of converted literals
+    size_t operations;
+    std::vector<double> durations;
+};
+
+// Accumulates a value of every operation, so that the compiler can not remove the measured work
+static size_t sink = 0;
+
+static void PrintUsage() {
+    std::cerr << "Usage: ostrich-microbench [--option value]..." << std::endl
+              << "  --triples             The number of triples in the snapshot" << std::endl
+              << "  --triplesPerSubject   The average number of triples per subject" << std::endl
+              << "  --distinctObjects     The number of distinct objects, relative to the number of triples" << std::endl
+              << "  --termLength          The approximate length of IRIs in characters" << std::endl
+              << "  --literals            The share of objects that are literals" << std::endl
+              << "  --datatypes           The share of literals with a datatype" << std::endl
+              << "  --languages           The share of literals with a language" << std::endl
+              << "  --changeRate          The fraction of triples that changes in an append" << std::endl
+              << "  --versions            The number of versions of every triple in version query results" << std::endl
+              << "  --cacheSize           The capacity of the term cache, where 0 disables caching" << std::endl
+              << "  --iterations          The number of measured executions of every benchmark" << std::endl
+              << "  --warmup              The number of unmeasured executions of every benchmark" << std::endl
+              << "  --seed                The seed of the generated data" << std::endl;
+}
+
+static Options ParseOptions(int argc, char **argv) {
+    Options options;
+    std::map<std::string, std::function<void(const std::string &)>> setters = {
+            {"--triples",           [&](const std::string &value) { options.triples = std::stoul(value); }},
+            {"--triplesPerSubject", [&](const std::string &value) { options.triples_per_subject = std::stoul(value); }},
+            {"--distinctObjects",   [&](const std::string &value) { options.distinct_objects = std::stod(value); }},
+            {"--termLength",        [&](const std::string &value) { options.term_length = std::stoul(value); }},
+            {"--literals",          [&](const std::string &value) { options.literals = std::stod(value); }},
+            {"--datatypes",         [&](const std::string &value) { options.datatypes = std::stod(value); }},
+            {"--languages",         [&](const std::string &value) { options.languages = std::stod(value); }},
+            {"--changeRate",        [&](const std::string &value) { options.change_rate = std::stod(value); }},
+            {"--versions",          [&](const std::string &value) { options.versions = std::stoul(value); }},
+            {"--cacheSize",         [&](const std::string &value) { options.cache_size = std::stoul(value); }},
+            {"--iterations",        [&](const std::string &value) { options.iterations = std::stoul(value); }},
+            {"--warmup",            [&](const std::string &value) { options.warmup = std::stoul(value); }},
+            {"--seed",              [&](const std::string &value) { options.seed = std::stoul(value); }},
+    };
+    for (int i = 1; i < argc; i++) {
+        std::string name = argv[i];
+        auto setter = setters.find(name);
+        if (setter == setters.end() || i + 1 >= argc) {
+            throw std::invalid_argument("Unknown option or missing value: " + name);
+        }
+        setter->second(argv[++i]);
+    }
+    if (options.triples == 0 || options.triples_per_subject == 0 || options.iterations == 0) {
+        throw std::invalid_argument("The number of triples, triples per subject and iterations must be positive");
+    }
+    return options;
+}
+
+// Generates triples of which the terms are in their JavaScript representation, as they are received by the bindings
+class TripleGenerator {
+public:
+    explicit TripleGenerator(const Options &options) : options(options), random(options.seed) {
+        // Pad the namespace so that IRIs have about the configured length
+        const std::string base = "http://example.org/";
+        prefix = base + std::string(options.term_length > base.length() + 8 ? options.term_length - base.length() - 8 : 0, 'a') + "/";
+        subjects = std::max<size_t>(1, options.triples / options.triples_per_subject);
+        objects = std::max<size_t>(1, (size_t) ((double) options.triples * options.distinct_objects));
+    }
+
+    AppendTriple next(bool addition) {
+        AppendTriple triple;
+        triple.subject = prefix + "s" + std::to_string(uniform(subjects));
+        // Predicates follow a skewed distribution, as a few predicates occur in most datasets
+        triple.predicate = prefix + "p" + std::to_string(chance(0.4) ? uniform(3) : 3 + uniform(100));
+        triple.object = chance(options.literals) ? literal(uniform(objects)) : prefix + "o" + std::to_string(uniform(objects));
+        triple.addition = addition;
+        return triple;
+    }
+
+    // A literal in the JavaScript representation, such as "value"^^http://example.org/datatype
+    std::string literal(size_t id) {
+        std::string value = "\"value " + std::to_string(id) + "\"";
+        double kind = unit(random);
+        if (kind < options.datatypes) {
+            return value + "^^http://www.w3.org/2001/XMLSchema#string";
+        }
+        if (kind < options.datatypes + options.languages) {
+            return value + "@en";
+        }
+        return value;
+    }
+
+private:
+    const Options &options;
+    std::mt19937_64 random;
+    std::uniform_real_distribution<double> unit{0, 1};
+    std::string prefix;
+    size_t subjects;
+    size_t objects;
+
+    size_t uniform(size_t max) { return std::uniform_int_distribution<size_t>(0, max - 1)(random); }
+    bool chance(double share) { return unit(random) < share; }
+};
+
+// Executes the benchmark for the configured number of iterations, after warming up
+static Result Measure(const Options &options, const std::string &name, size_t operations, const std::function<void()> &run) {
+    Result result{name, operations, {}};
+    for (size_t i = 0; i < options.warmup; i++) {
+        run();
+    }
+    for (size_t i = 0; i < options.iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        result.durations.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::cerr << "  " << name << std::endl;
+    return result;
+}
+
+// Converts literals between their JavaScript and HDT representation, as patterns and results are.
+// Both conversions work in-place, so the copy of each literal is measured separately.
+static void BenchmarkLiterals(const Options &options, TripleGenerator &generator, std::vector<Result> &results) {
+    std::vector<std::string> literals;
+    for (size_t i = 0; i < options.triples; i++) {
+        literals.push_back(generator.literal(i));
+    }
+    std::vector<std::string> hdt_literals = literals;
+    for (auto &literal : hdt_literals) {
+        toHdtLiteral(literal);
+    }
+
+    results.push_back(Measure(options, "literal.copy", literals.size(), [&]() {
+        for (auto &literal : literals) {
+            std::string copy = literal;
+            sink += copy.size();
+        }
+    }));
+    results.push_back(Measure(options, "literal.toHdt", literals.size(), [&]() {
+        for (auto &literal : literals) {
+            std::string copy = literal;
+            sink += toHdtLiteral(copy).size();
+        }
+    }));
+    results.push_back(Measure(options, "literal.fromHdt", hdt_literals.size(), [&]() {
+        for (auto &literal : hdt_literals) {
+            std::string copy = literal;
+            sink += fromHdtLiteral(copy).size();
+        }
+    }));
+}
+
+// Decodes the terms of every triple, as the workers do before marshalling results
+static void BenchmarkDecoding(const Options &options, DictionaryManager &dict, const std::vector<Triple> &triples,
+                              std::vector<Result> &results) {
+    auto decode = [&](TermCache &cache) {
+        for (auto &triple : triples) {
+            sink += cache.get(dict, triple.get_subject(), hdt::SUBJECT).size();
+            sink += cache.get(dict, triple.get_predicate(), hdt::PREDICATE).size();
+            sink += cache.get(dict, triple.get_object(), hdt::OBJECT).size();
+        }
+    };
+    TermCache uncached(0);
+    results.push_back(Measure(options, "decode.uncached", triples.size(), [&]() { decode(uncached); }));
+    // The cache is shared by all queries of a store, so it is not cleared between iterations
+    TermCache cached(options.cache_size);
+    results.push_back(Measure(options, "decode.cached", triples.size(), [&]() { decode(cached); }));
+}
+
+// Copies and frees query results in the same way as the workers of the buffered bindings,
+// which copy every result to the heap while iterating, and free it after marshalling
+static void BenchmarkCopying(const Options &options, const std::shared_ptr<DictionaryManager> &dict, const std::vector<Triple> &triples,
+                             std::vector<Result> &results) {
+    std::vector<TripleDelta *> deltas;
+    deltas.reserve(triples.size());
+    results.push_back(Measure(options, "copy.tripleDelta", triples.size(), [&]() {
+        for (auto &triple : triples) {
+            deltas.push_back(new TripleDelta(new Triple(triple), true, dict));
+        }
+        for (auto &delta : deltas) {
+            sink += delta->get_triple()->get_subject();
+            delete delta;
+        }
+        deltas.clear();
+    }));
+
+    std::vector<int> versions;
+    for (size_t version = 0; version < options.versions; version++) {
+        versions.push_back((int) version);
+    }
+    std::vector<TripleVersions *> triple_versions;
+    triple_versions.reserve(triples.size());
+    results.push_back(Measure(options, "copy.tripleVersions", triples.size(), [&]() {
+        for (auto &triple : triples) {
+            triple_versions.push_back(new TripleVersions(new Triple(triple), new std::vector<int>(versions), dict));
+        }
+        // The version query worker only frees the triple and versions of every result
+        for (auto &t : triple_versions) {
+            sink += t->get_versions()->size();
+            delete t->get_triple();
+            delete t->get_versions();
+        }
+        triple_versions.clear();
+    }));
+}
+
+// Sorts and encodes the triples of an append, as the append worker does after reading them from JavaScript.
+// Encoding an appended triple inserts its new terms into the dictionary, so only the first encoding inserts terms.
+static void BenchmarkAppend(const Options &options, const std::shared_ptr<DictionaryManager> &dict,
+                            const std::vector<AppendTriple> &changes, std::vector<Result> &results) {
+    results.push_back(Measure(options, "append.sort", changes.size(), [&]() {
+        std::vector<AppendTriple> sorted = changes;
+        std::sort(sorted.begin(), sorted.end(), ExternalSorter::less);
+        sink += sorted.size();
+    }));
+
+    std::vector<AppendTriple> sorted = changes;
+    std::sort(sorted.begin(), sorted.end(), ExternalSorter::less);
+    auto encode = [&]() {
+        AppendTriplePatchElementIterator it(sorted, dict);
+        PatchElement element(Triple(0, 0, 0), false);
+        while (it.next(&element)) {
+            sink += element.get_triple().get_object();
+        }
+    };
+    Options once = options;
+    once.warmup = 0;
+    once.iterations = 1;
+    results.push_back(Measure(once, "append.encodeNewTerms", sorted.size(), encode));
+    results.push_back(Measure(options, "append.encode", sorted.size(), encode));
+}
+
+static void WriteReport(const Options &options, const std::vector<Result> &results) {
+    std::ostringstream report;
+    report << "{" << std::endl
+           << "  \"options\": {"
+           << "\"triples\": " << options.triples
+           << ", \"triplesPerSubject\": " << options.triples_per_subject
+           << ", \"distinctObjects\": " << options.distinct_objects
+           << ", \"termLength\": " << options.term_length
+           << ", \"literals\": " << options.literals
+           << ", \"datatypes\": " << options.datatypes
+           << ", \"languages\": " << options.languages
+           << ", \"changeRate\": " << options.change_rate
+           << ", \"versions\": " << options.versions
+           << ", \"cacheSize\": " << options.cache_size
+           << ", \"iterations\": " << options.iterations
+           << ", \"warmup\": " << options.warmup
+           << ", \"seed\": " << options.seed << "}," << std::endl
+           << "  \"results\": [" << std::endl;
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+        // Report the time per operation, of which the minimum is least affected by other processes
+        std::vector<double> per_operation;
+        for (double duration : result.durations) {
+            per_operation.push_back(duration / (double) std::max<size_t>(1, result.operations));
+        }
+        std::sort(per_operation.begin(), per_operation.end());
+        double sum = 0;
+        for (double duration : per_operation) {
+            sum += duration;
+        }
+        double mean = sum / (double) per_operation.size();
+        report << "    {\"name\": \"" << result.name << "\""
+               << ", \"operations\": " << result.operations
+               << ", \"nsPerOperation\": {\"mean\": " << mean
+               << ", \"min\": " << per_operation.front()
+               << ", \"p50\": " << per_operation[(per_operation.size() - 1) / 2]
+               << ", \"max\": " << per_operation.back() << "}"
+               << ", \"operationsPerSecond\": " << (mean > 0 ? 1e9 / mean : 0) << "}"
+               << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    report << "  ]" << std::endl << "}" << std::endl;
+    std::cout << report.str();
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const std::exception &error) {
+        std::cerr << error.what() << std::endl;
+        PrintUsage();
+        return 1;
+    }
+
+    // The dictionary of a store can only be created through a snapshot, so a temporary store is created
+    std::string path = (std::filesystem::temp_directory_path() / "ostrich-microbench-XXXXXX").string();
+    if (mkdtemp(path.data()) == nullptr) {
+        std::cerr << "Could not create a temporary directory" << std::endl;
+        return 1;
+    }
+    path += "/";
+    Controller *controller = nullptr;
+    int status = 0;
+    try {
+        TripleGenerator generator(options);
+        std::vector<Result> results;
+
+        std::cerr << "Generating a snapshot of " << options.triples << " triples in " << path << std::endl;
+        auto elements_snapshot = std::make_unique<std::vector<hdt::TripleString>>();
+        std::vector<AppendTriple> snapshot;
+        for (size_t i = 0; i < options.triples; i++) {
+            AppendTriple triple = generator.next(true);
+            // Snapshots store literals in their HDT representation
+            std::string object = triple.object;
+            elements_snapshot->push_back(hdt::TripleString(triple.subject, triple.predicate, toHdtLiteral(object)));
+            snapshot.push_back(std::move(triple));
+        }
+        controller = new Controller(path, SnapshotCreationStrategy::get_composite_strategy("never", "0"),
+                                    kyotocabinet::HashDB::TCOMPRESS, false);
+        IteratorTripleStringVector it_snapshot(elements_snapshot.get());
+        std::cout.setstate(std::ios_base::failbit); // Disable cout info from HDT
+        controller->get_snapshot_manager()->create_snapshot(0, &it_snapshot, "<http://example.org>");
+        std::cout.clear();
+        std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(0);
+
+        // Encode the snapshot triples, which only looks up their ids
+        std::vector<Triple> triples;
+        triples.reserve(elements_snapshot->size());
+        for (auto &triple : *elements_snapshot) {
+            triples.emplace_back(triple.getSubject(), triple.getPredicate(), triple.getObject(), dict);
+        }
+
+        // Changes delete existing triples, and add the same number of new triples
+        std::vector<AppendTriple> changes;
+        size_t change_count = (size_t) ((double) options.triples * options.change_rate);
+        for (size_t i = 0; i < change_count; i++) {
+            AppendTriple deletion = snapshot[(i * 7919) % snapshot.size()];
+            deletion.addition = false;
+            changes.push_back(std::move(deletion));
+            changes.push_back(generator.next(true));
+        }
+
+        std::cerr << "Running benchmarks" << std::endl;
+        BenchmarkLiterals(options, generator, results);
+        BenchmarkDecoding(options, *dict, triples, results);
+        BenchmarkCopying(options, dict, triples, results);
+        BenchmarkAppend(options, dict, changes, results);
+        WriteReport(options, results);
+        std::cerr << "Checksum " << sink << std::endl;
+    } catch (const std::exception &error) {
+        std::cerr << error.what() << std::endl;
+        status = 1;
+    }
+    if (controller != nullptr) {
+        Controller::cleanup(path, controller);
+    }
+    std::filesystem::remove_all(path);
+    return status;
+}
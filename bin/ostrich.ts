@@ -1,12 +1,18 @@
+import * as fs from 'fs';
+import * as os from 'os';
+import * as Path from 'path';
 import type * as RDF from '@rdfjs/types';
 import rdfSerializer from 'rdf-serialize';
 import { stringToTerm } from 'rdf-string';
 import { quadToStringQuad as quadToStringQuadTtl } from 'rdf-string-ttl';
 import * as yargs from 'yargs';
 import { hideBin } from 'yargs/helpers';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
 import type { OstrichStore } from '../lib/OstrichStore';
 import { fromPath } from '../lib/OstrichStore';
-const streamifyArray = require('streamify-array');
+
+// The number of triples that are fetched at once while streaming results
+const STREAM_BUFFER_SIZE = 1024;
 
 (async function() {
   const contentTypes = await rdfSerializer.getContentTypes();
@@ -49,20 +55,42 @@ const streamifyArray = require('streamify-array');
           default: 'text/turtle',
         },
       }), async args => {
-      await queryContext(args.archive, args.query, args.format, async(store, subject, predicate, object) => {
-        const { triples, cardinality, exactCardinality } = await store.searchTriplesVersionMaterialized(
-          subject,
-          predicate,
-          object,
-          { offset: args.offset, limit: args.limit, version: args.version },
+      if (args.format === 'application/n-triples') {
+        // N-Triples are serialized natively, and written directly to stdout
+        await queryContext(args.archive, args.query, args.format, async(store, subject, predicate, object) => {
+          const { cardinality, exactCardinality } = await store
+            .countTriplesVersionMaterialized(subject, predicate, object, args.version);
+          process.stdout.write(`# Total matches: ${cardinality}${exactCardinality ? '' : ' (estimated)'}\n`);
+          await store.exportTriplesVersionMaterialized(
+            subject,
+            predicate,
+            object,
+            process.stdout.fd,
+            { offset: args.offset, limit: args.limit, version: args.version },
+          );
+        });
+        return;
+      }
+      const { subject, predicate, object } = parsePattern(args.query);
+      // Results are streamed from a buffered store, so large versions are never materialized in memory
+      const store = await fromPathBuffered(args.archive, STREAM_BUFFER_SIZE, { readOnly: true });
+      const { cardinality, exactCardinality } = await store
+        .countTriplesVersionMaterialized(subject, predicate, object, args.version);
+      process.stdout.write(`# Total matches: ${cardinality}${exactCardinality ? '' : ' (estimated)'}\n`);
+      await new Promise<void>((resolve, reject) => {
+        const output = rdfSerializer.serialize(
+          store.streamTriplesVersionMaterialized(
+            subject,
+            predicate,
+            object,
+            { offset: args.offset, limit: args.limit, version: args.version },
+          ),
+          { contentType: args.format },
         );
-        process.stdout.write(`# Total matches: ${cardinality}${exactCardinality ? '' : ' (estimated)'}\n`);
-        await new Promise<void>((resolve, reject) => rdfSerializer
-          .serialize(streamifyArray(triples), { contentType: args.format })
-          .pipe(process.stdout)
-          .on('error', reject)
-          .on('end', resolve));
+        output.pipe(process.stdout);
+        output.on('error', reject).on('end', resolve);
       });
+      await store.close();
     })
     .command('dm [archive] [query]', 'Query delta materialized', yrgs => yrgs
       .options({
@@ -80,17 +108,17 @@ const streamifyArray = require('streamify-array');
         },
       }), async args => {
       await queryContext(args.archive, args.query, args.format, async(store, subject, predicate, object) => {
-        const { triples, cardinality, exactCardinality } = await store.searchTriplesDeltaMaterialized(
+        const { cardinality, exactCardinality } = await store
+          .countTriplesDeltaMaterialized(subject, predicate, object, args.versionStart, args.versionEnd);
+        process.stdout.write(`# Total matches: ${cardinality}${exactCardinality ? '' : ' (estimated)'}\n`);
+        // Changes are serialized natively as '+ ' or '- ' prefixed N-Triples, and written directly to stdout
+        await store.exportTriplesDeltaMaterialized(
           subject,
           predicate,
           object,
+          process.stdout.fd,
           { offset: args.offset, limit: args.limit, versionStart: args.versionStart, versionEnd: args.versionEnd },
         );
-        process.stdout.write(`# Total matches: ${cardinality}${exactCardinality ? '' : ' (estimated)'}\n`);
-        for (const triple of triples) {
-          const stringTriple = quadToStringQuadTtl(triple);
-          console.log(`${triple.addition ? '+ ' : '- '} ${stringTriple.subject} ${stringTriple.predicate} ${stringTriple.object}`);
-        }
       });
     })
     .command('v [archive] [query]', 'Query version', yrgs => yrgs, async args => {
@@ -117,12 +145,46 @@ const streamifyArray = require('streamify-array');
   Triples in last version: ${(await store.countTriplesVersionMaterialized(null, null, null)).cardinality}`);
       });
     })
+    .command('ingest <archive> <dumps>', 'Append a directory of version dumps to an archive', yrgs => yrgs
+      .positional('dumps', {
+        describe: 'A directory of N-Triples or N-Quads files, of which the numbers in their names are the versions',
+        type: 'string',
+        demandOption: true,
+      })
+      .options({
+        threads: {
+          alias: 't',
+          type: 'number',
+          describe: 'The number of threads that parse a single file',
+          default: os.cpus().length,
+        },
+      }), async args => {
+      const paths = listVersionDumps(args.dumps);
+      const store = await fromPath(args.archive, { readOnly: false });
+      const start = process.hrtime();
+      let totalTriples = 0;
+      await store.ingest(paths, {
+        threads: args.threads,
+        onProgress(progress) {
+          totalTriples += progress.tripleCount;
+          const changes = progress.additionCount + progress.deletionCount;
+          console.log(`Version ${progress.version}: ${progress.tripleCount} triples (+${progress.additionCount} -${progress.deletionCount}), parsed in ${progress.parseSeconds.toFixed(2)}s, appended in ${progress.appendSeconds.toFixed(2)}s (${Math.round(changes / Math.max(progress.appendSeconds, 0.001))} changes/s)`);
+        },
+      });
+      const [ seconds, nanoseconds ] = process.hrtime(start);
+      const duration = seconds + nanoseconds / 1e9;
+      console.log(`Ingested ${paths.length} versions in ${duration.toFixed(2)}s (${Math.round(totalTriples / Math.max(duration, 0.001))} triples/s)`);
+      await store.close();
+    })
     .strict()
     .demandCommand()
     .version(false)
     .example(`$0 vm archive.ostrich '?s <ex:p> ?o'`, '')
     .example(`$0 vm archive.ostrich '?s ?p ?o' -v 10 -o 5 -l 10 -f turtle`, '')
     .example(`$0 vm archive.ostrich '?s ?p ?o' --version 10 -offset 5 --limit 10`, '')
+    .example(`$0 vm archive.ostrich '?s ?p ?o' -f application/n-triples > version.nt`, '')
+    .example(`$0 dm archive.ostrich '?s ?p ?o' -s 0 -e 10`, '')
+    .example(`$0 ingest archive.ostrich dumps/ --threads 4`, '')
     .help()
     .parse();
 })()
@@ -147,13 +209,44 @@ async function queryContext(
   ) => Promise<void>,
 ): Promise<void> {
   // Parse query
-  const parts = /^\s*<?([^\s>]*)>?\s*<?([^\s>]*)>?\s*<?([^]*?)>?\s*$/u.exec(query);
-  const subject = parts && !parts[1].startsWith('?') && stringToTerm(parts[1]) || null;
-  const predicate = parts && !parts[2].startsWith('?') && stringToTerm(parts[2]) || null;
-  const object = parts && !parts[3].startsWith('?') && stringToTerm(parts[3]) || null;
+  const { subject, predicate, object } = parsePattern(query);
 
   // Load Ostrich
   const store = await fromPath(archive);
   await queryCb(store, subject, predicate, object);
   await store.close();
 }
+
+/**
+ * Parse a triple pattern query, in which variables and missing terms are wildcards.
+ * @param query A triple pattern query.
+ */
+function parsePattern(query: string): {
+  subject: RDF.Term | null;
+  predicate: RDF.Term | null;
+  object: RDF.Term | null;
+} {
+  const parts = /^\s*<?([^\s>]*)>?\s*<?([^\s>]*)>?\s*<?([^]*?)>?\s*$/u.exec(query);
+  return {
+    subject: parts && !parts[1].startsWith('?') && stringToTerm(parts[1]) || null,
+    predicate: parts && !parts[2].startsWith('?') && stringToTerm(parts[2]) || null,
+    object: parts && !parts[3].startsWith('?') && stringToTerm(parts[3]) || null,
+  };
+}
+
+/**
+ * List the files in the given directory, ordered by the first number in their names.
+ * @param directory A directory of version dumps.
+ */
+function listVersionDumps(directory: string): string[] {
+  // eslint-disable-next-line no-sync
+  const entries = fs.readdirSync(directory)
+    .map(name => ({ name, version: Number.parseInt((/\d+/u.exec(name) || [ '' ])[0], 10) }));
+  const invalid = entries.find(entry => Number.isNaN(entry.version));
+  if (invalid) {
+    throw new Error(`The version dump '${invalid.name}' does not contain a version number in its name`);
+  }
+  return entries
+    .sort((left, right) => left.version - right.version)
+    .map(entry => Path.join(directory, entry.name));
+}
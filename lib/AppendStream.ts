@@ -0,0 +1,79 @@
+import { Writable } from 'stream';
+import { quadToStringQuad } from 'rdf-string';
+import type { IAppendStreamProcessor } from './IOstrichStoreNative';
+import type { IQuadDelta, IStringQuadDelta } from './utils';
+
+/**
+ * A writable stream of triples, annotated with addition: true or false, that are appended as a single version.
+ * Triples are passed to OSTRICH in chunks while the append is running,
+ * and writing is paused while OSTRICH has not caught up yet.
+ *
+ * The number of inserted triples is available once the stream has emitted 'finish'.
+ */
+export class AppendStream extends Writable {
+  public insertedCount?: number;
+
+  protected readonly processor: IAppendStreamProcessor;
+  private chunk: IStringQuadDelta[] = [];
+  private ended = false;
+  private result?: { error?: Error; insertedCount?: number };
+  private onResult?: () => void;
+
+  /**
+   * @param startAppend Starts the native append, of which the callback is invoked once it has finished.
+   * @param chunkSize The number of triples per chunk.
+   */
+  public constructor(
+    startAppend: (onAppended: (error: Error | undefined, insertedCount: number) => void) => IAppendStreamProcessor,
+    public readonly chunkSize: number,
+  ) {
+    super({ objectMode: true });
+    this.processor = startAppend((error, insertedCount) => {
+      this.result = { error, insertedCount };
+      if (this.onResult) {
+        this.onResult();
+      }
+    });
+  }
+
+  public _write(triple: IQuadDelta, encoding: string, callback: (error?: Error | null) => void): void {
+    this.chunk.push({ addition: triple.addition, ...quadToStringQuad(triple) });
+    if (this.chunk.length >= this.chunkSize) {
+      return this.flush(callback);
+    }
+    callback();
+  }
+
+  public _final(callback: (error?: Error | null) => void): void {
+    this.flush(error => {
+      if (error) {
+        return callback(error);
+      }
+      this.ended = true;
+      this.processor._end();
+      this.onResult = () => {
+        this.insertedCount = this.result!.insertedCount;
+        callback(this.result!.error);
+      };
+      if (this.result) {
+        this.onResult();
+      }
+    });
+  }
+
+  public _destroy(error: Error | null, callback: (error?: Error | null) => void): void {
+    if (!this.ended) {
+      this.processor._abort(error ? error.message : 'The append stream was destroyed before it ended');
+    }
+    callback(error);
+  }
+
+  protected flush(callback: (error?: Error | null) => void): void {
+    if (this.chunk.length === 0) {
+      return callback();
+    }
+    const chunk = this.chunk;
+    this.chunk = [];
+    this.processor._push(chunk, callback);
+  }
+}
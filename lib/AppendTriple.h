@@ -0,0 +1,14 @@
+#ifndef OSTRICH_APPENDTRIPLE_H
+#define OSTRICH_APPENDTRIPLE_H
+
+#include <string>
+
+// A triple to append, annotated with whether it is an addition or a deletion
+struct AppendTriple {
+    std::string subject;
+    std::string predicate;
+    std::string object;
+    bool addition;
+};
+
+#endif //OSTRICH_APPENDTRIPLE_H
@@ -0,0 +1,62 @@
+import type * as RDF from '@rdfjs/types';
+import type { TripleBatch } from './TripleBatch';
+
+/**
+ * The type of a query in a batch.
+ * This corresponds to BatchQueryType in OstrichStore.cc
+ */
+export enum BatchQueryType {
+  SearchVersionMaterialized = 0,
+  SearchDeltaMaterialized = 1,
+  SearchVersion = 2,
+  CountVersionMaterialized = 3,
+  CountDeltaMaterialized = 4,
+  CountVersion = 5,
+}
+
+/**
+ * A single query within a batch.
+ * Depending on the type, version applies to version materialized queries,
+ * versionStart and versionEnd apply to delta materialized queries,
+ * and offset and limit apply to search queries.
+ */
+export interface IBatchQuery {
+  type: BatchQueryType;
+  subject?: RDF.Term | null;
+  predicate?: RDF.Term | null;
+  object?: RDF.Term | null;
+  offset?: number;
+  limit?: number;
+  version?: number;
+  versionStart?: number;
+  versionEnd?: number;
+}
+
+/**
+ * The result of a single query within a batch.
+ * Count queries do not have triples.
+ */
+export interface IBatchQueryResult {
+  triples?: TripleBatch;
+  cardinality: number;
+  exactCardinality: boolean;
+  /**
+   * If the search was stopped before it was done, because the batch was cancelled.
+   */
+  truncated: boolean;
+}
+
+/**
+ * A single query within a batch as it is passed to the native store.
+ */
+export interface IBatchQueryNative {
+  type: BatchQueryType;
+  subject: string | null;
+  predicate: string | null;
+  object: string | null;
+  offset: number;
+  limit: number;
+  version: number;
+  versionStart: number;
+  versionEnd: number;
+}
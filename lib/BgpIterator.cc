@@ -0,0 +1,181 @@
+#include "BgpIterator.h"
+#include "LiteralsUtils.h"
+
+#include <algorithm>
+#include <limits>
+
+BgpIterator::BgpIterator(Controller *controller, std::vector<JoinPattern> patterns, int version,
+                         std::shared_ptr<TermCache> cache)
+        : controller(controller), patterns(std::move(patterns)),
+          version(version >= 0 ? version : controller->get_max_patch_id()),
+          dict(controller->get_dictionary_manager(this->version)), cache(std::move(cache)),
+          planned(false), done(false) {}
+
+bool BgpIterator::next(JoinBinding *binding) {
+    if (done) {
+        return false;
+    }
+    if (!planned) {
+        plan();
+        // A basic graph pattern without patterns has a single empty binding
+        if (patterns.empty()) {
+            done = true;
+            binding->clear();
+            return true;
+        }
+        if (!open(0)) {
+            done = true;
+            return false;
+        }
+    }
+
+    Triple t;
+    while (!iterators.empty()) {
+        size_t depth = iterators.size() - 1;
+        if (!iterators[depth]->next(&t)) {
+            iterators.pop_back();
+            bindings.pop_back();
+            continue;
+        }
+        IdBinding id_binding = bindings[depth];
+        if (!bind(patterns[depth], t, id_binding)) {
+            continue;
+        }
+        if (depth + 1 < patterns.size()) {
+            bindings.push_back(std::move(id_binding));
+            if (!open(depth + 1)) {
+                bindings.pop_back();
+            }
+            continue;
+        }
+
+        // Only the final bindings are decoded
+        binding->clear();
+        for (auto &entry : id_binding) {
+            binding->emplace_back(entry.first, decode(entry.second));
+        }
+        return true;
+    }
+    done = true;
+    return false;
+}
+
+// Orders the patterns by their estimated number of matches
+void BgpIterator::plan() {
+    planned = true;
+    std::vector<size_t> counts;
+    for (auto &pattern : patterns) {
+        std::string subject, predicate, object;
+        if (!substitute(pattern.subject, {}, false, subject) || !substitute(pattern.predicate, {}, false, predicate)) {
+            counts.push_back(0);
+            continue;
+        }
+        substitute(pattern.object, {}, true, object);
+        counts.push_back(controller->get_version_materialized_count(
+                StringTriple(subject, predicate, toHdtLiteral(object)), version, true).first);
+    }
+
+    // Greedily pick the pattern with the fewest matches, but avoid cartesian products where possible
+    std::vector<JoinPattern> ordered;
+    std::vector<std::string> variables;
+    std::vector<bool> used(patterns.size(), false);
+    auto is_connected = [&variables](const JoinPattern &pattern) {
+        for (const std::string *component : {&pattern.subject, &pattern.predicate, &pattern.object}) {
+            if (!component->empty() && (*component)[0] == '?'
+                && std::find(variables.begin(), variables.end(), *component) != variables.end()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    while (ordered.size() < patterns.size()) {
+        size_t best = 0;
+        bool best_connected = false;
+        size_t best_count = std::numeric_limits<size_t>::max();
+        bool found = false;
+        for (size_t i = 0; i < patterns.size(); i++) {
+            if (used[i]) {
+                continue;
+            }
+            bool connected = ordered.empty() || is_connected(patterns[i]);
+            if (!found || (connected && !best_connected) || (connected == best_connected && counts[i] < best_count)) {
+                best = i;
+                best_connected = connected;
+                best_count = counts[i];
+                found = true;
+            }
+        }
+        used[best] = true;
+        for (const std::string *component : {&patterns[best].subject, &patterns[best].predicate, &patterns[best].object}) {
+            if (!component->empty() && (*component)[0] == '?') {
+                variables.push_back(*component);
+            }
+        }
+        ordered.push_back(patterns[best]);
+    }
+    patterns = std::move(ordered);
+    bindings.emplace_back();
+}
+
+// Starts iterating over the pattern at the given depth, bound by the binding at that depth.
+// Returns false if the pattern can not have any matches.
+bool BgpIterator::open(size_t depth) {
+    const JoinPattern &pattern = patterns[depth];
+    const IdBinding &binding = bindings[depth];
+    std::string subject, predicate, object;
+    // Literals only occur as objects, so there are no matches if a literal is bound elsewhere
+    if (!substitute(pattern.subject, binding, false, subject) || !substitute(pattern.predicate, binding, false, predicate)) {
+        return false;
+    }
+    substitute(pattern.object, binding, true, object);
+    iterators.emplace_back(controller->get_version_materialized(StringTriple(subject, predicate, toHdtLiteral(object)),
+                                                                0, version));
+    return true;
+}
+
+// Adds the variables of the pattern to the binding, returns false if the triple conflicts with the binding
+bool BgpIterator::bind(const JoinPattern &pattern, const Triple &triple, IdBinding &binding) {
+    return bind_term(pattern.subject, triple.get_subject(), hdt::SUBJECT, binding)
+           && bind_term(pattern.predicate, triple.get_predicate(), hdt::PREDICATE, binding)
+           && bind_term(pattern.object, triple.get_object(), hdt::OBJECT, binding);
+}
+
+bool BgpIterator::bind_term(const std::string &component, size_t id, hdt::TripleComponentRole role,
+                            IdBinding &binding) {
+    if (component.empty() || component[0] != '?') {
+        return true;
+    }
+    std::string variable = component.substr(1);
+    for (auto &entry : binding) {
+        if (entry.first == variable) {
+            // Ids can only be compared within the same role
+            if (entry.second.role == role) {
+                return entry.second.id == id;
+            }
+            return decode(entry.second) == cache->get(*dict, id, role);
+        }
+    }
+    binding.emplace_back(variable, BoundTerm{id, role});
+    return true;
+}
+
+// Replaces a variable component by its value in the binding, or by a wildcard if it is unbound.
+// Returns false if the resulting term is a literal while this is not allowed.
+bool BgpIterator::substitute(const std::string &component, const IdBinding &binding, bool allow_literal,
+                             std::string &term) {
+    term = component;
+    if (!component.empty() && component[0] == '?') {
+        term = "";
+        for (auto &entry : binding) {
+            if (entry.first == component.substr(1)) {
+                term = decode(entry.second);
+                break;
+            }
+        }
+    }
+    return allow_literal || term.empty() || term[0] != '"';
+}
+
+std::string BgpIterator::decode(const BoundTerm &term) {
+    return cache->get(*dict, term.id, term.role);
+}
@@ -0,0 +1,54 @@
+#ifndef OSTRICH_BGPITERATOR_H
+#define OSTRICH_BGPITERATOR_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "BindJoin.h"
+#include "TermCache.h"
+
+// Evaluates a basic graph pattern within a single version.
+// Patterns are ordered by their estimated number of matches, preferring patterns that share a variable with
+// the patterns before them, and are then joined in nested loops.
+// Intermediate bindings only hold dictionary ids, so terms are only decoded to bind them in a pattern,
+// and for the resulting bindings.
+class BgpIterator : public BindingIterator {
+public:
+    // A version of -1 refers to the latest version
+    BgpIterator(Controller *controller, std::vector<JoinPattern> patterns, int version,
+                std::shared_ptr<TermCache> cache);
+
+    bool next(JoinBinding *binding) override;
+
+private:
+    // A term that was bound to a variable, identified by its id in the dictionary of the given role
+    struct BoundTerm {
+        size_t id;
+        hdt::TripleComponentRole role;
+    };
+    typedef std::vector<std::pair<std::string, BoundTerm>> IdBinding;
+
+    Controller *controller;
+    std::vector<JoinPattern> patterns;
+    int version;
+    std::shared_ptr<DictionaryManager> dict;
+    std::shared_ptr<TermCache> cache;
+
+    bool planned;
+    bool done;
+    // The iterator for the pattern at each depth, and the binding from all patterns before it
+    std::vector<std::unique_ptr<TripleIterator>> iterators;
+    std::vector<IdBinding> bindings;
+
+    void plan();
+    bool open(size_t depth);
+    bool bind(const JoinPattern &pattern, const Triple &triple, IdBinding &binding);
+    bool bind_term(const std::string &component, size_t id, hdt::TripleComponentRole role, IdBinding &binding);
+    bool substitute(const std::string &component, const IdBinding &binding, bool allow_literal, std::string &term);
+    std::string decode(const BoundTerm &term);
+};
+
+#endif //OSTRICH_BGPITERATOR_H
@@ -0,0 +1,92 @@
+#include "BindJoin.h"
+#include "LiteralsUtils.h"
+
+BindJoinIterator::BindJoinIterator(Controller *controller, JoinPattern left, JoinPattern right, int version,
+                                   std::shared_ptr<TermCache> cache)
+        : controller(controller), left(std::move(left)), right(std::move(right)),
+          version(version >= 0 ? version : controller->get_max_patch_id()),
+          dict(controller->get_dictionary_manager(this->version)), cache(std::move(cache)) {
+    std::string subject, predicate, object;
+    substitute(this->left.subject, false, subject);
+    substitute(this->left.predicate, false, predicate);
+    substitute(this->left.object, true, object);
+    left_it.reset(controller->get_version_materialized(StringTriple(subject, predicate, toHdtLiteral(object)),
+                                                       0, this->version));
+}
+
+bool BindJoinIterator::next(JoinBinding *binding) {
+    Triple t;
+    while (true) {
+        while (right_it && right_it->next(&t)) {
+            *binding = left_binding;
+            if (bind(right, t, *binding)) {
+                return true;
+            }
+        }
+        if (!next_left()) {
+            return false;
+        }
+    }
+}
+
+// Advances to the next left triple of which the bound right pattern can have matches
+bool BindJoinIterator::next_left() {
+    right_it.reset();
+    Triple t;
+    while (left_it->next(&t)) {
+        left_binding.clear();
+        if (!bind(left, t, left_binding)) {
+            continue;
+        }
+
+        // Literals only occur as objects, so there are no matches if a literal is bound elsewhere
+        std::string subject, predicate, object;
+        if (!substitute(right.subject, false, subject) || !substitute(right.predicate, false, predicate)) {
+            continue;
+        }
+        substitute(right.object, true, object);
+        right_it.reset(controller->get_version_materialized(StringTriple(subject, predicate, toHdtLiteral(object)),
+                                                            0, version));
+        return true;
+    }
+    return false;
+}
+
+// Adds the variables of the pattern to the binding, returns false if the triple conflicts with the binding
+bool BindJoinIterator::bind(const JoinPattern &pattern, const Triple &triple, JoinBinding &binding) {
+    return bind_term(pattern.subject, triple.get_subject(), hdt::SUBJECT, binding)
+           && bind_term(pattern.predicate, triple.get_predicate(), hdt::PREDICATE, binding)
+           && bind_term(pattern.object, triple.get_object(), hdt::OBJECT, binding);
+}
+
+bool BindJoinIterator::bind_term(const std::string &component, size_t id, hdt::TripleComponentRole role,
+                                 JoinBinding &binding) {
+    if (component.empty() || component[0] != '?') {
+        return true;
+    }
+    std::string term = cache->get(*dict, id, role);
+    std::string variable = component.substr(1);
+    for (auto &entry : binding) {
+        if (entry.first == variable) {
+            return entry.second == term;
+        }
+    }
+    binding.emplace_back(variable, term);
+    return true;
+}
+
+// Replaces a variable component by its value in the current left binding, or by a wildcard if it is unbound.
+// Returns false if the resulting term is a literal while this is not allowed.
+bool BindJoinIterator::substitute(const std::string &component, bool allow_literal, std::string &term) const {
+    term = component;
+    if (!component.empty() && component[0] == '?') {
+        term = "";
+        for (auto &entry : left_binding) {
+            if (entry.first == component.substr(1)) {
+                term = entry.second;
+                break;
+            }
+        }
+    }
+    return allow_literal || term.empty() || term[0] != '"';
+}
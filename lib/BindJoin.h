@@ -0,0 +1,61 @@
+#ifndef OSTRICH_BINDJOIN_H
+#define OSTRICH_BINDJOIN_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "TermCache.h"
+
+// A triple pattern of which each component is a term, a variable (starting with '?'), or empty for a wildcard.
+// Terms are in their JavaScript representation.
+struct JoinPattern {
+    std::string subject;
+    std::string predicate;
+    std::string object;
+};
+
+// Variable names (without '?') mapped to terms in their JavaScript representation
+typedef std::vector<std::pair<std::string, std::string>> JoinBinding;
+
+// Produces bindings, for example from a join
+class BindingIterator {
+public:
+    virtual ~BindingIterator() = default;
+
+    // Produces the next binding, returns false when there are no more bindings
+    virtual bool next(JoinBinding *binding) = 0;
+};
+
+// A nested-loop join of two triple patterns within a single version.
+// For each triple that matches the left pattern, its variables are bound in the right pattern,
+// after which each triple that matches the bound right pattern results in a binding.
+class BindJoinIterator : public BindingIterator {
+public:
+    // A version of -1 refers to the latest version
+    BindJoinIterator(Controller *controller, JoinPattern left, JoinPattern right, int version,
+                     std::shared_ptr<TermCache> cache);
+
+    bool next(JoinBinding *binding) override;
+
+private:
+    Controller *controller;
+    JoinPattern left;
+    JoinPattern right;
+    int version;
+    std::shared_ptr<DictionaryManager> dict;
+    std::shared_ptr<TermCache> cache;
+
+    std::unique_ptr<TripleIterator> left_it;
+    std::unique_ptr<TripleIterator> right_it;
+    JoinBinding left_binding;
+
+    bool next_left();
+    bool bind(const JoinPattern &pattern, const Triple &triple, JoinBinding &binding);
+    bool bind_term(const std::string &component, size_t id, hdt::TripleComponentRole role, JoinBinding &binding);
+    bool substitute(const std::string &component, bool allow_literal, std::string &term) const;
+};
+
+#endif //OSTRICH_BINDJOIN_H
@@ -1,64 +1,233 @@
 #include "LiteralsUtils.h"
 #include "BufferedOstrichStore.h"
+#include "QueryCancellation.h"
+#include "SharedSnapshots.h"
 
+#include <algorithm>
+#include <cstring>
 #include <utility>
 
 
+// Serializes the state of a query processor, of which the given number of returned results have not been consumed yet
+static std::string SerializeContinuation(ContinuationToken state, const v8::Local<v8::Value> &unconsumed) {
+    if (unconsumed->IsNumber()) {
+        state.position -= std::min(state.position, unconsumed->Uint32Value(Nan::GetCurrentContext()).FromJust());
+    }
+    return state.serialize();
+}
+
+// Creates the trace of a batch of a query processor, with the pattern, position and versions of its query
+static OperationTrace TraceBatch(const std::shared_ptr<QueryTracer> &tracer, const char *operation, const ContinuationToken &state) {
+    OperationTrace trace(tracer, operation);
+    trace.pattern(state.subject, state.predicate, state.object).arg("offset", (int64_t) state.position)
+            .arg("versionStart", (int64_t) state.version_start).arg("versionEnd", (int64_t) state.version_end);
+    return trace;
+}
+
+// Describes a batch of a query processor for the slow query log, with the position of the batch as its offset
+static SlowQuery DescribeBatch(StatsOperation operation, const ContinuationToken &state, int32_t number) {
+    return SlowQuery{operation, state.subject, state.predicate, state.object, (uint32_t) state.position, (uint32_t) number,
+                     operation == STATS_OPERATION_VERSION ? -1 : state.version_start,
+                     operation == STATS_OPERATION_VERSION ? -1 : state.version_end};
+}
+
+// Throws if the store was closed, must be called while holding the read lock of the store
+static Controller *OpenController(BufferedOstrichStore *store) {
+    Controller *controller = store->GetController();
+    if (controller == nullptr) {
+        throw std::runtime_error("Attempted to query a closed OSTRICH store");
+    }
+    return controller;
+}
+
+// Sets a decoded term on a triple object, and returns its number of bytes for the stats of the query
+static size_t SetTerm(const v8::Local<v8::Object> &tripleObject, const v8::Local<v8::String> &key, const std::string &term) {
+    tripleObject->Set(Nan::GetCurrentContext(), key, Nan::New(term).ToLocalChecked());
+    return term.size();
+}
+
+
 class VMNextWorker: public Nan::AsyncWorker {
 private:
-    TripleIterator* it;
+    BufferedOstrichStore *store;
+    VersionMaterializationProcessor *processor;
+    uint32_t *position;
     int32_t number;
-    std::shared_ptr<DictionaryManager> dict;
+    std::shared_ptr<TermCache> cache;
 
-    // Callback return values
-    std::vector<Triple> triples;
+    // Callback return values, of which the terms are decoded while the dictionary can not be modified by appends
+    std::vector<std::string> terms;
     bool done;
+    QueryStopCheck stop;
+    OperationTimer timer;
+    OperationTrace trace;
+    std::shared_ptr<SlowQueryLog> slow_queries;
+    SlowQuery slow_query;
 
 public:
-    VMNextWorker(TripleIterator *iterator, std::shared_ptr<DictionaryManager> dict, int32_t number, Nan::Callback *callback, v8::Local<v8::Object> self)
-            : Nan::AsyncWorker(callback), it(iterator), number(number), dict(std::move(dict)), done(false) {
+    VMNextWorker(BufferedOstrichStore *store, VersionMaterializationProcessor *processor, uint32_t *position, std::shared_ptr<TermCache> cache, int32_t number,
+                 std::shared_ptr<QueryCancellation> cancellation, std::shared_ptr<QueryStats> stats, OperationTrace trace,
+                 std::shared_ptr<SlowQueryLog> slow_queries, SlowQuery slow_query, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), processor(processor), position(position), number(number), cache(std::move(cache)), done(false),
+              stop(std::move(cancellation)), timer(std::move(stats), STATS_OPERATION_VERSION_MATERIALIZED), trace(std::move(trace)),
+              slow_queries(std::move(slow_queries)), slow_query(std::move(slow_query)) {
         SaveToPersistent("self", self);
     }
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto tracing = trace.span("execute");
+        tracing.count("queueWait", (int64_t) trace.since_created());
+        auto lock = store->LockRead();
         try {
+            TripleIterator *it = processor->GetIterator();
+            DictionaryManager &dict = processor->GetDictionary();
             Triple t;
             uint32_t count = 0;
-            while (count < number && it->next(&t)) {
-                triples.push_back(t);
+            // A cancelled query ends the iteration early, as if the iterator were finished
+            auto iterating = trace.span("iterate");
+            auto decoding = trace.accumulate("decode");
+            while (count < number && !stop() && it->next(&t)) {
+                decoding.begin();
+                terms.push_back(cache->get(dict, t.get_subject(), hdt::SUBJECT));
+                terms.push_back(cache->get(dict, t.get_predicate(), hdt::PREDICATE));
+                terms.push_back(cache->get(dict, t.get_object(), hdt::OBJECT));
+                decoding.end();
                 count++;
             }
+            iterating.count("results", count);
+            iterating.end();
             if (count < number) {  // if count < number, it means that the iterator is finished
                 done = true;
             }
+            if (slow_queries->is_slow(executing.elapsed())) {
+                slow_query.results = count;
+                slow_queries->record(std::move(slow_query), timer, executing);
+            }
         } catch (const std::runtime_error &error) {
             SetErrorMessage(error.what());
         }
     }
 
     void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        auto marshalling = trace.span("marshal");
         uint32_t count = 0;
-        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(triples.size());
+        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(terms.size() / 3);
         const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
         const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
         const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
-        for (auto& triple : triples) {
+        uint64_t bytes = 0;
+        for (size_t i = 0; i + 2 < terms.size(); i += 3) {
             v8::Local<v8::Object> tripleObject = Nan::New<v8::Object>();
-            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(triple.get_subject(*dict).c_str()).ToLocalChecked());
-            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(triple.get_predicate(*dict).c_str()).ToLocalChecked());
-            std::string object = triple.get_object(*dict);
-            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(fromHdtLiteral(object).c_str()).ToLocalChecked());
+            bytes += SetTerm(tripleObject, SUBJECT, terms[i]);
+            bytes += SetTerm(tripleObject, PREDICATE, terms[i + 1]);
+            bytes += SetTerm(tripleObject, OBJECT, terms[i + 2]);
             triplesArray->Set(Nan::GetCurrentContext(), count++, tripleObject);
         }
 
-        // Send the Javascript Array and whether we are done iterating
-        const unsigned argc = 3;
-        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Boolean>(done)};
+        // The triples have been returned, so a continuation starts after them
+        *position += count;
+
+        // Send the Javascript Array, whether we are done iterating, and whether the results were truncated
+        const unsigned argc = 4;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Boolean>(done), Nan::New<v8::Boolean>(stop.is_stopped())};
+        timer.finish(count, bytes);
+        marshalling.end();
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+
+/**
+ * Async Worker for VersionMaterializationProcessor::NextIds
+ */
+class VMNextIdsWorker: public Nan::AsyncWorker {
+private:
+    BufferedOstrichStore *store;
+    VersionMaterializationProcessor *processor;
+    uint32_t *position;
+    int32_t number;
+
+    // Callback return values
+    char *idsData{nullptr};
+    size_t idsLength{0};
+    bool done;
+    QueryStopCheck stop;
+    OperationTimer timer;
+
+public:
+    VMNextIdsWorker(BufferedOstrichStore *store, VersionMaterializationProcessor *processor, uint32_t *position, int32_t number,
+                    std::shared_ptr<QueryCancellation> cancellation, std::shared_ptr<QueryStats> stats, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), processor(processor), position(position), number(number), done(false), stop(std::move(cancellation)),
+              timer(std::move(stats), STATS_OPERATION_VERSION_MATERIALIZED) {
+        SaveToPersistent("self", self);
+    }
+
+    ~VMNextIdsWorker() override {
+        free(idsData);
+    }
+
+    void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
+        try {
+            TripleIterator *it = processor->GetIterator();
+            // Ids are stored as doubles, as these can be exposed to JavaScript as a Float64Array without loss.
+            std::vector<double> ids;
+            Triple t;
+            uint32_t count = 0;
+            // A cancelled query ends the iteration early, as if the iterator were finished
+            while (count < number && !stop() && it->next(&t)) {
+                ids.push_back((double) t.get_subject());
+                ids.push_back((double) t.get_predicate());
+                ids.push_back((double) t.get_object());
+                count++;
+            }
+            if (count < number) {  // if count < number, it means that the iterator is finished
+                done = true;
+            }
+
+            idsLength = ids.size() * sizeof(double);
+            idsData = (char *) malloc(std::max(idsLength, sizeof(double)));
+            if (idsData == nullptr) {
+                throw std::runtime_error("Could not allocate " + std::to_string(idsLength) + " bytes of triple ids");
+            }
+            memcpy(idsData, ids.data(), idsLength);
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+        }
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+
+        // The ids have been returned, so a continuation starts after them
+        *position += idsLength / (3 * sizeof(double));
+
+        // The buffer takes ownership of the ids
+        v8::Local<v8::Value> ids = Nan::NewBuffer(idsData, idsLength).ToLocalChecked();
+        idsData = nullptr;
+
+        // Send the ids, whether we are done iterating, and whether the results were truncated
+        const unsigned argc = 4;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), ids, Nan::New<v8::Boolean>(done), Nan::New<v8::Boolean>(stop.is_stopped())};
+        timer.finish(idsLength / (3 * sizeof(double)), idsLength);
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -68,21 +237,62 @@ public:
 // VersionMaterializationProcessor
 Nan::Persistent<v8::Function> VersionMaterializationProcessor::constructor;
 
-VersionMaterializationProcessor::VersionMaterializationProcessor(TripleIterator *vm_iterator,  std::shared_ptr<DictionaryManager> dict, const v8::Local<v8::Object> &handle)
-        : iterator(vm_iterator), dict(std::move(dict)) {
+VersionMaterializationProcessor::VersionMaterializationProcessor(BufferedOstrichStore *store, std::shared_ptr<TermCache> cache,
+                                                                 std::shared_ptr<QueryStats> stats, std::shared_ptr<QueryTracer> tracer,
+                                                                 std::shared_ptr<SlowQueryLog> slow_queries, ContinuationToken state,
+                                                                 const v8::Local<v8::Object> &handle)
+        : store(store), cache(std::move(cache)), stats(std::move(stats)), tracer(std::move(tracer)),
+          slow_queries(std::move(slow_queries)), state(std::move(state)) {
     this->Wrap(handle);
 }
 
+TripleIterator *VersionMaterializationProcessor::GetIterator() {
+    Controller *controller = OpenController(store);
+    // Appends do not change the results of this version, so the iterator is recreated at the same position
+    if (!iterator || generation != store->GetWriteGeneration()) {
+        StringTriple pattern(state.subject, state.predicate, state.object);
+        iterator.reset(controller->get_version_materialized(pattern, state.position, state.version_start));
+        dict = controller->get_dictionary_manager(state.version_start);
+        generation = store->GetWriteGeneration();
+    }
+    return iterator.get();
+}
+
 void VersionMaterializationProcessor::Next(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.Length() >= 2);
     auto proc = Nan::ObjectWrap::Unwrap<VersionMaterializationProcessor>(info.This());
-    Nan::AsyncQueueWorker(new VMNextWorker(proc->iterator.get(),
-                                           proc->dict,
+    Nan::AsyncQueueWorker(new VMNextWorker(proc->store,
+                                           proc,
+                                           &proc->state.position,
+                                           proc->cache,
                                            info[0]->Int32Value(Nan::GetCurrentContext()).FromJust(),
+                                           QueryCancellationHandle::FromValue(info[3]),
+                                           proc->stats,
+                                           TraceBatch(proc->tracer, "versionMaterialized", proc->state),
+                                           proc->slow_queries,
+                                           DescribeBatch(STATS_OPERATION_VERSION_MATERIALIZED, proc->state, info[0]->Int32Value(Nan::GetCurrentContext()).FromJust()),
                                            new Nan::Callback(info[1].As<v8::Function>()),
                                            info[2]->IsObject() ? info[2].As<v8::Object>() : info.This()));
 }
 
+void VersionMaterializationProcessor::NextIds(Nan::NAN_METHOD_ARGS_TYPE info) {
+    assert(info.Length() >= 2);
+    auto proc = Nan::ObjectWrap::Unwrap<VersionMaterializationProcessor>(info.This());
+    Nan::AsyncQueueWorker(new VMNextIdsWorker(proc->store,
+                                              proc,
+                                              &proc->state.position,
+                                              info[0]->Int32Value(Nan::GetCurrentContext()).FromJust(),
+                                              QueryCancellationHandle::FromValue(info[3]),
+                                              proc->stats,
+                                              new Nan::Callback(info[1].As<v8::Function>()),
+                                              info[2]->IsObject() ? info[2].As<v8::Object>() : info.This()));
+}
+
+void VersionMaterializationProcessor::GetContinuationToken(Nan::NAN_METHOD_ARGS_TYPE info) {
+    auto proc = Nan::ObjectWrap::Unwrap<VersionMaterializationProcessor>(info.This());
+    info.GetReturnValue().Set(Nan::New(SerializeContinuation(proc->state, info[0])).ToLocalChecked());
+}
+
 void VersionMaterializationProcessor::New(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.IsConstructCall());
     info.GetReturnValue().Set(info.This());
@@ -96,6 +306,8 @@ const Nan::Persistent<v8::Function> &VersionMaterializationProcessor::GetConstru
         tpl->InstanceTemplate()->SetInternalFieldCount(1);
         // Create prototype
         Nan::SetPrototypeMethod(tpl, "_next", Next);
+        Nan::SetPrototypeMethod(tpl, "_nextIds", NextIds);
+        Nan::SetPrototypeMethod(tpl, "_continuationToken", GetContinuationToken);
         // Set constructor
         constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
     }
@@ -107,63 +319,102 @@ const Nan::Persistent<v8::Function> &VersionMaterializationProcessor::GetConstru
  */
 class DMNextWorker: public Nan::AsyncWorker {
 private:
-    TripleDeltaIterator* it;
+    BufferedOstrichStore *store;
+    DeltaMaterializationProcessor *processor;
+    uint32_t *position;
     int32_t number;
+    std::shared_ptr<TermCache> cache;
 
-    // Callback return values
-    std::vector<TripleDelta*> triples;
+    // Callback return values, of which the terms are decoded while the dictionary can not be modified by appends
+    std::vector<std::string> terms;
+    std::vector<bool> additions;
     bool done;
+    QueryStopCheck stop;
+    OperationTimer timer;
+    OperationTrace trace;
+    std::shared_ptr<SlowQueryLog> slow_queries;
+    SlowQuery slow_query;
 
 public:
-    DMNextWorker(TripleDeltaIterator *iterator, int32_t number, Nan::Callback *callback, v8::Local<v8::Object> self)
-            : Nan::AsyncWorker(callback), it(iterator), number(number), done(false) {
+    DMNextWorker(BufferedOstrichStore *store, DeltaMaterializationProcessor *processor, uint32_t *position, std::shared_ptr<TermCache> cache, int32_t number,
+                 std::shared_ptr<QueryCancellation> cancellation, std::shared_ptr<QueryStats> stats, OperationTrace trace,
+                 std::shared_ptr<SlowQueryLog> slow_queries, SlowQuery slow_query, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), processor(processor), position(position), number(number), cache(std::move(cache)), done(false),
+              stop(std::move(cancellation)), timer(std::move(stats), STATS_OPERATION_DELTA_MATERIALIZED), trace(std::move(trace)),
+              slow_queries(std::move(slow_queries)), slow_query(std::move(slow_query)) {
         SaveToPersistent("self", self);
     }
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto tracing = trace.span("execute");
+        tracing.count("queueWait", (int64_t) trace.since_created());
+        auto lock = store->LockRead();
         try {
+            TripleDeltaIterator *it = processor->GetIterator();
             TripleDelta t;
             uint32_t count = 0;
-            while (it->next(&t) && (count < number || count == -1)) {
-                triples.push_back(new TripleDelta(new Triple(*t.get_triple()), t.is_addition(), t.get_dictionary()));
+            // A cancelled query ends the iteration early, as if the iterator were finished
+            auto iterating = trace.span("iterate");
+            auto decoding = trace.accumulate("decode");
+            while (count < number && !stop() && it->next(&t)) {
+                DictionaryManager &dict = *t.get_dictionary();
+                decoding.begin();
+                terms.push_back(cache->get(dict, t.get_triple()->get_subject(), hdt::SUBJECT));
+                terms.push_back(cache->get(dict, t.get_triple()->get_predicate(), hdt::PREDICATE));
+                terms.push_back(cache->get(dict, t.get_triple()->get_object(), hdt::OBJECT));
+                decoding.end();
+                additions.push_back(t.is_addition());
                 count++;
             }
+            iterating.count("results", count);
+            iterating.end();
             if (count < number) {  // if count < number, it means that the iterator is finished
                 done = true;
             }
+            if (slow_queries->is_slow(executing.elapsed())) {
+                slow_query.results = count;
+                slow_queries->record(std::move(slow_query), timer, executing);
+            }
         } catch (const std::runtime_error &error) {
             SetErrorMessage(error.what());
         }
     }
 
     void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        auto marshalling = trace.span("marshal");
         uint32_t count = 0;
-        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(triples.size());
+        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(additions.size());
         const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
         const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
         const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
         const v8::Local<v8::String> ADDITION = Nan::New("addition").ToLocalChecked();
-        for (auto& triple : triples) {
-            Triple* t = triple->get_triple();
-            std::shared_ptr<DictionaryManager> dict = triple->get_dictionary();
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < additions.size(); i++) {
             v8::Local<v8::Object> tripleObject = Nan::New<v8::Object>();
-            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(t->get_subject(*dict).c_str()).ToLocalChecked());
-            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(t->get_predicate(*dict).c_str()).ToLocalChecked());
-            std::string object = t->get_object(*dict);
-            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(fromHdtLiteral(object).c_str()).ToLocalChecked());
-            tripleObject->Set(Nan::GetCurrentContext(), ADDITION, Nan::New(triple->is_addition()));
+            bytes += SetTerm(tripleObject, SUBJECT, terms[3 * i]);
+            bytes += SetTerm(tripleObject, PREDICATE, terms[3 * i + 1]);
+            bytes += SetTerm(tripleObject, OBJECT, terms[3 * i + 2]);
+            tripleObject->Set(Nan::GetCurrentContext(), ADDITION, Nan::New((bool) additions[i]));
             triplesArray->Set(Nan::GetCurrentContext(), count++, tripleObject);
-            delete triple;
         }
 
-        // Send the Javascript Array and whether we are done iterating
-        const unsigned argc = 3;
-        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Boolean>(done)};
+        // The triples have been returned, so a continuation starts after them
+        *position += count;
+
+        // Send the Javascript Array, whether we are done iterating, and whether the results were truncated
+        const unsigned argc = 4;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Boolean>(done), Nan::New<v8::Boolean>(stop.is_stopped())};
+        timer.finish(count, bytes);
+        marshalling.end();
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -172,20 +423,48 @@ public:
 // DeltaMaterializationProcessor
 Nan::Persistent<v8::Function> DeltaMaterializationProcessor::constructor;
 
-DeltaMaterializationProcessor::DeltaMaterializationProcessor(TripleDeltaIterator *dm_iterator, const v8::Local<v8::Object> &handle) : iterator(dm_iterator) {
+DeltaMaterializationProcessor::DeltaMaterializationProcessor(BufferedOstrichStore *store, std::shared_ptr<TermCache> cache, std::shared_ptr<QueryStats> stats,
+                                                             std::shared_ptr<QueryTracer> tracer, std::shared_ptr<SlowQueryLog> slow_queries,
+                                                             ContinuationToken state, const v8::Local<v8::Object> &handle)
+        : store(store), cache(std::move(cache)), stats(std::move(stats)), tracer(std::move(tracer)),
+          slow_queries(std::move(slow_queries)), state(std::move(state)) {
     this->Wrap(handle);
 }
 
+TripleDeltaIterator *DeltaMaterializationProcessor::GetIterator() {
+    Controller *controller = OpenController(store);
+    // Appends do not change the changes between these versions, so the iterator is recreated at the same position
+    if (!iterator || generation != store->GetWriteGeneration()) {
+        StringTriple pattern(state.subject, state.predicate, state.object);
+        iterator.reset(controller->get_delta_materialized(pattern, state.position, state.version_start, state.version_end));
+        generation = store->GetWriteGeneration();
+    }
+    return iterator.get();
+}
+
 void DeltaMaterializationProcessor::Next(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.Length() >= 2);
     auto proc = Nan::ObjectWrap::Unwrap<DeltaMaterializationProcessor>(info.This());
     int bufferingSize = info[0]->Int32Value(Nan::GetCurrentContext()).FromJust();
-    Nan::AsyncQueueWorker(new DMNextWorker(proc->iterator.get(),
+    Nan::AsyncQueueWorker(new DMNextWorker(proc->store,
+                                           proc,
+                                           &proc->state.position,
+                                           proc->cache,
                                            info[0]->Int32Value(Nan::GetCurrentContext()).FromJust(),
+                                           QueryCancellationHandle::FromValue(info[3]),
+                                           proc->stats,
+                                           TraceBatch(proc->tracer, "deltaMaterialized", proc->state),
+                                           proc->slow_queries,
+                                           DescribeBatch(STATS_OPERATION_DELTA_MATERIALIZED, proc->state, info[0]->Int32Value(Nan::GetCurrentContext()).FromJust()),
                                            new Nan::Callback(info[1].As<v8::Function>()),
                                            info[2]->IsObject() ? info[2].As<v8::Object>() : info.This()));
 }
 
+void DeltaMaterializationProcessor::GetContinuationToken(Nan::NAN_METHOD_ARGS_TYPE info) {
+    auto proc = Nan::ObjectWrap::Unwrap<DeltaMaterializationProcessor>(info.This());
+    info.GetReturnValue().Set(Nan::New(SerializeContinuation(proc->state, info[0])).ToLocalChecked());
+}
+
 void DeltaMaterializationProcessor::New(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.IsConstructCall());
     info.GetReturnValue().Set(info.This());
@@ -198,6 +477,7 @@ const Nan::Persistent<v8::Function> &DeltaMaterializationProcessor::GetConstruct
         tpl->InstanceTemplate()->SetInternalFieldCount(1);
         // Set prototype
         Nan::SetPrototypeMethod(tpl, "_next", Next);
+        Nan::SetPrototypeMethod(tpl, "_continuationToken", GetContinuationToken);
         // Set constructor
         constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
     }
@@ -211,68 +491,107 @@ const Nan::Persistent<v8::Function> &DeltaMaterializationProcessor::GetConstruct
  */
 class VQNextWorker: public Nan::AsyncWorker {
 private:
-    TripleVersionsIterator* it;
+    BufferedOstrichStore *store;
+    VersionQueryProcessor *processor;
+    uint32_t *position;
     int32_t number;
+    std::shared_ptr<TermCache> cache;
 
-    // Callback return values
-    std::vector<TripleVersions*> triples;
+    // Callback return values, of which the terms are decoded while the dictionary can not be modified by appends
+    std::vector<std::string> terms;
+    std::vector<std::vector<int>> versions;
     bool done;
+    QueryStopCheck stop;
+    OperationTimer timer;
+    OperationTrace trace;
+    std::shared_ptr<SlowQueryLog> slow_queries;
+    SlowQuery slow_query;
 
 public:
-    VQNextWorker(TripleVersionsIterator *iterator, int32_t number, Nan::Callback *callback, v8::Local<v8::Object> self)
-            : Nan::AsyncWorker(callback), it(iterator), number(number), done(false) {
+    VQNextWorker(BufferedOstrichStore *store, VersionQueryProcessor *processor, uint32_t *position, std::shared_ptr<TermCache> cache, int32_t number,
+                 std::shared_ptr<QueryCancellation> cancellation, std::shared_ptr<QueryStats> stats, OperationTrace trace,
+                 std::shared_ptr<SlowQueryLog> slow_queries, SlowQuery slow_query, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), processor(processor), position(position), number(number), cache(std::move(cache)), done(false),
+              stop(std::move(cancellation)), timer(std::move(stats), STATS_OPERATION_VERSION), trace(std::move(trace)),
+              slow_queries(std::move(slow_queries)), slow_query(std::move(slow_query)) {
         SaveToPersistent("self", self);
     }
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto tracing = trace.span("execute");
+        tracing.count("queueWait", (int64_t) trace.since_created());
+        auto lock = store->LockRead();
         try {
+            TripleVersionsIterator *it = processor->GetIterator();
             TripleVersions t;
             uint32_t count = 0;
-            while (it->next(&t) && (count < number || count == -1)) {
-                triples.push_back(new TripleVersions(new Triple(*t.get_triple()), new std::vector<int>(*t.get_versions()), t.get_dictionary()));
+            // A cancelled query ends the iteration early, as if the iterator were finished
+            auto iterating = trace.span("iterate");
+            auto decoding = trace.accumulate("decode");
+            while (count < number && !stop() && it->next(&t)) {
+                DictionaryManager &dict = *t.get_dictionary();
+                decoding.begin();
+                terms.push_back(cache->get(dict, t.get_triple()->get_subject(), hdt::SUBJECT));
+                terms.push_back(cache->get(dict, t.get_triple()->get_predicate(), hdt::PREDICATE));
+                terms.push_back(cache->get(dict, t.get_triple()->get_object(), hdt::OBJECT));
+                decoding.end();
+                versions.push_back(*t.get_versions());
                 count++;
             }
+            iterating.count("results", count);
+            iterating.end();
             if (count < number) {  // if count < number, it means that the iterator is finished
                 done = true;
             }
+            if (slow_queries->is_slow(executing.elapsed())) {
+                slow_query.results = count;
+                slow_queries->record(std::move(slow_query), timer, executing);
+            }
         } catch (const std::runtime_error &error) {
             SetErrorMessage(error.what());
         }
     }
 
     void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        auto marshalling = trace.span("marshal");
         uint32_t count = 0;
-        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(triples.size());
+        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(versions.size());
         const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
         const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
         const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
         const v8::Local<v8::String> VERSIONS = Nan::New("versions").ToLocalChecked();
-        for (auto& t: triples) {
-            std::shared_ptr<DictionaryManager> dict = t->get_dictionary();
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < versions.size(); i++) {
             v8::Local<v8::Object> tripleObject = Nan::New<v8::Object>();
-            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(t->get_triple()->get_subject(*dict).c_str()).ToLocalChecked());
-            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(t->get_triple()->get_predicate(*dict).c_str()).ToLocalChecked());
-            std::string object = t->get_triple()->get_object(*dict);
-            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(fromHdtLiteral(object).c_str()).ToLocalChecked());
-
-            v8::Local<v8::Array> versionsArray = Nan::New<v8::Array>(t->get_versions()->size());
-            for (uint32_t countVersions = 0; countVersions < t->get_versions()->size(); countVersions++) {
-                versionsArray->Set(Nan::GetCurrentContext(), countVersions, Nan::New((*(t->get_versions()))[countVersions]));
+            bytes += SetTerm(tripleObject, SUBJECT, terms[3 * i]);
+            bytes += SetTerm(tripleObject, PREDICATE, terms[3 * i + 1]);
+            bytes += SetTerm(tripleObject, OBJECT, terms[3 * i + 2]);
+
+            v8::Local<v8::Array> versionsArray = Nan::New<v8::Array>(versions[i].size());
+            for (uint32_t countVersions = 0; countVersions < versions[i].size(); countVersions++) {
+                versionsArray->Set(Nan::GetCurrentContext(), countVersions, Nan::New(versions[i][countVersions]));
             }
             tripleObject->Set(Nan::GetCurrentContext(), VERSIONS, versionsArray);
             triplesArray->Set(Nan::GetCurrentContext(), count++, tripleObject);
-            delete t->get_triple();
-            delete t->get_versions();
         }
 
-        // Send the Javascript Array and whether we are done iterating
-        const unsigned argc = 3;
-        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Boolean>(done)};
+        // The triples have been returned, so a continuation starts after them
+        *position += count;
+
+        // Send the Javascript Array, whether we are done iterating, and whether the results were truncated
+        const unsigned argc = 4;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Boolean>(done), Nan::New<v8::Boolean>(stop.is_stopped())};
+        timer.finish(count, bytes);
+        marshalling.end();
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -281,19 +600,48 @@ public:
 // VersionQueryProcessor
 Nan::Persistent<v8::Function> VersionQueryProcessor::constructor;
 
-VersionQueryProcessor::VersionQueryProcessor(TripleVersionsIterator *vq_iterator, const v8::Local<v8::Object> &handle) : iterator(vq_iterator) {
+VersionQueryProcessor::VersionQueryProcessor(BufferedOstrichStore *store, std::shared_ptr<TermCache> cache, std::shared_ptr<QueryStats> stats,
+                                             std::shared_ptr<QueryTracer> tracer, std::shared_ptr<SlowQueryLog> slow_queries,
+                                             ContinuationToken state, const v8::Local<v8::Object> &handle)
+        : store(store), cache(std::move(cache)), stats(std::move(stats)), tracer(std::move(tracer)),
+          slow_queries(std::move(slow_queries)), state(std::move(state)) {
     this->Wrap(handle);
 }
 
+TripleVersionsIterator *VersionQueryProcessor::GetIterator() {
+    Controller *controller = OpenController(store);
+    if (state.max_version != store->GetVisibleVersion()) {
+        throw std::runtime_error("The version query is outdated, as versions have been appended since");
+    }
+    if (!iterator) {
+        StringTriple pattern(state.subject, state.predicate, state.object);
+        iterator.reset(controller->get_version(pattern, state.position));
+    }
+    return iterator.get();
+}
+
 void VersionQueryProcessor::Next(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.Length() >= 2);
     auto proc = Nan::ObjectWrap::Unwrap<VersionQueryProcessor>(info.This());
-    Nan::AsyncQueueWorker(new VQNextWorker(proc->iterator.get(),
+    Nan::AsyncQueueWorker(new VQNextWorker(proc->store,
+                                           proc,
+                                           &proc->state.position,
+                                           proc->cache,
                                            info[0]->Int32Value(Nan::GetCurrentContext()).FromJust(),
+                                           QueryCancellationHandle::FromValue(info[3]),
+                                           proc->stats,
+                                           TraceBatch(proc->tracer, "version", proc->state),
+                                           proc->slow_queries,
+                                           DescribeBatch(STATS_OPERATION_VERSION, proc->state, info[0]->Int32Value(Nan::GetCurrentContext()).FromJust()),
                                            new Nan::Callback(info[1].As<v8::Function>()),
                                            info[2]->IsObject() ? info[2].As<v8::Object>() : info.This()));
 }
 
+void VersionQueryProcessor::GetContinuationToken(Nan::NAN_METHOD_ARGS_TYPE info) {
+    auto proc = Nan::ObjectWrap::Unwrap<VersionQueryProcessor>(info.This());
+    info.GetReturnValue().Set(Nan::New(SerializeContinuation(proc->state, info[0])).ToLocalChecked());
+}
+
 void VersionQueryProcessor::New(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.IsConstructCall());
     info.GetReturnValue().Set(info.This());
@@ -306,6 +654,7 @@ const Nan::Persistent<v8::Function> &VersionQueryProcessor::GetConstructor() {
         tpl->InstanceTemplate()->SetInternalFieldCount(1);
         // Set prototype
         Nan::SetPrototypeMethod(tpl, "_next", Next);
+        Nan::SetPrototypeMethod(tpl, "_continuationToken", GetContinuationToken);
         // Set constructor
         constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
     }
@@ -313,6 +662,135 @@ const Nan::Persistent<v8::Function> &VersionQueryProcessor::GetConstructor() {
 }
 
 
+/**
+ * Async Worker for BindingsProcessor::Next
+ */
+class BindingsNextWorker: public Nan::AsyncWorker {
+private:
+    BufferedOstrichStore *store;
+    BindingsProcessor *processor;
+    uint64_t *position;
+    int32_t number;
+
+    // Callback return values
+    std::vector<JoinBinding> bindings;
+    bool done;
+    OperationTimer timer;
+
+public:
+    BindingsNextWorker(BufferedOstrichStore *store, BindingsProcessor *processor, uint64_t *position, int32_t number,
+                       std::shared_ptr<QueryStats> stats, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), processor(processor), position(position), number(number), done(false),
+              timer(std::move(stats), STATS_OPERATION_BATCH) {
+        SaveToPersistent("self", self);
+    }
+
+    void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
+        try {
+            BindingIterator *it = processor->GetIterator();
+            JoinBinding binding;
+            uint32_t count = 0;
+            while (count < number && it->next(&binding)) {
+                bindings.push_back(binding);
+                count++;
+            }
+            if (count < number) {  // if count < number, it means that the iterator is finished
+                done = true;
+            }
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+        }
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+
+        uint32_t count = 0;
+        v8::Local<v8::Array> bindingsArray = Nan::New<v8::Array>(bindings.size());
+        uint64_t bytes = 0;
+        for (auto& binding : bindings) {
+            v8::Local<v8::Object> bindingObject = Nan::New<v8::Object>();
+            for (auto& entry : binding) {
+                bindingObject->Set(Nan::GetCurrentContext(), Nan::New(entry.first).ToLocalChecked(), Nan::New(entry.second).ToLocalChecked());
+                bytes += entry.second.size();
+            }
+            bindingsArray->Set(Nan::GetCurrentContext(), count++, bindingObject);
+        }
+
+        // The bindings have been returned, so a recreated iterator starts after them
+        *position += count;
+
+        // Send the Javascript Array and whether we are done iterating
+        const unsigned argc = 3;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), bindingsArray, Nan::New<v8::Boolean>(done)};
+        timer.finish(bindings.size(), bytes);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+
+// BindingsProcessor
+Nan::Persistent<v8::Function> BindingsProcessor::constructor;
+
+BindingsProcessor::BindingsProcessor(BufferedOstrichStore *store, std::function<BindingIterator *()> create_iterator,
+                                     std::shared_ptr<QueryStats> stats, const v8::Local<v8::Object> &handle)
+        : store(store), create_iterator(std::move(create_iterator)), stats(std::move(stats)) {
+    this->Wrap(handle);
+}
+
+BindingIterator *BindingsProcessor::GetIterator() {
+    OpenController(store);
+    // Appends do not change the bindings of this version, so the iterator is recreated and skips the returned ones
+    if (!iterator || generation != store->GetWriteGeneration()) {
+        iterator.reset(create_iterator());
+        generation = store->GetWriteGeneration();
+        JoinBinding binding;
+        for (uint64_t skipped = 0; skipped < position && iterator->next(&binding); skipped++) {}
+    }
+    return iterator.get();
+}
+
+void BindingsProcessor::Next(Nan::NAN_METHOD_ARGS_TYPE info) {
+    assert(info.Length() >= 2);
+    auto proc = Nan::ObjectWrap::Unwrap<BindingsProcessor>(info.This());
+    Nan::AsyncQueueWorker(new BindingsNextWorker(proc->store,
+                                             proc,
+                                             &proc->position,
+                                             info[0]->Int32Value(Nan::GetCurrentContext()).FromJust(),
+                                             proc->stats,
+                                             new Nan::Callback(info[1].As<v8::Function>()),
+                                             info[2]->IsObject() ? info[2].As<v8::Object>() : info.This()));
+}
+
+void BindingsProcessor::New(Nan::NAN_METHOD_ARGS_TYPE info) {
+    assert(info.IsConstructCall());
+    info.GetReturnValue().Set(info.This());
+}
+
+const Nan::Persistent<v8::Function> &BindingsProcessor::GetConstructor() {
+    if (constructor.IsEmpty()) {
+        // Create constructor template
+        v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+        tpl->SetClassName(Nan::New("BindingsProcessor").ToLocalChecked());
+        tpl->InstanceTemplate()->SetInternalFieldCount(1);
+        // Create prototype
+        Nan::SetPrototypeMethod(tpl, "_next", Next);
+        // Set constructor
+        constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
+    }
+    return constructor;
+}
+
 // ================================================================================
 // ================================================================================
 // ================================================================================
@@ -320,7 +798,11 @@ const Nan::Persistent<v8::Function> &VersionQueryProcessor::GetConstructor() {
 Nan::Persistent<v8::Function> BufferedOstrichStore::constructor;
 
 // Creates a new Ostrich store.
-BufferedOstrichStore::BufferedOstrichStore(std::string path, const v8::Local<v8::Object> &handle, Controller *controller) : path(std::move(path)), controller(controller), features(1) {
+BufferedOstrichStore::BufferedOstrichStore(std::string path, const v8::Local<v8::Object> &handle, Controller *controller, size_t term_cache_size)
+        : path(std::move(path)), controller(controller), features(1), term_cache(std::make_shared<TermCache>(term_cache_size)),
+          stats(std::make_shared<QueryStats>()), tracer(std::make_shared<QueryTracer>()),
+          slow_queries(std::make_shared<SlowQueryLog>(controller)), write_generation(0),
+          visible_version(controller->get_max_patch_id()) {
     this->Wrap(handle);
 }
 
@@ -330,6 +812,8 @@ BufferedOstrichStore::~BufferedOstrichStore() {
 
 // Destroys the document, disabling all further operations.
 void BufferedOstrichStore::Destroy(bool remove) {
+    // Batches of query processors that are still being fetched finish before the controller is deleted
+    auto lock = LockWrite();
     if (controller != nullptr) {
         if (remove) {
             Controller::cleanup(path, controller);
@@ -338,6 +822,7 @@ void BufferedOstrichStore::Destroy(bool remove) {
         }
         controller = nullptr;
     }
+    term_cache->clear();
 }
 
 void BufferedOstrichStore::New(Nan::NAN_METHOD_ARGS_TYPE info) {
@@ -358,7 +843,16 @@ const Nan::Persistent<v8::Function> &BufferedOstrichStore::GetConstructor() {
         Nan::SetPrototypeMethod(constructorTemplate, "_countTriplesDeltaMaterialized", CountTriplesDeltaMaterialized);
         Nan::SetPrototypeMethod(constructorTemplate, "_searchTriplesVersion", SearchTriplesVersion);
         Nan::SetPrototypeMethod(constructorTemplate, "_countTriplesVersion", CountTriplesVersion);
+        Nan::SetPrototypeMethod(constructorTemplate, "_resume", Resume);
+        Nan::SetPrototypeMethod(constructorTemplate, "_joinVersionMaterialized", JoinVersionMaterialized);
+        Nan::SetPrototypeMethod(constructorTemplate, "_searchBgpVersionMaterialized", SearchBgpVersionMaterialized);
+        Nan::SetPrototypeMethod(constructorTemplate, "_decodeTripleIds", DecodeTripleIds);
         Nan::SetPrototypeMethod(constructorTemplate, "_append", Append);
+        Nan::SetPrototypeMethod(constructorTemplate, "_stats", Stats);
+        Nan::SetPrototypeMethod(constructorTemplate, "_startTracing", StartTracing);
+        Nan::SetPrototypeMethod(constructorTemplate, "_stopTracing", StopTracing);
+        Nan::SetPrototypeMethod(constructorTemplate, "_setSlowQueryLog", SetSlowQueryLog);
+        Nan::SetPrototypeMethod(constructorTemplate, "_slowQueries", SlowQueries);
         Nan::SetPrototypeMethod(constructorTemplate, "_close", Close);
         Nan::SetAccessor(constructorTemplate->PrototypeTemplate(), Nan::New("maxVersion").ToLocalChecked(), MaxVersion);
         Nan::SetAccessor(constructorTemplate->PrototypeTemplate(), Nan::New("_features").ToLocalChecked(), Features);
@@ -375,18 +869,27 @@ class CreateWorker : public Nan::AsyncWorker {
     std::string path;
     Controller *controller;
     bool read_only;
+    bool shared;
     SnapshotCreationStrategy *strategy;
+    size_t term_cache_size;
 
 public:
-    CreateWorker(const char *path, bool read_only, const std::string& strategy_name, const std::string& strategy_parameter, Nan::Callback *callback)
-            : Nan::AsyncWorker(callback), path(path), read_only(read_only), controller(nullptr),
-              strategy(SnapshotCreationStrategy::get_composite_strategy(strategy_name, strategy_parameter)) {};
+    CreateWorker(const char *path, bool read_only, bool shared, const std::string& strategy_name, const std::string& strategy_parameter,
+                 size_t term_cache_size, Nan::Callback *callback)
+            : Nan::AsyncWorker(callback), path(path), read_only(read_only), shared(shared), controller(nullptr),
+              strategy(SnapshotCreationStrategy::get_composite_strategy(strategy_name, strategy_parameter)),
+              term_cache_size(term_cache_size) {};
 
     void Execute() override {
         try {
+            if (shared) {
+                PrepareSharedSnapshots(path);
+            }
             controller = new Controller(path, strategy, kyotocabinet::HashDB::TCOMPRESS, read_only);
         } catch (const std::invalid_argument &error) {
             SetErrorMessage(error.what());
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
         }
     }
 
@@ -394,7 +897,7 @@ public:
         Nan::HandleScope scope;
         // Create a new OstrichStore
         v8::Local<v8::Object> newStore = Nan::NewInstance(Nan::New(BufferedOstrichStore::GetConstructor())).ToLocalChecked();
-        new BufferedOstrichStore(path, newStore, controller);
+        new BufferedOstrichStore(path, newStore, controller, term_cache_size);
         // Send the new OstrichStore through the callback
         const unsigned argc = 2;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), newStore};
@@ -403,13 +906,55 @@ public:
     }
 };
 
+// JavaScript signature: createBufferedOstrichStore(path, readOnly, strategyName, strategyParameter, options, callback)
+// The options object may contain termCacheSize: the maximum number of decoded terms that are cached,
+// and shared: whether the indexes of all snapshots must be persisted, so that read-only processes can share them.
 void BufferedOstrichStore::Create(Nan::NAN_METHOD_ARGS_TYPE info) {
-    assert(info.Length() >= 4);
+    assert(info.Length() >= 6);
+    size_t term_cache_size = TERM_CACHE_DEFAULT_CAPACITY;
+    bool shared = false;
+    if (info[4]->IsObject()) {
+        v8::Local<v8::Object> options = info[4].As<v8::Object>();
+        v8::Local<v8::Value> value = Nan::Get(options, Nan::New("termCacheSize").ToLocalChecked()).ToLocalChecked();
+        if (value->IsNumber()) {
+            term_cache_size = value->Uint32Value(Nan::GetCurrentContext()).FromJust();
+        }
+        value = Nan::Get(options, Nan::New("shared").ToLocalChecked()).ToLocalChecked();
+        shared = value->BooleanValue(info.GetIsolate());
+    }
     Nan::AsyncQueueWorker(new CreateWorker(*Nan::Utf8String(info[0]),
                                            info[1]->BooleanValue(info.GetIsolate()),
+                                           shared,
                                            *Nan::Utf8String(info[2]),
                                            *Nan::Utf8String(info[3]),
-                                           new Nan::Callback(info[4].As<v8::Function>())));
+                                           term_cache_size,
+                                           new Nan::Callback(info[5].As<v8::Function>())));
+}
+
+/******** Query processors ********/
+
+// Creates a query processor that starts at the position of the given state,
+// of which the iterator is only created by its first batch, so that the controller is not used on the main thread
+static v8::Local<v8::Object> NewQueryProcessor(BufferedOstrichStore *store, const ContinuationToken &state) {
+    v8::Local<v8::Object> queryProcessor;
+    switch (state.type) {
+        case CONTINUATION_VERSION_MATERIALIZED: {
+            queryProcessor = Nan::NewInstance(Nan::New(VersionMaterializationProcessor::GetConstructor())).ToLocalChecked();
+            new VersionMaterializationProcessor(store, store->GetTermCache(), store->GetStats(), store->GetTracer(), store->GetSlowQueryLog(), state, queryProcessor);
+            break;
+        }
+        case CONTINUATION_DELTA_MATERIALIZED: {
+            queryProcessor = Nan::NewInstance(Nan::New(DeltaMaterializationProcessor::GetConstructor())).ToLocalChecked();
+            new DeltaMaterializationProcessor(store, store->GetTermCache(), store->GetStats(), store->GetTracer(), store->GetSlowQueryLog(), state, queryProcessor);
+            break;
+        }
+        case CONTINUATION_VERSION: {
+            queryProcessor = Nan::NewInstance(Nan::New(VersionQueryProcessor::GetConstructor())).ToLocalChecked();
+            new VersionQueryProcessor(store, store->GetTermCache(), store->GetStats(), store->GetTracer(), store->GetSlowQueryLog(), state, queryProcessor);
+            break;
+        }
+    }
+    return queryProcessor;
 }
 
 /******** SearchTriplesVersionMaterialized ********/
@@ -418,20 +963,18 @@ void BufferedOstrichStore::SearchTriplesVersionMaterialized(Nan::NAN_METHOD_ARGS
     assert(info.Length() >= 5);
     auto thisStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
 
-    std::string s(*Nan::Utf8String(info[0]));
-    std::string p(*Nan::Utf8String(info[1]));
-    std::string o(*Nan::Utf8String(info[2]));
-
-    int offset = info[3]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    ContinuationToken state;
+    state.type = CONTINUATION_VERSION_MATERIALIZED;
+    state.subject = *Nan::Utf8String(info[0]);
+    state.predicate = *Nan::Utf8String(info[1]);
+    state.object = *Nan::Utf8String(info[2]);
+    state.position = info[3]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    state.max_version = thisStore->GetVisibleVersion();
+    // Resolve the latest version, so that a continuation keeps iterating over the same version after an append
     int version = info[4]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    state.version_start = state.version_end = version >= 0 ? version : state.max_version;
 
-    TripleIterator* it = thisStore->GetController()->get_version_materialized(StringTriple(s, p, o), offset, version);
-    std::shared_ptr<DictionaryManager> dict = thisStore->GetController()->get_dictionary_manager(version);
-
-    v8::Local<v8::Object> queryProcessor = Nan::NewInstance(Nan::New(VersionMaterializationProcessor::GetConstructor())).ToLocalChecked();
-    new VersionMaterializationProcessor(it, dict, queryProcessor);
-
-    info.GetReturnValue().Set(queryProcessor);
+    info.GetReturnValue().Set(NewQueryProcessor(thisStore, state));
 }
 
 /******** CountTriplesVersionMaterialized ********/
@@ -444,19 +987,23 @@ class CountTriplesVersionMaterializedWorker : public Nan::AsyncWorker {
     // Callback return values
     uint32_t totalCount{0};
     bool hasExactCount{false};
+    OperationTimer timer;
 
 public:
     CountTriplesVersionMaterializedWorker(BufferedOstrichStore *store, std::string subject, std::string predicate, std::string object, int32_t version, Nan::Callback *callback, v8::Local<v8::Object> self)
-            : Nan::AsyncWorker(callback), store(store), subject(std::move(subject)), predicate(std::move(predicate)), object(std::move(object)), version(version) {
+            : Nan::AsyncWorker(callback), store(store), subject(std::move(subject)), predicate(std::move(predicate)), object(std::move(object)), version(version),
+              timer(store->GetStats(), STATS_OPERATION_COUNT) {
         SaveToPersistent("self", self);
     };
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
         try {
-            Controller *controller = store->GetController();
+            Controller *controller = OpenController(store);
 
             // Check version
-            version = version >= 0 ? version : controller->get_max_patch_id();
+            version = version >= 0 ? version : store->GetVisibleVersion();
 
             // Prepare the triple pattern
             StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
@@ -472,14 +1019,17 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
         // Send the JavaScript array and estimated total count through the callback
         const unsigned argc = 3;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        timer.finish(0, 0);
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -509,16 +1059,17 @@ void BufferedOstrichStore::SearchTriplesDeltaMaterialized(Nan::NAN_METHOD_ARGS_T
     std::string p(*Nan::Utf8String(info[1]));
     std::string o(*Nan::Utf8String(info[2]));
 
-    int offset = info[3]->Int32Value(Nan::GetCurrentContext()).FromJust();
-    int version_start = info[4]->Int32Value(Nan::GetCurrentContext()).FromJust();
-    int version_end = info[5]->Int32Value(Nan::GetCurrentContext()).FromJust();
-
-    TripleDeltaIterator* it = thisStore->GetController()->get_delta_materialized(StringTriple(s, p, o), offset, version_start, version_end);
-
-    v8::Local<v8::Object> queryProcessor = Nan::NewInstance(Nan::New(DeltaMaterializationProcessor::GetConstructor())).ToLocalChecked();
-    new DeltaMaterializationProcessor(it, queryProcessor);
-
-    info.GetReturnValue().Set(queryProcessor);
+    ContinuationToken state;
+    state.type = CONTINUATION_DELTA_MATERIALIZED;
+    state.subject = s;
+    state.predicate = p;
+    state.object = o;
+    state.position = info[3]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    state.version_start = info[4]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    state.version_end = info[5]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    state.max_version = thisStore->GetVisibleVersion();
+
+    info.GetReturnValue().Set(NewQueryProcessor(thisStore, state));
 }
 
 /******** CountTriplesDeltaMaterialized ********/
@@ -531,22 +1082,25 @@ class CountTriplesDeltaMaterializedWorker : public Nan::AsyncWorker {
     // Callback return values
     uint32_t totalCount{0};
     bool hasExactCount;
+    OperationTimer timer;
 
 public:
     CountTriplesDeltaMaterializedWorker(BufferedOstrichStore *store, std::string subject, std::string predicate, std::string object,
                                         int32_t version_start, int32_t version_end, Nan::Callback *callback, v8::Local<v8::Object> self)
             : Nan::AsyncWorker(callback),
               store(store), subject(std::move(subject)), predicate(std::move(predicate)), object(std::move(object)),
-              version_start(version_start), version_end(version_end) {
+              version_start(version_start), version_end(version_end), timer(store->GetStats(), STATS_OPERATION_COUNT) {
         SaveToPersistent("self", self);
     }
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
         try {
-            Controller *controller = store->GetController();
+            Controller *controller = OpenController(store);
 
             // Check version
-            version_end = version_end >= 0 ? version_end : controller->get_max_patch_id();
+            version_end = version_end >= 0 ? version_end : store->GetVisibleVersion();
 
             // Prepare the triple pattern
             StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
@@ -562,14 +1116,17 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
         // Send the JavaScript array and estimated total count through the callback
         const unsigned argc = 3;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        timer.finish(0, 0);
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -600,14 +1157,16 @@ void BufferedOstrichStore::SearchTriplesVersion(Nan::NAN_METHOD_ARGS_TYPE info)
     std::string p(*Nan::Utf8String(info[1]));
     std::string o(*Nan::Utf8String(info[2]));
 
-    int offset = info[3]->Int32Value(Nan::GetCurrentContext()).FromJust();
-
-    TripleVersionsIterator* it = thisStore->GetController()->get_version(StringTriple(s, p, o), offset);
-
-    v8::Local<v8::Object> queryProcessor = Nan::NewInstance(Nan::New(VersionQueryProcessor::GetConstructor())).ToLocalChecked();
-    new VersionQueryProcessor(it, queryProcessor);
+    ContinuationToken state;
+    state.type = CONTINUATION_VERSION;
+    state.subject = s;
+    state.predicate = p;
+    state.object = o;
+    state.position = info[3]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    state.version_start = state.version_end = -1;
+    state.max_version = thisStore->GetVisibleVersion();
 
-    info.GetReturnValue().Set(queryProcessor);
+    info.GetReturnValue().Set(NewQueryProcessor(thisStore, state));
 }
 
 /******** CountTriplesVersion ********/
@@ -619,17 +1178,21 @@ class CountTriplesVersionWorker : public Nan::AsyncWorker {
     // Callback return values
     uint32_t totalCount;
     bool hasExactCount;
+    OperationTimer timer;
 
 public:
     CountTriplesVersionWorker(BufferedOstrichStore *store, std::string subject, std::string predicate, std::string object, Nan::Callback *callback, v8::Local<v8::Object> self)
             : Nan::AsyncWorker(callback),
-              store(store), subject(std::move(subject)), predicate(std::move(predicate)), object(std::move(object)), totalCount(0) {
+              store(store), subject(std::move(subject)), predicate(std::move(predicate)), object(std::move(object)), totalCount(0),
+              timer(store->GetStats(), STATS_OPERATION_COUNT) {
         SaveToPersistent("self", self);
     };
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
         try {
-            Controller *controller = store->GetController();
+            Controller *controller = OpenController(store);
 
             // Prepare the triple pattern
             StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
@@ -645,15 +1208,18 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
 
         // Send the JavaScript array and estimated total count through the callback
         const unsigned argc = 3;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        timer.finish(0, 0);
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -674,11 +1240,184 @@ void BufferedOstrichStore::CountTriplesVersion(Nan::NAN_METHOD_ARGS_TYPE info) {
 }
 
 
+/******** Resume ********/
+
+// JavaScript signature: _resume(token), which returns {type, processor}
+// with type 'versionMaterialized', 'deltaMaterialized' or 'version'.
+void BufferedOstrichStore::Resume(Nan::NAN_METHOD_ARGS_TYPE info) {
+    assert(info.Length() >= 1);
+    auto thisStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+
+    ContinuationToken state;
+    try {
+        state = ContinuationToken::deserialize(*Nan::Utf8String(info[0]));
+    } catch (const std::runtime_error &error) {
+        return Nan::ThrowError(error.what());
+    }
+
+    // Versions are only ever appended, so VM and DM results remain valid as long as their versions exist
+    int max_version = thisStore->GetVisibleVersion();
+    if (state.type == CONTINUATION_VERSION && state.max_version != max_version) {
+        return Nan::ThrowError("The continuation token is outdated, as versions have been appended since");
+    }
+    if (state.version_end > max_version) {
+        return Nan::ThrowError(("The continuation token refers to version " + std::to_string(state.version_end)
+                                + ", which does not exist in this store").c_str());
+    }
+
+    const char *type = state.type == CONTINUATION_VERSION_MATERIALIZED ? "versionMaterialized"
+                       : state.type == CONTINUATION_DELTA_MATERIALIZED ? "deltaMaterialized" : "version";
+    v8::Local<v8::Object> result = Nan::New<v8::Object>();
+    Nan::Set(result, Nan::New("type").ToLocalChecked(), Nan::New(type).ToLocalChecked());
+    Nan::Set(result, Nan::New("processor").ToLocalChecked(), NewQueryProcessor(thisStore, state));
+    info.GetReturnValue().Set(result);
+}
+
+/******** JoinVersionMaterialized ********/
+
+// Variables in the patterns are prefixed with '?', and empty components are wildcards.
+void BufferedOstrichStore::JoinVersionMaterialized(Nan::NAN_METHOD_ARGS_TYPE info) {
+    assert(info.Length() >= 7);
+    auto thisStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+
+    JoinPattern left{*Nan::Utf8String(info[0]), *Nan::Utf8String(info[1]), *Nan::Utf8String(info[2])};
+    JoinPattern right{*Nan::Utf8String(info[3]), *Nan::Utf8String(info[4]), *Nan::Utf8String(info[5])};
+    int version = info[6]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    version = version >= 0 ? version : thisStore->GetVisibleVersion();
+
+    v8::Local<v8::Object> bindingsProcessor = Nan::NewInstance(Nan::New(BindingsProcessor::GetConstructor())).ToLocalChecked();
+    new BindingsProcessor(thisStore, [thisStore, left, right, version]() -> BindingIterator * {
+        return new BindJoinIterator(thisStore->GetController(), left, right, version, thisStore->GetTermCache());
+    }, thisStore->GetStats(), bindingsProcessor);
+
+    info.GetReturnValue().Set(bindingsProcessor);
+}
+
+/******** SearchBgpVersionMaterialized ********/
+
+// Patterns are passed as a flat array of subjects, predicates and objects,
+// in which variables are prefixed with '?', and empty components are wildcards.
+void BufferedOstrichStore::SearchBgpVersionMaterialized(Nan::NAN_METHOD_ARGS_TYPE info) {
+    assert(info.Length() >= 2);
+    auto thisStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+
+    v8::Local<v8::Array> patternsArray = info[0].As<v8::Array>();
+    std::vector<JoinPattern> patterns;
+    for (uint32_t i = 0; i + 2 < patternsArray->Length(); i += 3) {
+        patterns.push_back(JoinPattern{*Nan::Utf8String(Nan::Get(patternsArray, i).ToLocalChecked()),
+                                       *Nan::Utf8String(Nan::Get(patternsArray, i + 1).ToLocalChecked()),
+                                       *Nan::Utf8String(Nan::Get(patternsArray, i + 2).ToLocalChecked())});
+    }
+    int version = info[1]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    version = version >= 0 ? version : thisStore->GetVisibleVersion();
+
+    v8::Local<v8::Object> bindingsProcessor = Nan::NewInstance(Nan::New(BindingsProcessor::GetConstructor())).ToLocalChecked();
+    new BindingsProcessor(thisStore, [thisStore, patterns, version]() -> BindingIterator * {
+        return new BgpIterator(thisStore->GetController(), patterns, version, thisStore->GetTermCache());
+    }, thisStore->GetStats(), bindingsProcessor);
+
+    info.GetReturnValue().Set(bindingsProcessor);
+}
+
+/******** DecodeTripleIds ********/
+
+class DecodeTripleIdsWorker : public Nan::AsyncWorker {
+    BufferedOstrichStore *store;
+    std::shared_ptr<TermCache> cache;
+    // JavaScript function arguments
+    std::vector<double> ids;
+    int version;
+    // Callback return values
+    std::vector<std::string> terms;
+    OperationTimer timer;
+
+public:
+    DecodeTripleIdsWorker(BufferedOstrichStore *store, const double *ids, size_t count, int32_t version,
+                          Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback),
+              store(store), cache(store->GetTermCache()), ids(ids, ids + count), version(version),
+              timer(store->GetStats(), STATS_OPERATION_DECODE) {
+        SaveToPersistent("self", self);
+    };
+
+    void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
+        try {
+            Controller *controller = OpenController(store);
+
+            // Check version
+            version = version >= 0 ? version : store->GetVisibleVersion();
+            std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(version);
+
+            // Decode all ids, hot terms will come straight from the cache.
+            // Ids come from JavaScript, so ids that are not in the dictionary are rejected instead of being looked up.
+            terms.reserve(ids.size());
+            for (size_t i = 0; i < ids.size(); i++) {
+                hdt::TripleComponentRole role = i % 3 == 0 ? hdt::SUBJECT : i % 3 == 1 ? hdt::PREDICATE : hdt::OBJECT;
+                if (!TermCache::is_valid_id(*dict, ids[i], role)) {
+                    throw std::runtime_error("Invalid triple id at index " + std::to_string(i) + ": "
+                                             + std::to_string(ids[i]) + " is not a term id of version " + std::to_string(version));
+                }
+                terms.push_back(cache->get(*dict, (size_t) ids[i], role));
+            }
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+        }
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+
+        // Convert the triples into a JavaScript object array
+        uint32_t count = 0;
+        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(terms.size() / 3);
+        const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
+        const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
+        const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
+        uint64_t bytes = 0;
+        for (size_t i = 0; i + 2 < terms.size(); i += 3) {
+            v8::Local<v8::Object> tripleObject = Nan::New<v8::Object>();
+            bytes += SetTerm(tripleObject, SUBJECT, terms[i]);
+            bytes += SetTerm(tripleObject, PREDICATE, terms[i + 1]);
+            bytes += SetTerm(tripleObject, OBJECT, terms[i + 2]);
+            triplesArray->Set(Nan::GetCurrentContext(), count++, tripleObject);
+        }
+
+        const unsigned argc = 2;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray};
+        timer.finish(terms.size() / 3, bytes);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+void BufferedOstrichStore::DecodeTripleIds(Nan::NAN_METHOD_ARGS_TYPE info) {
+    assert(info.Length() >= 3);
+    auto thisStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+
+    v8::Local<v8::Object> ids = info[0].As<v8::Object>();
+    int version = info[1]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    auto callback = new Nan::Callback(info[2].As<v8::Function>());
+    auto self = info[3]->IsObject() ? info[3].As<v8::Object>() : info.This();
+
+    Nan::AsyncQueueWorker(new DecodeTripleIdsWorker(thisStore, (const double *) node::Buffer::Data(ids),
+                                                    node::Buffer::Length(ids) / sizeof(double), version, callback, self));
+}
+
+
 /******** MaxVersion ********/
 
 void BufferedOstrichStore::MaxVersion(v8::Local<v8::String> property, Nan::NAN_PROPERTY_GETTER_ARGS_TYPE info) {
     auto *ostrichStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
-    info.GetReturnValue().Set(Nan::New<v8::Integer>(ostrichStore->GetController()->get_max_patch_id()));
+    info.GetReturnValue().Set(Nan::New<v8::Integer>(ostrichStore->GetVisibleVersion()));
 }
 
 /******** Features ********/
@@ -688,104 +1427,148 @@ void BufferedOstrichStore::Features(v8::Local<v8::String> property, Nan::NAN_PRO
     info.GetReturnValue().Set(Nan::New<v8::Integer>(ostrichStore->features));
 }
 
+/******** Stats ********/
+
+// The stats are kept by the store, and remain readable once it is closed
+void BufferedOstrichStore::Stats(Nan::NAN_METHOD_ARGS_TYPE info) {
+    auto *ostrichStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+    info.GetReturnValue().Set(ostrichStore->stats->ToObject());
+}
+
+/******** Tracing ********/
+
+// Starts recording the spans of all batches and appends that are created from now on
+void BufferedOstrichStore::StartTracing(Nan::NAN_METHOD_ARGS_TYPE info) {
+    auto *ostrichStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+    ostrichStore->tracer->start();
+}
+
+// Stops recording spans, and returns the recorded spans as a Chrome trace object
+void BufferedOstrichStore::StopTracing(Nan::NAN_METHOD_ARGS_TYPE info) {
+    auto *ostrichStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+    info.GetReturnValue().Set(ostrichStore->tracer->stop());
+}
+
+/******** Slow query log ********/
+
+// Logs the batches of iterators that execute for at least the threshold in milliseconds,
+// or no batches if the threshold is negative
+void BufferedOstrichStore::SetSlowQueryLog(Nan::NAN_METHOD_ARGS_TYPE info) {
+    assert(info.Length() >= 3);
+    auto *ostrichStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+    double threshold = info[0]->NumberValue(Nan::GetCurrentContext()).FromJust();
+    ostrichStore->slow_queries->configure(threshold < 0 ? -1 : (int64_t) (threshold * 1000),
+                                          info[1]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                          *Nan::Utf8String(info[2]));
+}
+
+// Returns the latest slow batches, from the oldest to the latest
+void BufferedOstrichStore::SlowQueries(Nan::NAN_METHOD_ARGS_TYPE info) {
+    auto *ostrichStore = Nan::ObjectWrap::Unwrap<BufferedOstrichStore>(info.This());
+    info.GetReturnValue().Set(ostrichStore->slow_queries->ToArray());
+}
+
 /******** Append ********/
 
 class AppendWorker : public Nan::AsyncWorker {
     BufferedOstrichStore *store;
     int version;
-    PatchElementIteratorVector *it_patch = nullptr;
-    IteratorTripleStringVector *it_snapshot = nullptr;
-    std::vector<PatchElement> *elements_patch;
-    std::vector<hdt::TripleString> *elements_snapshot;
-    std::shared_ptr<DictionaryManager> dict;
+    // The triples are only encoded once the write lock is held, as encoding adds terms to the dictionary
+    std::vector<hdt::TripleString> triples;
+    std::vector<bool> additions;
     uint32_t insertedCount = 0;
+    OperationTimer timer;
+    OperationTrace trace;
 
 public:
     AppendWorker(BufferedOstrichStore *store, int version, v8::Local<v8::Array> triples, Nan::Callback *callback, v8::Local<v8::Object> self)
-            : Nan::AsyncWorker(callback), store(store) {
+            : Nan::AsyncWorker(callback), store(store), version(version), timer(store->GetStats(), STATS_OPERATION_APPEND),
+              trace(store->GetTracer(), "append") {
         SaveToPersistent("self", self);
+        trace.arg("triples", (int64_t) triples->Length());
+        auto converting = trace.span("convert");
         // For lower memory usage, we would have to use the (streaming) patch builder.
+        const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
+        const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
+        const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
+        const v8::Local<v8::String> ADDITION = Nan::New("addition").ToLocalChecked();
+        this->triples.reserve(triples->Length());
+        additions.reserve(triples->Length());
+        for (uint32_t i = 0; i < triples->Length(); i++) {
+            v8::Local<v8::Object> tripleObject = triples->Get(Nan::GetCurrentContext(), i).ToLocalChecked()->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+            std::string subject = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), SUBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
+            std::string predicate = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), PREDICATE).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
+            std::string object = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), OBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
+            bool addition = tripleObject->Get(Nan::GetCurrentContext(), ADDITION).ToLocalChecked()->BooleanValue(v8::Isolate::GetCurrent());
+            this->triples.emplace_back(subject, predicate, object);
+            additions.push_back(addition);
+        }
+    };
+
+    void Execute() override {
+        auto executing = timer.execute();
+        auto tracing = trace.span("execute");
+        tracing.count("queueWait", (int64_t) trace.since_created());
+        // Queries wait for the append, so that they never observe a partially appended version
+        auto lock = store->LockWrite();
+        auto writing = trace.span("write");
         try {
             Controller *controller = store->GetController();
+            if (controller == nullptr) {
+                throw std::runtime_error("Attempted to append to a closed OSTRICH store");
+            }
 
             // Check version
-            this->version = version >= 0 ? version : controller->get_max_patch_id() + 1;
+            version = version >= 0 ? version : controller->get_max_patch_id() + 1;
+            tracing.count("version", version);
 
-            const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
-            const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
-            const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
-            const v8::Local<v8::String> ADDITION = Nan::New("addition").ToLocalChecked();
-
-            // Prepare the iterator
-            elements_patch = new std::vector<PatchElement>();
-            elements_snapshot = new std::vector<hdt::TripleString>();
+            // Insert
             if (version == 0) {
-                for (uint32_t i = 0; i < triples->Length(); i++) {
-                    v8::Local<v8::Object> tripleObject = triples->Get(Nan::GetCurrentContext(), i).ToLocalChecked()->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
-                    std::string subject = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), SUBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    std::string predicate = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), PREDICATE).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    std::string object = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), OBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    bool addition = tripleObject->Get(Nan::GetCurrentContext(), ADDITION).ToLocalChecked()->BooleanValue(v8::Isolate::GetCurrent());
-                    if (!addition) {
-                        SetErrorMessage("All triples of the initial snapshot MUST be additions, but a deletion was found.");
-                        it_snapshot = nullptr;
-                        break;
-                    }
-                    elements_snapshot->push_back(hdt::TripleString(subject, predicate, object));
+                if (std::find(additions.begin(), additions.end(), false) != additions.end()) {
+                    throw std::runtime_error("All triples of the initial snapshot MUST be additions, but a deletion was found.");
                 }
-                it_snapshot = new IteratorTripleStringVector(elements_snapshot);
-            } else {
-                dict = controller->get_dictionary_manager(0);
-                for (uint32_t i = 0; i < triples->Length(); i++) {
-                    v8::Local<v8::Object> tripleObject = triples->Get(Nan::GetCurrentContext(), i).ToLocalChecked()->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
-                    std::string subject = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), SUBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    std::string predicate = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), PREDICATE).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    std::string object = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), OBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    bool addition = tripleObject->Get(Nan::GetCurrentContext(), ADDITION).ToLocalChecked()->BooleanValue(v8::Isolate::GetCurrent());
-                    PatchElement element(Triple(subject, predicate, object, dict), addition);
-                    elements_patch->push_back(element);
-                    insertedCount++;
-                }
-                it_patch = new PatchElementIteratorVector(elements_patch);
-            }
-        } catch (const runtime_error& error) {
-            SetErrorMessage(error.what());
-        }
-    };
-
-    void Execute() override {
-        try {
-            // Insert
-            Controller *controller = store->GetController();
-            if (it_patch) {
-                controller->append(it_patch, version, dict, false); // For debugging, add: new StdoutProgressListener()
-            } else if (it_snapshot) {
+                IteratorTripleStringVector it_snapshot(&triples);
                 std::cout.setstate(std::ios_base::failbit); // Disable cout info from HDT
-                std::shared_ptr<hdt::HDT> hdt = controller->get_snapshot_manager()->create_snapshot(version, it_snapshot, "<http://example.org>");
+                std::shared_ptr<hdt::HDT> hdt = controller->get_snapshot_manager()->create_snapshot(version, &it_snapshot, "<http://example.org>");
                 std::cout.clear();
                 insertedCount = hdt->getTriples()->getNumberOfElements();
+            } else {
+                std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(0);
+                std::vector<PatchElement> elements;
+                elements.reserve(triples.size());
+                for (size_t i = 0; i < triples.size(); i++) {
+                    elements.emplace_back(Triple(triples[i].getSubject(), triples[i].getPredicate(), triples[i].getObject(), dict), additions[i]);
+                }
+                PatchElementIteratorVector it_patch(&elements);
+                controller->append(&it_patch, version, dict, false); // For debugging, add: new StdoutProgressListener()
+                insertedCount = elements.size();
             }
-            delete elements_patch;
-            delete elements_snapshot;
+            store->PublishVersions();
+            // Cached terms may refer to dictionaries that were replaced by this append
+            store->GetTermCache()->clear();
         }
         catch (const runtime_error& error) {
+            std::cout.clear();
             SetErrorMessage(error.what());
         }
-        delete it_patch;
-        delete it_snapshot;
     }
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
+        auto marshalling = trace.span("marshal");
 
         // Send the JavaScript array and estimated total count through the callback
         const unsigned argc = 2;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>(insertedCount)};
+        timer.finish(insertedCount, 0);
+        marshalling.end();
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
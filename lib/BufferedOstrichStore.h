@@ -1,24 +1,58 @@
 #ifndef OSTRICH_BUFFEREDOSTRICHSTORE_H
 #define OSTRICH_BUFFEREDOSTRICHSTORE_H
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <nan.h>
 
 #include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "BgpIterator.h"
+#include "BindJoin.h"
+#include "ContinuationToken.h"
+#include "QueryStats.h"
+#include "QueryTrace.h"
+#include "SlowQueryLog.h"
+#include "TermCache.h"
 
 
+class BufferedOstrichStore;
+
+// Query processors create their iterator on the first batch, and recreate it at their position after an append,
+// as appends invalidate the iterators of the controller.
 class VersionMaterializationProcessor: public Nan::ObjectWrap {
 private:
+    BufferedOstrichStore *store;
     std::unique_ptr<TripleIterator> iterator;
+    // The write generation of the store when the iterator was created
+    uint64_t generation{0};
     std::shared_ptr<DictionaryManager> dict;
+    std::shared_ptr<TermCache> cache;
+    std::shared_ptr<QueryStats> stats;
+    std::shared_ptr<QueryTracer> tracer;
+    std::shared_ptr<SlowQueryLog> slow_queries;
+    ContinuationToken state;
 
     static NAN_METHOD(New);
-    // VersionMaterializationProcessor::next(number, callback, self)
+    // VersionMaterializationProcessor::next(number, callback, self, cancellation)
     static NAN_METHOD(Next);
+    // VersionMaterializationProcessor::continuationToken(unconsumed)
+    static NAN_METHOD(GetContinuationToken);
+    // VersionMaterializationProcessor::nextIds(number, callback, self, cancellation)
+    static NAN_METHOD(NextIds);
 
     static Nan::Persistent<v8::Function> constructor;
 public:
-    VersionMaterializationProcessor(TripleIterator* vm_iterator, std::shared_ptr<DictionaryManager> dict, const v8::Local<v8::Object> &handle);
+    VersionMaterializationProcessor(BufferedOstrichStore *store, std::shared_ptr<TermCache> cache, std::shared_ptr<QueryStats> stats,
+                                    std::shared_ptr<QueryTracer> tracer, std::shared_ptr<SlowQueryLog> slow_queries,
+                                    ContinuationToken state, const v8::Local<v8::Object> &handle);
+
+    // Returns the iterator at the current position, must be called while holding the read lock of the store
+    TripleIterator *GetIterator();
+    // Returns the dictionary of the version of the iterator, must be called after GetIterator
+    DictionaryManager &GetDictionary() { return *dict; }
 
     static const Nan::Persistent<v8::Function> &GetConstructor();
 };
@@ -26,16 +60,31 @@ public:
 
 class DeltaMaterializationProcessor: public Nan::ObjectWrap {
 private:
+    BufferedOstrichStore *store;
     std::unique_ptr<TripleDeltaIterator> iterator;
+    // The write generation of the store when the iterator was created
+    uint64_t generation{0};
+    std::shared_ptr<TermCache> cache;
+    std::shared_ptr<QueryStats> stats;
+    std::shared_ptr<QueryTracer> tracer;
+    std::shared_ptr<SlowQueryLog> slow_queries;
+    ContinuationToken state;
 
     static NAN_METHOD(New);
-    // DeltaMaterializationProcessor::next(number, callback, self)
+    // DeltaMaterializationProcessor::next(number, callback, self, cancellation)
     static NAN_METHOD(Next);
+    // DeltaMaterializationProcessor::continuationToken(unconsumed)
+    static NAN_METHOD(GetContinuationToken);
 
     static Nan::Persistent<v8::Function> constructor;
 
 public:
-    explicit DeltaMaterializationProcessor(TripleDeltaIterator* dm_iterator, const v8::Local<v8::Object> &handle);
+    DeltaMaterializationProcessor(BufferedOstrichStore *store, std::shared_ptr<TermCache> cache, std::shared_ptr<QueryStats> stats,
+                                    std::shared_ptr<QueryTracer> tracer, std::shared_ptr<SlowQueryLog> slow_queries,
+                                    ContinuationToken state, const v8::Local<v8::Object> &handle);
+
+    // Returns the iterator at the current position, must be called while holding the read lock of the store
+    TripleDeltaIterator *GetIterator();
 
     static const Nan::Persistent<v8::Function> &GetConstructor();
 };
@@ -43,16 +92,58 @@ public:
 
 class VersionQueryProcessor: public Nan::ObjectWrap {
 private:
+    BufferedOstrichStore *store;
     std::unique_ptr<TripleVersionsIterator> iterator;
+    std::shared_ptr<TermCache> cache;
+    std::shared_ptr<QueryStats> stats;
+    std::shared_ptr<QueryTracer> tracer;
+    std::shared_ptr<SlowQueryLog> slow_queries;
+    ContinuationToken state;
 
     static NAN_METHOD(New);
-    // VersionQueryProcessor::next(number, callback, self)
+    // VersionQueryProcessor::next(number, callback, self, cancellation)
     static NAN_METHOD(Next);
+    // VersionQueryProcessor::continuationToken(unconsumed)
+    static NAN_METHOD(GetContinuationToken);
 
     static Nan::Persistent<v8::Function> constructor;
 
 public:
-    explicit VersionQueryProcessor(TripleVersionsIterator* vq_iterator, const v8::Local<v8::Object> &handle);
+    VersionQueryProcessor(BufferedOstrichStore *store, std::shared_ptr<TermCache> cache, std::shared_ptr<QueryStats> stats,
+                                    std::shared_ptr<QueryTracer> tracer, std::shared_ptr<SlowQueryLog> slow_queries,
+                                    ContinuationToken state, const v8::Local<v8::Object> &handle);
+
+    // Returns the iterator at the current position, must be called while holding the read lock of the store.
+    // The versions of triples change with every append, so the iterator fails once a version has been appended since the query.
+    TripleVersionsIterator *GetIterator();
+
+    static const Nan::Persistent<v8::Function> &GetConstructor();
+};
+
+
+class BindingsProcessor: public Nan::ObjectWrap {
+private:
+    BufferedOstrichStore *store;
+    std::function<BindingIterator *()> create_iterator;
+    std::unique_ptr<BindingIterator> iterator;
+    // The write generation of the store when the iterator was created
+    uint64_t generation{0};
+    // The number of bindings that have been returned, which a recreated iterator skips
+    uint64_t position{0};
+    std::shared_ptr<QueryStats> stats;
+
+    static NAN_METHOD(New);
+    // BindingsProcessor::next(number, callback, self)
+    static NAN_METHOD(Next);
+
+    static Nan::Persistent<v8::Function> constructor;
+
+public:
+    BindingsProcessor(BufferedOstrichStore *store, std::function<BindingIterator *()> create_iterator, std::shared_ptr<QueryStats> stats,
+                      const v8::Local<v8::Object> &handle);
+
+    // Returns the iterator after the returned bindings, must be called while holding the read lock of the store
+    BindingIterator *GetIterator();
 
     static const Nan::Persistent<v8::Function> &GetConstructor();
 };
@@ -63,6 +154,14 @@ private:
     Controller *controller;
     int features;
     std::string path;
+    std::shared_ptr<TermCache> term_cache;
+    std::shared_ptr<QueryStats> stats;
+    std::shared_ptr<QueryTracer> tracer;
+    std::shared_ptr<SlowQueryLog> slow_queries;
+    std::shared_mutex controller_mutex;
+    std::mutex writer_gate;
+    std::atomic<uint64_t> write_generation;
+    std::atomic<int> visible_version;
 
     // Construction and destruction
     ~BufferedOstrichStore() override;
@@ -86,6 +185,18 @@ private:
     // OstrichStore#_countTriplesVersion(subject, predicate, object, callback, self)
     static NAN_METHOD(CountTriplesVersion);
 
+    // OstrichStore#_resume(token)
+    static NAN_METHOD(Resume);
+
+    // OstrichStore#_joinVersionMaterialized(leftSubject, leftPredicate, leftObject, rightSubject, rightPredicate, rightObject, version, self)
+    static NAN_METHOD(JoinVersionMaterialized);
+
+    // OstrichStore#_searchBgpVersionMaterialized(patterns, version, self)
+    static NAN_METHOD(SearchBgpVersionMaterialized);
+
+    // OstrichStore#_decodeTripleIds(ids, version, callback, self)
+    static NAN_METHOD(DecodeTripleIds);
+
     // OstrichStore#maxVersion
     static NAN_PROPERTY_GETTER(MaxVersion);
 
@@ -95,6 +206,19 @@ private:
     // OstrichStore#_features
     static NAN_PROPERTY_GETTER(Features);
 
+    // OstrichStore#_stats()
+    static NAN_METHOD(Stats);
+
+    // OstrichStore#_startTracing()
+    static NAN_METHOD(StartTracing);
+    // OstrichStore#_stopTracing()
+    static NAN_METHOD(StopTracing);
+
+    // OstrichStore#_setSlowQueryLog(threshold, capacity, file)
+    static NAN_METHOD(SetSlowQueryLog);
+    // OstrichStore#_slowQueries()
+    static NAN_METHOD(SlowQueries);
+
     // OstrichStore#_close([remove], [callback], [self])
     static NAN_METHOD(Close);
 
@@ -104,7 +228,7 @@ private:
     static Nan::Persistent<v8::Function> constructor;
 
 public:
-    BufferedOstrichStore(std::string path, const v8::Local<v8::Object> &handle, Controller *controller);
+    BufferedOstrichStore(std::string path, const v8::Local<v8::Object> &handle, Controller *controller, size_t term_cache_size);
 
     static NAN_METHOD(Create);
 
@@ -113,6 +237,28 @@ public:
 
     // Accessors
     Controller *GetController() { return controller; }
+    // Queries hold a read lock while they use the controller, and appends hold the write lock while they modify it,
+    // like in OstrichStore, including the gate that lets a pending append precede new queries.
+    std::shared_lock<std::shared_mutex> LockRead() {
+        { std::lock_guard<std::mutex> gate(writer_gate); }
+        return std::shared_lock<std::shared_mutex>(controller_mutex);
+    }
+    std::unique_lock<std::shared_mutex> LockWrite() {
+        std::lock_guard<std::mutex> gate(writer_gate);
+        std::unique_lock<std::shared_mutex> lock(controller_mutex);
+        write_generation++;
+        return lock;
+    }
+    // Changes whenever the write lock is taken, so that query processors can detect that their iterators have to be recreated
+    [[nodiscard]] uint64_t GetWriteGeneration() const { return write_generation.load(); }
+    // The latest version of which the append has completed, to which queries without a version are pinned
+    [[nodiscard]] int GetVisibleVersion() const { return visible_version.load(); }
+    // Makes the appended versions visible, must be called while holding the write lock
+    void PublishVersions() { visible_version = controller->get_max_patch_id(); }
+    std::shared_ptr<TermCache> GetTermCache() { return term_cache; }
+    std::shared_ptr<QueryStats> GetStats() { return stats; }
+    std::shared_ptr<QueryTracer> GetTracer() { return tracer; }
+    std::shared_ptr<SlowQueryLog> GetSlowQueryLog() { return slow_queries; }
 };
 
 
@@ -1,31 +1,238 @@
 import * as fs from 'fs';
 import type * as RDF from '@rdfjs/types';
-import { stringQuadToQuad, termToString, quadToStringQuad } from 'rdf-string';
-import type { IBufferedOstrichStoreNative,
+import { stringQuadToQuad, stringToTerm, termToString, quadToStringQuad } from 'rdf-string';
+import type { IBindingsProcessor,
+  IBufferedOstrichStoreNative,
   IQueryProcessor,
   IVersionMaterializationProcessor,
   IVersionQueryProcessor,
   IDeltaMaterializationProcessor } from './IBufferedOstrichStoreNative';
-import type { IQuadDelta } from './utils';
-import { serializeTerm, strcmp } from './utils';
+import type { IQueryCancellationNative, IQueryCancellationOptions } from './QueryCancellation';
+import { createQueryCancellation } from './QueryCancellation';
+import type { IStoreStats } from './QueryStats';
+import type { ITrace } from './QueryTrace';
+import type { ISlowQuery, ISlowQueryLogOptions } from './SlowQueryLog';
+import type { IQuadDelta, ITriplePattern } from './utils';
+import { QueryStream } from './QueryStream';
+import { serializeTerm, strcmp, tripleIdsFromBuffer, tripleIdsToBuffer } from './utils';
 const ostrichNative = require('../build/Release/ostrich-buffered.node');
 
+/**
+ * Convert a term in a triple pattern to an OSTRICH-supported string,
+ * in which variables are retained as '?name', and other wildcards are empty.
+ * @param term An RDF/JS term.
+ */
+function serializePatternTerm(term: RDF.Term | undefined | null): string {
+  if (!term) {
+    return '';
+  }
+  return termToString(term);
+}
+
+/**
+ * Pick the cancellation options of a query, which override those of the store.
+ * @param options Query options.
+ */
+function cancellationOptions(options?: IQueryCancellationOptions): IQueryCancellationOptions {
+  const picked: IQueryCancellationOptions = {};
+  if (options && options.signal) {
+    picked.signal = options.signal;
+  }
+  if (options && options.timeout) {
+    picked.timeout = options.timeout;
+  }
+  return picked;
+}
+
+/**
+ * Options for iterating over query results in batches.
+ * If a signal or timeout stops the iteration, the results found so far are returned,
+ * after which the iterator is done and truncated.
+ */
+export interface IQueryIteratorOptions extends IQueryCancellationOptions {
+  /**
+   * If the next batch is fetched natively while the current one is being consumed, defaults to true.
+   */
+  prefetch?: boolean;
+  /**
+   * The maximum number of triples in a batch, up to which batches grow while consumers wait for them,
+   * defaults to eight times the initial buffer size.
+   */
+  maxBufferSize?: number;
+  /**
+   * The approximate number of bytes of terms in a batch, beyond which batches shrink, defaults to 8 MiB.
+   */
+  maxBufferBytes?: number;
+}
+
 /**
  * An abstract defining how results from OSTRICH are iterated
  */
 export abstract class QueryIterator {
+  private readonly prefetch: boolean;
+  private readonly maxBufferSize: number;
+  private readonly maxBufferBytes: number;
+  private _currentBufferSize: number;
+  // The number of triples of which the terms are expected to fit in the maximum number of bytes
+  private bufferSizeForBytes = Number.POSITIVE_INFINITY;
+  private pending?: Promise<[boolean, RDF.Quad[]]>;
+  private pendingReady = false;
+  // The batch that is being fetched natively, of which the worker still uses the native iterator
+  private fetching?: Promise<[boolean, RDF.Quad[]]>;
+  // The number of fetched triples that have not been returned by next yet
+  private undelivered = 0;
+  private done = false;
+  private finished = false;
+  private _truncated = false;
+  protected readonly cancellation?: IQueryCancellationNative;
+  private readonly disposeCancellation: () => void;
+
   protected constructor(
     public readonly bufferSize: number,
     protected readonly queryProcessor: IQueryProcessor,
     protected readonly finishCallback: (() => void),
-  ) {}
+    options: IQueryIteratorOptions = {},
+  ) {
+    this.prefetch = options.prefetch !== false;
+    this.maxBufferSize = Math.max(bufferSize, options.maxBufferSize || bufferSize * 8);
+    this.maxBufferBytes = options.maxBufferBytes || 8 * 1024 * 1024;
+    this._currentBufferSize = bufferSize;
+    const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
+    this.cancellation = cancellation;
+    this.disposeCancellation = dispose;
+  }
+
+  /**
+   * If the iteration was stopped by a signal or timeout before all results were returned.
+   * The remaining results can be obtained by resuming the continuation token.
+   */
+  public get truncated(): boolean {
+    return this._truncated;
+  }
+
+  /**
+   * The number of triples that will be requested for the next batch.
+   */
+  public get currentBufferSize(): number {
+    return this._currentBufferSize;
+  }
 
   /**
    * Return a tuple [done, quads]
    * done: if there is no more quads to come
    * quads: an array of quads
    */
-  public abstract next(): Promise<[boolean, RDF.Quad[]]>;
+  public async next(): Promise<[boolean, RDF.Quad[]]> {
+    if (this.done) {
+      return [ true, []];
+    }
+    if (!this.pending) {
+      this.pending = this.fetch();
+    } else if (!this.pendingReady) {
+      // The consumer is faster than native iteration, so larger batches reduce the overhead per triple
+      this._currentBufferSize = Math.min(this.maxBufferSize, this.bufferSizeForBytes, this._currentBufferSize * 2);
+    }
+    const batch = this.pending;
+    this.pending = undefined;
+    const [ done, quads ] = await batch;
+    this.undelivered -= quads.length;
+    if (done) {
+      this.done = true;
+    }
+    if (!this.done && this.prefetch) {
+      this.pending = this.fetch();
+    }
+    return [ done, quads ];
+  }
+
+  /**
+   * Return an opaque token from which the results after the ones returned so far can be iterated
+   * using BufferedOstrichStore#resume, also by another process that opened the same archive.
+   */
+  public continuationToken(): string {
+    return this.queryProcessor._continuationToken(this.undelivered);
+  }
+
+  /**
+   * Stop iterating before all results have been returned,
+   * so that the store can be closed once a prefetched batch has arrived.
+   */
+  public async close(): Promise<void> {
+    this.done = true;
+    this.pending = undefined;
+    if (this.fetching) {
+      await this.fetching.catch(() => {
+        // The error is irrelevant once the iterator is closed
+      });
+    }
+    this.finish();
+  }
+
+  /**
+   * Natively fetch the given number of triples, or less if the results are exhausted.
+   * @param size The number of triples.
+   * @param callback Callback for the fetched triples.
+   */
+  protected abstract fetchBatch(
+    size: number,
+    callback: (error: Error | undefined, quads: RDF.Quad[], truncated?: boolean) => void,
+  ): void;
+
+  private fetch(): Promise<[boolean, RDF.Quad[]]> {
+    const size = this._currentBufferSize;
+    this.pendingReady = false;
+    const batch = new Promise<[boolean, RDF.Quad[]]>((resolve, reject) => {
+      this.fetchBatch(size, (error, quads, truncated) => {
+        if (error) {
+          return reject(error);
+        }
+        if (truncated) {
+          this._truncated = true;
+        }
+        // The native position already includes these triples, so they are counted before any continuation token
+        this.pendingReady = true;
+        this.undelivered += quads.length;
+        this.limitBufferBytes(quads);
+        const done = quads.length < size;
+        if (done) {
+          this.finish();
+        }
+        resolve([ done, quads ]);
+      });
+    });
+    this.fetching = batch;
+    // Errors of prefetched batches are only reported once they are requested
+    const settle = (): void => {
+      if (this.fetching === batch) {
+        this.fetching = undefined;
+      }
+    };
+    batch.then(settle, settle);
+    return batch;
+  }
+
+  private finish(): void {
+    if (!this.finished) {
+      this.finished = true;
+      this.disposeCancellation();
+      this.finishCallback();
+    }
+  }
+
+  /**
+   * Limit the size of the next batches by the number of bytes of the terms in the given batch.
+   * @param quads A fetched batch.
+   */
+  private limitBufferBytes(quads: RDF.Quad[]): void {
+    let bytes = 0;
+    for (const quad of quads) {
+      bytes += quad.subject.value.length + quad.predicate.value.length + quad.object.value.length;
+    }
+    if (bytes > 0) {
+      this.bufferSizeForBytes = Math.max(1, Math.floor(this.maxBufferBytes * quads.length / bytes));
+      this._currentBufferSize = Math.min(this._currentBufferSize, this.bufferSizeForBytes);
+    }
+  }
 }
 
 /**
@@ -36,28 +243,62 @@ export class VMQueryIterator extends QueryIterator {
     public readonly bufferSize: number,
     protected readonly queryProcessor: IVersionMaterializationProcessor,
     protected readonly finishCallback: (() => void),
+    options?: IQueryIteratorOptions,
   ) {
-    super(bufferSize, queryProcessor, finishCallback);
+    super(bufferSize, queryProcessor, finishCallback, options);
   }
 
-  public async next(): Promise<[boolean, RDF.Quad[]]> {
+  protected fetchBatch(
+    size: number,
+    callback: (error: Error | undefined, quads: RDF.Quad[], truncated?: boolean) => void,
+  ): void {
+    this.queryProcessor._next(size, (error, quads, done, truncated) => {
+      if (error) {
+        return callback(error, []);
+      }
+      callback(undefined, quads.map(quad => stringQuadToQuad(quad)), truncated);
+    }, undefined, this.cancellation);
+  }
+}
+
+/**
+ * Iterate over the dictionary ids of VM query results.
+ */
+export class VMIdQueryIterator {
+  public constructor(
+    public readonly bufferSize: number,
+    protected readonly queryProcessor: IVersionMaterializationProcessor,
+    protected readonly finishCallback: (() => void),
+  ) {}
+
+  /**
+   * Return a tuple [done, ids]
+   * done: if there are no more triples to come
+   * ids: subject, predicate and object ids for each triple
+   */
+  public async next(): Promise<[boolean, Float64Array]> {
     return new Promise((resolve, reject) => {
-      this.queryProcessor._next(this.bufferSize, (error, quads) => {
-        const buffer: RDF.Quad[] = [];
+      this.queryProcessor._nextIds(this.bufferSize, (error, buffer) => {
         if (error) {
           return reject(error);
         }
-        quads.forEach(quad => {
-          buffer.push(stringQuadToQuad(quad));
-        });
-        const done = buffer.length < this.bufferSize;
+        const ids = tripleIdsFromBuffer(buffer);
+        const done = ids.length / 3 < this.bufferSize;
         if (done) {
           this.finishCallback();
         }
-        resolve([ done, buffer ]);
+        resolve([ done, ids ]);
       });
     });
   }
+
+  /**
+   * Return an opaque token from which the results after the ones returned so far can be iterated
+   * using BufferedOstrichStore#resume.
+   */
+  public continuationToken(): string {
+    return this.queryProcessor._continuationToken(0);
+  }
 }
 
 /**
@@ -68,29 +309,25 @@ export class DMQueryIterator extends QueryIterator {
     public readonly bufferSize: number,
     protected readonly queryProcessor: IDeltaMaterializationProcessor,
     protected readonly finishCallback: (() => void),
+    options?: IQueryIteratorOptions,
   ) {
-    super(bufferSize, queryProcessor, finishCallback);
+    super(bufferSize, queryProcessor, finishCallback, options);
   }
 
-  public async next(): Promise<[boolean, RDF.Quad[]]> {
-    return new Promise((resolve, reject) => {
-      this.queryProcessor._next(this.bufferSize, (error, quadsDM) => {
-        const buffer: RDF.Quad[] = [];
-        if (error) {
-          return reject(error);
-        }
-        quadsDM.forEach(quadDM => {
-          const quad = stringQuadToQuad(quadDM);
-          Object.assign(quad, { addition: quadDM.addition });
-          buffer.push(quad);
-        });
-        const done = buffer.length < this.bufferSize;
-        if (done) {
-          this.finishCallback();
-        }
-        resolve([ done, buffer ]);
-      });
-    });
+  protected fetchBatch(
+    size: number,
+    callback: (error: Error | undefined, quads: RDF.Quad[], truncated?: boolean) => void,
+  ): void {
+    this.queryProcessor._next(size, (error, quadsDM, done, truncated) => {
+      if (error) {
+        return callback(error, []);
+      }
+      callback(undefined, quadsDM.map(quadDM => {
+        const quad = stringQuadToQuad(quadDM);
+        Object.assign(quad, { addition: quadDM.addition });
+        return quad;
+      }), truncated);
+    }, undefined, this.cancellation);
   }
 }
 
@@ -102,21 +339,55 @@ export class VQQueryIterator extends QueryIterator {
     public readonly bufferSize: number,
     protected readonly queryProcessor: IVersionQueryProcessor,
     protected readonly finishCallback: (() => void),
+    options?: IQueryIteratorOptions,
   ) {
-    super(bufferSize, queryProcessor, finishCallback);
+    super(bufferSize, queryProcessor, finishCallback, options);
   }
 
-  public async next(): Promise<[boolean, RDF.Quad[]]> {
+  protected fetchBatch(
+    size: number,
+    callback: (error: Error | undefined, quads: RDF.Quad[], truncated?: boolean) => void,
+  ): void {
+    this.queryProcessor._next(size, (error, quadsV, done, truncated) => {
+      if (error) {
+        return callback(error, []);
+      }
+      callback(undefined, quadsV.map(quadV => {
+        const quad = stringQuadToQuad(quadV);
+        Object.assign(quad, { versions: quadV.versions });
+        return quad;
+      }), truncated);
+    }, undefined, this.cancellation);
+  }
+}
+
+/**
+ * Iterate over bindings, such as the results of a join.
+ */
+export class BindingsIterator {
+  public constructor(
+    public readonly bufferSize: number,
+    protected readonly bindingsProcessor: IBindingsProcessor,
+    protected readonly finishCallback: (() => void),
+  ) {}
+
+  /**
+   * Return a tuple [done, bindings]
+   * done: if there are no more bindings to come
+   * bindings: an array of bindings, each mapping variable names to terms
+   */
+  public async next(): Promise<[boolean, Record<string, RDF.Term>[]]> {
     return new Promise((resolve, reject) => {
-      this.queryProcessor._next(this.bufferSize, (error, quadsV) => {
-        const buffer: RDF.Quad[] = [];
+      this.bindingsProcessor._next(this.bufferSize, (error, stringBindings) => {
         if (error) {
           return reject(error);
         }
-        quadsV.forEach(quadV => {
-          const quad = stringQuadToQuad(quadV);
-          Object.assign(quad, { versions: quadV.versions });
-          buffer.push(quad);
+        const buffer = stringBindings.map(stringBinding => {
+          const binding: Record<string, RDF.Term> = {};
+          for (const variable of Object.keys(stringBinding)) {
+            binding[variable] = stringToTerm(stringBinding[variable]);
+          }
+          return binding;
         });
         const done = buffer.length < this.bufferSize;
         if (done) {
@@ -138,6 +409,7 @@ export class BufferedOstrichStore {
     public readonly bufferSize: number,
     public readonly readOnly: boolean,
     public readonly features: Record<string, boolean>,
+    public readonly iteratorOptions: IQueryIteratorOptions = {},
   ) {}
 
   /**
@@ -154,6 +426,59 @@ export class BufferedOstrichStore {
     return this.native.closed;
   }
 
+  /**
+   * The counters and latencies of all operations since the store was opened,
+   * which can still be read after the store was closed.
+   * Each operation is split into the time it waited for a thread, the time it executed,
+   * and the time of converting its results into JavaScript values.
+   */
+  public stats(): IStoreStats {
+    return this.native._stats();
+  }
+
+  /**
+   * Starts recording a span of each phase of all operations that are created from now on,
+   * and removes the spans of an earlier trace.
+   * Operations that are created while not tracing only check whether tracing is enabled.
+   */
+  public startTracing(): void {
+    this.native._startTracing();
+  }
+
+  /**
+   * Stops recording spans, and returns the spans that were recorded since tracing was started.
+   * The trace can be loaded in Perfetto or chrome://tracing after serializing it as JSON.
+   */
+  public stopTracing(): ITrace {
+    return this.native._stopTracing();
+  }
+
+  /**
+   * Logs the version-materialized, delta-materialized and version queries that execute longer than a threshold,
+   * together with estimations of the number of snapshot triples and changes that match their pattern.
+   * For iterators, every batch is logged separately, with the position of the batch as its offset.
+   * Without options, no more queries are logged, and the logged queries are removed.
+   * @param options The threshold in milliseconds, the number of slow queries to keep, and an optional file to append to.
+   */
+  public setSlowQueryLog(options?: ISlowQueryLogOptions): void {
+    if (!options) {
+      this.native._setSlowQueryLog(-1, 0, '');
+      return;
+    }
+    this.native._setSlowQueryLog(
+      Math.max(0, options.threshold),
+      options.capacity === undefined ? 100 : options.capacity,
+      options.file || '',
+    );
+  }
+
+  /**
+   * The latest queries that executed longer than the threshold of the slow query log, from the oldest to the latest.
+   */
+  public slowQueries(): ISlowQuery[] {
+    return this.native._slowQueries();
+  }
+
   /**
    * Searches the document for triples with the given subject, predicate, object and version
    * for a version materialized query.
@@ -166,7 +491,7 @@ export class BufferedOstrichStore {
     subject: RDF.Term | undefined | null,
     predicate: RDF.Term | undefined | null,
     object: RDF.Term | undefined | null,
-    options?: { offset?: number; version?: number },
+    options?: { offset?: number; version?: number } & IQueryCancellationOptions,
   ): VMQueryIterator {
     if (this.closed) {
       throw new Error('Attempted to query a closed OSTRICH store');
@@ -187,6 +512,224 @@ export class BufferedOstrichStore {
     return new VMQueryIterator(this.bufferSize, queryProcessor, () => {
       this.operations--;
       this.finishOperation();
+    }, { ...this.iteratorOptions, ...cancellationOptions(options) });
+  }
+
+  /**
+   * Searches the document for triples with the given subject, predicate, object and version
+   * for a version materialized query, and only returns their dictionary ids.
+   * Ids can be decoded using decodeTripleIds.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public searchTripleIdsVersionMaterialized(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options?: { offset?: number; version?: number },
+  ): VMIdQueryIterator {
+    if (this.closed) {
+      throw new Error('Attempted to query a closed OSTRICH store');
+    }
+    if (this.maxVersion < 0) {
+      throw new Error('Attempted to query an OSTRICH store without versions');
+    }
+    const offset = options && options.offset ? Math.max(0, options.offset) : 0;
+    const version = options && (options.version || options.version === 0) ? options.version : -1;
+    this.operations++;
+    const queryProcessor = this.native._searchTriplesVersionMaterialized(
+      serializeTerm(subject),
+      serializeTerm(predicate),
+      serializeTerm(object),
+      offset,
+      version,
+    );
+    return new VMIdQueryIterator(this.bufferSize, queryProcessor, () => {
+      this.operations--;
+      this.finishOperation();
+    });
+  }
+
+  /**
+   * Streams the triples with the given subject, predicate, object and version for a version materialized query.
+   * Batches are only fetched while fewer than highWaterMark triples are buffered.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public streamTriplesVersionMaterialized(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options?: { offset?: number; limit?: number; version?: number; highWaterMark?: number } & IQueryCancellationOptions,
+  ): QueryStream {
+    return new QueryStream(this.searchTriplesVersionMaterialized(subject, predicate, object, options), options);
+  }
+
+  /**
+   * Streams the triples with the given subject, predicate, object, versionStart and versionEnd
+   * for a delta materialized query, annotated with addition: true or false.
+   * Batches are only fetched while fewer than highWaterMark triples are buffered.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public streamTriplesDeltaMaterialized(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options: {
+      offset?: number; limit?: number; versionStart: number; versionEnd: number; highWaterMark?: number;
+    } & IQueryCancellationOptions,
+  ): QueryStream {
+    return new QueryStream(this.searchTriplesDeltaMaterialized(subject, predicate, object, options), options);
+  }
+
+  /**
+   * Streams the triples with the given subject, predicate and object for a version query,
+   * annotated with the versions in which they exist.
+   * Batches are only fetched while fewer than highWaterMark triples are buffered.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public streamTriplesVersion(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options?: { offset?: number; limit?: number; highWaterMark?: number } & IQueryCancellationOptions,
+  ): QueryStream {
+    return new QueryStream(this.searchTriplesVersion(subject, predicate, object, options), options);
+  }
+
+  /**
+   * Continues a VM, DM or VQ query from a token that was obtained from its iterator,
+   * without iterating over the results that were returned before the token was obtained.
+   * VM and DM tokens remain valid after appends, but VQ tokens can only be resumed until the next append.
+   * @param token A continuation token.
+   */
+  public resume(token: string): VMQueryIterator | DMQueryIterator | VQQueryIterator {
+    if (this.closed) {
+      throw new Error('Attempted to query a closed OSTRICH store');
+    }
+    const resumed = this.native._resume(token);
+    this.operations++;
+    const finishCallback = (): void => {
+      this.operations--;
+      this.finishOperation();
+    };
+    switch (resumed.type) {
+      case 'versionMaterialized':
+        return new VMQueryIterator(this.bufferSize, resumed.processor, finishCallback, this.iteratorOptions);
+      case 'deltaMaterialized':
+        return new DMQueryIterator(this.bufferSize, resumed.processor, finishCallback, this.iteratorOptions);
+      case 'version':
+        return new VQQueryIterator(this.bufferSize, resumed.processor, finishCallback, this.iteratorOptions);
+    }
+  }
+
+  /**
+   * Joins two triple patterns in a version, for which the join is executed natively.
+   * Variables that occur in both patterns are bound to the values of each triple matching the left pattern,
+   * after which the resulting right pattern is evaluated.
+   * Undefined and null terms are wildcards that are not bound.
+   * @param left The left triple pattern.
+   * @param right The right triple pattern.
+   * @param options Options
+   */
+  public joinVersionMaterialized(
+    left: ITriplePattern,
+    right: ITriplePattern,
+    options?: { version?: number },
+  ): BindingsIterator {
+    if (this.closed) {
+      throw new Error('Attempted to query a closed OSTRICH store');
+    }
+    if (this.maxVersion < 0) {
+      throw new Error('Attempted to query an OSTRICH store without versions');
+    }
+    const version = options && (options.version || options.version === 0) ? options.version : -1;
+    this.operations++;
+    const bindingsProcessor = this.native._joinVersionMaterialized(
+      serializePatternTerm(left.subject),
+      serializePatternTerm(left.predicate),
+      serializePatternTerm(left.object),
+      serializePatternTerm(right.subject),
+      serializePatternTerm(right.predicate),
+      serializePatternTerm(right.object),
+      version,
+    );
+    return new BindingsIterator(this.bufferSize, bindingsProcessor, () => {
+      this.operations--;
+      this.finishOperation();
+    });
+  }
+
+  /**
+   * Evaluates a basic graph pattern in a version, for which all joins are executed natively.
+   * Patterns are evaluated in order of their estimated number of matches,
+   * and terms are only decoded for the resulting bindings.
+   * Undefined and null terms are wildcards that are not bound.
+   * @param patterns The triple patterns.
+   * @param options Options
+   */
+  public searchBgpVersionMaterialized(
+    patterns: ITriplePattern[],
+    options?: { version?: number },
+  ): BindingsIterator {
+    if (this.closed) {
+      throw new Error('Attempted to query a closed OSTRICH store');
+    }
+    if (this.maxVersion < 0) {
+      throw new Error('Attempted to query an OSTRICH store without versions');
+    }
+    const version = options && (options.version || options.version === 0) ? options.version : -1;
+    const serializedPatterns: string[] = [];
+    for (const pattern of patterns) {
+      serializedPatterns.push(
+        serializePatternTerm(pattern.subject),
+        serializePatternTerm(pattern.predicate),
+        serializePatternTerm(pattern.object),
+      );
+    }
+    this.operations++;
+    const bindingsProcessor = this.native._searchBgpVersionMaterialized(serializedPatterns, version);
+    return new BindingsIterator(this.bufferSize, bindingsProcessor, () => {
+      this.operations--;
+      this.finishOperation();
+    });
+  }
+
+  /**
+   * Decodes dictionary ids, as returned by searchTripleIdsVersionMaterialized, into triples.
+   * Decoded terms are cached by the store, so frequently occurring terms are only decoded once.
+   * Rejects if an id is not the id of a term in the given version.
+   * @param ids Subject, predicate and object ids for each triple.
+   * @param version The version the ids were obtained from.
+   */
+  public decodeTripleIds(ids: Float64Array, version = -1): Promise<RDF.Quad[]> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to query a closed OSTRICH store'));
+      }
+      this.operations++;
+      this.native._decodeTripleIds(
+        tripleIdsToBuffer(ids),
+        version,
+        (error, triples) => {
+          this.operations--;
+          this.finishOperation();
+          if (error) {
+            return reject(error);
+          }
+          resolve(triples.map(triple => stringQuadToQuad(triple)));
+        },
+      );
     });
   }
 
@@ -238,7 +781,7 @@ export class BufferedOstrichStore {
     subject: RDF.Term | undefined | null,
     predicate: RDF.Term | undefined | null,
     object: RDF.Term | undefined | null,
-    options: { offset?: number; limit?: number; versionStart: number; versionEnd: number },
+    options: { offset?: number; limit?: number; versionStart: number; versionEnd: number } & IQueryCancellationOptions,
   ): DMQueryIterator {
     if (this.closed) {
       throw new Error('Attempted to query a closed OSTRICH store');
@@ -267,7 +810,7 @@ export class BufferedOstrichStore {
     return new DMQueryIterator(this.bufferSize, queryProcessor, () => {
       this.operations--;
       this.finishOperation();
-    });
+    }, { ...this.iteratorOptions, ...cancellationOptions(options) });
   }
 
   /**
@@ -320,7 +863,7 @@ export class BufferedOstrichStore {
     subject: RDF.Term | undefined | null,
     predicate: RDF.Term | undefined | null,
     object: RDF.Term | undefined | null,
-    options?: { offset?: number; limit?: number },
+    options?: { offset?: number; limit?: number } & IQueryCancellationOptions,
   ): VQQueryIterator {
     if (this.closed) {
       throw new Error('Attempted to query a closed OSTRICH store');
@@ -339,7 +882,7 @@ export class BufferedOstrichStore {
     return new VQQueryIterator(this.bufferSize, queryProcessor, () => {
       this.operations--;
       this.finishOperation();
-    });
+    }, { ...this.iteratorOptions, ...cancellationOptions(options) });
   }
 
   /**
@@ -412,9 +955,7 @@ export class BufferedOstrichStore {
       }
 
       this.operations++;
-      if (version === -1) {
-        version = this.maxVersion + 1;
-      }
+      // The native append resolves the next version once it is the only one that modifies the store
       this.native._append(
         version,
         triples.map(triple => ({ addition: triple.addition, ...quadToStringQuad(triple) })),
@@ -484,7 +1025,7 @@ export class BufferedOstrichStore {
 /**
  * Creates a buffered Ostrich store for the given path.
  * @param path Path to an OSTRICH store.
- * @param bufferSize The number of triples to buffer during querying
+ * @param bufferSize The initial number of triples to buffer during querying, which adapts to the consumer
  * @param options Options for opening the store.
  */
 export function fromPathBuffered(
@@ -492,10 +1033,12 @@ export function fromPathBuffered(
   bufferSize: number,
   options?: {
     readOnly?: boolean;
+    shared?: boolean;
     strategyName?: string;
     strategyParameter?: string;
     dataFactory?: RDF.DataFactory;
-  },
+    termCacheSize?: number;
+  } & IQueryIteratorOptions,
 ): Promise<BufferedOstrichStore> {
   return new Promise((resolve, reject) => {
     if (path.length === 0) {
@@ -509,6 +1052,13 @@ export function fromPathBuffered(
       options = {};
     }
 
+    if (options.shared) {
+      if (options.readOnly === false) {
+        return reject(new Error('A shared OSTRICH store can only be opened in read-only mode'));
+      }
+      options = { ...options, readOnly: true };
+    }
+
     if (typeof options.strategyName !== 'string') {
       options.strategyName = 'never';
       options.strategyParameter = '0';
@@ -534,6 +1084,7 @@ export function fromPathBuffered(
       options.readOnly,
       options.strategyName,
       options.strategyParameter,
+      { termCacheSize: options.termCacheSize, shared: Boolean(options.shared) },
       (error: Error, native: IBufferedOstrichStoreNative) => {
         // Abort the creation if any error occurred
         if (error) {
@@ -552,6 +1103,13 @@ export function fromPathBuffered(
             countTriplesVersion: true,
             appendVersionedTriples: !options!.readOnly,
           }),
+          {
+            prefetch: options!.prefetch,
+            maxBufferSize: options!.maxBufferSize,
+            maxBufferBytes: options!.maxBufferBytes,
+            signal: options!.signal,
+            timeout: options!.timeout,
+          },
         );
         resolve(document);
       },
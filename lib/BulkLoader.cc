@@ -0,0 +1,197 @@
+#include "BulkLoader.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include "NTriplesParser.h"
+
+static bool EqualTriples(const AppendTriple &left, const AppendTriple &right) {
+    return left.subject == right.subject && left.predicate == right.predicate && left.object == right.object;
+}
+
+// Reads the next block of whole lines, returns false if the end of the file has been reached
+static bool ReadVersionDumpBlock(std::ifstream &in, const std::string &path, std::string &block) {
+    block.resize(VERSION_DUMP_BLOCK_SIZE);
+    in.read(&block[0], (std::streamsize) block.size());
+    block.resize((size_t) in.gcount());
+    if (in && block.back() != '\n') {
+        // Complete the last line of the block
+        std::string rest;
+        std::getline(in, rest);
+        block += rest;
+    }
+    if (in.bad()) {
+        throw std::runtime_error("Could not read the version dump " + path);
+    }
+    return !block.empty();
+}
+
+// Parses all lines in the given block, which must start at the beginning of a line
+static void ParseVersionDumpBlock(const std::string &block, std::vector<AppendTriple> &triples) {
+    const char *begin = block.data();
+    const char *end = begin + block.size();
+    AppendTriple triple;
+    while (begin < end) {
+        const char *line_end = std::find(begin, end, '\n');
+        if (ParseNTriplesLine(begin, line_end, triple)) {
+            triples.push_back(std::move(triple));
+        }
+        begin = line_end + 1;
+    }
+}
+
+void SortVersionDump(const std::string &path, ExternalSorter &sorter, size_t threads) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Could not open the version dump " + path);
+    }
+
+    // Blocks are read and added to the sorter one at a time, but parsed concurrently
+    std::mutex read_mutex;
+    std::mutex sort_mutex;
+    std::exception_ptr error;
+    auto work = [&]() {
+        std::string block;
+        std::vector<AppendTriple> triples;
+        try {
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lock(read_mutex);
+                    if (error || !ReadVersionDumpBlock(in, path, block)) {
+                        return;
+                    }
+                }
+                ParseVersionDumpBlock(block, triples);
+                std::lock_guard<std::mutex> lock(sort_mutex);
+                for (auto &triple : triples) {
+                    sorter.add(std::move(triple));
+                }
+                triples.clear();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(read_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    try {
+        for (size_t i = 1; i < threads; i++) {
+            workers.emplace_back(work);
+        }
+    } catch (const std::system_error &) {
+        // Parse on the threads that could be started
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ForEachVersionMaterialized(Controller *controller, int version, TermCache &cache,
+                                const std::function<void(AppendTriple &&)> &callback) {
+    std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(version);
+    std::unique_ptr<TripleIterator> it(controller->get_version_materialized(StringTriple("", "", ""), 0, version));
+    Triple t;
+    while (it->next(&t)) {
+        callback(AppendTriple{
+                cache.get(*dict, t.get_subject(), hdt::SUBJECT),
+                cache.get(*dict, t.get_predicate(), hdt::PREDICATE),
+                cache.get(*dict, t.get_object(), hdt::OBJECT),
+                true,
+        });
+    }
+}
+
+AppendTriplePatchElementIterator::AppendTriplePatchElementIterator(const std::vector<AppendTriple> &triples,
+                                                                   std::shared_ptr<DictionaryManager> dict)
+        : triples(triples), dict(std::move(dict)), passed(0) {}
+
+bool AppendTriplePatchElementIterator::next(PatchElement *element) {
+    if (passed >= triples.size()) {
+        return false;
+    }
+    const AppendTriple &triple = triples[passed++];
+    *element = PatchElement(Triple(triple.subject, triple.predicate, triple.object, dict), triple.addition);
+    return true;
+}
+
+void AppendTriplePatchElementIterator::goToStart() {
+    passed = 0;
+}
+
+size_t AppendTriplePatchElementIterator::getPassed() {
+    return passed;
+}
+
+VersionDeltaPatchElementIterator::VersionDeltaPatchElementIterator(ExternalSorter &previous, ExternalSorter &current,
+                                                                   std::shared_ptr<DictionaryManager> dict,
+                                                                   ExternalSorter *current_copy)
+        : previous(previous), current(current), dict(std::move(dict)), current_copy(current_copy),
+          addition_count(0), deletion_count(0), current_count(0) {
+    has_previous = previous.next(&previous_head);
+    has_current = current.next(&current_head);
+    read_current();
+}
+
+bool VersionDeltaPatchElementIterator::next(PatchElement *element) {
+    while (has_previous || has_current) {
+        if (!has_current || (has_previous && ExternalSorter::less(previous_head, current_head))) {
+            *element = PatchElement(Triple(previous_head.subject, previous_head.predicate, previous_head.object, dict), false);
+            deletion_count++;
+            has_previous = advance(previous, previous_head);
+            return true;
+        }
+        if (!has_previous || ExternalSorter::less(current_head, previous_head)) {
+            *element = PatchElement(Triple(current_head.subject, current_head.predicate, current_head.object, dict), true);
+            addition_count++;
+            has_current = advance(current, current_head);
+            read_current();
+            return true;
+        }
+        has_previous = advance(previous, previous_head);
+        has_current = advance(current, current_head);
+        read_current();
+    }
+    return false;
+}
+
+void VersionDeltaPatchElementIterator::read_current() {
+    if (has_current) {
+        current_count++;
+        if (current_copy != nullptr) {
+            current_copy->add(current_head);
+        }
+    }
+}
+
+// Replaces the head by the next triple of the sorter that differs from it, returns false if the sorter is exhausted
+bool VersionDeltaPatchElementIterator::advance(ExternalSorter &sorter, AppendTriple &head) {
+    AppendTriple triple;
+    while (sorter.next(&triple)) {
+        if (!EqualTriples(triple, head)) {
+            head = std::move(triple);
+            return true;
+        }
+    }
+    return false;
+}
+
+void VersionDeltaPatchElementIterator::goToStart() {
+    if (getPassed() > 0) {
+        throw std::runtime_error("Version deltas can only be iterated once");
+    }
+}
+
+size_t VersionDeltaPatchElementIterator::getPassed() {
+    return addition_count + deletion_count;
+}
@@ -0,0 +1,79 @@
+#ifndef OSTRICH_BULKLOADER_H
+#define OSTRICH_BULKLOADER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "AppendTriple.h"
+#include "ExternalSorter.h"
+#include "TermCache.h"
+
+// The number of bytes of a version dump that a thread reads and parses at once
+const size_t VERSION_DUMP_BLOCK_SIZE = 4 * 1024 * 1024;
+
+// Reads an N-Triples or N-Quads file, and adds its triples to the sorter as additions.
+// The file is read in blocks of whole lines, which are parsed on the given number of threads,
+// so that only the sorter and a block per thread are in memory at any time.
+void SortVersionDump(const std::string &path, ExternalSorter &sorter, size_t threads);
+
+// Invokes the callback for all triples of the given version of the store, in their JavaScript representation.
+// The triples are not sorted in SPO-order, as the store orders them by their dictionary ids.
+void ForEachVersionMaterialized(Controller *controller, int version, TermCache &cache,
+                                const std::function<void(AppendTriple &&)> &callback);
+
+// Iterates over sorted triples as patch elements, which are only encoded while they are being read
+class AppendTriplePatchElementIterator : public PatchElementIterator {
+public:
+    AppendTriplePatchElementIterator(const std::vector<AppendTriple> &triples, std::shared_ptr<DictionaryManager> dict);
+
+    bool next(PatchElement *element) override;
+    void goToStart() override;
+    size_t getPassed() override;
+
+private:
+    const std::vector<AppendTriple> &triples;
+    std::shared_ptr<DictionaryManager> dict;
+    size_t passed;
+};
+
+// Iterates over the changes from the previous to the current version as patch elements,
+// where both versions are read from a finished sorter, and duplicate triples are ignored.
+// If current_copy is not null, the distinct triples of the current version are added to it while they are read,
+// so that the current version can be compared to the next one without reading it again.
+class VersionDeltaPatchElementIterator : public PatchElementIterator {
+public:
+    VersionDeltaPatchElementIterator(ExternalSorter &previous, ExternalSorter &current, std::shared_ptr<DictionaryManager> dict,
+                                     ExternalSorter *current_copy = nullptr);
+
+    bool next(PatchElement *element) override;
+    // A sorter can only be read once, so this throws if any element has been read already
+    void goToStart() override;
+    size_t getPassed() override;
+
+    [[nodiscard]] size_t get_addition_count() const { return addition_count; }
+    [[nodiscard]] size_t get_deletion_count() const { return deletion_count; }
+    // The number of distinct triples of the current version that have been read
+    [[nodiscard]] size_t get_current_count() const { return current_count; }
+
+private:
+    ExternalSorter &previous;
+    ExternalSorter &current;
+    std::shared_ptr<DictionaryManager> dict;
+    ExternalSorter *current_copy;
+    AppendTriple previous_head;
+    AppendTriple current_head;
+    bool has_previous;
+    bool has_current;
+    size_t addition_count;
+    size_t deletion_count;
+    size_t current_count;
+
+    static bool advance(ExternalSorter &sorter, AppendTriple &head);
+    // Counts and copies the head of the current version, if there is one
+    void read_current();
+};
+
+#endif //OSTRICH_BULKLOADER_H
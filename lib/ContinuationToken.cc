@@ -0,0 +1,145 @@
+#include "ContinuationToken.h"
+
+#include <stdexcept>
+
+// The version of the token layout, which is increased whenever it changes
+static const uint8_t TOKEN_FORMAT_VERSION = 1;
+
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static void WriteUint32(std::string &out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((char) ((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static void WriteString(std::string &out, const std::string &value) {
+    WriteUint32(out, (uint32_t) value.size());
+    out.append(value);
+}
+
+static uint32_t ReadUint32(const std::string &in, size_t &pos) {
+    if (in.size() - pos < 4) {
+        throw std::runtime_error("Invalid continuation token");
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t) (uint8_t) in[pos++] << (8 * i);
+    }
+    return value;
+}
+
+static std::string ReadString(const std::string &in, size_t &pos) {
+    uint32_t length = ReadUint32(in, pos);
+    if (in.size() - pos < length) {
+        throw std::runtime_error("Invalid continuation token");
+    }
+    std::string value = in.substr(pos, length);
+    pos += length;
+    return value;
+}
+
+// 32-bit FNV-1a, which detects truncated and modified tokens
+static uint32_t Checksum(const char *data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t) data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static std::string EncodeBase64Url(const std::string &in) {
+    std::string out;
+    out.reserve((in.size() * 4 + 2) / 3);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : in) {
+        buffer = (buffer << 8) | (uint8_t) c;
+        bits += 8;
+        while (bits >= 6) {
+            bits -= 6;
+            out.push_back(BASE64_ALPHABET[(buffer >> bits) & 0x3F]);
+        }
+    }
+    if (bits > 0) {
+        out.push_back(BASE64_ALPHABET[(buffer << (6 - bits)) & 0x3F]);
+    }
+    return out;
+}
+
+static std::string DecodeBase64Url(const std::string &in) {
+    std::string out;
+    out.reserve(in.size() * 3 / 4);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : in) {
+        uint32_t value;
+        if (c >= 'A' && c <= 'Z') {
+            value = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            value = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            value = c - '0' + 52;
+        } else if (c == '-') {
+            value = 62;
+        } else if (c == '_') {
+            value = 63;
+        } else {
+            throw std::runtime_error("Invalid continuation token");
+        }
+        buffer = (buffer << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back((char) ((buffer >> bits) & 0xFF));
+        }
+    }
+    return out;
+}
+
+std::string ContinuationToken::serialize() const {
+    std::string out;
+    out.push_back((char) TOKEN_FORMAT_VERSION);
+    out.push_back((char) type);
+    WriteUint32(out, (uint32_t) version_start);
+    WriteUint32(out, (uint32_t) version_end);
+    WriteUint32(out, (uint32_t) max_version);
+    WriteUint32(out, position);
+    WriteString(out, subject);
+    WriteString(out, predicate);
+    WriteString(out, object);
+    WriteUint32(out, Checksum(out.data(), out.size()));
+    return EncodeBase64Url(out);
+}
+
+ContinuationToken ContinuationToken::deserialize(const std::string &token) {
+    std::string in = DecodeBase64Url(token);
+    if (in.size() < 6 || in[0] != (char) TOKEN_FORMAT_VERSION) {
+        throw std::runtime_error("Invalid continuation token");
+    }
+    size_t checksum_pos = in.size() - 4;
+    if (ReadUint32(in, checksum_pos) != Checksum(in.data(), in.size() - 4)) {
+        throw std::runtime_error("Invalid continuation token");
+    }
+    in.resize(in.size() - 4);
+
+    size_t pos = 1;
+    uint8_t type = (uint8_t) in[pos++];
+    if (type > CONTINUATION_VERSION) {
+        throw std::runtime_error("Invalid continuation token");
+    }
+    ContinuationToken result;
+    result.type = (ContinuationQueryType) type;
+    result.version_start = (int) ReadUint32(in, pos);
+    result.version_end = (int) ReadUint32(in, pos);
+    result.max_version = (int) ReadUint32(in, pos);
+    result.position = ReadUint32(in, pos);
+    result.subject = ReadString(in, pos);
+    result.predicate = ReadString(in, pos);
+    result.object = ReadString(in, pos);
+    if (pos != in.size()) {
+        throw std::runtime_error("Invalid continuation token");
+    }
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef OSTRICH_CONTINUATIONTOKEN_H
+#define OSTRICH_CONTINUATIONTOKEN_H
+
+#include <cstdint>
+#include <string>
+
+// The kinds of queries of which the iteration can be continued
+enum ContinuationQueryType {
+    CONTINUATION_VERSION_MATERIALIZED = 0,
+    CONTINUATION_DELTA_MATERIALIZED = 1,
+    CONTINUATION_VERSION = 2,
+};
+
+// The state of a query processor that is needed to continue its iteration in another processor,
+// possibly in another process that opened the same archive.
+// OSTRICH iterators can not be serialized, so a query is continued by creating a new iterator at the position,
+// which OSTRICH seeks to directly in snapshots and patch trees where it can.
+struct ContinuationToken {
+    ContinuationQueryType type;
+    std::string subject;
+    std::string predicate;
+    std::string object;
+    // The queried version for VM queries, or the queried range for DM queries, with -1 for VQ queries
+    int version_start;
+    int version_end;
+    // The maximum version of the archive when the query started, as VQ results change with every append
+    int max_version;
+    // The number of results that have been returned so far, including the initial offset
+    uint32_t position;
+
+    // Encodes the token as an opaque, URL-safe string
+    [[nodiscard]] std::string serialize() const;
+
+    // Decodes a token that was produced by serialize, and throws a runtime_error if it is invalid
+    static ContinuationToken deserialize(const std::string &token);
+};
+
+#endif //OSTRICH_CONTINUATIONTOKEN_H
@@ -0,0 +1,232 @@
+#include "ExternalSorter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+// Serialization of triples in runs
+static void WriteString(std::ofstream &out, const std::string &value) {
+    auto length = (uint32_t) value.size();
+    out.write((const char *) &length, sizeof(length));
+    out.write(value.data(), length);
+}
+
+static bool ReadString(std::ifstream &in, std::string &value) {
+    uint32_t length;
+    if (!in.read((char *) &length, sizeof(length))) {
+        return false;
+    }
+    value.resize(length);
+    return (bool) in.read(&value[0], length);
+}
+
+static void WriteTriple(std::ofstream &out, const AppendTriple &triple) {
+    WriteString(out, triple.subject);
+    WriteString(out, triple.predicate);
+    WriteString(out, triple.object);
+    out.put(triple.addition ? 1 : 0);
+}
+
+// Creates a temporary file of a run, which starts with its number of triples
+static std::ofstream CreateRun(const std::string &path, uint64_t count) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Could not create the temporary sort file " + path);
+    }
+    out.write((const char *) &count, sizeof(count));
+    return out;
+}
+
+static void FinishRun(std::ofstream &out, const std::string &path) {
+    if (!out.flush()) {
+        throw std::runtime_error("Could not write the temporary sort file " + path);
+    }
+}
+
+ExternalSorter::ExternalSorter(size_t memory_budget, std::string temp_prefix)
+        : memory_budget(memory_budget), temp_prefix(std::move(temp_prefix)), buffer_bytes(0), created_runs(0),
+          finished(false) {}
+
+ExternalSorter::~ExternalSorter() {
+    runs.clear();
+    for (auto &path : run_paths) {
+        std::remove(path.c_str());
+    }
+}
+
+void ExternalSorter::add(AppendTriple triple) {
+    if (finished) {
+        throw std::runtime_error("Attempted to add a triple to a finished sorter");
+    }
+    buffer_bytes += sizeof(AppendTriple) + triple.subject.size() + triple.predicate.size() + triple.object.size();
+    buffer.push_back(std::move(triple));
+    if (buffer_bytes > memory_budget) {
+        spill();
+    }
+}
+
+void ExternalSorter::spill() {
+    std::stable_sort(buffer.begin(), buffer.end(), less);
+    std::string path = temp_prefix + std::to_string(created_runs++);
+    std::ofstream out = CreateRun(path, buffer.size());
+    run_paths.push_back(path);
+    for (auto &triple : buffer) {
+        WriteTriple(out, triple);
+    }
+    FinishRun(out, path);
+    buffer.clear();
+    buffer.shrink_to_fit();
+    buffer_bytes = 0;
+}
+
+void ExternalSorter::merge_pass() {
+    std::vector<std::string> merged(run_paths.begin(), run_paths.begin() + EXTERNAL_SORTER_MAX_FAN_IN);
+    open_runs(merged, false);
+    std::string path = temp_prefix + std::to_string(created_runs++);
+    std::ofstream out = CreateRun(path, 0);
+    // Until the merge has succeeded, the merged run is only registered to be removed with the others
+    run_paths.push_back(path);
+    uint64_t count = 0;
+    AppendTriple triple;
+    while (pop(&triple)) {
+        WriteTriple(out, triple);
+        count++;
+    }
+    // The count is only known once the runs have been merged
+    out.seekp(0);
+    out.write((const char *) &count, sizeof(count));
+    FinishRun(out, path);
+    runs.clear();
+    heap.clear();
+
+    // The merged run contains the earliest triples, so it takes the place of the runs it replaces
+    for (auto &merged_path : merged) {
+        std::remove(merged_path.c_str());
+    }
+    run_paths.pop_back();
+    run_paths.erase(run_paths.begin(), run_paths.begin() + EXTERNAL_SORTER_MAX_FAN_IN);
+    run_paths.insert(run_paths.begin(), path);
+}
+
+void ExternalSorter::open_runs(const std::vector<std::string> &paths, bool with_buffer) {
+    for (auto &path : paths) {
+        std::unique_ptr<std::ifstream> file(new std::ifstream(path, std::ios::binary));
+        if (!file->is_open()) {
+            throw std::runtime_error("Could not open the temporary sort file " + path);
+        }
+        uint64_t count;
+        if (!file->read((char *) &count, sizeof(count))) {
+            throw std::runtime_error("Could not read the temporary sort file " + path);
+        }
+        runs.push_back(Run{std::move(file), 0, count, {}});
+    }
+    if (with_buffer) {
+        runs.push_back(Run{nullptr, 0, 0, {}});
+    }
+
+    auto greater = [this](size_t left, size_t right) { return after(left, right); };
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (advance(runs[i])) {
+            heap.push_back(i);
+            std::push_heap(heap.begin(), heap.end(), greater);
+        }
+    }
+}
+
+void ExternalSorter::finish() {
+    finished = true;
+    std::stable_sort(buffer.begin(), buffer.end(), less);
+
+    while (run_paths.size() + 1 > EXTERNAL_SORTER_MAX_FAN_IN) {
+        merge_pass();
+    }
+    // The in-memory buffer is merged as an additional run
+    open_runs(run_paths, true);
+}
+
+bool ExternalSorter::next(AppendTriple *triple) {
+    if (!finished) {
+        throw std::runtime_error("Attempted to read from a sorter that has not finished");
+    }
+    return pop(triple);
+}
+
+bool ExternalSorter::pop(AppendTriple *triple) {
+    if (heap.empty()) {
+        return false;
+    }
+    auto greater = [this](size_t left, size_t right) { return after(left, right); };
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    size_t i = heap.back();
+    heap.pop_back();
+    *triple = std::move(runs[i].head);
+    if (advance(runs[i])) {
+        heap.push_back(i);
+        std::push_heap(heap.begin(), heap.end(), greater);
+    }
+    return true;
+}
+
+// Reads the next triple of the run into its head, returns false if the run is exhausted
+bool ExternalSorter::advance(Run &run) {
+    if (!run.file) {
+        if (run.index >= buffer.size()) {
+            return false;
+        }
+        run.head = std::move(buffer[run.index++]);
+        return true;
+    }
+    if (run.remaining == 0) {
+        return false;
+    }
+    int addition;
+    if (!ReadString(*run.file, run.head.subject) || !ReadString(*run.file, run.head.predicate)
+        || !ReadString(*run.file, run.head.object) || (addition = run.file->get()) == EOF) {
+        // The file ended before all of its triples were read
+        throw std::runtime_error("Could not read a temporary sort file, as it was truncated");
+    }
+    run.head.addition = addition != 0;
+    run.remaining--;
+    return true;
+}
+
+// If the head of the left run must be read after the head of the right run.
+// Equal triples are read in the order in which they were added, so earlier runs go first.
+bool ExternalSorter::after(size_t left, size_t right) const {
+    return less(runs[right].head, runs[left].head) || (!less(runs[left].head, runs[right].head) && right < left);
+}
+
+bool ExternalSorter::less(const AppendTriple &left, const AppendTriple &right) {
+    int comp = left.subject.compare(right.subject);
+    if (comp == 0) {
+        comp = left.predicate.compare(right.predicate);
+        if (comp == 0) {
+            comp = left.object.compare(right.object);
+        }
+    }
+    return comp < 0;
+}
+
+SortedPatchElementIterator::SortedPatchElementIterator(ExternalSorter &sorter, std::shared_ptr<DictionaryManager> dict)
+        : sorter(sorter), dict(std::move(dict)), passed(0) {}
+
+bool SortedPatchElementIterator::next(PatchElement *element) {
+    AppendTriple triple;
+    if (!sorter.next(&triple)) {
+        return false;
+    }
+    *element = PatchElement(Triple(triple.subject, triple.predicate, triple.object, dict), triple.addition);
+    passed++;
+    return true;
+}
+
+void SortedPatchElementIterator::goToStart() {
+    if (passed > 0) {
+        throw std::runtime_error("Sorted triples can only be iterated once");
+    }
+}
+
+size_t SortedPatchElementIterator::getPassed() {
+    return passed;
+}
@@ -0,0 +1,92 @@
+#ifndef OSTRICH_EXTERNALSORTER_H
+#define OSTRICH_EXTERNALSORTER_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "AppendTriple.h"
+
+// The default number of bytes of triples that are sorted in memory before they are spilled to disk
+const size_t EXTERNAL_SORTER_DEFAULT_MEMORY = 256 * 1024 * 1024;
+// The maximum number of runs that are merged at once, beyond which runs are first merged into larger runs
+const size_t EXTERNAL_SORTER_MAX_FAN_IN = 64;
+
+// Sorts triples in SPO-order, by the byte order of their terms.
+// Triples are sorted in memory until the memory budget is exceeded,
+// after which the sorted run is spilled to a temporary file, which starts with its number of triples.
+// Once all triples have been added, the runs are merged while reading,
+// after merging them in passes of EXTERNAL_SORTER_MAX_FAN_IN runs if there are more runs than that.
+class ExternalSorter {
+public:
+    // Temporary files are created at the given path prefix
+    ExternalSorter(size_t memory_budget, std::string temp_prefix);
+    ~ExternalSorter();
+
+    void add(AppendTriple triple);
+    // Indicates that all triples have been added, after which they can be read in order
+    void finish();
+    // Reads the next triple in order, returns false if all triples have been read
+    bool next(AppendTriple *triple);
+
+    [[nodiscard]] size_t get_run_count() const { return run_paths.size(); }
+
+    // The SPO-order in which triples are read, by the byte order of their terms
+    static bool less(const AppendTriple &left, const AppendTriple &right);
+
+private:
+    // A sorted run that is being merged, either from a temporary file, or from the in-memory buffer
+    struct Run {
+        std::unique_ptr<std::ifstream> file;
+        size_t index;
+        // The number of triples that have not been read from the file yet
+        uint64_t remaining;
+        AppendTriple head;
+    };
+
+    const size_t memory_budget;
+    const std::string temp_prefix;
+
+    std::vector<AppendTriple> buffer;
+    size_t buffer_bytes;
+    // The temporary files of the runs, from the earliest to the latest added triples
+    std::vector<std::string> run_paths;
+    // The number of temporary files that have been created, which are named after it
+    size_t created_runs;
+
+    bool finished;
+    std::vector<Run> runs;
+    // Indexes of runs that still have triples, ordered as a min-heap on their head
+    std::vector<size_t> heap;
+
+    void spill();
+    // Merges the first EXTERNAL_SORTER_MAX_FAN_IN runs into a single run
+    void merge_pass();
+    // Starts merging the given temporary files, and the in-memory buffer as the last run if requested
+    void open_runs(const std::vector<std::string> &paths, bool with_buffer);
+    // Reads the next triple of the runs that are being merged, returns false if all of them have been read
+    bool pop(AppendTriple *triple);
+    bool advance(Run &run);
+    [[nodiscard]] bool after(size_t left, size_t right) const;
+};
+
+// Iterates over the triples of a finished sorter as patch elements
+class SortedPatchElementIterator : public PatchElementIterator {
+public:
+    SortedPatchElementIterator(ExternalSorter &sorter, std::shared_ptr<DictionaryManager> dict);
+
+    bool next(PatchElement *element) override;
+    // A sorter can only be read once, so this throws if any element has been read already
+    void goToStart() override;
+    size_t getPassed() override;
+
+private:
+    ExternalSorter &sorter;
+    std::shared_ptr<DictionaryManager> dict;
+    size_t passed;
+};
+
+#endif //OSTRICH_EXTERNALSORTER_H
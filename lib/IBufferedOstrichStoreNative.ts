@@ -1,31 +1,65 @@
 import type { IStringQuad } from 'rdf-string';
+import type { IQueryCancellationNative } from './QueryCancellation';
+import type { IStoreStats } from './QueryStats';
+import type { ITrace } from './QueryTrace';
+import type { ISlowQuery } from './SlowQueryLog';
 import type { IStringQuadDelta, IStringQuadVersion } from './utils';
 
 export interface IQueryProcessor {
   _next: (
     number: number,
-    callback: (error: Error | undefined, triples: IStringQuad[]) => void,
+    callback: (error: Error | undefined, triples: IStringQuad[], done: boolean, truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
   ) => void;
+  _continuationToken: (unconsumed: number) => string;
 }
 
 export interface IVersionMaterializationProcessor extends IQueryProcessor {
   _next: (
     number: number,
-    callback: (error: Error | undefined, triples: IStringQuad[]) => void,
+    callback: (error: Error | undefined, triples: IStringQuad[], done: boolean, truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
+  ) => void;
+  _nextIds: (
+    number: number,
+    callback: (error: Error | undefined, ids: Buffer, done: boolean, truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
   ) => void;
 }
 
 export interface IDeltaMaterializationProcessor extends IQueryProcessor {
   _next: (
     number: number,
-    callback: (error: Error | undefined, triples: IStringQuadDelta[]) => void,
+    callback: (error: Error | undefined, triples: IStringQuadDelta[], done: boolean, truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
   ) => void;
 }
 
 export interface IVersionQueryProcessor extends IQueryProcessor {
   _next: (
     number: number,
-    callback: (error: Error | undefined, triples: IStringQuadVersion[]) => void,
+    callback: (error: Error | undefined, triples: IStringQuadVersion[], done: boolean, truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
+  ) => void;
+}
+
+/**
+ * A query processor that continues the iteration of a continuation token
+ */
+export type IResumedQueryProcessor =
+  { type: 'versionMaterialized'; processor: IVersionMaterializationProcessor } |
+  { type: 'deltaMaterialized'; processor: IDeltaMaterializationProcessor } |
+  { type: 'version'; processor: IVersionQueryProcessor };
+
+export interface IBindingsProcessor {
+  _next: (
+    number: number,
+    callback: (error: Error | undefined, bindings: Record<string, string>[]) => void,
   ) => void;
 }
 
@@ -36,6 +70,11 @@ export interface IBufferedOstrichStoreNative {
   maxVersion: number;
   closed: boolean;
   _close: (remove: boolean, callback: (error?: Error) => void) => void;
+  _stats: () => IStoreStats;
+  _startTracing: () => void;
+  _stopTracing: () => ITrace;
+  _setSlowQueryLog: (threshold: number, capacity: number, file: string) => void;
+  _slowQueries: () => ISlowQuery[];
   _searchTriplesVersionMaterialized: (
     subject: string | null,
     predicate: string | null,
@@ -78,6 +117,25 @@ export interface IBufferedOstrichStoreNative {
     object: string | null,
     cb: (error: Error | undefined, totalCount: number, hasExactCount: boolean) => void,
   ) => void;
+  _resume: (token: string) => IResumedQueryProcessor;
+  _joinVersionMaterialized: (
+    leftSubject: string,
+    leftPredicate: string,
+    leftObject: string,
+    rightSubject: string,
+    rightPredicate: string,
+    rightObject: string,
+    version: number,
+  ) => IBindingsProcessor;
+  _searchBgpVersionMaterialized: (
+    patterns: string[],
+    version: number,
+  ) => IBindingsProcessor;
+  _decodeTripleIds: (
+    ids: Buffer,
+    version: number,
+    cb: (error: Error | undefined, triples: IStringQuad[]) => void,
+  ) => void;
   _append: (
     version: number,
     triples: IStringQuadDelta[],
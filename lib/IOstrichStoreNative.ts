@@ -1,5 +1,28 @@
 import type { IStringQuad } from 'rdf-string';
-import type { IStringQuadDelta, IStringQuadVersion } from './utils';
+import type { IBatchQueryNative } from './BatchQuery';
+import type { IQueryCancellationNative } from './QueryCancellation';
+import type { IStoreStats } from './QueryStats';
+import type { ITrace } from './QueryTrace';
+import type { ISlowQuery } from './SlowQueryLog';
+import type { IIngestProgress, IStringQuadDelta, IStringQuadVersion } from './utils';
+
+/**
+ * The writable end of a streaming append in OstrichStore.cc
+ */
+export interface IAppendStreamProcessor {
+  _push: (triples: IStringQuadDelta[], cb: (error?: Error) => void) => void;
+  _end: () => void;
+  _abort: (reason: string) => void;
+}
+
+/**
+ * The credits of a partitioned scan in PartitionCredits.h,
+ * of which a partition can only send a limited number of chunks before they are released.
+ */
+export interface IPartitionCredits {
+  _release: (partition: number) => void;
+  _cancel: () => void;
+}
 
 /**
  * A native OSTRICH store that corresponds to the implementation in OstrichStore.cc
@@ -8,6 +31,12 @@ export interface IOstrichStoreNative {
   maxVersion: number;
   closed: boolean;
   _close: (remove: boolean, callback: (error?: Error) => void) => void;
+  _cancelScans: () => void;
+  _stats: () => IStoreStats;
+  _startTracing: () => void;
+  _stopTracing: () => ITrace;
+  _setSlowQueryLog: (threshold: number, capacity: number, file: string) => void;
+  _slowQueries: () => ISlowQuery[];
   _searchTriplesVersionMaterialized: (
     subject: string | null,
     predicate: string | null,
@@ -15,7 +44,10 @@ export interface IOstrichStoreNative {
     offset: number,
     limit: number,
     version: number,
-    cb: (error: Error | undefined, triples: IStringQuad[], totalCount: number, hasExactCount: boolean) => void,
+    cb: (error: Error | undefined, triples: IStringQuad[], totalCount: number, hasExactCount: boolean,
+      truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
   ) => void;
   _countTriplesVersionMaterialized: (
     subject: string | null,
@@ -32,7 +64,10 @@ export interface IOstrichStoreNative {
     limit: number,
     versionStart: number,
     versionEnd: number,
-    cb: (error: Error | undefined, triples: IStringQuadDelta[], totalCount: number, hasExactCount: boolean) => void,
+    cb: (error: Error | undefined, triples: IStringQuadDelta[], totalCount: number, hasExactCount: boolean,
+      truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
   ) => void;
   _countTriplesDeltaMaterialized: (
     subject: string | null,
@@ -48,7 +83,10 @@ export interface IOstrichStoreNative {
     object: string | null,
     offset: number,
     limit: number,
-    cb: (error: Error | undefined, triples: IStringQuadVersion[], totalCount: number, hasExactCount: boolean) => void,
+    cb: (error: Error | undefined, triples: IStringQuadVersion[], totalCount: number, hasExactCount: boolean,
+      truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
   ) => void;
   _countTriplesVersion: (
     subject: string | null,
@@ -56,9 +94,132 @@ export interface IOstrichStoreNative {
     object: string | null,
     cb: (error: Error | undefined, totalCount: number, hasExactCount: boolean) => void,
   ) => void;
+  _searchTriplesVersionMaterializedPacked: (
+    subject: string | null,
+    predicate: string | null,
+    object: string | null,
+    offset: number,
+    limit: number,
+    version: number,
+    cb: (error: Error | undefined, batch: Buffer, totalCount: number, hasExactCount: boolean,
+      truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
+  ) => void;
+  _searchTriplesDeltaMaterializedPacked: (
+    subject: string | null,
+    predicate: string | null,
+    object: string | null,
+    offset: number,
+    limit: number,
+    versionStart: number,
+    versionEnd: number,
+    cb: (error: Error | undefined, batch: Buffer, totalCount: number, hasExactCount: boolean,
+      truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
+  ) => void;
+  _searchTriplesVersionPacked: (
+    subject: string | null,
+    predicate: string | null,
+    object: string | null,
+    offset: number,
+    limit: number,
+    cb: (error: Error | undefined, batch: Buffer, totalCount: number, hasExactCount: boolean,
+      truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
+  ) => void;
+  _searchTripleIdsVersionMaterialized: (
+    subject: string | null,
+    predicate: string | null,
+    object: string | null,
+    offset: number,
+    limit: number,
+    version: number,
+    cb: (error: Error | undefined, ids: Buffer, totalCount: number, hasExactCount: boolean, truncated: boolean) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
+  ) => void;
+  _decodeTripleIds: (
+    ids: Buffer,
+    version: number,
+    cb: (error: Error | undefined, triples: IStringQuad[]) => void,
+  ) => void;
+  _searchBatch: (
+    queries: IBatchQueryNative[],
+    parallelism: number,
+    cb: (error: Error | undefined,
+      results: { batch?: Buffer; totalCount: number; hasExactCount: boolean; truncated: boolean }[]) => void,
+    self?: undefined,
+    cancellation?: IQueryCancellationNative,
+  ) => void;
+  _searchTriplesVersionMaterializedPartitioned: (
+    subject: string | null,
+    predicate: string | null,
+    object: string | null,
+    version: number,
+    partitions: number,
+    chunkSize: number,
+    queueSize: number,
+    chunkCb: (partition: number, batch: Buffer | null, done: boolean) => void,
+    cb: (error: Error | undefined, count: number) => void,
+  ) => IPartitionCredits;
+  _exportTriplesVersionMaterialized: (
+    subject: string | null,
+    predicate: string | null,
+    object: string | null,
+    offset: number,
+    limit: number,
+    version: number,
+    fd: number,
+    chunkCb: ((chunk: Buffer) => void) | undefined,
+    cb: (error: Error | undefined, count: number) => void,
+  ) => IPartitionCredits | undefined;
+  _exportTriplesDeltaMaterialized: (
+    subject: string | null,
+    predicate: string | null,
+    object: string | null,
+    offset: number,
+    limit: number,
+    versionStart: number,
+    versionEnd: number,
+    fd: number,
+    chunkCb: ((chunk: Buffer) => void) | undefined,
+    cb: (error: Error | undefined, count: number) => void,
+  ) => IPartitionCredits | undefined;
   _append: (
     version: number,
     triples: IStringQuadDelta[],
     cb: (error: Error | undefined, insertedCount: number) => void,
   ) => void;
+  _appendUnsorted: (
+    version: number,
+    triples: IStringQuadDelta[],
+    sortMemory: number,
+    cb: (error: Error | undefined, insertedCount: number) => void,
+  ) => void;
+  _appendStream: (
+    version: number,
+    queueSize: number,
+    sortMemory: number,
+    cb: (error: Error | undefined, insertedCount: number) => void,
+  ) => IAppendStreamProcessor;
+  _appendFullVersion: (
+    triples: IStringQuadDelta[],
+    sortMemory: number,
+    cb: (error: Error | undefined, insertedCount: number) => void,
+  ) => void;
+  _appendFromFile: (
+    path: string,
+    sortMemory: number,
+    cb: (error: Error | undefined, insertedCount: number) => void,
+  ) => void;
+  _ingest: (
+    paths: string[],
+    threads: number,
+    sortMemory: number,
+    progressCb: ((progress: IIngestProgress) => void) | undefined,
+    cb: (error: Error | undefined, versionCount: number) => void,
+  ) => void;
 }
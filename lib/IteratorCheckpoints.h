@@ -0,0 +1,106 @@
+#ifndef OSTRICH_ITERATORCHECKPOINTS_H
+#define OSTRICH_ITERATORCHECKPOINTS_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Identifies the results of a triple pattern in a version, or between two versions
+struct CheckpointKey {
+    std::string subject;
+    std::string predicate;
+    std::string object;
+    int version_start;
+    int version_end;
+
+    bool operator==(const CheckpointKey &other) const {
+        return version_start == other.version_start && version_end == other.version_end
+               && subject == other.subject && predicate == other.predicate && object == other.object;
+    }
+};
+
+// The default number of iterators that are kept per store, where 0 disables checkpoints
+const size_t ITERATOR_CHECKPOINTS_DEFAULT_CAPACITY = 0;
+// The maximum number of results that are skipped when resuming from a checkpoint,
+// beyond which creating a new iterator at the offset is assumed to be cheaper
+const uint32_t ITERATOR_CHECKPOINTS_MAX_SKIP = 1024;
+
+// A bounded, thread-safe LRU collection of iterators that were left at a certain position after returning a page,
+// so that a later page of the same query can resume from them instead of skipping all earlier results again.
+// An iterator can only be resumed once, after which it can be put back at its new position.
+// Checkpoints are cleared when a version is appended, and iterators of queries that started before that are not kept.
+template<class Iterator>
+class IteratorCheckpoints {
+public:
+    // A capacity of 0 disables checkpoints
+    explicit IteratorCheckpoints(size_t capacity) : max_size(capacity), generation(0) {}
+
+    // Takes the iterator of the query with the highest position that is at most the offset and at most
+    // ITERATOR_CHECKPOINTS_MAX_SKIP before it, and sets its position, or returns nullptr if there is none
+    std::unique_ptr<Iterator> take(const CheckpointKey &key, uint32_t offset, uint32_t &position) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto best = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            if (it->position <= offset && offset - it->position <= ITERATOR_CHECKPOINTS_MAX_SKIP
+                && (best == entries.end() || it->position > best->position) && it->key == key) {
+                best = it;
+            }
+        }
+        if (best == entries.end()) {
+            return nullptr;
+        }
+        position = best->position;
+        std::unique_ptr<Iterator> iterator = std::move(best->iterator);
+        entries.erase(best);
+        return iterator;
+    }
+
+    // Keeps the iterator of a query that started at the given generation, of which the next result is at the position
+    void put(CheckpointKey key, uint32_t position, std::unique_ptr<Iterator> iterator, uint64_t query_generation) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (max_size == 0 || query_generation != generation) {
+            return;
+        }
+        entries.push_front(Entry{std::move(key), position, std::move(iterator)});
+        if (entries.size() > max_size) {
+            entries.pop_back();
+        }
+    }
+
+    // The generation that is passed to put for a query that starts now
+    uint64_t get_generation() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return generation;
+    }
+
+    // Removes all checkpoints, and ignores iterators of queries that are still running
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        entries.clear();
+    }
+
+    [[nodiscard]] size_t capacity() const { return max_size; }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+private:
+    struct Entry {
+        CheckpointKey key;
+        uint32_t position;
+        std::unique_ptr<Iterator> iterator;
+    };
+
+    const size_t max_size;
+    std::mutex mutex;
+    uint64_t generation;
+    // Most recently kept entries first
+    std::list<Entry> entries;
+};
+
+#endif //OSTRICH_ITERATORCHECKPOINTS_H
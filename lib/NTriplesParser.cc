@@ -0,0 +1,186 @@
+#include "NTriplesParser.h"
+
+#include <stdexcept>
+
+static const char *const XSD_STRING = "http://www.w3.org/2001/XMLSchema#string";
+
+class LineParser {
+public:
+    LineParser(const char *begin, const char *end) : begin(begin), pos(begin), end(end) {}
+
+    bool parse(AppendTriple &triple) {
+        skip_whitespace();
+        if (pos == end || *pos == '#') {
+            return false;
+        }
+        triple.subject = parse_subject();
+        skip_whitespace();
+        triple.predicate = parse_iri();
+        skip_whitespace();
+        triple.object = parse_object();
+        skip_whitespace();
+        // The graph of a quad is ignored
+        if (pos != end && *pos != '.') {
+            parse_subject();
+            skip_whitespace();
+        }
+        expect('.');
+        skip_whitespace();
+        if (pos != end && *pos != '#') {
+            fail("Unexpected content after the end of the triple");
+        }
+        triple.addition = true;
+        return true;
+    }
+
+private:
+    const char *const begin;
+    const char *pos;
+    const char *const end;
+
+    [[noreturn]] void fail(const std::string &message) {
+        throw std::runtime_error(message + " in N-Triples line: " + std::string(begin, end));
+    }
+
+    void skip_whitespace() {
+        while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) {
+            pos++;
+        }
+    }
+
+    void expect(char c) {
+        if (pos == end || *pos != c) {
+            fail(std::string("Expected '") + c + "'");
+        }
+        pos++;
+    }
+
+    std::string parse_subject() {
+        if (pos != end && *pos == '_') {
+            return parse_blank_node();
+        }
+        return parse_iri();
+    }
+
+    std::string parse_object() {
+        if (pos != end && *pos == '"') {
+            return parse_literal();
+        }
+        return parse_subject();
+    }
+
+    std::string parse_iri() {
+        expect('<');
+        std::string iri;
+        while (pos != end && *pos != '>') {
+            if (*pos == '\\') {
+                parse_escape(iri);
+            } else {
+                iri += *pos++;
+            }
+        }
+        expect('>');
+        return iri;
+    }
+
+    std::string parse_blank_node() {
+        expect('_');
+        expect(':');
+        const char *start = pos;
+        while (pos != end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '<' && *pos != '"') {
+            pos++;
+        }
+        // A label can not end with a dot, which is the end of the triple instead
+        while (pos != start && *(pos - 1) == '.') {
+            pos--;
+        }
+        if (pos == start) {
+            fail("Expected a blank node label");
+        }
+        return "_:" + std::string(start, pos);
+    }
+
+    std::string parse_literal() {
+        expect('"');
+        std::string literal = "\"";
+        while (pos != end && *pos != '"') {
+            if (*pos == '\\') {
+                parse_escape(literal);
+            } else {
+                literal += *pos++;
+            }
+        }
+        expect('"');
+        literal += '"';
+        if (pos != end && *pos == '@') {
+            const char *start = pos++;
+            while (pos != end && (isalnum((unsigned char) *pos) || *pos == '-')) {
+                pos++;
+            }
+            literal.append(start, pos);
+        } else if (pos != end && *pos == '^') {
+            expect('^');
+            expect('^');
+            std::string datatype = parse_iri();
+            if (datatype != XSD_STRING) {
+                literal += "^^" + datatype;
+            }
+        }
+        return literal;
+    }
+
+    void parse_escape(std::string &out) {
+        expect('\\');
+        if (pos == end) {
+            fail("Unexpected end of an escape sequence");
+        }
+        char c = *pos++;
+        switch (c) {
+            case 't': out += '\t'; break;
+            case 'b': out += '\b'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 'f': out += '\f'; break;
+            case '"': out += '"'; break;
+            case '\'': out += '\''; break;
+            case '\\': out += '\\'; break;
+            case 'u': append_utf8(out, parse_hex(4)); break;
+            case 'U': append_utf8(out, parse_hex(8)); break;
+            default: fail(std::string("Invalid escape sequence \\") + c);
+        }
+    }
+
+    uint32_t parse_hex(int digits) {
+        uint32_t value = 0;
+        for (int i = 0; i < digits; i++) {
+            if (pos == end || !isxdigit((unsigned char) *pos)) {
+                fail("Invalid unicode escape sequence");
+            }
+            char c = *pos++;
+            value = value * 16 + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        return value;
+    }
+
+    static void append_utf8(std::string &out, uint32_t code_point) {
+        if (code_point < 0x80) {
+            out += (char) code_point;
+        } else if (code_point < 0x800) {
+            out += (char) (0xC0 | (code_point >> 6));
+            out += (char) (0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+            out += (char) (0xE0 | (code_point >> 12));
+            out += (char) (0x80 | ((code_point >> 6) & 0x3F));
+            out += (char) (0x80 | (code_point & 0x3F));
+        } else {
+            out += (char) (0xF0 | (code_point >> 18));
+            out += (char) (0x80 | ((code_point >> 12) & 0x3F));
+            out += (char) (0x80 | ((code_point >> 6) & 0x3F));
+            out += (char) (0x80 | (code_point & 0x3F));
+        }
+    }
+};
+
+bool ParseNTriplesLine(const char *begin, const char *end, AppendTriple &triple) {
+    return LineParser(begin, end).parse(triple);
+}
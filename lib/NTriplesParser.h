@@ -0,0 +1,14 @@
+#ifndef OSTRICH_NTRIPLESPARSER_H
+#define OSTRICH_NTRIPLESPARSER_H
+
+#include <string>
+
+#include "AppendTriple.h"
+
+// Parses a single line of an N-Triples or N-Quads document into a triple, of which the graph is ignored.
+// Terms are represented in the same way as they are passed from JavaScript,
+// so IRIs are not enclosed in angle brackets, and literals have the form "value"@language or "value"^^datatype.
+// Returns false if the line contains no triple, and throws if the line is invalid.
+bool ParseNTriplesLine(const char *begin, const char *end, AppendTriple &triple);
+
+#endif //OSTRICH_NTRIPLESPARSER_H
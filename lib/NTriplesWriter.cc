@@ -0,0 +1,86 @@
+#include "NTriplesWriter.h"
+
+#include <utility>
+
+void AppendNTriplesTerm(const std::string &term, std::string &out) {
+    if (!term.empty() && term[0] == '"') {
+        // The value of a literal ends at its last quote, after which its language or datatype follows
+        size_t end = term.rfind('"');
+        out.push_back('"');
+        for (size_t i = 1; i < end; i++) {
+            char c = term[i];
+            switch (c) {
+                case '"':
+                    out.append("\\\"");
+                    break;
+                case '\\':
+                    out.append("\\\\");
+                    break;
+                case '\n':
+                    out.append("\\n");
+                    break;
+                case '\r':
+                    out.append("\\r");
+                    break;
+                default:
+                    out.push_back(c);
+            }
+        }
+        // Datatypes are already surrounded by angular brackets in HDT
+        out.append(term, end, std::string::npos);
+    } else if (term.size() > 1 && term[0] == '_' && term[1] == ':') {
+        out.append(term);
+    } else {
+        out.push_back('<');
+        out.append(term);
+        out.push_back('>');
+    }
+}
+
+NTriplesWriter::NTriplesWriter(Sink sink, size_t buffer_size)
+        : sink(std::move(sink)), buffer_size(buffer_size), count(0) {
+    buffer.reserve(buffer_size + 1024);
+}
+
+void NTriplesWriter::write_triple(Triple &triple, DictionaryManager &dict) {
+    append_term(dict, triple.get_subject(), hdt::SUBJECT);
+    buffer.push_back(' ');
+    append_term(dict, triple.get_predicate(), hdt::PREDICATE);
+    buffer.push_back(' ');
+    append_term(dict, triple.get_object(), hdt::OBJECT);
+    end_line();
+}
+
+void NTriplesWriter::write_delta(Triple &triple, DictionaryManager &dict, bool addition) {
+    buffer.append(addition ? "+ " : "- ");
+    write_triple(triple, dict);
+}
+
+void NTriplesWriter::flush() {
+    if (!buffer.empty()) {
+        sink(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void NTriplesWriter::append_term(DictionaryManager &dict, size_t id, hdt::TripleComponentRole role) {
+    TermCacheKey key{&dict, id, role};
+    auto it = terms.find(key);
+    if (it == terms.end()) {
+        if (terms.size() >= NTRIPLES_WRITER_TERM_CACHE_SIZE) {
+            terms.clear();
+        }
+        std::string encoded;
+        AppendNTriplesTerm(dict.idToString(id, role), encoded);
+        it = terms.emplace(key, std::move(encoded)).first;
+    }
+    buffer.append(it->second);
+}
+
+void NTriplesWriter::end_line() {
+    buffer.append(" .\n");
+    count++;
+    if (buffer.size() >= buffer_size) {
+        flush();
+    }
+}
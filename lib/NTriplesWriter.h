@@ -0,0 +1,47 @@
+#ifndef OSTRICH_NTRIPLESWRITER_H
+#define OSTRICH_NTRIPLESWRITER_H
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "TermCache.h"
+
+// The default number of bytes that are buffered before they are passed to the sink
+const size_t NTRIPLES_WRITER_DEFAULT_BUFFER_SIZE = 1 << 20;
+// The maximum number of encoded terms that are kept per writer
+const size_t NTRIPLES_WRITER_TERM_CACHE_SIZE = 65536;
+
+// Appends a term in its HDT representation to the output in its N-Triples representation
+void AppendNTriplesTerm(const std::string &term, std::string &out);
+
+// Writes triples as N-Triples, directly from their dictionary ids, into a buffer that is passed to a sink when it is full.
+// Deltas are written as N-Triples lines that are prefixed with '+ ' for additions and '- ' for deletions.
+// Encoded terms are kept in a bounded map, so that frequently occurring terms are only decoded once.
+class NTriplesWriter {
+public:
+    // Receives the bytes of consecutive lines
+    typedef std::function<void(const char *data, size_t length)> Sink;
+
+    explicit NTriplesWriter(Sink sink, size_t buffer_size = NTRIPLES_WRITER_DEFAULT_BUFFER_SIZE);
+
+    void write_triple(Triple &triple, DictionaryManager &dict);
+    void write_delta(Triple &triple, DictionaryManager &dict, bool addition);
+    // Passes the remaining buffered bytes to the sink
+    void flush();
+
+    [[nodiscard]] size_t get_count() const { return count; }
+
+private:
+    Sink sink;
+    size_t buffer_size;
+    std::string buffer;
+    size_t count;
+    std::unordered_map<TermCacheKey, std::string, TermCacheKeyHash> terms;
+
+    void append_term(DictionaryManager &dict, size_t id, hdt::TripleComponentRole role);
+    void end_line();
+};
+
+#endif //OSTRICH_NTRIPLESWRITER_H
@@ -1,16 +1,41 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>
 #include <vector>
+#include <poll.h>
+#include <unistd.h>
 #include <HDTEnums.hpp>
 #include <HDTManager.hpp>
 #include "OstrichStore.h"
 #include "LiteralsUtils.h"
+#include "TripleBatch.h"
+#include "ExternalSorter.h"
+#include "BulkLoader.h"
+#include "NTriplesWriter.h"
+#include "QueryCancellation.h"
+#include "SharedSnapshots.h"
+#include "PartitionCredits.h"
+#include "WorkerThread.h"
 
 /******** Construction and destruction ********/
 
 Nan::Persistent<v8::Function> OstrichStore::constructor;
 
 // Creates a new Ostrich store.
-OstrichStore::OstrichStore(std::string path, const v8::Local<v8::Object> &handle, Controller *controller) : path(std::move(path)), controller(controller), features(1) {
+OstrichStore::OstrichStore(std::string path, const v8::Local<v8::Object> &handle, Controller *controller, size_t term_cache_size,
+                           size_t result_cache_size, size_t checkpoint_count, std::unique_ptr<QueryPool> query_pool)
+        : path(std::move(path)), controller(controller), features(1), term_cache(std::make_shared<TermCache>(term_cache_size)),
+          result_cache(std::make_shared<ResultCache>(result_cache_size)),
+          vm_checkpoints(std::make_shared<IteratorCheckpoints<TripleIterator>>(checkpoint_count)),
+          dm_checkpoints(std::make_shared<IteratorCheckpoints<TripleDeltaIterator>>(checkpoint_count)),
+          query_pool(std::move(query_pool)), stats(std::make_shared<QueryStats>()), tracer(std::make_shared<QueryTracer>()),
+          slow_queries(std::make_shared<SlowQueryLog>(controller)), visible_version(controller->get_max_patch_id()),
+          write_generation(0) {
     this->Wrap(handle);
 }
 
@@ -21,6 +46,13 @@ OstrichStore::~OstrichStore() {
 
 // Destroys the document, disabling all further operations.
 void OstrichStore::Destroy(bool remove) {
+    // Scans that are not read would otherwise never finish
+    StopScans();
+    // Wait for running queries before the controller is deleted
+    query_pool.reset();
+    // Parked iterators refer to the patch trees, snapshots and dictionaries of the controller,
+    // so they must be destroyed before it
+    ClearCaches();
     if (controller != nullptr) {
         if (remove) {
             Controller::cleanup(path, controller);
@@ -31,6 +63,57 @@ void OstrichStore::Destroy(bool remove) {
     }
 }
 
+void OstrichStore::RegisterScan(const std::shared_ptr<PartitionCredits> &credits) {
+    std::lock_guard<std::mutex> lock(scans_mutex);
+    scans.erase(std::remove_if(scans.begin(), scans.end(), [](const std::weak_ptr<PartitionCredits> &scan) { return scan.expired(); }),
+                scans.end());
+    scans.push_back(credits);
+}
+
+void OstrichStore::StopScans() {
+    std::lock_guard<std::mutex> lock(scans_mutex);
+    for (auto &scan : scans) {
+        if (auto credits = scan.lock()) {
+            credits->cancel();
+        }
+    }
+    scans.clear();
+}
+
+// Fails with the given message without doing any work.
+class RejectedWorker : public Nan::AsyncWorker {
+    std::string message;
+
+public:
+    RejectedWorker(std::string message, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), message(std::move(message)) {
+        SaveToPersistent("self", self);
+    };
+
+    void Execute() override {
+        SetErrorMessage(message.c_str());
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+void OstrichStore::QueueQuery(QueryType type, Nan::AsyncWorker *worker, const v8::Local<v8::Function> &callback) {
+    if (query_pool == nullptr) {
+        // The store has been closed
+        Nan::AsyncQueueWorker(worker);
+    } else if (!query_pool->queue(worker, type)) {
+        worker->Destroy();
+        // Query types correspond to the first stats operations
+        OperationTimer(stats, (StatsOperation) type).fail();
+        Nan::AsyncQueueWorker(new RejectedWorker("The query queue is full, as " + std::to_string(query_pool->get_queue_depth())
+                                                 + " queries are already waiting", new Nan::Callback(callback), handle()));
+    }
+}
+
 // Constructs a JavaScript wrapper for an Ostrich store.
 NAN_METHOD(OstrichStore::New) {
     assert(info.IsConstructCall());
@@ -50,9 +133,29 @@ const Nan::Persistent<v8::Function> &OstrichStore::GetConstructor() {
         Nan::SetPrototypeMethod(constructorTemplate, "_searchTriplesDeltaMaterialized", SearchTriplesDeltaMaterialized);
         Nan::SetPrototypeMethod(constructorTemplate, "_countTriplesDeltaMaterialized", CountTriplesDeltaMaterialized);
         Nan::SetPrototypeMethod(constructorTemplate, "_searchTriplesVersion", SearchTriplesVersion);
+        Nan::SetPrototypeMethod(constructorTemplate, "_searchTriplesVersionMaterializedPacked", SearchTriplesVersionMaterializedPacked);
+        Nan::SetPrototypeMethod(constructorTemplate, "_searchTriplesDeltaMaterializedPacked", SearchTriplesDeltaMaterializedPacked);
+        Nan::SetPrototypeMethod(constructorTemplate, "_searchTriplesVersionPacked", SearchTriplesVersionPacked);
         Nan::SetPrototypeMethod(constructorTemplate, "_countTriplesVersion", CountTriplesVersion);
+        Nan::SetPrototypeMethod(constructorTemplate, "_searchTripleIdsVersionMaterialized", SearchTripleIdsVersionMaterialized);
+        Nan::SetPrototypeMethod(constructorTemplate, "_decodeTripleIds", DecodeTripleIds);
+        Nan::SetPrototypeMethod(constructorTemplate, "_searchBatch", SearchBatch);
+        Nan::SetPrototypeMethod(constructorTemplate, "_searchTriplesVersionMaterializedPartitioned", SearchTriplesVersionMaterializedPartitioned);
+        Nan::SetPrototypeMethod(constructorTemplate, "_exportTriplesVersionMaterialized", ExportTriplesVersionMaterialized);
+        Nan::SetPrototypeMethod(constructorTemplate, "_exportTriplesDeltaMaterialized", ExportTriplesDeltaMaterialized);
         Nan::SetPrototypeMethod(constructorTemplate, "_append", Append);
+        Nan::SetPrototypeMethod(constructorTemplate, "_appendUnsorted", AppendUnsorted);
+        Nan::SetPrototypeMethod(constructorTemplate, "_appendStream", AppendStream);
+        Nan::SetPrototypeMethod(constructorTemplate, "_appendFullVersion", AppendFullVersion);
+        Nan::SetPrototypeMethod(constructorTemplate, "_appendFromFile", AppendFromFile);
+        Nan::SetPrototypeMethod(constructorTemplate, "_ingest", Ingest);
+        Nan::SetPrototypeMethod(constructorTemplate, "_cancelScans", CancelScans);
         Nan::SetPrototypeMethod(constructorTemplate, "_close", Close);
+        Nan::SetPrototypeMethod(constructorTemplate, "_stats", Stats);
+        Nan::SetPrototypeMethod(constructorTemplate, "_startTracing", StartTracing);
+        Nan::SetPrototypeMethod(constructorTemplate, "_stopTracing", StopTracing);
+        Nan::SetPrototypeMethod(constructorTemplate, "_setSlowQueryLog", SetSlowQueryLog);
+        Nan::SetPrototypeMethod(constructorTemplate, "_slowQueries", SlowQueries);
         Nan::SetAccessor(constructorTemplate->PrototypeTemplate(), Nan::New("maxVersion").ToLocalChecked(), MaxVersion);
         Nan::SetAccessor(constructorTemplate->PrototypeTemplate(), Nan::New("_features").ToLocalChecked(), Features);
         Nan::SetAccessor(constructorTemplate->PrototypeTemplate(), Nan::New("closed").ToLocalChecked(), Closed);
@@ -69,18 +172,32 @@ class CreateWorker : public Nan::AsyncWorker {
     std::string path;
     Controller *controller;
     bool read_only;
+    bool shared;
     SnapshotCreationStrategy *strategy;
+    size_t term_cache_size;
+    size_t result_cache_size;
+    size_t checkpoint_count;
+    QueryPoolOptions query_pool_options;
 
 public:
-    CreateWorker(const char *path, bool read_only, const std::string& strategy_name, const std::string& strategy_parameter, Nan::Callback *callback)
-            : Nan::AsyncWorker(callback), path(path), read_only(read_only), controller(nullptr),
-              strategy(SnapshotCreationStrategy::get_composite_strategy(strategy_name, strategy_parameter)) {};
+    CreateWorker(const char *path, bool read_only, bool shared, const std::string& strategy_name, const std::string& strategy_parameter,
+                 size_t term_cache_size, size_t result_cache_size, size_t checkpoint_count,
+                 const QueryPoolOptions &query_pool_options, Nan::Callback *callback)
+            : Nan::AsyncWorker(callback), path(path), read_only(read_only), shared(shared), controller(nullptr),
+              strategy(SnapshotCreationStrategy::get_composite_strategy(strategy_name, strategy_parameter)),
+              term_cache_size(term_cache_size), result_cache_size(result_cache_size), checkpoint_count(checkpoint_count),
+              query_pool_options(query_pool_options) {};
 
     void Execute() override {
         try {
+            if (shared) {
+                PrepareSharedSnapshots(path);
+            }
             controller = new Controller(path, strategy, kyotocabinet::HashDB::TCOMPRESS, read_only);
         } catch (const std::invalid_argument &error) {
             SetErrorMessage(error.what());
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
         }
     }
 
@@ -88,7 +205,8 @@ public:
         Nan::HandleScope scope;
         // Create a new OstrichStore
         v8::Local<v8::Object> newStore = Nan::NewInstance(Nan::New(OstrichStore::GetConstructor())).ToLocalChecked();
-        new OstrichStore(path, newStore, controller);
+        new OstrichStore(path, newStore, controller, term_cache_size, result_cache_size, checkpoint_count,
+                         std::make_unique<QueryPool>(Nan::GetCurrentEventLoop(), query_pool_options));
         // Send the new OstrichStore through the callback
         const unsigned argc = 2;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), newStore};
@@ -98,65 +216,378 @@ public:
 };
 
 // Creates a new instance of OstrichStore.
-// JavaScript signature: createOstrichStore(path, readOnly, callback)
+// JavaScript signature: createOstrichStore(path, readOnly, strategyName, strategyParameter, options, callback)
+// The options object may contain termCacheSize: the maximum number of decoded terms that are cached,
+// resultCacheSize: the maximum number of bytes of version materialized pages that are cached,
+// checkpointCount: the maximum number of iterators that are kept to resume later pages from,
+// queryThreads: the number of threads that execute queries, where 0 uses the default libuv thread pool,
+// queryQueueDepth: the maximum number of queries that wait for a thread, where 0 is unbounded,
+// queryPriorities: an object that maps query types to a QueryPriority,
+// and shared: whether the indexes of all snapshots must be persisted, so that read-only processes can share them.
 NAN_METHOD(OstrichStore::Create) {
-    assert(info.Length() == 4);
+    assert(info.Length() >= 6);
+    bool shared = false;
+    size_t term_cache_size = TERM_CACHE_DEFAULT_CAPACITY;
+    size_t result_cache_size = RESULT_CACHE_DEFAULT_SIZE;
+    size_t checkpoint_count = ITERATOR_CHECKPOINTS_DEFAULT_CAPACITY;
+    QueryPoolOptions query_pool_options;
+    if (info[4]->IsObject()) {
+        v8::Local<v8::Object> options = info[4].As<v8::Object>();
+        v8::Local<v8::Value> value = Nan::Get(options, Nan::New("termCacheSize").ToLocalChecked()).ToLocalChecked();
+        if (value->IsNumber()) {
+            term_cache_size = value->Uint32Value(Nan::GetCurrentContext()).FromJust();
+        }
+        value = Nan::Get(options, Nan::New("shared").ToLocalChecked()).ToLocalChecked();
+        shared = value->BooleanValue(info.GetIsolate());
+        value = Nan::Get(options, Nan::New("resultCacheSize").ToLocalChecked()).ToLocalChecked();
+        if (value->IsNumber()) {
+            result_cache_size = (size_t) std::max(value->IntegerValue(Nan::GetCurrentContext()).FromJust(), (int64_t) 0);
+        }
+        value = Nan::Get(options, Nan::New("checkpointCount").ToLocalChecked()).ToLocalChecked();
+        if (value->IsNumber()) {
+            checkpoint_count = value->Uint32Value(Nan::GetCurrentContext()).FromJust();
+        }
+        value = Nan::Get(options, Nan::New("queryThreads").ToLocalChecked()).ToLocalChecked();
+        if (value->IsNumber()) {
+            query_pool_options.threads = value->Uint32Value(Nan::GetCurrentContext()).FromJust();
+        }
+        value = Nan::Get(options, Nan::New("queryQueueDepth").ToLocalChecked()).ToLocalChecked();
+        if (value->IsNumber()) {
+            query_pool_options.queue_depth = value->Uint32Value(Nan::GetCurrentContext()).FromJust();
+        }
+        value = Nan::Get(options, Nan::New("queryPriorities").ToLocalChecked()).ToLocalChecked();
+        if (value->IsObject()) {
+            v8::Local<v8::Object> priorities = value.As<v8::Object>();
+            const char *types[QUERY_TYPES] = {"versionMaterialized", "deltaMaterialized", "version", "count", "batch", "export"};
+            for (size_t type = 0; type < QUERY_TYPES; type++) {
+                v8::Local<v8::Value> priority = Nan::Get(priorities, Nan::New(types[type]).ToLocalChecked()).ToLocalChecked();
+                if (priority->IsNumber()) {
+                    query_pool_options.priorities[type] = (QueryPriority) std::min(
+                            priority->Uint32Value(Nan::GetCurrentContext()).FromJust(), (uint32_t) QUERY_PRIORITY_LOW);
+                }
+            }
+        }
+    }
     Nan::AsyncQueueWorker(new CreateWorker(*Nan::Utf8String(info[0]),
                                            info[1]->BooleanValue(info.GetIsolate()),
+                                           shared,
                                            *Nan::Utf8String(info[2]),
                                            *Nan::Utf8String(info[3]),
-                                           new Nan::Callback(info[4].As<v8::Function>())));
+                                           term_cache_size,
+                                           result_cache_size,
+                                           checkpoint_count,
+                                           query_pool_options,
+                                           new Nan::Callback(info[5].As<v8::Function>())));
 }
 
 
 /******** OstrichStore#_searchTriplesVersionMaterialized ********/
 
+// Counts the bytes of decoded terms, as recorded in the stats of queries
+static uint64_t TermBytes(const std::vector<std::string> &terms) {
+    uint64_t bytes = 0;
+    for (auto &term : terms) {
+        bytes += term.size();
+    }
+    return bytes;
+}
+
 class SearchTriplesVersionMaterializedWorker : public Nan::AsyncWorker {
     OstrichStore *store;
+    std::shared_ptr<TermCache> cache;
+    std::shared_ptr<ResultCache> results;
+    std::shared_ptr<IteratorCheckpoints<TripleIterator>> checkpoints;
     std::shared_ptr<DictionaryManager> dict;
     // JavaScript function arguments
     std::string subject, predicate, object;
     uint32_t offset, limit;
+    bool packed;
+    QueryStopCheck stop;
     v8::Persistent<v8::Object> self;
-    // Callback return values
-    std::vector<Triple> triples;
+    // Callback return values, with three decoded terms per triple
+    std::vector<std::string> terms;
+    char *packedData{nullptr};
+    size_t packedLength{0};
     int version;
     uint32_t totalCount{0};
     bool hasExactCount{false};
+    OperationTimer timer;
+    OperationTrace trace;
 
 public:
     SearchTriplesVersionMaterializedWorker(OstrichStore *store, char *subject, char *predicate, char *object,
-                                           uint32_t offset, uint32_t limit, int32_t version, Nan::Callback *callback,
-                                           v8::Local<v8::Object> self)
+                                           uint32_t offset, uint32_t limit, int32_t version, bool packed,
+                                           std::shared_ptr<QueryCancellation> cancellation,
+                                           Nan::Callback *callback, v8::Local<v8::Object> self)
             : Nan::AsyncWorker(callback),
-              store(store), subject(subject), predicate(predicate), object(object),
-              offset(offset), limit(limit), version(version) {
+              store(store), cache(store->GetTermCache()), results(store->GetResultCache()),
+              checkpoints(store->GetVersionMaterializedCheckpoints()),
+              subject(subject), predicate(predicate), object(object), offset(offset), limit(limit), packed(packed),
+              stop(std::move(cancellation)), version(version),
+              timer(store->GetStats(), STATS_OPERATION_VERSION_MATERIALIZED),
+              trace(store->GetTracer(), "versionMaterialized") {
         SaveToPersistent("self", self);
+        trace.pattern(this->subject, this->predicate, this->object).arg("offset", (int64_t) offset).arg("limit", (int64_t) limit);
     };
 
+    ~SearchTriplesVersionMaterializedWorker() override {
+        free(packedData);
+    }
+
     void Execute() override {
+        auto executing = timer.execute();
+        auto tracing = trace.span("execute");
+        tracing.count("queueWait", (int64_t) trace.since_created());
+        auto waiting = trace.span("lock");
+        auto lock = store->LockRead();
+        waiting.end();
         TripleIterator *it = nullptr;
         try {
             Controller *controller = store->GetController();
 
             // Check version
-            version = version >= 0 ? version : controller->get_max_patch_id();
+            version = version >= 0 ? version : store->GetVisibleVersion();
+
+            // Serve repeated pages from the result cache
+            ResultCacheKey key{subject, predicate, object, version, offset, limit};
+            uint64_t generation = results->get_generation();
+            ResultCacheEntry cached;
+            if (packed && results->get(key, cached)) {
+                packedLength = cached.batch->size();
+                packedData = (char *) malloc(packedLength);
+                if (packedData == nullptr) {
+                    throw std::runtime_error("Could not allocate a triple batch of " + std::to_string(packedLength) + " bytes");
+                }
+                memcpy(packedData, cached.batch->data(), packedLength);
+                totalCount = cached.totalCount;
+                hasExactCount = cached.hasExactCount;
+                return;
+            }
 
             // Prepare the triple pattern
+            auto looking_up = trace.span("lookup");
+            looking_up.count("version", version);
             dict = controller->get_dictionary_manager(version);
+            CheckpointKey checkpoint_key{subject, predicate, object, version, version};
+            uint64_t checkpoint_generation = checkpoints->get_generation();
+            StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
+
+            // Resume an iterator that was left shortly before the offset by an earlier page, or build a new one
+            Triple t;
+            uint32_t position;
+            if (std::unique_ptr<TripleIterator> resumed = checkpoints->take(checkpoint_key, offset, position)) {
+                it = resumed.release();
+                while (position < offset && it->next(&t)) {
+                    position++;
+                }
+            } else {
+                it = controller->get_version_materialized(triple_pattern, offset, version);
+            }
+            looking_up.end();
+
+            // Add matching triples to the result vector,
+            // or directly into a packed batch so that no per-triple work remains for the main thread.
+            // The limit is checked first, so that no triple after the page is consumed.
+            // If the query is cancelled, the page is truncated to the triples that were found so far.
+            auto iterating = trace.span("iterate");
+            auto decoding = trace.accumulate("decode");
+            if (packed) {
+                TripleBatchBuilder batch(TRIPLE_BATCH_VERSION_MATERIALIZED, *cache);
+                while ((limit == 0 || totalCount < limit) && !stop() && it->next(&t)) {
+                    decoding.begin();
+                    batch.add(t, *dict);
+                    decoding.end();
+                    totalCount++;
+                }
+                packedData = batch.release(packedLength);
+            } else {
+                // Terms are decoded here, as the dictionary may be modified by an append once the query is done
+                while ((limit == 0 || totalCount < limit) && !stop() && it->next(&t)) {
+                    decoding.begin();
+                    terms.push_back(cache->get(*dict, t.get_subject(), hdt::SUBJECT));
+                    terms.push_back(cache->get(*dict, t.get_predicate(), hdt::PREDICATE));
+                    terms.push_back(cache->get(*dict, t.get_object(), hdt::OBJECT));
+                    decoding.end();
+                    totalCount++;
+                }
+            }
+            hasExactCount = (limit != 0 && totalCount == limit) || stop.is_stopped() ? hdt::APPROXIMATE : hdt::EXACT;
+            iterating.count("results", totalCount);
+            iterating.end();
+            // A full page may be followed by more results, which the next page can resume from
+            if (limit != 0 && totalCount == limit) {
+                checkpoints->put(std::move(checkpoint_key), offset + totalCount, std::unique_ptr<TripleIterator>(it), checkpoint_generation);
+                it = nullptr;
+            }
+            if (packed && !stop.is_stopped()) {
+                results->put(std::move(key), ResultCacheEntry{std::make_shared<const std::string>(packedData, packedLength),
+                                                               totalCount, hasExactCount}, generation);
+            }
+            // Slow queries are logged while the controller cannot be modified by an append
+            std::shared_ptr<SlowQueryLog> slow_queries = store->GetSlowQueryLog();
+            if (slow_queries->is_slow(executing.elapsed())) {
+                slow_queries->record(SlowQuery{STATS_OPERATION_VERSION_MATERIALIZED, subject, predicate, object, offset, limit,
+                                               version, version, totalCount}, timer, executing);
+            }
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+        }
+        delete it;
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        auto marshalling = trace.span("marshal");
+
+        if (packed) {
+            // The buffer takes ownership of the packed data
+            v8::Local<v8::Value> batch = Nan::NewBuffer(packedData, packedLength).ToLocalChecked();
+            packedData = nullptr;
+            const unsigned argc = 5;
+            v8::Local<v8::Value> argv[argc] = {Nan::Null(), batch, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount),
+                                               Nan::New<v8::Boolean>(stop.is_stopped())};
+            timer.finish(totalCount, packedLength);
+            marshalling.end();
+            Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+            return;
+        }
+
+        // Convert the triples into a JavaScript object array
+        uint32_t count = 0;
+        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(terms.size() / 3);
+        const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
+        const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
+        const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
+        for (size_t i = 0; i + 2 < terms.size(); i += 3) {
+            v8::Local<v8::Object> tripleObject = Nan::New<v8::Object>();
+            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(terms[i]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(terms[i + 1]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(terms[i + 2]).ToLocalChecked());
+            triplesArray->Set(Nan::GetCurrentContext(), count++, tripleObject);
+        }
+
+        // Send the JavaScript array, estimated total count, and whether the results were truncated through the callback
+        const unsigned argc = 5;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount),
+                                           Nan::New<v8::Boolean>(stop.is_stopped())};
+        timer.finish(totalCount, TermBytes(terms));
+        marshalling.end();
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+static void QueueSearchTriplesVersionMaterialized(Nan::NAN_METHOD_ARGS_TYPE info, bool packed) {
+    assert(info.Length() >= 7);
+    OstrichStore *store = Nan::ObjectWrap::Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_VERSION_MATERIALIZED, new SearchTriplesVersionMaterializedWorker(store,
+                                                                                                  *Nan::Utf8String(info[0]),
+                                                                                                  *Nan::Utf8String(info[1]),
+                                                                                                  *Nan::Utf8String(info[2]),
+                                                                                                  info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                                  info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                                  info[5]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                                  packed,
+                                                                                                  QueryCancellationHandle::FromValue(info[8]),
+                                                                                                  new Nan::Callback(info[6].As<v8::Function>()),
+                                                                                                  info[7]->IsObject() ? info[7].As<v8::Object>() : info.This()), info[6].As<v8::Function>());
+}
+
+// Searches for a triple pattern in the document.
+// JavaScript signature: OstrichStore#_searchTriplesVersionMaterialized(subject, predicate, object, offset, limit, version, callback, self, cancellation)
+NAN_METHOD(OstrichStore::SearchTriplesVersionMaterialized) {
+    QueueSearchTriplesVersionMaterialized(info, false);
+}
+
+// Searches for a triple pattern in the document, and returns the results as a packed triple batch.
+// JavaScript signature: OstrichStore#_searchTriplesVersionMaterializedPacked(subject, predicate, object, offset, limit, version, callback, self, cancellation)
+NAN_METHOD(OstrichStore::SearchTriplesVersionMaterializedPacked) {
+    QueueSearchTriplesVersionMaterialized(info, true);
+}
+
+/******** OstrichStore#_searchTripleIdsVersionMaterialized ********/
+
+class SearchTripleIdsVersionMaterializedWorker : public Nan::AsyncWorker {
+    OstrichStore *store;
+    // JavaScript function arguments
+    std::string subject, predicate, object;
+    uint32_t offset, limit;
+    int version;
+    QueryStopCheck stop;
+    v8::Persistent<v8::Object> self;
+    // Callback return values
+    char *idsData{nullptr};
+    size_t idsLength{0};
+    uint32_t totalCount{0};
+    bool hasExactCount{false};
+    OperationTimer timer;
+
+public:
+    SearchTripleIdsVersionMaterializedWorker(OstrichStore *store, char *subject, char *predicate, char *object,
+                                             uint32_t offset, uint32_t limit, int32_t version,
+                                             std::shared_ptr<QueryCancellation> cancellation,
+                                             Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback),
+              store(store), subject(subject), predicate(predicate), object(object),
+              offset(offset), limit(limit), version(version), stop(std::move(cancellation)),
+              timer(store->GetStats(), STATS_OPERATION_VERSION_MATERIALIZED) {
+        SaveToPersistent("self", self);
+    };
+
+    ~SearchTripleIdsVersionMaterializedWorker() override {
+        free(idsData);
+    }
+
+    void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
+        TripleIterator *it = nullptr;
+        try {
+            Controller *controller = store->GetController();
+
+            // Check version
+            version = version >= 0 ? version : store->GetVisibleVersion();
+
+            // Prepare the triple pattern
             StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
 
             // Build iterator
             it = controller->get_version_materialized(triple_pattern, offset, version);
 
-            // Add matching triples to the result vector
+            // Collect the subject, predicate and object ids of the matching triples.
+            // Ids are stored as doubles, as these can be exposed to JavaScript as a Float64Array without loss.
+            // The limit is checked first, so that no triple after the page is consumed.
+            // If the query is cancelled, the page is truncated to the triples that were found so far.
+            std::vector<double> ids;
             Triple t;
-
-            while (it->next(&t) && (limit == 0 || triples.size() < limit)) {
-                triples.push_back(t);
+            while ((limit == 0 || totalCount < limit) && !stop() && it->next(&t)) {
+                ids.push_back((double) t.get_subject());
+                ids.push_back((double) t.get_predicate());
+                ids.push_back((double) t.get_object());
                 totalCount++;
             }
-            hasExactCount = (limit != 0 && totalCount == limit) ? hdt::APPROXIMATE : hdt::EXACT;
+            hasExactCount = (limit != 0 && totalCount == limit) || stop.is_stopped() ? hdt::APPROXIMATE : hdt::EXACT;
+
+            idsLength = ids.size() * sizeof(double);
+            idsData = (char *) malloc(std::max(idsLength, sizeof(double)));
+            if (idsData == nullptr) {
+                throw std::runtime_error("Could not allocate " + std::to_string(idsLength) + " bytes of triple ids");
+            }
+            memcpy(idsData, ids.data(), idsLength);
+
+            // Slow queries are logged while the controller cannot be modified by an append
+            std::shared_ptr<SlowQueryLog> slow_queries = store->GetSlowQueryLog();
+            if (slow_queries->is_slow(executing.elapsed())) {
+                slow_queries->record(SlowQuery{STATS_OPERATION_VERSION_MATERIALIZED, subject, predicate, object, offset, limit,
+                                               version, version, totalCount}, timer, executing);
+            }
         } catch (const std::runtime_error &error) {
             SetErrorMessage(error.what());
         }
@@ -165,48 +596,136 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
+
+        // The buffer takes ownership of the ids
+        v8::Local<v8::Value> ids = Nan::NewBuffer(idsData, idsLength).ToLocalChecked();
+        idsData = nullptr;
+        const unsigned argc = 5;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), ids, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount),
+                                           Nan::New<v8::Boolean>(stop.is_stopped())};
+        timer.finish(totalCount, idsLength);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+// Searches for a triple pattern in the document, and only returns the dictionary ids of the matching triples.
+// JavaScript signature: OstrichStore#_searchTripleIdsVersionMaterialized(subject, predicate, object, offset, limit, version, callback, self, cancellation)
+NAN_METHOD(OstrichStore::SearchTripleIdsVersionMaterialized) {
+    assert(info.Length() >= 7);
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_VERSION_MATERIALIZED, new SearchTripleIdsVersionMaterializedWorker(store,
+                                                                                                    *Nan::Utf8String(info[0]),
+                                                                                                    *Nan::Utf8String(info[1]),
+                                                                                                    *Nan::Utf8String(info[2]),
+                                                                                                    info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                                    info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                                    info[5]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                                    QueryCancellationHandle::FromValue(info[8]),
+                                                                                                    new Nan::Callback(info[6].As<v8::Function>()),
+                                                                                                    info[7]->IsObject() ? info[7].As<v8::Object>() : info.This()), info[6].As<v8::Function>());
+}
+
+
+/******** OstrichStore#_decodeTripleIds ********/
+
+class DecodeTripleIdsWorker : public Nan::AsyncWorker {
+    OstrichStore *store;
+    std::shared_ptr<TermCache> cache;
+    // JavaScript function arguments
+    std::vector<double> ids;
+    int version;
+    v8::Persistent<v8::Object> self;
+    // Callback return values
+    std::vector<std::string> terms;
+    OperationTimer timer;
+
+public:
+    DecodeTripleIdsWorker(OstrichStore *store, const double *ids, size_t count, int32_t version,
+                          Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback),
+              store(store), cache(store->GetTermCache()), ids(ids, ids + count), version(version),
+              timer(store->GetStats(), STATS_OPERATION_DECODE) {
+        SaveToPersistent("self", self);
+    };
+
+    void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
+        try {
+            Controller *controller = store->GetController();
+
+            // Check version
+            version = version >= 0 ? version : store->GetVisibleVersion();
+            std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(version);
+
+            // Decode all ids, hot terms will come straight from the cache.
+            // Ids come from JavaScript, so ids that are not in the dictionary are rejected instead of being looked up.
+            terms.reserve(ids.size());
+            for (size_t i = 0; i < ids.size(); i++) {
+                hdt::TripleComponentRole role = i % 3 == 0 ? hdt::SUBJECT : i % 3 == 1 ? hdt::PREDICATE : hdt::OBJECT;
+                if (!TermCache::is_valid_id(*dict, ids[i], role)) {
+                    throw std::runtime_error("Invalid triple id at index " + std::to_string(i) + ": "
+                                             + std::to_string(ids[i]) + " is not a term id of version " + std::to_string(version));
+                }
+                terms.push_back(cache->get(*dict, (size_t) ids[i], role));
+            }
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+        }
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
 
         // Convert the triples into a JavaScript object array
         uint32_t count = 0;
-        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(triples.size());
+        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(terms.size() / 3);
         const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
         const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
         const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
-        for (auto& triple : triples) {
+        for (size_t i = 0; i + 2 < terms.size(); i += 3) {
             v8::Local<v8::Object> tripleObject = Nan::New<v8::Object>();
-            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(triple.get_subject(*dict).c_str()).ToLocalChecked());
-            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(triple.get_predicate(*dict).c_str()).ToLocalChecked());
-            std::string object = triple.get_object(*dict);
-            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(fromHdtLiteral(object).c_str()).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(terms[i]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(terms[i + 1]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(terms[i + 2]).ToLocalChecked());
             triplesArray->Set(Nan::GetCurrentContext(), count++, tripleObject);
         }
 
-        // Send the JavaScript array and estimated total count through the callback
-        const unsigned argc = 4;
-        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        const unsigned argc = 2;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray};
+        timer.finish(terms.size() / 3, TermBytes(terms));
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
 };
 
-// Searches for a triple pattern in the document.
-// JavaScript signature: OstrichStore#_searchTriplesVersionMaterialized(subject, predicate, object, offset, limit, version, callback)
-NAN_METHOD(OstrichStore::SearchTriplesVersionMaterialized) {
-    assert(info.Length() >= 7);
-    Nan::AsyncQueueWorker(new SearchTriplesVersionMaterializedWorker(Unwrap<OstrichStore>(info.This()),
-                                                                     *Nan::Utf8String(info[0]),
-                                                                     *Nan::Utf8String(info[1]),
-                                                                     *Nan::Utf8String(info[2]),
-                                                                     info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                     info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                     info[5]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                     new Nan::Callback(info[6].As<v8::Function>()),
-                                                                     info[7]->IsObject() ? info[7].As<v8::Object>() : info.This()));
+// Decodes subject, predicate and object ids, as returned by _searchTripleIdsVersionMaterialized, into triples.
+// JavaScript signature: OstrichStore#_decodeTripleIds(ids, version, callback)
+NAN_METHOD(OstrichStore::DecodeTripleIds) {
+    assert(info.Length() >= 3);
+    v8::Local<v8::Object> ids = info[0].As<v8::Object>();
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_VERSION_MATERIALIZED, new DecodeTripleIdsWorker(store,
+                                                                                 (const double *) node::Buffer::Data(ids),
+                                                                                 node::Buffer::Length(ids) / sizeof(double),
+                                                                                 info[1]->Int32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                 new Nan::Callback(info[2].As<v8::Function>()),
+                                                                                 info[3]->IsObject() ? info[3].As<v8::Object>() : info.This()), info[2].As<v8::Function>());
 }
 
 /******** OstrichStore#_countTriplesVersionMaterialized ********/
@@ -220,19 +739,23 @@ class CountTriplesVersionMaterializedWorker : public Nan::AsyncWorker {
     // Callback return values
     uint32_t totalCount{0};
     bool hasExactCount{false};
+    OperationTimer timer;
 
 public:
     CountTriplesVersionMaterializedWorker(OstrichStore *store, char *subject, char *predicate, char *object, int32_t version, Nan::Callback *callback, v8::Local<v8::Object> self)
-            : Nan::AsyncWorker(callback), store(store), subject(subject), predicate(predicate), object(object), version(version) {
+            : Nan::AsyncWorker(callback), store(store), subject(subject), predicate(predicate), object(object), version(version),
+              timer(store->GetStats(), STATS_OPERATION_COUNT) {
         SaveToPersistent("self", self);
     };
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
         try {
             Controller *controller = store->GetController();
 
             // Check version
-            version = version >= 0 ? version : controller->get_max_patch_id();
+            version = version >= 0 ? version : store->GetVisibleVersion();
 
             // Prepare the triple pattern
             StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
@@ -248,14 +771,17 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
         // Send the JavaScript array and estimated total count through the callback
         const unsigned argc = 3;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        timer.finish(0, 0);
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -264,59 +790,135 @@ public:
 
 void OstrichStore::CountTriplesVersionMaterialized(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.Length() >= 5);
-    Nan::AsyncQueueWorker(new CountTriplesVersionMaterializedWorker(Unwrap<OstrichStore>(info.This()),
-                                                                     *Nan::Utf8String(info[0]),
-                                                                     *Nan::Utf8String(info[1]),
-                                                                     *Nan::Utf8String(info[2]),
-                                                                     info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                     new Nan::Callback(info[4].As<v8::Function>()),
-                                                                     info[5]->IsObject() ? info[5].As<v8::Object>() : info.This()));
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_COUNT, new CountTriplesVersionMaterializedWorker(store,
+                                                                                  *Nan::Utf8String(info[0]),
+                                                                                  *Nan::Utf8String(info[1]),
+                                                                                  *Nan::Utf8String(info[2]),
+                                                                                  info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                  new Nan::Callback(info[4].As<v8::Function>()),
+                                                                                  info[5]->IsObject() ? info[5].As<v8::Object>() : info.This()), info[4].As<v8::Function>());
 }
 
 /******** OstrichStore#_searchTriplesDeltaMaterialized ********/
 class SearchTriplesDeltaMaterializedWorker : public Nan::AsyncWorker {
     OstrichStore *store;
+    std::shared_ptr<TermCache> cache;
+    std::shared_ptr<IteratorCheckpoints<TripleDeltaIterator>> checkpoints;
     // JavaScript function arguments
     std::string subject, predicate, object;
     uint32_t offset, limit;
     int version_start, version_end;
+    bool packed;
+    QueryStopCheck stop;
     v8::Persistent<v8::Object> self;
-    // Callback return values
-    std::vector<TripleDelta*> triples;
+    // Callback return values, with three decoded terms per triple
+    std::vector<std::string> terms;
+    std::vector<bool> additions;
+    char *packedData{nullptr};
+    size_t packedLength{0};
     uint32_t totalCount{0};
     bool hasExactCount;
+    OperationTimer timer;
+    OperationTrace trace;
 
 public:
     SearchTriplesDeltaMaterializedWorker(OstrichStore *store, char *subject, char *predicate, char *object,
                                          uint32_t offset, uint32_t limit, int32_t version_start, int32_t version_end,
+                                         bool packed, std::shared_ptr<QueryCancellation> cancellation,
                                          Nan::Callback *callback, v8::Local<v8::Object> self)
             : Nan::AsyncWorker(callback),
-              store(store), subject(subject), predicate(predicate), object(object),
-              offset(offset), limit(limit), version_start(version_start), version_end(version_end) {
+              store(store), cache(store->GetTermCache()), checkpoints(store->GetDeltaMaterializedCheckpoints()),
+              subject(subject), predicate(predicate), object(object),
+              offset(offset), limit(limit), version_start(version_start), version_end(version_end), packed(packed),
+              stop(std::move(cancellation)),
+              timer(store->GetStats(), STATS_OPERATION_DELTA_MATERIALIZED),
+              trace(store->GetTracer(), "deltaMaterialized") {
         SaveToPersistent("self", self);
+        trace.pattern(this->subject, this->predicate, this->object).arg("offset", (int64_t) offset).arg("limit", (int64_t) limit);
     };
 
+    ~SearchTriplesDeltaMaterializedWorker() override {
+        free(packedData);
+    }
+
     void Execute() override {
+        auto executing = timer.execute();
+        auto tracing = trace.span("execute");
+        tracing.count("queueWait", (int64_t) trace.since_created());
+        auto waiting = trace.span("lock");
+        auto lock = store->LockRead();
+        waiting.end();
         TripleDeltaIterator *it = nullptr;
         try {
             Controller *controller = store->GetController();
 
             // Check version
-            version_end = version_end >= 0 ? version_end : controller->get_max_patch_id();
+            version_end = version_end >= 0 ? version_end : store->GetVisibleVersion();
 
             // Prepare the triple pattern
+            auto looking_up = trace.span("lookup");
+            looking_up.count("versionStart", version_start);
+            looking_up.count("versionEnd", version_end);
+            CheckpointKey checkpoint_key{subject, predicate, object, version_start, version_end};
+            uint64_t checkpoint_generation = checkpoints->get_generation();
             StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
 
-            // Get the iterator
-            it = controller->get_delta_materialized(triple_pattern, offset, version_start, version_end);
-
-            // Add matching triples to the result vector
+            // Resume an iterator that was left shortly before the offset by an earlier page, or get a new one
             TripleDelta t;
-            while (it->next(&t) && (!limit || triples.size() < limit)) {
-                triples.push_back(new TripleDelta(new Triple(*t.get_triple()), t.is_addition(), t.get_dictionary()));
-                totalCount++;
+            uint32_t position;
+            if (std::unique_ptr<TripleDeltaIterator> resumed = checkpoints->take(checkpoint_key, offset, position)) {
+                it = resumed.release();
+                while (position < offset && it->next(&t)) {
+                    position++;
+                }
+            } else {
+                it = controller->get_delta_materialized(triple_pattern, offset, version_start, version_end);
+            }
+            looking_up.end();
+
+            // Add matching triples to the result vector,
+            // or directly into a packed batch so that no per-triple work remains for the main thread.
+            // The limit is checked first, so that no triple after the page is consumed.
+            // If the query is cancelled, the page is truncated to the triples that were found so far.
+            auto iterating = trace.span("iterate");
+            auto decoding = trace.accumulate("decode");
+            if (packed) {
+                TripleBatchBuilder batch(TRIPLE_BATCH_DELTA_MATERIALIZED, *cache);
+                while ((!limit || totalCount < limit) && !stop() && it->next(&t)) {
+                    decoding.begin();
+                    batch.add(*t.get_triple(), *t.get_dictionary(), t.is_addition());
+                    decoding.end();
+                    totalCount++;
+                }
+                packedData = batch.release(packedLength);
+            } else {
+                // Terms are decoded here, as the dictionary may be modified by an append once the query is done
+                while ((!limit || totalCount < limit) && !stop() && it->next(&t)) {
+                    DictionaryManager &dict = *t.get_dictionary();
+                    decoding.begin();
+                    terms.push_back(cache->get(dict, t.get_triple()->get_subject(), hdt::SUBJECT));
+                    terms.push_back(cache->get(dict, t.get_triple()->get_predicate(), hdt::PREDICATE));
+                    terms.push_back(cache->get(dict, t.get_triple()->get_object(), hdt::OBJECT));
+                    decoding.end();
+                    additions.push_back(t.is_addition());
+                    totalCount++;
+                }
+            }
+            hasExactCount = (limit != 0 && totalCount == limit) || stop.is_stopped() ? hdt::APPROXIMATE : hdt::EXACT;
+            iterating.count("results", totalCount);
+            iterating.end();
+            // A full page may be followed by more results, which the next page can resume from
+            if (limit != 0 && totalCount == limit) {
+                checkpoints->put(std::move(checkpoint_key), offset + totalCount, std::unique_ptr<TripleDeltaIterator>(it), checkpoint_generation);
+                it = nullptr;
+            }
+            // Slow queries are logged while the controller cannot be modified by an append
+            std::shared_ptr<SlowQueryLog> slow_queries = store->GetSlowQueryLog();
+            if (slow_queries->is_slow(executing.elapsed())) {
+                slow_queries->record(SlowQuery{STATS_OPERATION_DELTA_MATERIALIZED, subject, predicate, object, offset, limit,
+                                               version_start, version_end, totalCount}, timer, executing);
             }
-            hasExactCount = (limit != 0 && totalCount == limit) ? hdt::APPROXIMATE : hdt::EXACT;
         } catch (const std::runtime_error &error) {
             SetErrorMessage(error.what());
         }
@@ -325,54 +927,83 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
+        auto marshalling = trace.span("marshal");
+
+        if (packed) {
+            // The buffer takes ownership of the packed data
+            v8::Local<v8::Value> batch = Nan::NewBuffer(packedData, packedLength).ToLocalChecked();
+            packedData = nullptr;
+            const unsigned argc = 5;
+            v8::Local<v8::Value> argv[argc] = {Nan::Null(), batch, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount),
+                                               Nan::New<v8::Boolean>(stop.is_stopped())};
+            timer.finish(totalCount, packedLength);
+            marshalling.end();
+            Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+            return;
+        }
 
         // Convert the triples into a JavaScript object array
         uint32_t count = 0;
-        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(triples.size());
+        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(additions.size());
         const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
         const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
         const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
         const v8::Local<v8::String> ADDITION = Nan::New("addition").ToLocalChecked();
-        for (auto& triple : triples) {
-            std::shared_ptr<DictionaryManager> dict = triple->get_dictionary();
+        for (size_t i = 0; i < additions.size(); i++) {
             v8::Local<v8::Object> tripleObject = Nan::New<v8::Object>();
-            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(triple->get_triple()->get_subject(*dict).c_str()).ToLocalChecked());
-            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(triple->get_triple()->get_predicate(*dict).c_str()).ToLocalChecked());
-            std::string object = triple->get_triple()->get_object(*dict);
-            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(fromHdtLiteral(object).c_str()).ToLocalChecked());
-            tripleObject->Set(Nan::GetCurrentContext(), ADDITION, Nan::New(triple->is_addition()));
+            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(terms[3 * i]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(terms[3 * i + 1]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(terms[3 * i + 2]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), ADDITION, Nan::New((bool) additions[i]));
             triplesArray->Set(Nan::GetCurrentContext(), count++, tripleObject);
-            delete triple;
         }
 
-        // Send the JavaScript array and estimated total count through the callback
-        const unsigned argc = 4;
-        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        // Send the JavaScript array, estimated total count, and whether the results were truncated through the callback
+        const unsigned argc = 5;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount),
+                                           Nan::New<v8::Boolean>(stop.is_stopped())};
+        timer.finish(totalCount, TermBytes(terms));
+        marshalling.end();
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
 };
 
+static void QueueSearchTriplesDeltaMaterialized(Nan::NAN_METHOD_ARGS_TYPE info, bool packed) {
+    assert(info.Length() >= 8);
+    OstrichStore *store = Nan::ObjectWrap::Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_DELTA_MATERIALIZED, new SearchTriplesDeltaMaterializedWorker(store,
+                                                                                              *Nan::Utf8String(info[0]),
+                                                                                              *Nan::Utf8String(info[1]),
+                                                                                              *Nan::Utf8String(info[2]),
+                                                                                              info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                              info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                              info[5]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                              info[6]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                              packed,
+                                                                                              QueryCancellationHandle::FromValue(info[9]),
+                                                                                              new Nan::Callback(info[7].As<v8::Function>()),
+                                                                                              info[8]->IsObject() ? info[8].As<v8::Object>()
+                                                                                              : info.This()), info[7].As<v8::Function>());
+}
+
 // Searches for a triple pattern in the document.
-// JavaScript signature: OstrichStore#_searchTriplesDeltaMaterialized(subject, predicate, object, offset, limit, version, callback)
+// JavaScript signature: OstrichStore#_searchTriplesDeltaMaterialized(subject, predicate, object, offset, limit, version_start, version_end, callback, self, cancellation)
 NAN_METHOD(OstrichStore::SearchTriplesDeltaMaterialized) {
-    assert(info.Length() >= 8);
-    Nan::AsyncQueueWorker(new SearchTriplesDeltaMaterializedWorker(Unwrap<OstrichStore>(info.This()),
-                                                                   *Nan::Utf8String(info[0]),
-                                                                   *Nan::Utf8String(info[1]),
-                                                                   *Nan::Utf8String(info[2]),
-                                                                   info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                   info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                   info[5]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                   info[6]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                   new Nan::Callback(info[7].As<v8::Function>()),
-                                                                   info[8]->IsObject() ? info[8].As<v8::Object>()
-                                                                                       : info.This()));
+    QueueSearchTriplesDeltaMaterialized(info, false);
+}
+
+// Searches for a triple pattern in the document, and returns the results as a packed triple batch.
+// JavaScript signature: OstrichStore#_searchTriplesDeltaMaterializedPacked(subject, predicate, object, offset, limit, version_start, version_end, callback, self, cancellation)
+NAN_METHOD(OstrichStore::SearchTriplesDeltaMaterializedPacked) {
+    QueueSearchTriplesDeltaMaterialized(info, true);
 }
 
 
@@ -387,22 +1018,26 @@ class CountTriplesDeltaMaterializedWorker : public Nan::AsyncWorker {
     // Callback return values
     uint32_t totalCount{0};
     bool hasExactCount;
+    OperationTimer timer;
 
 public:
     CountTriplesDeltaMaterializedWorker(OstrichStore *store, char *subject, char *predicate, char *object,
                                          int32_t version_start, int32_t version_end, Nan::Callback *callback, v8::Local<v8::Object> self)
             : Nan::AsyncWorker(callback),
               store(store), subject(subject), predicate(predicate), object(object),
-              version_start(version_start), version_end(version_end) {
+              version_start(version_start), version_end(version_end),
+              timer(store->GetStats(), STATS_OPERATION_COUNT) {
         SaveToPersistent("self", self);
     }
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
         try {
             Controller *controller = store->GetController();
 
             // Check version
-            version_end = version_end >= 0 ? version_end : controller->get_max_patch_id();
+            version_end = version_end >= 0 ? version_end : store->GetVisibleVersion();
 
             // Prepare the triple pattern
             StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
@@ -418,14 +1053,17 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
         // Send the JavaScript array and estimated total count through the callback
         const unsigned argc = 3;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        timer.finish(0, 0);
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -433,14 +1071,15 @@ public:
 
 void OstrichStore::CountTriplesDeltaMaterialized(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.Length() >= 6);
-    Nan::AsyncQueueWorker(new CountTriplesDeltaMaterializedWorker(Unwrap<OstrichStore>(info.This()),
-                                                                   *Nan::Utf8String(info[0]),
-                                                                   *Nan::Utf8String(info[1]),
-                                                                   *Nan::Utf8String(info[2]),
-                                                                   info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                   info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                                   new Nan::Callback(info[5].As<v8::Function>()),
-                                                                   info[6]->IsObject() ? info[6].As<v8::Object>() : info.This()));
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_COUNT, new CountTriplesDeltaMaterializedWorker(store,
+                                                                                *Nan::Utf8String(info[0]),
+                                                                                *Nan::Utf8String(info[1]),
+                                                                                *Nan::Utf8String(info[2]),
+                                                                                info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                                new Nan::Callback(info[5].As<v8::Function>()),
+                                                                                info[6]->IsObject() ? info[6].As<v8::Object>() : info.This()), info[5].As<v8::Function>());
 }
 
 
@@ -448,24 +1087,46 @@ void OstrichStore::CountTriplesDeltaMaterialized(Nan::NAN_METHOD_ARGS_TYPE info)
 
 class SearchTriplesVersionWorker : public Nan::AsyncWorker {
     OstrichStore *store;
+    std::shared_ptr<TermCache> cache;
     // JavaScript function arguments
     std::string subject, predicate, object;
     uint32_t offset, limit;
+    bool packed;
+    QueryStopCheck stop;
     v8::Persistent<v8::Object> self;
-    // Callback return values
-    std::vector<TripleVersions *> triples;
+    // Callback return values, with three decoded terms per triple
+    std::vector<std::string> terms;
+    std::vector<std::vector<int>> versions;
+    char *packedData{nullptr};
+    size_t packedLength{0};
     uint32_t totalCount;
     bool hasExactCount;
+    OperationTimer timer;
+    OperationTrace trace;
 
 public:
-    SearchTriplesVersionWorker(OstrichStore *store, char *subject, char *predicate, char *object, uint32_t offset, uint32_t limit, Nan::Callback *callback, v8::Local<v8::Object> self)
+    SearchTriplesVersionWorker(OstrichStore *store, char *subject, char *predicate, char *object, uint32_t offset, uint32_t limit, bool packed,
+                               std::shared_ptr<QueryCancellation> cancellation, Nan::Callback *callback, v8::Local<v8::Object> self)
             : Nan::AsyncWorker(callback),
-              store(store), subject(subject), predicate(predicate), object(object),
-              offset(offset), limit(limit), totalCount(0) {
+              store(store), cache(store->GetTermCache()), subject(subject), predicate(predicate), object(object),
+              offset(offset), limit(limit), packed(packed), stop(std::move(cancellation)), totalCount(0),
+              timer(store->GetStats(), STATS_OPERATION_VERSION),
+              trace(store->GetTracer(), "version") {
         SaveToPersistent("self", self);
+        trace.pattern(this->subject, this->predicate, this->object).arg("offset", (int64_t) offset).arg("limit", (int64_t) limit);
     };
 
+    ~SearchTriplesVersionWorker() override {
+        free(packedData);
+    }
+
     void Execute() override {
+        auto executing = timer.execute();
+        auto tracing = trace.span("execute");
+        tracing.count("queueWait", (int64_t) trace.since_created());
+        auto waiting = trace.span("lock");
+        auto lock = store->LockRead();
+        waiting.end();
         TripleVersionsIterator *it = nullptr;
         try {
             Controller *controller = store->GetController();
@@ -474,16 +1135,48 @@ public:
             StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
 
             // Get the iterator
+            auto looking_up = trace.span("lookup");
             it = controller->get_version(triple_pattern, offset);
+            looking_up.end();
 
-            // Add matching triples to the result vector
+            // Add matching triples to the result vector,
+            // or directly into a packed batch so that no per-triple work remains for the main thread.
+            // The limit is checked first, so that no triple after the page is consumed.
+            // If the query is cancelled, the page is truncated to the triples that were found so far.
             TripleVersions t;
-
-            while (it->next(&t) && (!limit || triples.size() < limit)) {
-                triples.push_back(new TripleVersions(new Triple(*t.get_triple()), new std::vector<int>(*t.get_versions()), t.get_dictionary()));
-                totalCount++;
+            auto iterating = trace.span("iterate");
+            auto decoding = trace.accumulate("decode");
+            if (packed) {
+                TripleBatchBuilder batch(TRIPLE_BATCH_VERSION, *cache);
+                while ((!limit || totalCount < limit) && !stop() && it->next(&t)) {
+                    decoding.begin();
+                    batch.add(*t.get_triple(), *t.get_dictionary(), *t.get_versions());
+                    decoding.end();
+                    totalCount++;
+                }
+                packedData = batch.release(packedLength);
+            } else {
+                // Terms are decoded here, as the dictionary may be modified by an append once the query is done
+                while ((!limit || totalCount < limit) && !stop() && it->next(&t)) {
+                    DictionaryManager &dict = *t.get_dictionary();
+                    decoding.begin();
+                    terms.push_back(cache->get(dict, t.get_triple()->get_subject(), hdt::SUBJECT));
+                    terms.push_back(cache->get(dict, t.get_triple()->get_predicate(), hdt::PREDICATE));
+                    terms.push_back(cache->get(dict, t.get_triple()->get_object(), hdt::OBJECT));
+                    decoding.end();
+                    versions.push_back(*t.get_versions());
+                    totalCount++;
+                }
+            }
+            hasExactCount = (limit != 0 && totalCount == limit) || stop.is_stopped() ? hdt::APPROXIMATE : hdt::EXACT;
+            iterating.count("results", totalCount);
+            iterating.end();
+            // Slow queries are logged while the controller cannot be modified by an append
+            std::shared_ptr<SlowQueryLog> slow_queries = store->GetSlowQueryLog();
+            if (slow_queries->is_slow(executing.elapsed())) {
+                slow_queries->record(SlowQuery{STATS_OPERATION_VERSION, subject, predicate, object, offset, limit,
+                                               -1, -1, totalCount}, timer, executing);
             }
-            hasExactCount = (limit != 0 && totalCount == limit) ? hdt::APPROXIMATE : hdt::EXACT;
         } catch (const std::runtime_error& error) {
             SetErrorMessage(error.what());
         }
@@ -492,57 +1185,85 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
+        auto marshalling = trace.span("marshal");
+
+        if (packed) {
+            // The buffer takes ownership of the packed data
+            v8::Local<v8::Value> batch = Nan::NewBuffer(packedData, packedLength).ToLocalChecked();
+            packedData = nullptr;
+            const unsigned argc = 5;
+            v8::Local<v8::Value> argv[argc] = {Nan::Null(), batch, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount),
+                                               Nan::New<v8::Boolean>(stop.is_stopped())};
+            timer.finish(totalCount, packedLength);
+            marshalling.end();
+            Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+            return;
+        }
 
         // Convert the triples into a JavaScript object array
         uint32_t count = 0;
-        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(triples.size());
+        v8::Local<v8::Array> triplesArray = Nan::New<v8::Array>(versions.size());
         const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
         const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
         const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
         const v8::Local<v8::String> VERSIONS = Nan::New("versions").ToLocalChecked();
-        for (auto& t: triples) {
-            std::shared_ptr<DictionaryManager> dict = t->get_dictionary();
+        for (size_t i = 0; i < versions.size(); i++) {
             v8::Local<v8::Object> tripleObject = Nan::New<v8::Object>();
-            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(t->get_triple()->get_subject(*dict).c_str()).ToLocalChecked());
-            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(t->get_triple()->get_predicate(*dict).c_str()).ToLocalChecked());
-            std::string object = t->get_triple()->get_object(*dict);
-            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(fromHdtLiteral(object).c_str()).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), SUBJECT, Nan::New(terms[3 * i]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), PREDICATE, Nan::New(terms[3 * i + 1]).ToLocalChecked());
+            tripleObject->Set(Nan::GetCurrentContext(), OBJECT, Nan::New(terms[3 * i + 2]).ToLocalChecked());
 
-            v8::Local<v8::Array> versionsArray = Nan::New<v8::Array>(t->get_versions()->size());
-            for (uint32_t countVersions = 0; countVersions < t->get_versions()->size(); countVersions++) {
-                versionsArray->Set(Nan::GetCurrentContext(), countVersions, Nan::New((*(t->get_versions()))[countVersions]));
+            v8::Local<v8::Array> versionsArray = Nan::New<v8::Array>(versions[i].size());
+            for (uint32_t countVersions = 0; countVersions < versions[i].size(); countVersions++) {
+                versionsArray->Set(Nan::GetCurrentContext(), countVersions, Nan::New(versions[i][countVersions]));
             }
             tripleObject->Set(Nan::GetCurrentContext(), VERSIONS, versionsArray);
             triplesArray->Set(Nan::GetCurrentContext(), count++, tripleObject);
-            delete t->get_triple();
-            delete t->get_versions();
         }
 
-        // Send the JavaScript array and estimated total count through the callback
-        const unsigned argc = 4;
-        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        // Send the JavaScript array, estimated total count, and whether the results were truncated through the callback
+        const unsigned argc = 5;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), triplesArray, Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount),
+                                           Nan::New<v8::Boolean>(stop.is_stopped())};
+        timer.finish(totalCount, TermBytes(terms));
+        marshalling.end();
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
 };
 
+static void QueueSearchTriplesVersion(Nan::NAN_METHOD_ARGS_TYPE info, bool packed) {
+    assert(info.Length() >= 7);
+    OstrichStore *store = Nan::ObjectWrap::Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_VERSION, new SearchTriplesVersionWorker(store,
+                                                                         *Nan::Utf8String(info[0]),
+                                                                         *Nan::Utf8String(info[1]),
+                                                                         *Nan::Utf8String(info[2]),
+                                                                         info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                         info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                                                         packed,
+                                                                         QueryCancellationHandle::FromValue(info[7]),
+                                                                         new Nan::Callback(info[5].As<v8::Function>()),
+                                                                         info[6]->IsObject() ? info[6].As<v8::Object>() : info.This()), info[5].As<v8::Function>());
+}
+
 // Searches for a triple pattern in the document.
-// JavaScript signature: OstrichStore#_searchTriplesVersion(subject, predicate, object, offset, limit, callback)
+// JavaScript signature: OstrichStore#_searchTriplesVersion(subject, predicate, object, offset, limit, callback, self, cancellation)
 NAN_METHOD(OstrichStore::SearchTriplesVersion) {
-    assert(info.Length() >= 7);
-    Nan::AsyncQueueWorker(new SearchTriplesVersionWorker(Unwrap<OstrichStore>(info.This()),
-                                                         *Nan::Utf8String(info[0]),
-                                                         *Nan::Utf8String(info[1]),
-                                                         *Nan::Utf8String(info[2]),
-                                                         info[3]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                         info[4]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
-                                                         new Nan::Callback(info[5].As<v8::Function>()),
-                                                         info[6]->IsObject() ? info[6].As<v8::Object>() : info.This()));
+    QueueSearchTriplesVersion(info, false);
+}
+
+// Searches for a triple pattern in the document, and returns the results as a packed triple batch.
+// JavaScript signature: OstrichStore#_searchTriplesVersionPacked(subject, predicate, object, offset, limit, callback, self, cancellation)
+NAN_METHOD(OstrichStore::SearchTriplesVersionPacked) {
+    QueueSearchTriplesVersion(info, true);
 }
 
 
@@ -556,15 +1277,19 @@ class CountTriplesVersionWorker : public Nan::AsyncWorker {
     // Callback return values
     uint32_t totalCount;
     bool hasExactCount;
+    OperationTimer timer;
 
 public:
     CountTriplesVersionWorker(OstrichStore *store, char *subject, char *predicate, char *object, Nan::Callback *callback, v8::Local<v8::Object> self)
             : Nan::AsyncWorker(callback),
-              store(store), subject(subject), predicate(predicate), object(object), totalCount(0) {
+              store(store), subject(subject), predicate(predicate), object(object), totalCount(0),
+              timer(store->GetStats(), STATS_OPERATION_COUNT) {
         SaveToPersistent("self", self);
     };
 
     void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
         try {
             Controller *controller = store->GetController();
 
@@ -582,15 +1307,18 @@ public:
 
     void HandleOKCallback() override {
         Nan::HandleScope scope;
+        timer.start_marshal();
 
         // Send the JavaScript array and estimated total count through the callback
         const unsigned argc = 3;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>((uint32_t) totalCount), Nan::New<v8::Boolean>((bool) hasExactCount)};
+        timer.finish(0, 0);
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() override {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -598,113 +1326,888 @@ public:
 
 void OstrichStore::CountTriplesVersion(Nan::NAN_METHOD_ARGS_TYPE info) {
     assert(info.Length() >= 5);
-    Nan::AsyncQueueWorker(new CountTriplesVersionWorker(Unwrap<OstrichStore>(info.This()),
-                                                         *Nan::Utf8String(info[0]),
-                                                         *Nan::Utf8String(info[1]),
-                                                         *Nan::Utf8String(info[2]),
-                                                         new Nan::Callback(info[3].As<v8::Function>()),
-                                                         info[4]->IsObject() ? info[5].As<v8::Object>() : info.This()));
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_COUNT, new CountTriplesVersionWorker(store,
+                                                                      *Nan::Utf8String(info[0]),
+                                                                      *Nan::Utf8String(info[1]),
+                                                                      *Nan::Utf8String(info[2]),
+                                                                      new Nan::Callback(info[3].As<v8::Function>()),
+                                                                      info[4]->IsObject() ? info[5].As<v8::Object>() : info.This()), info[3].As<v8::Function>());
 }
 
-/******** OstrichStore#_append ********/
+/******** OstrichStore#_searchBatch ********/
 
-class AppendWorker : public Nan::AsyncWorker {
+// The type of a query in a batch, the first three correspond to TripleBatchKind
+enum BatchQueryType {
+    BATCH_QUERY_VERSION_MATERIALIZED = 0,
+    BATCH_QUERY_DELTA_MATERIALIZED = 1,
+    BATCH_QUERY_VERSION = 2,
+    BATCH_QUERY_COUNT_VERSION_MATERIALIZED = 3,
+    BATCH_QUERY_COUNT_DELTA_MATERIALIZED = 4,
+    BATCH_QUERY_COUNT_VERSION = 5,
+};
+
+struct BatchQuery {
+    BatchQueryType type;
+    std::string subject, predicate, object;
+    uint32_t offset, limit;
+    int version, version_start, version_end;
+};
+
+struct BatchQueryResult {
+    char *packedData{nullptr};
+    size_t packedLength{0};
+    uint32_t totalCount{0};
+    bool hasExactCount{false};
+    bool truncated{false};
+    std::string error;
+};
+
+class SearchBatchWorker : public Nan::AsyncWorker {
     OstrichStore *store;
-    int version;
-    PatchElementIteratorVector *it_patch = nullptr;
-    IteratorTripleStringVector *it_snapshot = nullptr;
-    std::vector<PatchElement> *elements_patch;
-    std::vector<hdt::TripleString> *elements_snapshot;
+    std::shared_ptr<TermCache> cache;
+    // JavaScript function arguments
+    std::vector<BatchQuery> queries;
+    uint32_t parallelism;
+    // Shared by all queries of the batch, each of which checks it separately
+    std::shared_ptr<QueryCancellation> cancellation;
     v8::Persistent<v8::Object> self;
-    std::shared_ptr<DictionaryManager> dict;
-    uint32_t insertedCount = 0;
+    // Callback return values
+    std::vector<BatchQueryResult> results;
+    OperationTimer timer;
 
 public:
-    AppendWorker(OstrichStore *store, int version, v8::Local<v8::Array> triples, Nan::Callback *callback, v8::Local<v8::Object> self)
-            : Nan::AsyncWorker(callback), store(store) {
+    SearchBatchWorker(OstrichStore *store, std::vector<BatchQuery> queries, uint32_t parallelism,
+                      std::shared_ptr<QueryCancellation> cancellation, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), cache(store->GetTermCache()), queries(std::move(queries)),
+              parallelism(parallelism), cancellation(std::move(cancellation)), results(this->queries.size()),
+              timer(store->GetStats(), STATS_OPERATION_BATCH) {
         SaveToPersistent("self", self);
-        // For lower memory usage, we would have to use the (streaming) patch builder.
-        try {
-            Controller *controller = store->GetController();
-
-            // Check version
-            this->version = version >= 0 ? version : controller->get_max_patch_id() + 1;
+    };
 
-            const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
-            const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
-            const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
-            const v8::Local<v8::String> ADDITION = Nan::New("addition").ToLocalChecked();
+    ~SearchBatchWorker() override {
+        for (auto &result : results) {
+            free(result.packedData);
+        }
+    }
 
-            // Prepare the iterator
-            elements_patch = new std::vector<PatchElement>();
-            elements_snapshot = new std::vector<hdt::TripleString>();
-            if (version == 0) {
-                for (uint32_t i = 0; i < triples->Length(); i++) {
-                    v8::Local<v8::Object> tripleObject = triples->Get(Nan::GetCurrentContext(), i).ToLocalChecked()->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
-                    std::string subject = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), SUBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    std::string predicate = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), PREDICATE).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    std::string object = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), OBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    bool addition = tripleObject->Get(Nan::GetCurrentContext(), ADDITION).ToLocalChecked()->BooleanValue(v8::Isolate::GetCurrent());
-                    if (!addition) {
-                        SetErrorMessage("All triples of the initial snapshot MUST be additions, but a deletion was found.");
-                        it_snapshot = nullptr;
-                        break;
-                    }
-                    elements_snapshot->push_back(hdt::TripleString(subject, predicate, object));
-                }
-                it_snapshot = new IteratorTripleStringVector(elements_snapshot);
-            } else {
-                dict = controller->get_dictionary_manager(0);
-                for (uint32_t i = 0; i < triples->Length(); i++) {
-                    v8::Local<v8::Object> tripleObject = triples->Get(Nan::GetCurrentContext(), i).ToLocalChecked()->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
-                    std::string subject = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), SUBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    std::string predicate = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), PREDICATE).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    std::string object = std::string(*v8::String::Utf8Value(v8::Isolate::GetCurrent(), tripleObject->Get(Nan::GetCurrentContext(), OBJECT).ToLocalChecked()->ToString(Nan::GetCurrentContext()).ToLocalChecked()));
-                    bool addition = tripleObject->Get(Nan::GetCurrentContext(), ADDITION).ToLocalChecked()->BooleanValue(v8::Isolate::GetCurrent());
-                    PatchElement element(Triple(subject, predicate, object, dict), addition);
-                    elements_patch->push_back(element);
-                    insertedCount++;
+    void Execute() override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
+        // Queries are claimed one by one, so that a slow query does not hold up the others in its partition
+        std::atomic<size_t> next{0};
+        auto work = [this, &next]() {
+            size_t i;
+            while ((i = next++) < queries.size()) {
+                try {
+                    Run(queries[i], results[i]);
+                } catch (const std::runtime_error &error) {
+                    results[i].error = error.what();
                 }
-                it_patch = new PatchElementIteratorVector(elements_patch);
             }
-        } catch (const runtime_error& error) {
-            SetErrorMessage(error.what());
+        };
+
+        store->RunParallel(std::min((size_t) std::max(parallelism, (uint32_t) 1), queries.size()), work);
+
+        for (auto &result : results) {
+            if (!result.error.empty()) {
+                SetErrorMessage(result.error.c_str());
+                break;
+            }
         }
-    };
+    }
 
-    void Execute() {
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+
+        // Convert the results into a JavaScript object array
+        v8::Local<v8::Array> resultsArray = Nan::New<v8::Array>(results.size());
+        const v8::Local<v8::String> BATCH = Nan::New("batch").ToLocalChecked();
+        const v8::Local<v8::String> TOTAL_COUNT = Nan::New("totalCount").ToLocalChecked();
+        const v8::Local<v8::String> HAS_EXACT_COUNT = Nan::New("hasExactCount").ToLocalChecked();
+        const v8::Local<v8::String> TRUNCATED = Nan::New("truncated").ToLocalChecked();
+        uint64_t resultCount = 0;
+        uint64_t resultBytes = 0;
+        for (uint32_t i = 0; i < results.size(); i++) {
+            BatchQueryResult &result = results[i];
+            v8::Local<v8::Object> resultObject = Nan::New<v8::Object>();
+            if (result.packedData != nullptr) {
+                // Only search queries have packed triples, of which the total count is the number of triples
+                resultCount += result.totalCount;
+                resultBytes += result.packedLength;
+                // The buffer takes ownership of the packed data
+                resultObject->Set(Nan::GetCurrentContext(), BATCH, Nan::NewBuffer(result.packedData, result.packedLength).ToLocalChecked());
+                result.packedData = nullptr;
+            }
+            resultObject->Set(Nan::GetCurrentContext(), TOTAL_COUNT, Nan::New<v8::Integer>(result.totalCount));
+            resultObject->Set(Nan::GetCurrentContext(), HAS_EXACT_COUNT, Nan::New<v8::Boolean>(result.hasExactCount));
+            resultObject->Set(Nan::GetCurrentContext(), TRUNCATED, Nan::New<v8::Boolean>(result.truncated));
+            resultsArray->Set(Nan::GetCurrentContext(), i, resultObject);
+        }
+
+        const unsigned argc = 2;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), resultsArray};
+        timer.finish(resultCount, resultBytes);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+
+private:
+    // Executes a single query of the batch.
+    // If the batch is cancelled, search queries are truncated to the triples that were found so far.
+    void Run(BatchQuery &query, BatchQueryResult &result) {
+        Controller *controller = store->GetController();
+        StringTriple triple_pattern(query.subject, query.predicate, toHdtLiteral(query.object));
+        QueryStopCheck stop(cancellation);
+        switch (query.type) {
+            case BATCH_QUERY_VERSION_MATERIALIZED: {
+                int version = query.version >= 0 ? query.version : store->GetVisibleVersion();
+                std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(version);
+                std::unique_ptr<TripleIterator> it(controller->get_version_materialized(triple_pattern, query.offset, version));
+                TripleBatchBuilder batch(TRIPLE_BATCH_VERSION_MATERIALIZED, *cache);
+                Triple t;
+                while ((query.limit == 0 || batch.size() < query.limit) && !stop() && it->next(&t)) {
+                    batch.add(t, *dict);
+                }
+                Finish(query, result, batch, stop);
+                break;
+            }
+            case BATCH_QUERY_DELTA_MATERIALIZED: {
+                int version_end = query.version_end >= 0 ? query.version_end : store->GetVisibleVersion();
+                std::unique_ptr<TripleDeltaIterator> it(controller->get_delta_materialized(triple_pattern, query.offset, query.version_start, version_end));
+                TripleBatchBuilder batch(TRIPLE_BATCH_DELTA_MATERIALIZED, *cache);
+                TripleDelta t;
+                while ((query.limit == 0 || batch.size() < query.limit) && !stop() && it->next(&t)) {
+                    batch.add(*t.get_triple(), *t.get_dictionary(), t.is_addition());
+                }
+                Finish(query, result, batch, stop);
+                break;
+            }
+            case BATCH_QUERY_VERSION: {
+                std::unique_ptr<TripleVersionsIterator> it(controller->get_version(triple_pattern, query.offset));
+                TripleBatchBuilder batch(TRIPLE_BATCH_VERSION, *cache);
+                TripleVersions t;
+                while ((query.limit == 0 || batch.size() < query.limit) && !stop() && it->next(&t)) {
+                    batch.add(*t.get_triple(), *t.get_dictionary(), *t.get_versions());
+                }
+                Finish(query, result, batch, stop);
+                break;
+            }
+            case BATCH_QUERY_COUNT_VERSION_MATERIALIZED: {
+                int version = query.version >= 0 ? query.version : store->GetVisibleVersion();
+                std::pair<size_t, hdt::ResultEstimationType> count_data = controller->get_version_materialized_count(triple_pattern, version, true);
+                result.totalCount = count_data.first;
+                result.hasExactCount = count_data.second == hdt::EXACT;
+                break;
+            }
+            case BATCH_QUERY_COUNT_DELTA_MATERIALIZED: {
+                int version_end = query.version_end >= 0 ? query.version_end : store->GetVisibleVersion();
+                std::pair<size_t, hdt::ResultEstimationType> count_data = controller->get_delta_materialized_count(triple_pattern, query.version_start, version_end, true);
+                result.totalCount = count_data.first;
+                result.hasExactCount = count_data.second == hdt::EXACT;
+                break;
+            }
+            case BATCH_QUERY_COUNT_VERSION: {
+                std::pair<size_t, hdt::ResultEstimationType> count_data = controller->get_version_count(triple_pattern, true);
+                result.totalCount = count_data.first;
+                result.hasExactCount = count_data.second == hdt::EXACT;
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown batch query type " + std::to_string(query.type));
+        }
+    }
+
+    // Counts the results of a search query in the same way as the individual search methods
+    static void Finish(const BatchQuery &query, BatchQueryResult &result, TripleBatchBuilder &batch, const QueryStopCheck &stop) {
+        result.totalCount = batch.size();
+        result.hasExactCount = (query.limit != 0 && result.totalCount == query.limit) || stop.is_stopped() ? hdt::APPROXIMATE : hdt::EXACT;
+        result.truncated = stop.is_stopped();
+        result.packedData = batch.release(result.packedLength);
+    }
+};
+
+// Executes multiple queries in a single worker, and returns all of their results at once.
+// Each query is an object with the fields type, subject, predicate, object, offset, limit, version, versionStart and versionEnd,
+// where type is one of the values of BatchQueryType.
+// JavaScript signature: OstrichStore#_searchBatch(queries, parallelism, callback, self, cancellation)
+NAN_METHOD(OstrichStore::SearchBatch) {
+    assert(info.Length() >= 3);
+    v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    v8::Local<v8::Array> queriesArray = info[0].As<v8::Array>();
+    const v8::Local<v8::String> TYPE = Nan::New("type").ToLocalChecked();
+    const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
+    const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
+    const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
+    const v8::Local<v8::String> OFFSET = Nan::New("offset").ToLocalChecked();
+    const v8::Local<v8::String> LIMIT = Nan::New("limit").ToLocalChecked();
+    const v8::Local<v8::String> VERSION = Nan::New("version").ToLocalChecked();
+    const v8::Local<v8::String> VERSION_START = Nan::New("versionStart").ToLocalChecked();
+    const v8::Local<v8::String> VERSION_END = Nan::New("versionEnd").ToLocalChecked();
+
+    std::vector<BatchQuery> queries;
+    queries.reserve(queriesArray->Length());
+    for (uint32_t i = 0; i < queriesArray->Length(); i++) {
+        v8::Local<v8::Object> queryObject = queriesArray->Get(context, i).ToLocalChecked()->ToObject(context).ToLocalChecked();
+        queries.push_back(BatchQuery{
+                (BatchQueryType) queryObject->Get(context, TYPE).ToLocalChecked()->Uint32Value(context).FromJust(),
+                *Nan::Utf8String(queryObject->Get(context, SUBJECT).ToLocalChecked()),
+                *Nan::Utf8String(queryObject->Get(context, PREDICATE).ToLocalChecked()),
+                *Nan::Utf8String(queryObject->Get(context, OBJECT).ToLocalChecked()),
+                queryObject->Get(context, OFFSET).ToLocalChecked()->Uint32Value(context).FromJust(),
+                queryObject->Get(context, LIMIT).ToLocalChecked()->Uint32Value(context).FromJust(),
+                queryObject->Get(context, VERSION).ToLocalChecked()->Int32Value(context).FromJust(),
+                queryObject->Get(context, VERSION_START).ToLocalChecked()->Int32Value(context).FromJust(),
+                queryObject->Get(context, VERSION_END).ToLocalChecked()->Int32Value(context).FromJust(),
+        });
+    }
+
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    store->QueueQuery(QUERY_TYPE_BATCH, new SearchBatchWorker(store,
+                                                              std::move(queries),
+                                                              info[1]->Uint32Value(context).FromJust(),
+                                                              QueryCancellationHandle::FromValue(info[4]),
+                                                              new Nan::Callback(info[2].As<v8::Function>()),
+                                                              info[3]->IsObject() ? info[3].As<v8::Object>() : info.This()), info[2].As<v8::Function>());
+}
+
+/******** OstrichStore#_searchTriplesVersionMaterializedPartitioned ********/
+
+// A packed batch of triples of a partition, of which the callback becomes the owner
+struct PartitionChunk {
+    uint32_t partition;
+    char *packedData;
+    size_t packedLength;
+    bool done;
+};
+
+// Scans a version materialized query in consecutive partitions of its results, in parallel on idle threads of the query pool.
+// The results of a VM query are sorted, so each partition covers a contiguous range of the snapshot's order.
+// Partitions are delimited by offsets in the exact result count, as OSTRICH resolves offsets without iterating.
+// Each partition needs a credit before it sends a chunk, so that it is only scanned as fast as its chunks are consumed.
+// A partition without credits is set aside, so that query pool threads never wait for JavaScript,
+// and the read lock is only held while a chunk is read, so that appends never wait for JavaScript either.
+// The scan itself runs on a thread of its own, which waits until one of the partitions that were set aside may continue.
+class SearchTriplesVersionMaterializedPartitionedWorker : public Nan::AsyncProgressQueueWorker<PartitionChunk> {
+    // The position of a partition, which is resumed once it may send another chunk
+    struct Partition {
+        size_t offset;
+        size_t end;
+        std::unique_ptr<TripleIterator> it;
+        // The write generation of the store when the iterator was created
+        uint64_t generation;
+    };
+
+    OstrichStore *store;
+    std::shared_ptr<TermCache> cache;
+    // JavaScript function arguments
+    std::string subject, predicate, object;
+    int32_t version;
+    uint32_t partitions, chunkSize;
+    std::shared_ptr<PartitionCredits> credits;
+    Nan::Callback *chunkCallback;
+    v8::Persistent<v8::Object> self;
+    // Callback return values
+    std::atomic<uint64_t> count{0};
+    uint64_t resultBytes{0};
+    OperationTimer timer;
+
+public:
+    SearchTriplesVersionMaterializedPartitionedWorker(OstrichStore *store, char *subject, char *predicate, char *object,
+                                                      int32_t version, uint32_t partitions, uint32_t chunkSize,
+                                                      std::shared_ptr<PartitionCredits> credits,
+                                                      Nan::Callback *callback, Nan::Callback *chunkCallback,
+                                                      v8::Local<v8::Object> self)
+            : Nan::AsyncProgressQueueWorker<PartitionChunk>(callback), store(store), cache(store->GetTermCache()),
+              subject(subject), predicate(predicate), object(object), version(version),
+              partitions(std::max(partitions, (uint32_t) 1)), chunkSize(std::max(chunkSize, (uint32_t) 1)),
+              credits(std::move(credits)), chunkCallback(chunkCallback),
+              timer(store->GetStats(), STATS_OPERATION_EXPORT) {
+        SaveToPersistent("self", self);
+    };
+
+    ~SearchTriplesVersionMaterializedPartitionedWorker() override {
+        delete chunkCallback;
+    }
+
+    void Execute(const ExecutionProgress &progress) override {
+        auto executing = timer.execute();
+        Controller *controller = store->GetController();
+
+        // Check version, which remains the same when later versions are appended during the scan
+        version = version >= 0 ? version : store->GetVisibleVersion();
+
+        // Prepare the triple pattern
+        StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
+
+        std::vector<Partition> states(partitions);
+        try {
+            auto lock = store->LockRead();
+            size_t total = controller->get_version_materialized_count(triple_pattern, version, false).first;
+            for (uint32_t partition = 0; partition < partitions; partition++) {
+                states[partition].offset = total * partition / partitions;
+                states[partition].end = total * (partition + 1) / partitions;
+            }
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+            return;
+        }
+
+        // Sends chunks of the partition while it has credits, returns true once the partition is done
+        std::vector<std::string> errors(partitions);
+        auto scan = [&](uint32_t partition) {
+            Partition &state = states[partition];
+            try {
+                while (state.offset < state.end) {
+                    if (!credits->try_acquire(partition)) {
+                        return false;
+                    }
+                    TripleBatchBuilder batch(TRIPLE_BATCH_VERSION_MATERIALIZED, *cache);
+                    {
+                        auto lock = store->LockRead();
+                        // Appends invalidate iterators, but do not change the results of this version,
+                        // so the iterator is recreated at the same offset
+                        if (!state.it || state.generation != store->GetWriteGeneration()) {
+                            state.it.reset(controller->get_version_materialized(triple_pattern, state.offset, version));
+                            state.generation = store->GetWriteGeneration();
+                        }
+                        std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(version);
+                        Triple t;
+                        while (state.offset < state.end && batch.size() < chunkSize && state.it->next(&t)) {
+                            batch.add(t, *dict);
+                            state.offset++;
+                        }
+                    }
+                    if (batch.size() == 0) {
+                        // The iterator ended before the counted end of the partition
+                        credits->release(partition);
+                        break;
+                    }
+                    count += batch.size();
+                    PartitionChunk chunk{partition, nullptr, 0, state.offset >= state.end};
+                    chunk.packedData = batch.release(chunk.packedLength);
+                    progress.Send(&chunk, 1);
+                    if (chunk.done) {
+                        return true;
+                    }
+                }
+            } catch (const std::runtime_error &error) {
+                errors[partition] = error.what();
+            }
+            // Mark the partition as done
+            PartitionChunk chunk{partition, nullptr, 0, true};
+            progress.Send(&chunk, 1);
+            return true;
+        };
+
+        // Partitions are claimed in order, so that the first partition that is not done is scanned first
+        std::mutex mutex;
+        std::deque<uint32_t> runnable;
+        std::vector<uint32_t> waiting;
+        uint32_t remaining = partitions;
+        for (uint32_t partition = 0; partition < partitions; partition++) {
+            runnable.push_back(partition);
+        }
+        auto work = [&]() {
+            while (true) {
+                uint32_t partition;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (runnable.empty()) {
+                        return;
+                    }
+                    partition = runnable.front();
+                    runnable.pop_front();
+                }
+                bool done = scan(partition);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (done) {
+                    remaining--;
+                } else {
+                    waiting.push_back(partition);
+                }
+            }
+        };
+        while (true) {
+            store->RunParallel(runnable.size(), work);
+            // All partitions are either done or out of credits now
+            if (remaining == 0 || !credits->wait(waiting)) {
+                break;
+            }
+            std::sort(waiting.begin(), waiting.end());
+            runnable.assign(waiting.begin(), waiting.end());
+            waiting.clear();
+        }
+
+        {
+            // Iterators may refer to the patch trees and dictionaries of the controller
+            auto lock = store->LockRead();
+            states.clear();
+        }
+        if (remaining > 0) {
+            SetErrorMessage("The partitioned scan was cancelled, as its stream was destroyed or its store was closed");
+            return;
+        }
+        for (auto &error : errors) {
+            if (!error.empty()) {
+                SetErrorMessage(error.c_str());
+                break;
+            }
+        }
+    }
+
+    void HandleProgressCallback(const PartitionChunk *chunks, size_t length) override {
+        Nan::HandleScope scope;
+        for (size_t i = 0; i < length; i++) {
+            timer.start_marshal();
+            const PartitionChunk &chunk = chunks[i];
+            resultBytes += chunk.packedLength;
+            const unsigned argc = 3;
+            v8::Local<v8::Value> argv[argc] = {
+                    Nan::New<v8::Integer>(chunk.partition),
+                    // The buffer takes ownership of the packed data
+                    chunk.packedData != nullptr ?
+                    (v8::Local<v8::Value>) Nan::NewBuffer(chunk.packedData, chunk.packedLength).ToLocalChecked() :
+                    (v8::Local<v8::Value>) Nan::Null(),
+                    Nan::New<v8::Boolean>(chunk.done),
+            };
+            timer.end_marshal();
+            Nan::Call(*chunkCallback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+        }
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        const unsigned argc = 2;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Number>((double) count.load())};
+        timer.finish(count.load(), resultBytes);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+// Searches for the triples of a version that match a triple pattern on multiple threads.
+// The chunk callback is invoked with a partition index, a packed batch of its triples or null, and whether the partition is done.
+// At most queueSize chunks of each partition are sent until they are released through the returned credits handle.
+// The callback is invoked with the total number of triples once all partitions are done.
+// JavaScript signature: OstrichStore#_searchTriplesVersionMaterializedPartitioned(subject, predicate, object, version, partitions, chunkSize, queueSize, chunkCallback, callback, self)
+NAN_METHOD(OstrichStore::SearchTriplesVersionMaterializedPartitioned) {
+    assert(info.Length() >= 9);
+    v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    uint32_t partitions = std::max(info[4]->Uint32Value(context).FromJust(), (uint32_t) 1);
+    auto credits = std::make_shared<PartitionCredits>(partitions, info[6]->Uint32Value(context).FromJust());
+    v8::Local<v8::Object> handle = Nan::NewInstance(Nan::New(PartitionCreditsHandle::GetConstructor())).ToLocalChecked();
+    new PartitionCreditsHandle(credits, handle);
+    store->RegisterScan(credits);
+    // The scan waits for its chunks to be read, so it must not occupy a thread of the query pool while it does
+    QueueWorkerOnOwnThread(new SearchTriplesVersionMaterializedPartitionedWorker(store,
+                                                                                 *Nan::Utf8String(info[0]),
+                                                                                 *Nan::Utf8String(info[1]),
+                                                                                 *Nan::Utf8String(info[2]),
+                                                                                 info[3]->Int32Value(context).FromJust(),
+                                                                                 partitions,
+                                                                                 info[5]->Uint32Value(context).FromJust(),
+                                                                                 credits,
+                                                                                 new Nan::Callback(info[8].As<v8::Function>()),
+                                                                                 new Nan::Callback(info[7].As<v8::Function>()),
+                                                                                 info[9]->IsObject() ? info[9].As<v8::Object>() : info.This()));
+    info.GetReturnValue().Set(handle);
+}
+
+/******** OstrichStore#_exportTriples ********/
+
+// Writes all bytes to the file descriptor, retrying partial and interrupted writes,
+// and waiting until a non-blocking file descriptor, such as a pipe to process.stdout, can be written again
+static void WriteAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pollfd writable{fd, POLLOUT, 0};
+                if (::poll(&writable, 1, -1) >= 0 || errno == EINTR) {
+                    continue;
+                }
+            }
+            throw std::runtime_error(std::string("Could not write the exported triples: ") + strerror(errno));
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+// Writes the results of a VM or DM query as N-Triples, directly from their dictionary ids,
+// to a file descriptor, or in chunks to a callback if the file descriptor is negative.
+// Chunks are only sent to the callback while it has credits, so that the export is only as fast as its stream is read.
+class ExportTriplesWorker : public Nan::AsyncProgressQueueWorker<char> {
+    OstrichStore *store;
+    // JavaScript function arguments
+    std::string subject, predicate, object;
+    uint32_t offset, limit;
+    int version_start, version_end;
+    bool delta;
+    int fd;
+    std::shared_ptr<PartitionCredits> credits;
+    Nan::Callback *chunkCallback;
+    v8::Persistent<v8::Object> self;
+    // Callback return values
+    uint32_t count{0};
+    uint64_t exportedBytes{0};
+    OperationTimer timer;
+
+public:
+    ExportTriplesWorker(OstrichStore *store, char *subject, char *predicate, char *object, uint32_t offset, uint32_t limit,
+                        int32_t version_start, int32_t version_end, bool delta, int32_t fd,
+                        std::shared_ptr<PartitionCredits> credits,
+                        Nan::Callback *callback, Nan::Callback *chunkCallback, v8::Local<v8::Object> self)
+            : Nan::AsyncProgressQueueWorker<char>(callback), store(store),
+              subject(subject), predicate(predicate), object(object), offset(offset), limit(limit),
+              version_start(version_start), version_end(version_end), delta(delta), fd(fd),
+              credits(std::move(credits)), chunkCallback(chunkCallback),
+              timer(store->GetStats(), STATS_OPERATION_EXPORT) {
+        SaveToPersistent("self", self);
+    };
+
+    ~ExportTriplesWorker() override {
+        delete chunkCallback;
+    }
+
+    void Execute(const ExecutionProgress &progress) override {
+        auto executing = timer.execute();
+        auto lock = store->LockRead();
+        try {
+            Controller *controller = store->GetController();
+
+            // Check version, which remains the same when later versions are appended during the export
+            version_end = version_end >= 0 ? version_end : store->GetVisibleVersion();
+
+            // Prepare the triple pattern
+            StringTriple triple_pattern(subject, predicate, toHdtLiteral(object));
+
+            // Delivering a chunk may wait for a slow reader for arbitrarily long, so the read lock is released meanwhile
+            NTriplesWriter writer([this, &progress, &lock](const char *data, size_t length) {
+                exportedBytes += length;
+                lock.unlock();
+                if (fd >= 0) {
+                    WriteAll(fd, data, length);
+                } else {
+                    while (!credits->try_acquire(0)) {
+                        if (!credits->wait({0})) {
+                            throw std::runtime_error("The export was cancelled, as its stream was destroyed or its store was closed");
+                        }
+                    }
+                    progress.Send(data, length);
+                }
+                lock = store->LockRead();
+            });
+            // Appends invalidate iterators, but do not change the results of these versions,
+            // so the iterator is recreated after the written triples if one happened while a chunk was delivered
+            uint64_t generation = store->GetWriteGeneration();
+            if (delta) {
+                std::unique_ptr<TripleDeltaIterator> it(controller->get_delta_materialized(triple_pattern, offset, version_start, version_end));
+                TripleDelta t;
+                while ((limit == 0 || writer.get_count() < limit) && it->next(&t)) {
+                    writer.write_delta(*t.get_triple(), *t.get_dictionary(), t.is_addition());
+                    if (generation != store->GetWriteGeneration()) {
+                        generation = store->GetWriteGeneration();
+                        it.reset(controller->get_delta_materialized(triple_pattern, offset + writer.get_count(), version_start, version_end));
+                    }
+                }
+            } else {
+                std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(version_end);
+                std::unique_ptr<TripleIterator> it(controller->get_version_materialized(triple_pattern, offset, version_end));
+                Triple t;
+                while ((limit == 0 || writer.get_count() < limit) && it->next(&t)) {
+                    writer.write_triple(t, *dict);
+                    if (generation != store->GetWriteGeneration()) {
+                        generation = store->GetWriteGeneration();
+                        dict = controller->get_dictionary_manager(version_end);
+                        it.reset(controller->get_version_materialized(triple_pattern, offset + writer.get_count(), version_end));
+                    }
+                }
+            }
+            writer.flush();
+            count = writer.get_count();
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+        }
+    }
+
+    void HandleProgressCallback(const char *data, size_t length) override {
+        Nan::HandleScope scope;
+        if (chunkCallback == nullptr) {
+            return;
+        }
+        timer.start_marshal();
+        const unsigned argc = 1;
+        v8::Local<v8::Value> argv[argc] = {Nan::CopyBuffer(data, length).ToLocalChecked()};
+        timer.end_marshal();
+        Nan::Call(*chunkCallback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        const unsigned argc = 2;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>(count)};
+        timer.finish(count, exportedBytes);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+// Starts an export to a file descriptor on the query pool,
+// or to the chunk callback on a thread of its own, as it waits until its chunks are read.
+// Returns the credits of the chunks that JavaScript releases once they are read, or undefined for a file descriptor.
+static v8::Local<v8::Value> QueueExport(OstrichStore *store, int32_t fd, const std::function<ExportTriplesWorker *(std::shared_ptr<PartitionCredits>)> &createWorker,
+                                        v8::Local<v8::Function> callback) {
+    if (fd >= 0) {
+        store->QueueQuery(QUERY_TYPE_EXPORT, createWorker(nullptr), callback);
+        return Nan::Undefined();
+    }
+    auto credits = std::make_shared<PartitionCredits>(1, PARTITION_CREDITS_DEFAULT_CAPACITY);
+    v8::Local<v8::Object> handle = Nan::NewInstance(Nan::New(PartitionCreditsHandle::GetConstructor())).ToLocalChecked();
+    new PartitionCreditsHandle(credits, handle);
+    store->RegisterScan(credits);
+    QueueWorkerOnOwnThread(createWorker(credits));
+    return handle;
+}
+
+// Exports the triples of a version that match a triple pattern as N-Triples.
+// The callback is invoked with the number of exported triples.
+// JavaScript signature: OstrichStore#_exportTriplesVersionMaterialized(subject, predicate, object, offset, limit, version, fd, chunkCallback, callback, self)
+NAN_METHOD(OstrichStore::ExportTriplesVersionMaterialized) {
+    assert(info.Length() >= 9);
+    v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    int32_t version = info[5]->Int32Value(context).FromJust();
+    int32_t fd = info[6]->Int32Value(context).FromJust();
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    info.GetReturnValue().Set(QueueExport(store, fd, [&](std::shared_ptr<PartitionCredits> credits) {
+        return new ExportTriplesWorker(store,
+                                       *Nan::Utf8String(info[0]),
+                                       *Nan::Utf8String(info[1]),
+                                       *Nan::Utf8String(info[2]),
+                                       info[3]->Uint32Value(context).FromJust(),
+                                       info[4]->Uint32Value(context).FromJust(),
+                                       version,
+                                       version,
+                                       false,
+                                       fd,
+                                       credits,
+                                       new Nan::Callback(info[8].As<v8::Function>()),
+                                       info[7]->IsFunction() ? new Nan::Callback(info[7].As<v8::Function>()) : nullptr,
+                                       info[9]->IsObject() ? info[9].As<v8::Object>() : info.This());
+    }, info[8].As<v8::Function>()));
+}
+
+// Exports the changes between two versions that match a triple pattern as N-Triples, prefixed with '+ ' or '- '.
+// The callback is invoked with the number of exported changes.
+// JavaScript signature: OstrichStore#_exportTriplesDeltaMaterialized(subject, predicate, object, offset, limit, version_start, version_end, fd, chunkCallback, callback, self)
+NAN_METHOD(OstrichStore::ExportTriplesDeltaMaterialized) {
+    assert(info.Length() >= 10);
+    v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    int32_t fd = info[7]->Int32Value(context).FromJust();
+    OstrichStore *store = Unwrap<OstrichStore>(info.This());
+    info.GetReturnValue().Set(QueueExport(store, fd, [&](std::shared_ptr<PartitionCredits> credits) {
+        return new ExportTriplesWorker(store,
+                                       *Nan::Utf8String(info[0]),
+                                       *Nan::Utf8String(info[1]),
+                                       *Nan::Utf8String(info[2]),
+                                       info[3]->Uint32Value(context).FromJust(),
+                                       info[4]->Uint32Value(context).FromJust(),
+                                       info[5]->Int32Value(context).FromJust(),
+                                       info[6]->Int32Value(context).FromJust(),
+                                       true,
+                                       fd,
+                                       credits,
+                                       new Nan::Callback(info[9].As<v8::Function>()),
+                                       info[8]->IsFunction() ? new Nan::Callback(info[8].As<v8::Function>()) : nullptr,
+                                       info[10]->IsObject() ? info[10].As<v8::Object>() : info.This());
+    }, info[9].As<v8::Function>()));
+}
+
+/******** OstrichStore#_append ********/
+
+// Reads the triples of a JavaScript array on the main thread, without encoding them yet
+static std::vector<AppendTriple> ReadAppendTriples(v8::Local<v8::Array> triples) {
+    v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    const v8::Local<v8::String> SUBJECT = Nan::New("subject").ToLocalChecked();
+    const v8::Local<v8::String> PREDICATE = Nan::New("predicate").ToLocalChecked();
+    const v8::Local<v8::String> OBJECT = Nan::New("object").ToLocalChecked();
+    const v8::Local<v8::String> ADDITION = Nan::New("addition").ToLocalChecked();
+
+    std::vector<AppendTriple> chunk;
+    chunk.reserve(triples->Length());
+    for (uint32_t i = 0; i < triples->Length(); i++) {
+        v8::Local<v8::Object> tripleObject = triples->Get(context, i).ToLocalChecked()->ToObject(context).ToLocalChecked();
+        chunk.push_back(AppendTriple{
+                *Nan::Utf8String(tripleObject->Get(context, SUBJECT).ToLocalChecked()),
+                *Nan::Utf8String(tripleObject->Get(context, PREDICATE).ToLocalChecked()),
+                *Nan::Utf8String(tripleObject->Get(context, OBJECT).ToLocalChecked()),
+                tripleObject->Get(context, ADDITION).ToLocalChecked()->BooleanValue(v8::Isolate::GetCurrent()),
+        });
+    }
+    return chunk;
+}
+
+// Creates the initial snapshot from the triples of a finished sorter, which must all be additions,
+// and returns the number of triples in the snapshot.
+// A snapshot can not be created from a single pass over the triples, so these are buffered,
+// without the duplicates, which are adjacent after sorting.
+// If copy is not null, the distinct triples are added to it as well.
+static size_t CreateSnapshotFromSorted(OstrichStore *store, ExternalSorter &sorter, ExternalSorter *copy) {
+    std::vector<hdt::TripleString> elements_snapshot;
+    AppendTriple triple, last;
+    for (bool first = true; sorter.next(&triple); first = false) {
+        if (!triple.addition) {
+            throw std::runtime_error("All triples of the initial snapshot MUST be additions, but a deletion was found.");
+        }
+        if (first || ExternalSorter::less(last, triple)) {
+            elements_snapshot.emplace_back(triple.subject, triple.predicate, triple.object);
+            if (copy) {
+                copy->add(triple);
+            }
+            last = std::move(triple);
+        }
+    }
+    IteratorTripleStringVector it_snapshot(&elements_snapshot);
+    auto lock = store->LockWrite();
+    std::cout.setstate(std::ios_base::failbit); // Disable cout info from HDT
+    std::shared_ptr<hdt::HDT> hdt = store->GetController()->get_snapshot_manager()->create_snapshot(0, &it_snapshot, "<http://example.org>");
+    std::cout.clear();
+    store->PublishVersions();
+    return hdt->getTriples()->getNumberOfElements();
+}
+
+class AppendWorker : public Nan::AsyncWorker {
+    OstrichStore *store;
+    int version;
+    // Triples that still have to be encoded, and sorted if sort_memory is not 0 or if they form the initial snapshot
+    std::vector<AppendTriple> elements_unsorted;
+    size_t sort_memory;
+    v8::Persistent<v8::Object> self;
+    std::shared_ptr<DictionaryManager> dict;
+    uint32_t insertedCount = 0;
+    OperationTimer timer;
+    OperationTrace trace;
+
+public:
+    // If sort_memory is 0, triples are assumed to be sorted already
+    AppendWorker(OstrichStore *store, int version, v8::Local<v8::Array> triples, size_t sort_memory, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), sort_memory(sort_memory),
+              timer(store->GetStats(), STATS_OPERATION_APPEND),
+              trace(store->GetTracer(), "append") {
+        SaveToPersistent("self", self);
+        trace.arg("triples", (int64_t) triples->Length());
+        auto converting = trace.span("convert");
+        // For lower memory usage, we would have to use the (streaming) patch builder.
+        try {
+            Controller *controller = store->GetController();
+
+            // Check version
+            this->version = version >= 0 ? version : store->GetVisibleVersion() + 1;
+
+            // Triples are only sorted and encoded in the worker thread,
+            // as encoding modifies the dictionary, which may be in use by queries.
+            if (this->version > 0) {
+                dict = controller->get_dictionary_manager(0);
+            }
+            elements_unsorted = ReadAppendTriples(triples);
+        } catch (const runtime_error& error) {
+            SetErrorMessage(error.what());
+        }
+    };
+
+    void Execute() {
+        auto executing = timer.execute();
+        auto tracing = trace.span("execute");
+        tracing.count("version", version);
+        tracing.count("queueWait", (int64_t) trace.since_created());
+        auto waiting = trace.span("lock");
+        auto append_lock = store->LockAppend();
+        waiting.end();
         try {
             // Insert
             Controller *controller = store->GetController();
-            if (it_patch) {
-                controller->append(it_patch, version, dict, false); // For debugging, add: new StdoutProgressListener()
-            } else if (it_snapshot) {
-                std::cout.setstate(std::ios_base::failbit); // Disable cout info from HDT
-                std::shared_ptr<hdt::HDT> hdt = controller->get_snapshot_manager()->create_snapshot(version, it_snapshot, "<http://example.org>");
-                std::cout.clear();
-                insertedCount = hdt->getTriples()->getNumberOfElements();
+            if (version == 0 || sort_memory > 0) {
+                // The initial snapshot is always sorted, so that its duplicates are skipped
+                auto sorting = trace.span("sort");
+                ExternalSorter sorter(sort_memory > 0 ? sort_memory : EXTERNAL_SORTER_DEFAULT_MEMORY,
+                                      store->GetPath() + ".append-sort-" + std::to_string((uintptr_t) this) + "-");
+                for (auto &triple : elements_unsorted) {
+                    sorter.add(std::move(triple));
+                }
+                std::vector<AppendTriple>().swap(elements_unsorted);
+                sorter.finish();
+                sorting.end();
+                if (version == 0) {
+                    auto writing = trace.span("write");
+                    insertedCount = CreateSnapshotFromSorted(store, sorter, nullptr);
+                } else {
+                    SortedPatchElementIterator it_sorted(sorter, dict);
+                    auto waiting_write = trace.span("lock");
+                    auto lock = store->LockWrite();
+                    waiting_write.end();
+                    auto writing = trace.span("write");
+                    controller->append(&it_sorted, version, dict, false);
+                    store->PublishVersions();
+                    insertedCount = it_sorted.getPassed();
+                }
+            } else {
+                AppendTriplePatchElementIterator it_patch(elements_unsorted, dict);
+                insertedCount = elements_unsorted.size();
+                auto waiting_write = trace.span("lock");
+                auto lock = store->LockWrite();
+                waiting_write.end();
+                auto writing = trace.span("write");
+                controller->append(&it_patch, version, dict, false); // For debugging, add: new StdoutProgressListener()
+                store->PublishVersions();
             }
-            delete elements_patch;
-            delete elements_snapshot;
         }
         catch (const runtime_error& error) {
             SetErrorMessage(error.what());
         }
-        delete it_patch;
-        delete it_snapshot;
     }
 
     void HandleOKCallback() {
         Nan::HandleScope scope;
+        timer.start_marshal();
+        auto marshalling = trace.span("marshal");
 
         // Send the JavaScript array and estimated total count through the callback
         const unsigned argc = 2;
         v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>(insertedCount)};
+        timer.finish(insertedCount, 0);
+        marshalling.end();
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
     }
 
     void HandleErrorCallback() {
         Nan::HandleScope scope;
+        timer.fail();
         v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
         Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
     }
@@ -716,18 +2219,516 @@ NAN_METHOD(OstrichStore::Append) {
     Nan::AsyncQueueWorker(new AppendWorker(Unwrap<OstrichStore>(info.This()),
                                            info[0]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
                                            info[1].As<v8::Array>(),
+                                           0,
                                            new Nan::Callback(info[2].As<v8::Function>()),
                                            info[3]->IsObject() ? info[3].As<v8::Object>() : info.This()));
 }
 
+// Appends triples in any order, which are sorted using at most the given number of bytes of memory,
+// after which sorted runs are spilled to temporary files in the store directory.
+// JavaScript signature: OstrichStore#_appendUnsorted(version, triples, sortMemory, callback, self)
+NAN_METHOD(OstrichStore::AppendUnsorted) {
+    assert(info.Length() >= 4);
+    Nan::AsyncQueueWorker(new AppendWorker(Unwrap<OstrichStore>(info.This()),
+                                           info[0]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                           info[1].As<v8::Array>(),
+                                           info[2]->IsNumber() ? (size_t) std::max(info[2]->IntegerValue(Nan::GetCurrentContext()).FromJust(), (int64_t) 1) : EXTERNAL_SORTER_DEFAULT_MEMORY,
+                                           new Nan::Callback(info[3].As<v8::Function>()),
+                                           info[4]->IsObject() ? info[4].As<v8::Object>() : info.This()));
+}
+
+
+/******** OstrichStore#_appendStream ********/
+
+// Consumes a patch element stream until it has ended
+class AppendStreamWorker : public Nan::AsyncWorker {
+    OstrichStore *store;
+    int version;
+    std::shared_ptr<PatchElementStream> stream;
+    std::shared_ptr<DictionaryManager> dict;
+    size_t sort_memory;
+    v8::Persistent<v8::Object> self;
+    uint32_t insertedCount = 0;
+    OperationTimer timer;
+
+public:
+    // If sort_memory is 0, triples are assumed to be pushed in order, and are spilled using the default memory budget
+    AppendStreamWorker(OstrichStore *store, int version, std::shared_ptr<PatchElementStream> stream,
+                       std::shared_ptr<DictionaryManager> dict, size_t sort_memory, Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), version(version), stream(std::move(stream)), dict(std::move(dict)),
+              sort_memory(sort_memory),
+              timer(store->GetStats(), STATS_OPERATION_APPEND) {
+        SaveToPersistent("self", self);
+    };
+
+    void Execute() override {
+        auto executing = timer.execute();
+        auto append_lock = store->LockAppend();
+        try {
+            Controller *controller = store->GetController();
+            // All triples are received before the write lock is taken, so that queries never wait for the producer.
+            // Triples that were pushed in order are spilled as well, so that they do not have to fit in memory.
+            ExternalSorter sorter(sort_memory > 0 ? sort_memory : EXTERNAL_SORTER_DEFAULT_MEMORY,
+                                  store->GetPath() + ".append-sort-" + std::to_string((uintptr_t) this) + "-");
+            AppendTriple triple;
+            while (stream->next_triple(&triple)) {
+                sorter.add(std::move(triple));
+            }
+            sorter.finish();
+            if (version == 0) {
+                insertedCount = CreateSnapshotFromSorted(store, sorter, nullptr);
+            } else {
+                SortedPatchElementIterator it_sorted(sorter, dict);
+                auto lock = store->LockWrite();
+                controller->append(&it_sorted, version, dict, false);
+                store->PublishVersions();
+                insertedCount = it_sorted.getPassed();
+            }
+        } catch (const std::runtime_error &error) {
+            // Fail the pending and future pushes of the producer
+            stream->abort(error.what());
+            SetErrorMessage(error.what());
+        }
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        const unsigned argc = 2;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>(insertedCount)};
+        timer.finish(insertedCount, 0);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+Nan::Persistent<v8::Function> AppendStreamProcessor::constructor;
+
+AppendStreamProcessor::AppendStreamProcessor(std::shared_ptr<PatchElementStream> stream, const v8::Local<v8::Object> &handle)
+        : stream(std::move(stream)), async(new uv_async_t), resource("ostrich:AppendStreamProcessor") {
+    this->Wrap(handle);
+    async->data = this;
+    uv_async_init(Nan::GetCurrentEventLoop(), async, [](uv_async_t *handle) {
+        auto *proc = static_cast<AppendStreamProcessor *>(handle->data);
+        if (proc->pending_callback) {
+            proc->TryPush();
+        }
+    });
+    uv_unref((uv_handle_t *) async);
+    uv_async_t *signal = async;
+    this->stream->set_listener([signal] { uv_async_send(signal); });
+}
+
+AppendStreamProcessor::~AppendStreamProcessor() {
+    // The handle is closed after the listener has been removed, as the consumer signals it while holding the stream lock
+    stream->set_listener(nullptr);
+    stream->abort("The append stream was destroyed before it ended");
+    uv_close((uv_handle_t *) async, [](uv_handle_t *handle) {
+        delete (uv_async_t *) handle;
+    });
+    pending_self.Reset();
+}
+
+void AppendStreamProcessor::TryPush() {
+    Nan::HandleScope scope;
+    std::string error;
+    try {
+        if (!stream->try_push(pending_chunk)) {
+            // The pending push keeps the loop alive until the consumer has made space
+            uv_ref((uv_handle_t *) async);
+            return;
+        }
+    } catch (const std::runtime_error &e) {
+        error = e.what();
+    }
+    uv_unref((uv_handle_t *) async);
+    std::unique_ptr<Nan::Callback> callback = std::move(pending_callback);
+    v8::Local<v8::Object> self = Nan::New(pending_self);
+    pending_self.Reset();
+    pending_chunk.clear();
+    v8::Local<v8::Value> argv[] = {error.empty() ? (v8::Local<v8::Value>) Nan::Null()
+                                                 : v8::Exception::Error(Nan::New(error).ToLocalChecked())};
+    callback->Call(self, 1, argv, &resource);
+}
+
+NAN_METHOD(AppendStreamProcessor::New) {
+    assert(info.IsConstructCall());
+    info.GetReturnValue().Set(info.This());
+}
+
+const Nan::Persistent<v8::Function> &AppendStreamProcessor::GetConstructor() {
+    if (constructor.IsEmpty()) {
+        // Create constructor template
+        v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+        tpl->SetClassName(Nan::New("AppendStreamProcessor").ToLocalChecked());
+        tpl->InstanceTemplate()->SetInternalFieldCount(1);
+        // Create prototype
+        Nan::SetPrototypeMethod(tpl, "_push", Push);
+        Nan::SetPrototypeMethod(tpl, "_end", End);
+        Nan::SetPrototypeMethod(tpl, "_abort", Abort);
+        // Set constructor
+        constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
+    }
+    return constructor;
+}
+
+// Pushes a chunk of triples, the callback is invoked once the chunk has been queued.
+// This never blocks: if the queue is full, the chunk waits on the loop thread until the append has consumed a chunk.
+// Only one chunk can be pending at a time.
+// JavaScript signature: AppendStreamProcessor#_push(triples, callback, self)
+NAN_METHOD(AppendStreamProcessor::Push) {
+    assert(info.Length() >= 2);
+    auto proc = Unwrap<AppendStreamProcessor>(info.This());
+    if (proc->pending_callback) {
+        return Nan::ThrowError("Attempted to push to an append stream while a previous chunk is still pending");
+    }
+    proc->pending_chunk = ReadAppendTriples(info[0].As<v8::Array>());
+    proc->pending_callback = std::make_unique<Nan::Callback>(info[1].As<v8::Function>());
+    proc->pending_self.Reset(info[2]->IsObject() ? info[2].As<v8::Object>() : info.This());
+    proc->TryPush();
+}
+
+// JavaScript signature: AppendStreamProcessor#_end()
+NAN_METHOD(AppendStreamProcessor::End) {
+    Unwrap<AppendStreamProcessor>(info.This())->stream->end();
+}
+
+// JavaScript signature: AppendStreamProcessor#_abort(reason)
+NAN_METHOD(AppendStreamProcessor::Abort) {
+    assert(info.Length() >= 1);
+    Unwrap<AppendStreamProcessor>(info.This())->stream->abort(*Nan::Utf8String(info[0]));
+}
+
+// Starts an append of which the triples are pushed in chunks to the returned processor,
+// which are spilled to sorted runs while they arrive.
+// The callback is invoked once the processor has been ended and all triples have been appended.
+// If sortMemory is not 0, triples may be pushed in any order, and are sorted using at most that number of bytes of memory.
+// JavaScript signature: OstrichStore#_appendStream(version, queueSize, sortMemory, callback, self)
+NAN_METHOD(OstrichStore::AppendStream) {
+    assert(info.Length() >= 4);
+    auto *store = Unwrap<OstrichStore>(info.This());
+    Controller *controller = store->GetController();
+    int version = info[0]->Int32Value(Nan::GetCurrentContext()).FromJust();
+    if (version < 0) {
+        version = store->GetVisibleVersion() + 1;
+    }
+    std::shared_ptr<DictionaryManager> dict = version == 0 ? nullptr : controller->get_dictionary_manager(0);
+    auto stream = std::make_shared<PatchElementStream>(info[1]->Uint32Value(Nan::GetCurrentContext()).FromJust());
+
+    v8::Local<v8::Object> processor = Nan::NewInstance(Nan::New(AppendStreamProcessor::GetConstructor())).ToLocalChecked();
+    new AppendStreamProcessor(stream, processor);
+
+    // The append waits for JavaScript while chunks arrive, so it must not occupy a thread of the libuv thread pool
+    QueueWorkerOnOwnThread(new AppendStreamWorker(store, version, stream, dict,
+                                                  (size_t) std::max(info[2]->IntegerValue(Nan::GetCurrentContext()).FromJust(), (int64_t) 0),
+                                                  new Nan::Callback(info[3].As<v8::Function>()),
+                                                  info[4]->IsObject() ? info[4].As<v8::Object>() : info.This()));
+    info.GetReturnValue().Set(processor);
+}
+
+
+/******** OstrichStore#_appendFullVersion ********/
+
+// Appends the changes between the latest version and a full version,
+// which is read from a JavaScript array or from an N-Triples or N-Quads file
+class AppendFullVersionWorker : public Nan::AsyncWorker {
+    OstrichStore *store;
+    std::vector<AppendTriple> triples;
+    std::string path;
+    size_t sort_memory;
+    v8::Persistent<v8::Object> self;
+    uint32_t insertedCount = 0;
+    OperationTimer timer;
+
+public:
+    // If the path is empty, the given triples are appended
+    AppendFullVersionWorker(OstrichStore *store, std::vector<AppendTriple> triples, std::string path, size_t sort_memory,
+                            Nan::Callback *callback, v8::Local<v8::Object> self)
+            : Nan::AsyncWorker(callback), store(store), triples(std::move(triples)), path(std::move(path)),
+              sort_memory(sort_memory),
+              timer(store->GetStats(), STATS_OPERATION_APPEND) {
+        SaveToPersistent("self", self);
+    };
+
+    void Execute() override {
+        auto executing = timer.execute();
+        auto append_lock = store->LockAppend();
+        try {
+            Controller *controller = store->GetController();
+            int version = controller->get_max_patch_id() + 1;
+            std::string temp_prefix = store->GetPath() + ".append-sort-" + std::to_string((uintptr_t) this) + "-";
+
+            // The full version can be in any order, so it is sorted before it is compared to the latest version
+            ExternalSorter current(sort_memory, temp_prefix + "current-");
+            if (path.empty()) {
+                for (auto &triple : triples) {
+                    // Triples of a full version are always additions, regardless of how they are annotated
+                    triple.addition = true;
+                    current.add(std::move(triple));
+                }
+                std::vector<AppendTriple>().swap(triples);
+            } else {
+                SortVersionDump(path, current, 1);
+            }
+            current.finish();
+
+            if (version == 0) {
+                insertedCount = CreateSnapshotFromSorted(store, current, nullptr);
+            } else {
+                // The latest version is ordered by dictionary ids, so it is sorted by its terms as well
+                ExternalSorter previous(sort_memory, temp_prefix + "previous-");
+                ForEachVersionMaterialized(controller, version - 1, *store->GetTermCache(),
+                                           [&previous](AppendTriple &&triple) { previous.add(std::move(triple)); });
+                previous.finish();
+
+                std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(0);
+                VersionDeltaPatchElementIterator it_delta(previous, current, dict);
+                auto lock = store->LockWrite();
+                controller->append(&it_delta, version, dict, false);
+                store->PublishVersions();
+                insertedCount = it_delta.getPassed();
+            }
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+        }
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        const unsigned argc = 2;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>(insertedCount)};
+        timer.finish(insertedCount, 0);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+};
+
+// Appends a new version that contains exactly the given triples,
+// by appending the changes with respect to the latest version.
+// Triples may be in any order, and are sorted using at most the given number of bytes of memory.
+// JavaScript signature: OstrichStore#_appendFullVersion(triples, sortMemory, callback, self)
+NAN_METHOD(OstrichStore::AppendFullVersion) {
+    assert(info.Length() >= 3);
+    Nan::AsyncQueueWorker(new AppendFullVersionWorker(Unwrap<OstrichStore>(info.This()),
+                                                      ReadAppendTriples(info[0].As<v8::Array>()),
+                                                      "",
+                                                      (size_t) std::max(info[1]->IntegerValue(Nan::GetCurrentContext()).FromJust(), (int64_t) 1),
+                                                      new Nan::Callback(info[2].As<v8::Function>()),
+                                                      info[3]->IsObject() ? info[3].As<v8::Object>() : info.This()));
+}
+
+// Appends a new version that contains exactly the triples in the given N-Triples or N-Quads file,
+// in the same way as OstrichStore#_appendFullVersion.
+// JavaScript signature: OstrichStore#_appendFromFile(path, sortMemory, callback, self)
+NAN_METHOD(OstrichStore::AppendFromFile) {
+    assert(info.Length() >= 3);
+    Nan::AsyncQueueWorker(new AppendFullVersionWorker(Unwrap<OstrichStore>(info.This()),
+                                                      std::vector<AppendTriple>(),
+                                                      *Nan::Utf8String(info[0]),
+                                                      (size_t) std::max(info[1]->IntegerValue(Nan::GetCurrentContext()).FromJust(), (int64_t) 1),
+                                                      new Nan::Callback(info[2].As<v8::Function>()),
+                                                      info[3]->IsObject() ? info[3].As<v8::Object>() : info.This()));
+}
+
+
+/******** OstrichStore#_ingest ********/
+
+// The statistics of a single ingested version
+struct IngestProgress {
+    int version;
+    size_t tripleCount;
+    size_t additionCount;
+    size_t deletionCount;
+    double parseSeconds;
+    double appendSeconds;
+};
+
+// Ingests a sequence of version dumps, of which each next dump is parsed while the previous one is appended
+class IngestWorker : public Nan::AsyncProgressQueueWorker<IngestProgress> {
+    OstrichStore *store;
+    std::vector<std::string> paths;
+    size_t threads;
+    size_t sort_memory;
+    Nan::Callback *progressCallback;
+    v8::Persistent<v8::Object> self;
+    uint32_t versionCount = 0;
+    uint64_t insertedCount = 0;
+    OperationTimer timer;
+
+    // The finished sorter of a dump that has been parsed, and the number of seconds this took
+    typedef std::pair<std::unique_ptr<ExternalSorter>, double> ParsedDump;
+
+public:
+    IngestWorker(OstrichStore *store, std::vector<std::string> paths, size_t threads, size_t sort_memory,
+                 Nan::Callback *callback, Nan::Callback *progressCallback, v8::Local<v8::Object> self)
+            : Nan::AsyncProgressQueueWorker<IngestProgress>(callback), store(store), paths(std::move(paths)),
+              threads(threads), sort_memory(sort_memory), progressCallback(progressCallback),
+              timer(store->GetStats(), STATS_OPERATION_APPEND) {
+        SaveToPersistent("self", self);
+    };
+
+    ~IngestWorker() override {
+        delete progressCallback;
+    }
+
+    void Execute(const ExecutionProgress &progress) override {
+        auto executing = timer.execute();
+        auto append_lock = store->LockAppend();
+        try {
+            Controller *controller = store->GetController();
+            int version = controller->get_max_patch_id() + 1;
+            if (paths.empty()) {
+                return;
+            }
+
+            std::string temp_prefix = store->GetPath() + ".ingest-sort-" + std::to_string((uintptr_t) this) + "-";
+
+            // Dumps are sorted into runs that are spilled to disk beyond the memory budget, so they never have to fit in memory
+            auto parse = [this, &temp_prefix](size_t i) {
+                auto start = std::chrono::steady_clock::now();
+                auto sorter = std::make_unique<ExternalSorter>(sort_memory, temp_prefix + std::to_string(i) + "-");
+                SortVersionDump(paths[i], *sorter, threads);
+                sorter->finish();
+                return ParsedDump(std::move(sorter), SecondsSince(start));
+            };
+            std::future<ParsedDump> next = std::async(std::launch::async, parse, 0);
+            // The first dump is compared to the latest version that is already in the store,
+            // and each next dump to a copy of the distinct triples of the dump before it, which is made while that is appended
+            std::unique_ptr<ExternalSorter> previous;
+            if (version > 0) {
+                previous = std::make_unique<ExternalSorter>(sort_memory, temp_prefix + "previous-");
+                ForEachVersionMaterialized(controller, version - 1, *store->GetTermCache(),
+                                           [&previous](AppendTriple &&triple) { previous->add(std::move(triple)); });
+                previous->finish();
+            }
+            for (size_t i = 0; i < paths.size(); i++, version++) {
+                ParsedDump current = next.get();
+                std::unique_ptr<ExternalSorter> current_copy;
+                if (i + 1 < paths.size()) {
+                    next = std::async(std::launch::async, parse, i + 1);
+                    current_copy = std::make_unique<ExternalSorter>(sort_memory, temp_prefix + "copy-" + std::to_string(i) + "-");
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                IngestProgress stats{version, 0, 0, 0, current.second, 0};
+                if (version == 0) {
+                    stats.tripleCount = CreateSnapshotFromSorted(store, *current.first, current_copy.get());
+                    stats.additionCount = stats.tripleCount;
+                } else {
+                    std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(0);
+                    VersionDeltaPatchElementIterator it_delta(*previous, *current.first, dict, current_copy.get());
+                    {
+                        auto lock = store->LockWrite();
+                        controller->append(&it_delta, version, dict, false);
+                        store->PublishVersions();
+                    }
+                    stats.tripleCount = it_delta.get_current_count();
+                    stats.additionCount = it_delta.get_addition_count();
+                    stats.deletionCount = it_delta.get_deletion_count();
+                }
+                if (current_copy) {
+                    current_copy->finish();
+                }
+                stats.appendSeconds = SecondsSince(start);
+                previous = std::move(current_copy);
+                versionCount++;
+                progress.Send(&stats, 1);
+            }
+        } catch (const std::runtime_error &error) {
+            SetErrorMessage(error.what());
+        }
+    }
+
+    void HandleProgressCallback(const IngestProgress *data, size_t count) override {
+        Nan::HandleScope scope;
+        for (size_t i = 0; i < count; i++) {
+            insertedCount += data[i].additionCount + data[i].deletionCount;
+        }
+        if (progressCallback == nullptr) {
+            return;
+        }
+        for (size_t i = 0; i < count; i++) {
+            v8::Local<v8::Object> progressObject = Nan::New<v8::Object>();
+            Nan::Set(progressObject, Nan::New("version").ToLocalChecked(), Nan::New<v8::Integer>(data[i].version));
+            Nan::Set(progressObject, Nan::New("tripleCount").ToLocalChecked(), Nan::New<v8::Number>((double) data[i].tripleCount));
+            Nan::Set(progressObject, Nan::New("additionCount").ToLocalChecked(), Nan::New<v8::Number>((double) data[i].additionCount));
+            Nan::Set(progressObject, Nan::New("deletionCount").ToLocalChecked(), Nan::New<v8::Number>((double) data[i].deletionCount));
+            Nan::Set(progressObject, Nan::New("parseSeconds").ToLocalChecked(), Nan::New<v8::Number>(data[i].parseSeconds));
+            Nan::Set(progressObject, Nan::New("appendSeconds").ToLocalChecked(), Nan::New<v8::Number>(data[i].appendSeconds));
+            const unsigned argc = 1;
+            v8::Local<v8::Value> argv[argc] = {progressObject};
+            Nan::Call(*progressCallback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+        }
+    }
+
+    void HandleOKCallback() override {
+        Nan::HandleScope scope;
+        timer.start_marshal();
+        const unsigned argc = 2;
+        v8::Local<v8::Value> argv[argc] = {Nan::Null(), Nan::New<v8::Integer>(versionCount)};
+        timer.finish(insertedCount, 0);
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), argc, argv);
+    }
+
+    void HandleErrorCallback() override {
+        Nan::HandleScope scope;
+        timer.fail();
+        v8::Local<v8::Value> argv[] = {v8::Exception::Error(Nan::New(ErrorMessage()).ToLocalChecked())};
+        Nan::Call(*callback, GetFromPersistent("self")->ToObject(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
+    }
+
+private:
+    static double SecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// Ingests N-Triples or N-Quads files as consecutive versions after the latest version.
+// Each file contains the full contents of its version, and is parsed on the given number of threads,
+// and sorted using at most sortMemory bytes of memory,
+// after which the changes with respect to the previous version are appended.
+// The progress callback is invoked with the statistics of each version once it has been ingested,
+// and the callback is invoked with the number of ingested versions.
+// JavaScript signature: OstrichStore#_ingest(paths, threads, sortMemory, progressCallback, callback, self)
+NAN_METHOD(OstrichStore::Ingest) {
+    assert(info.Length() >= 5);
+    v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    v8::Local<v8::Array> pathsArray = info[0].As<v8::Array>();
+    std::vector<std::string> paths;
+    paths.reserve(pathsArray->Length());
+    for (uint32_t i = 0; i < pathsArray->Length(); i++) {
+        paths.emplace_back(*Nan::Utf8String(pathsArray->Get(context, i).ToLocalChecked()));
+    }
+    Nan::AsyncQueueWorker(new IngestWorker(Unwrap<OstrichStore>(info.This()),
+                                           std::move(paths),
+                                           std::max(info[1]->Uint32Value(context).FromJust(), (uint32_t) 1),
+                                           info[2]->IsNumber() ? (size_t) std::max(info[2]->IntegerValue(context).FromJust(), (int64_t) 1) : EXTERNAL_SORTER_DEFAULT_MEMORY,
+                                           new Nan::Callback(info[4].As<v8::Function>()),
+                                           info[3]->IsFunction() ? new Nan::Callback(info[3].As<v8::Function>()) : nullptr,
+                                           info[5]->IsObject() ? info[5].As<v8::Object>() : info.This()));
+}
+
 
 /******** OstrichStore#maxVersion ********/
 
 
-// The max version that is available in the dataset
+// The max version that is available in the dataset, which excludes versions that are still being appended
 NAN_PROPERTY_GETTER(OstrichStore::MaxVersion) {
     auto *ostrichStore = Unwrap<OstrichStore>(info.This());
-    info.GetReturnValue().Set(Nan::New<v8::Integer>(ostrichStore->GetController()->get_max_patch_id()));
+    info.GetReturnValue().Set(Nan::New<v8::Integer>(ostrichStore->GetVisibleVersion()));
 }
 
 /******** OstrichStore#features ********/
@@ -741,6 +2742,76 @@ NAN_PROPERTY_GETTER(OstrichStore::Features) {
 
 
 
+/******** OstrichStore#_stats ********/
+
+// Gets the counters and latencies of all operations since the store was opened, which remain readable once it is closed.
+// JavaScript signature: OstrichStore#_stats()
+NAN_METHOD(OstrichStore::Stats) {
+    auto *ostrichStore = Unwrap<OstrichStore>(info.This());
+    info.GetReturnValue().Set(ostrichStore->stats->ToObject());
+}
+
+
+
+/******** OstrichStore#_startTracing ********/
+
+// Starts recording the spans of all operations that are created from now on.
+// JavaScript signature: OstrichStore#_startTracing()
+NAN_METHOD(OstrichStore::StartTracing) {
+    auto *ostrichStore = Unwrap<OstrichStore>(info.This());
+    ostrichStore->tracer->start();
+}
+
+
+
+/******** OstrichStore#_stopTracing ********/
+
+// Stops recording spans, and returns the recorded spans as a Chrome trace object.
+// Spans of operations that are still running are discarded once tracing is started again.
+// JavaScript signature: OstrichStore#_stopTracing()
+NAN_METHOD(OstrichStore::StopTracing) {
+    auto *ostrichStore = Unwrap<OstrichStore>(info.This());
+    info.GetReturnValue().Set(ostrichStore->tracer->stop());
+}
+
+
+
+/******** OstrichStore#_setSlowQueryLog ********/
+
+// Logs the version-materialized, delta-materialized and version queries that execute for at least the threshold
+// in milliseconds, or no queries if the threshold is negative.
+// JavaScript signature: OstrichStore#_setSlowQueryLog(threshold, capacity, file)
+NAN_METHOD(OstrichStore::SetSlowQueryLog) {
+    assert(info.Length() >= 3);
+    auto *ostrichStore = Unwrap<OstrichStore>(info.This());
+    double threshold = info[0]->NumberValue(Nan::GetCurrentContext()).FromJust();
+    ostrichStore->slow_queries->configure(threshold < 0 ? -1 : (int64_t) (threshold * 1000),
+                                          info[1]->Uint32Value(Nan::GetCurrentContext()).FromJust(),
+                                          *Nan::Utf8String(info[2]));
+}
+
+
+
+/******** OstrichStore#_slowQueries ********/
+
+// Returns the latest slow queries, from the oldest to the latest.
+// JavaScript signature: OstrichStore#_slowQueries()
+NAN_METHOD(OstrichStore::SlowQueries) {
+    auto *ostrichStore = Unwrap<OstrichStore>(info.This());
+    info.GetReturnValue().Set(ostrichStore->slow_queries->ToArray());
+}
+
+
+
+/******** OstrichStore#_cancelScans ********/
+
+// Cancels all partitioned scans, which is done when the store is closed, before it waits for its operations to finish.
+// JavaScript signature: OstrichStore#_cancelScans()
+NAN_METHOD(OstrichStore::CancelScans) {
+    Unwrap<OstrichStore>(info.This())->StopScans();
+}
+
+
 /******** OstrichStore#close ********/
 
 // Closes the document, disabling all further operations.
@@ -1,10 +1,26 @@
 #ifndef OstrichStore_H
 #define OstrichStore_H
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
 #include <node.h>
 #include <nan.h>
 
 #include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "IteratorCheckpoints.h"
+#include "PatchElementStream.h"
+#include "QueryPool.h"
+#include "QueryStats.h"
+#include "QueryTrace.h"
+#include "ResultCache.h"
+#include "SlowQueryLog.h"
+#include "TermCache.h"
+
+class PartitionCredits;
 
 enum OstrichStoreFeatures {
     Versioning = 1, // The document supports versioning
@@ -12,7 +28,8 @@ enum OstrichStoreFeatures {
 
 class OstrichStore : public Nan::ObjectWrap {
 public:
-    OstrichStore(std::string path, const v8::Local<v8::Object> &handle, Controller *controller);
+    OstrichStore(std::string path, const v8::Local<v8::Object> &handle, Controller *controller, size_t term_cache_size,
+                 size_t result_cache_size, size_t checkpoint_count, std::unique_ptr<QueryPool> query_pool);
 
     static NAN_METHOD(Create);
 
@@ -21,6 +38,66 @@ public:
 
     // Accessors
     Controller *GetController() { return controller; }
+    std::shared_ptr<TermCache> GetTermCache() { return term_cache; }
+    std::shared_ptr<ResultCache> GetResultCache() { return result_cache; }
+    std::shared_ptr<IteratorCheckpoints<TripleIterator>> GetVersionMaterializedCheckpoints() { return vm_checkpoints; }
+    std::shared_ptr<IteratorCheckpoints<TripleDeltaIterator>> GetDeltaMaterializedCheckpoints() { return dm_checkpoints; }
+    std::shared_ptr<QueryStats> GetStats() { return stats; }
+    std::shared_ptr<QueryTracer> GetTracer() { return tracer; }
+    std::shared_ptr<SlowQueryLog> GetSlowQueryLog() { return slow_queries; }
+    // Cached terms may refer to dictionaries that were replaced by an append,
+    // and cached results and iterators may be outdated
+    void ClearCaches() {
+        term_cache->clear();
+        result_cache->clear();
+        vm_checkpoints->clear();
+        dm_checkpoints->clear();
+    }
+    [[nodiscard]] const std::string &GetPath() const { return path; }
+    // Queries hold a read lock while they use the controller, and appends hold the write lock while they modify it,
+    // so that queries never observe a partially appended version.
+    // A pending writer closes the gate for new readers, so that a steady stream of queries cannot starve appends.
+    // The read lock is therefore not reentrant: a thread must never take it while it already holds it.
+    std::shared_lock<std::shared_mutex> LockRead() {
+        { std::lock_guard<std::mutex> gate(writer_gate); }
+        return std::shared_lock<std::shared_mutex>(controller_mutex);
+    }
+    std::unique_lock<std::shared_mutex> LockWrite() {
+        std::lock_guard<std::mutex> gate(writer_gate);
+        std::unique_lock<std::shared_mutex> lock(controller_mutex);
+        write_generation++;
+        return lock;
+    }
+    // Changes whenever the write lock is taken, so that queries that release the read lock in between results
+    // can detect that their iterators have to be recreated
+    [[nodiscard]] uint64_t GetWriteGeneration() const { return write_generation.load(); }
+    // Appends are executed one at a time, and only take the write lock once they are ready to modify the controller
+    std::unique_lock<std::mutex> LockAppend() { return std::unique_lock<std::mutex>(append_mutex); }
+    // The latest version of which the append has completed, to which queries without a version are pinned
+    [[nodiscard]] int GetVisibleVersion() const { return visible_version.load(); }
+    // Makes the versions that were appended while holding the write lock visible,
+    // after which cached terms, results and iterators are outdated.
+    void PublishVersions() {
+        ClearCaches();
+        visible_version.store(controller->get_max_patch_id());
+    }
+    // Queues a query worker on the query pool of this store.
+    // If the queue is full, the worker is destroyed and the callback is invoked with an error instead.
+    void QueueQuery(QueryType type, Nan::AsyncWorker *worker, const v8::Local<v8::Function> &callback);
+    // Executes the parallel work of a running query on its own thread and on idle threads of the query pool,
+    // so that queries do not start threads of their own
+    void RunParallel(size_t parallelism, const std::function<void()> &work) {
+        if (query_pool != nullptr) {
+            query_pool->run_parallel(parallelism, work);
+        } else {
+            work();
+        }
+    }
+
+    // Partitioned scans wait for their results to be read, which may never happen,
+    // so they are registered to be cancelled once the store is closed
+    void RegisterScan(const std::shared_ptr<PartitionCredits> &credits);
+    void StopScans();
 
     [[nodiscard]] bool Supports(OstrichStoreFeatures feature) const {
         return features & (int) feature;
@@ -30,6 +107,21 @@ private:
     Controller *controller;
     int features;
     std::string path;
+    std::shared_ptr<TermCache> term_cache;
+    std::shared_ptr<ResultCache> result_cache;
+    std::shared_ptr<IteratorCheckpoints<TripleIterator>> vm_checkpoints;
+    std::shared_ptr<IteratorCheckpoints<TripleDeltaIterator>> dm_checkpoints;
+    std::unique_ptr<QueryPool> query_pool;
+    std::shared_ptr<QueryStats> stats;
+    std::shared_ptr<QueryTracer> tracer;
+    std::shared_ptr<SlowQueryLog> slow_queries;
+    std::shared_mutex controller_mutex;
+    std::mutex writer_gate;
+    std::mutex append_mutex;
+    std::atomic<int> visible_version;
+    std::atomic<uint64_t> write_generation;
+    std::mutex scans_mutex;
+    std::vector<std::weak_ptr<PartitionCredits>> scans;
 
     // Construction and destruction
     ~OstrichStore() override;
@@ -38,30 +130,77 @@ private:
 
     static NAN_METHOD(New);
 
-    // OstrichStore#_searchTriplesVersionMaterialized(subject, predicate, object, offset, limit, version, callback, self)
+    // OstrichStore#_searchTriplesVersionMaterialized(subject, predicate, object, offset, limit, version, callback, self, cancellation)
     static NAN_METHOD(SearchTriplesVersionMaterialized);
     // OstrichStore#_countTriplesVersionMaterialized(subject, predicate, object, version, callback, self)
     static NAN_METHOD(CountTriplesVersionMaterialized);
 
-    // OstrichStore#_searchTriplesDeltaMaterialized(subject, predicate, object, offset, limit, version_start, version_end, callback, self)
+    // OstrichStore#_searchTriplesDeltaMaterialized(subject, predicate, object, offset, limit, version_start, version_end, callback, self, cancellation)
     static NAN_METHOD(SearchTriplesDeltaMaterialized);
     // OstrichStore#_countTriplesDeltaMaterialized(subject, predicate, object, version_start, version_end, callback, self)
     static NAN_METHOD(CountTriplesDeltaMaterialized);
 
-    // OstrichStore#_searchTriplesVersion(subject, predicate, object, offset, limit, callback, self)
+    // OstrichStore#_searchTriplesVersion(subject, predicate, object, offset, limit, callback, self, cancellation)
     static NAN_METHOD(SearchTriplesVersion);
     // OstrichStore#_countTriplesVersion(subject, predicate, object, callback, self)
     static NAN_METHOD(CountTriplesVersion);
 
+    // OstrichStore#_searchTriplesVersionMaterializedPacked(subject, predicate, object, offset, limit, version, callback, self, cancellation)
+    static NAN_METHOD(SearchTriplesVersionMaterializedPacked);
+    // OstrichStore#_searchTriplesDeltaMaterializedPacked(subject, predicate, object, offset, limit, version_start, version_end, callback, self, cancellation)
+    static NAN_METHOD(SearchTriplesDeltaMaterializedPacked);
+    // OstrichStore#_searchTriplesVersionPacked(subject, predicate, object, offset, limit, callback, self, cancellation)
+    static NAN_METHOD(SearchTriplesVersionPacked);
+
+    // OstrichStore#_searchTripleIdsVersionMaterialized(subject, predicate, object, offset, limit, version, callback, self)
+    static NAN_METHOD(SearchTripleIdsVersionMaterialized);
+    // OstrichStore#_decodeTripleIds(ids, version, callback, self)
+    static NAN_METHOD(DecodeTripleIds);
+
+    // OstrichStore#_searchBatch(queries, parallelism, callback, self)
+    static NAN_METHOD(SearchBatch);
+
+    // OstrichStore#_searchTriplesVersionMaterializedPartitioned(subject, predicate, object, version, partitions, chunkSize, queueSize, chunkCallback, callback, self)
+    static NAN_METHOD(SearchTriplesVersionMaterializedPartitioned);
+
+    // OstrichStore#_exportTriplesVersionMaterialized(subject, predicate, object, offset, limit, version, fd, chunkCallback, callback, self)
+    static NAN_METHOD(ExportTriplesVersionMaterialized);
+    // OstrichStore#_exportTriplesDeltaMaterialized(subject, predicate, object, offset, limit, version_start, version_end, fd, chunkCallback, callback, self)
+    static NAN_METHOD(ExportTriplesDeltaMaterialized);
+
     // OstrichStore#maxVersion
     static NAN_PROPERTY_GETTER(MaxVersion);
 
     // OstrichStore#_append(version, triples, callback, self)
     static NAN_METHOD(Append);
+    // OstrichStore#_appendUnsorted(version, triples, sortMemory, callback, self)
+    static NAN_METHOD(AppendUnsorted);
+    // OstrichStore#_appendStream(version, queueSize, sortMemory, callback, self)
+    static NAN_METHOD(AppendStream);
+    // OstrichStore#_appendFullVersion(triples, sortMemory, callback, self)
+    static NAN_METHOD(AppendFullVersion);
+    // OstrichStore#_appendFromFile(path, sortMemory, callback, self)
+    static NAN_METHOD(AppendFromFile);
+    // OstrichStore#_ingest(paths, threads, sortMemory, progressCallback, callback, self)
+    static NAN_METHOD(Ingest);
 
     // OstrichStore#_features
     static NAN_PROPERTY_GETTER(Features);
 
+    // OstrichStore#_stats()
+    static NAN_METHOD(Stats);
+
+    // OstrichStore#_startTracing()
+    static NAN_METHOD(StartTracing);
+    // OstrichStore#_stopTracing()
+    static NAN_METHOD(StopTracing);
+    // OstrichStore#_setSlowQueryLog(threshold, capacity, file)
+    static NAN_METHOD(SetSlowQueryLog);
+    // OstrichStore#_slowQueries()
+    static NAN_METHOD(SlowQueries);
+
+    // OstrichStore#_cancelScans()
+    static NAN_METHOD(CancelScans);
     // OstrichStore#_close([remove], [callback], [self])
     static NAN_METHOD(Close);
 
@@ -71,4 +210,40 @@ private:
     static Nan::Persistent<v8::Function> constructor;
 };
 
+// The writable end of a streaming append
+class AppendStreamProcessor : public Nan::ObjectWrap {
+public:
+    AppendStreamProcessor(std::shared_ptr<PatchElementStream> stream, const v8::Local<v8::Object> &handle);
+
+    static const Nan::Persistent<v8::Function> &GetConstructor();
+
+private:
+    std::shared_ptr<PatchElementStream> stream;
+    // Signalled by the consumer of the stream once there may be space for the pending chunk,
+    // and only referenced while a chunk is pending
+    uv_async_t *async;
+    Nan::AsyncResource resource;
+    // The chunk that is waiting for space in the stream, and the callback of its push
+    std::vector<AppendTriple> pending_chunk;
+    std::unique_ptr<Nan::Callback> pending_callback;
+    Nan::Persistent<v8::Object> pending_self;
+
+    // An append that is never ended would otherwise wait forever
+    ~AppendStreamProcessor() override;
+
+    // Queues the pending chunk if there is space, and invokes its callback if it was queued or failed
+    void TryPush();
+
+    static NAN_METHOD(New);
+
+    // AppendStreamProcessor#_push(triples, callback, self)
+    static NAN_METHOD(Push);
+    // AppendStreamProcessor#_end()
+    static NAN_METHOD(End);
+    // AppendStreamProcessor#_abort(reason)
+    static NAN_METHOD(Abort);
+
+    static Nan::Persistent<v8::Function> constructor;
+};
+
 #endif
@@ -1,12 +1,40 @@
 import * as fs from 'fs';
+import * as os from 'os';
+import { Readable } from 'stream';
 import type * as RDF from '@rdfjs/types';
 import { DataFactory } from 'rdf-data-factory';
-import { quadToStringQuad, stringQuadToQuad, termToString } from 'rdf-string';
-import type { IOstrichStoreNative } from './IOstrichStoreNative';
-import type { IQuadDelta, IQuadVersion } from './utils';
-import { serializeTerm, strcmp } from './utils';
+import { quadToStringQuad, stringQuadToQuad } from 'rdf-string';
+import { AppendStream } from './AppendStream';
+import type { IBatchQuery, IBatchQueryNative, IBatchQueryResult } from './BatchQuery';
+import { BatchQueryType } from './BatchQuery';
+import type { IOstrichStoreNative, IPartitionCredits } from './IOstrichStoreNative';
+import type { IQueryCancellationOptions } from './QueryCancellation';
+import { createQueryCancellation } from './QueryCancellation';
+import type { IQueryPoolOptions } from './QueryPool';
+import type { IStoreStats } from './QueryStats';
+import type { ITrace } from './QueryTrace';
+import type { ISlowQuery, ISlowQueryLogOptions } from './SlowQueryLog';
+import { TripleBatch } from './TripleBatch';
+import type { IIngestProgress, IQuadDelta, IQuadVersion, IStringQuadDelta } from './utils';
+import { serializeTerm, tripleIdsFromBuffer, tripleIdsToBuffer } from './utils';
 const ostrichNative = require('../build/Release/ostrich.node');
 
+/**
+ * Starts a native export to the given file descriptor, or to the given chunk callback if the file descriptor is -1,
+ * in which case the credits of the chunks are returned.
+ */
+type ExportNative = (
+  fd: number,
+  chunkCb: ((chunk: Buffer) => void) | undefined,
+  cb: (error: Error | undefined, count: number) => void,
+) => IPartitionCredits | undefined;
+
+/**
+ * The default number of bytes of triples that are sorted in memory during an append.
+ * This corresponds to EXTERNAL_SORTER_DEFAULT_MEMORY in ExternalSorter.h
+ */
+export const DEFAULT_SORT_MEMORY = 256 * 1024 * 1024;
+
 /**
  * A class for accessing an OSTRICH archive.
  */
@@ -20,6 +48,7 @@ export class OstrichStore {
     public readonly dataFactory: RDF.DataFactory,
     public readonly readOnly: boolean,
     public readonly features: Record<string, boolean>,
+    public readonly resultCacheSize = 0,
   ) {}
 
   /**
@@ -36,6 +65,58 @@ export class OstrichStore {
     return this.native.closed;
   }
 
+  /**
+   * The counters and latencies of all operations since the store was opened,
+   * which can still be read after the store was closed.
+   * Each operation is split into the time it waited for a thread, the time it executed,
+   * and the time of converting its results into JavaScript values.
+   */
+  public stats(): IStoreStats {
+    return this.native._stats();
+  }
+
+  /**
+   * Starts recording a span of each phase of all operations that are created from now on,
+   * and removes the spans of an earlier trace.
+   * Operations that are created while not tracing only check whether tracing is enabled.
+   */
+  public startTracing(): void {
+    this.native._startTracing();
+  }
+
+  /**
+   * Stops recording spans, and returns the spans that were recorded since tracing was started.
+   * The trace can be loaded in Perfetto or chrome://tracing after serializing it as JSON.
+   */
+  public stopTracing(): ITrace {
+    return this.native._stopTracing();
+  }
+
+  /**
+   * Logs the version-materialized, delta-materialized and version queries that execute longer than a threshold,
+   * together with estimations of the number of snapshot triples and changes that match their pattern.
+   * Without options, no more queries are logged, and the logged queries are removed.
+   * @param options The threshold in milliseconds, the number of slow queries to keep, and an optional file to append to.
+   */
+  public setSlowQueryLog(options?: ISlowQueryLogOptions): void {
+    if (!options) {
+      this.native._setSlowQueryLog(-1, 0, '');
+      return;
+    }
+    this.native._setSlowQueryLog(
+      Math.max(0, options.threshold),
+      options.capacity === undefined ? 100 : options.capacity,
+      options.file || '',
+    );
+  }
+
+  /**
+   * The latest queries that executed longer than the threshold of the slow query log, from the oldest to the latest.
+   */
+  public slowQueries(): ISlowQuery[] {
+    return this.native._slowQueries();
+  }
+
   /**
    * Searches the document for triples with the given subject, predicate, object and version
    * for a version materialized query.
@@ -48,8 +129,8 @@ export class OstrichStore {
     subject: RDF.Term | undefined | null,
     predicate: RDF.Term | undefined | null,
     object: RDF.Term | undefined | null,
-    options?: { offset?: number; limit?: number; version?: number },
-  ): Promise<{ triples: RDF.Quad[]; cardinality: number; exactCardinality: boolean }> {
+    options?: { offset?: number; limit?: number; version?: number } & IQueryCancellationOptions,
+  ): Promise<{ triples: RDF.Quad[]; cardinality: number; exactCardinality: boolean; truncated: boolean }> {
     return new Promise((resolve, reject) => {
       if (this.closed) {
         return reject(new Error('Attempted to query a closed OSTRICH store'));
@@ -60,7 +141,35 @@ export class OstrichStore {
       const offset = options && options.offset ? Math.max(0, options.offset) : 0;
       const limit = options && options.limit ? Math.max(0, options.limit) : 0;
       const version = options && (options.version || options.version === 0) ? options.version : -1;
+      const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
       this._operations++;
+      if (this.resultCacheSize > 0) {
+        // Only packed pages are cached
+        return this.native._searchTriplesVersionMaterializedPacked(
+          serializeTerm(subject),
+          serializeTerm(predicate),
+          serializeTerm(object),
+          offset,
+          limit,
+          version,
+          (error, batch, totalCount, hasExactCount, truncated) => {
+            this._operations--;
+            dispose();
+            this._finishOperation();
+            if (error) {
+              return reject(error);
+            }
+            resolve({
+              triples: new TripleBatch(batch, this.dataFactory).toArray(),
+              cardinality: totalCount,
+              exactCardinality: hasExactCount,
+              truncated,
+            });
+          },
+          undefined,
+          cancellation,
+        );
+      }
       this.native._searchTriplesVersionMaterialized(
         serializeTerm(subject),
         serializeTerm(predicate),
@@ -68,8 +177,9 @@ export class OstrichStore {
         offset,
         limit,
         version,
-        (error, triples, totalCount, hasExactCount) => {
+        (error, triples, totalCount, hasExactCount, truncated) => {
           this._operations--;
+          dispose();
           this._finishOperation();
           if (error) {
             return reject(error);
@@ -78,8 +188,66 @@ export class OstrichStore {
             triples: triples.map(triple => stringQuadToQuad(triple)),
             cardinality: totalCount,
             exactCardinality: hasExactCount,
+            truncated,
+          });
+        },
+        undefined,
+        cancellation,
+      );
+    });
+  }
+
+  /**
+   * Searches the document for triples with the given subject, predicate, object and version
+   * for a version materialized query.
+   * In contrast to searchTriplesVersionMaterialized, results are returned as a packed batch,
+   * which is produced entirely off the main thread, and of which the RDF/JS terms are created lazily.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public searchTriplesVersionMaterializedBatch(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options?: { offset?: number; limit?: number; version?: number } & IQueryCancellationOptions,
+  ): Promise<{ triples: TripleBatch; cardinality: number; exactCardinality: boolean; truncated: boolean }> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to query a closed OSTRICH store'));
+      }
+      if (this.maxVersion < 0) {
+        return reject(new Error('Attempted to query an OSTRICH store without versions'));
+      }
+      const offset = options && options.offset ? Math.max(0, options.offset) : 0;
+      const limit = options && options.limit ? Math.max(0, options.limit) : 0;
+      const version = options && (options.version || options.version === 0) ? options.version : -1;
+      const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
+      this._operations++;
+      this.native._searchTriplesVersionMaterializedPacked(
+        serializeTerm(subject),
+        serializeTerm(predicate),
+        serializeTerm(object),
+        offset,
+        limit,
+        version,
+        (error, batch, totalCount, hasExactCount, truncated) => {
+          this._operations--;
+          dispose();
+          this._finishOperation();
+          if (error) {
+            return reject(error);
+          }
+          resolve({
+            triples: new TripleBatch(batch, this.dataFactory),
+            cardinality: totalCount,
+            exactCardinality: hasExactCount,
+            truncated,
           });
         },
+        undefined,
+        cancellation,
       );
     });
   }
@@ -132,8 +300,8 @@ export class OstrichStore {
     subject: RDF.Term | undefined | null,
     predicate: RDF.Term | undefined | null,
     object: RDF.Term | undefined | null,
-    options: { offset?: number; limit?: number; versionStart: number; versionEnd: number },
-  ): Promise<{ triples: IQuadDelta[]; cardinality: number; exactCardinality: boolean }> {
+    options: { offset?: number; limit?: number; versionStart: number; versionEnd: number } & IQueryCancellationOptions,
+  ): Promise<{ triples: IQuadDelta[]; cardinality: number; exactCardinality: boolean; truncated: boolean }> {
     return new Promise((resolve, reject) => {
       if (this.closed) {
         return reject(new Error('Attempted to query a closed OSTRICH store'));
@@ -151,6 +319,7 @@ export class OstrichStore {
       if (versionEnd > this.maxVersion) {
         return reject(new Error(`'versionEnd' can not be larger than the maximum version (${this.maxVersion})`));
       }
+      const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
       this._operations++;
       this.native._searchTriplesDeltaMaterialized(
         serializeTerm(subject),
@@ -160,8 +329,9 @@ export class OstrichStore {
         limit,
         versionStart,
         versionEnd,
-        (error, triples, totalCount, hasExactCount) => {
+        (error, triples, totalCount, hasExactCount, truncated) => {
           this._operations--;
+          dispose();
           this._finishOperation();
           if (error) {
             return reject(error);
@@ -174,8 +344,72 @@ export class OstrichStore {
             }),
             cardinality: totalCount,
             exactCardinality: hasExactCount,
+            truncated,
+          });
+        },
+        undefined,
+        cancellation,
+      );
+    });
+  }
+
+  /**
+   * Searches the document for triples with the given subject, predicate, object, versionStart and versionEnd
+   * for a delta materialized query, and returns them as a packed batch.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public searchTriplesDeltaMaterializedBatch(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options: { offset?: number; limit?: number; versionStart: number; versionEnd: number } & IQueryCancellationOptions,
+  ): Promise<{ triples: TripleBatch<IQuadDelta>; cardinality: number; exactCardinality: boolean; truncated: boolean }> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to query a closed OSTRICH store'));
+      }
+      if (this.maxVersion < 0) {
+        return reject(new Error('Attempted to query an OSTRICH store without versions'));
+      }
+      const offset = options.offset ? Math.max(0, options.offset) : 0;
+      const limit = options.limit ? Math.max(0, options.limit) : 0;
+      const versionStart = options.versionStart;
+      const versionEnd = options.versionEnd;
+      if (versionStart >= versionEnd) {
+        return reject(new Error(`'versionStart' must be strictly smaller than 'versionEnd'`));
+      }
+      if (versionEnd > this.maxVersion) {
+        return reject(new Error(`'versionEnd' can not be larger than the maximum version (${this.maxVersion})`));
+      }
+      const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
+      this._operations++;
+      this.native._searchTriplesDeltaMaterializedPacked(
+        serializeTerm(subject),
+        serializeTerm(predicate),
+        serializeTerm(object),
+        offset,
+        limit,
+        versionStart,
+        versionEnd,
+        (error, batch, totalCount, hasExactCount, truncated) => {
+          this._operations--;
+          dispose();
+          this._finishOperation();
+          if (error) {
+            return reject(error);
+          }
+          resolve({
+            triples: new TripleBatch<IQuadDelta>(batch, this.dataFactory),
+            cardinality: totalCount,
+            exactCardinality: hasExactCount,
+            truncated,
           });
         },
+        undefined,
+        cancellation,
       );
     });
   }
@@ -230,8 +464,8 @@ export class OstrichStore {
     subject: RDF.Term | undefined | null,
     predicate: RDF.Term | undefined | null,
     object: RDF.Term | undefined | null,
-    options?: { offset?: number; limit?: number },
-  ): Promise<{ triples: IQuadVersion[]; cardinality: number; exactCardinality: boolean }> {
+    options?: { offset?: number; limit?: number } & IQueryCancellationOptions,
+  ): Promise<{ triples: IQuadVersion[]; cardinality: number; exactCardinality: boolean; truncated: boolean }> {
     return new Promise((resolve, reject) => {
       if (this.closed) {
         return reject(new Error('Attempted to query a closed OSTRICH store'));
@@ -242,6 +476,7 @@ export class OstrichStore {
       const offset = options && options.offset ? Math.max(0, options.offset) : 0;
       const limit = options && options.limit ? Math.max(0, options.limit) : 0;
 
+      const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
       this._operations++;
       this.native._searchTriplesVersion(
         serializeTerm(subject),
@@ -249,8 +484,9 @@ export class OstrichStore {
         serializeTerm(object),
         offset,
         limit,
-        (error, triples, totalCount, hasExactCount) => {
+        (error, triples, totalCount, hasExactCount, truncated) => {
           this._operations--;
+          dispose();
           this._finishOperation();
           if (error) {
             return reject(error);
@@ -263,8 +499,65 @@ export class OstrichStore {
             }),
             cardinality: totalCount,
             exactCardinality: hasExactCount,
+            truncated,
+          });
+        },
+        undefined,
+        cancellation,
+      );
+    });
+  }
+
+  /**
+   * Searches the document for triples with the given subject, predicate and object for a version query,
+   * and returns them as a packed batch.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public searchTriplesVersionBatch(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options?: { offset?: number; limit?: number } & IQueryCancellationOptions,
+  ): Promise<{
+    triples: TripleBatch<IQuadVersion>; cardinality: number; exactCardinality: boolean; truncated: boolean;
+  }> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to query a closed OSTRICH store'));
+      }
+      if (this.maxVersion < 0) {
+        return reject(new Error('Attempted to query an OSTRICH store without versions'));
+      }
+      const offset = options && options.offset ? Math.max(0, options.offset) : 0;
+      const limit = options && options.limit ? Math.max(0, options.limit) : 0;
+
+      const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
+      this._operations++;
+      this.native._searchTriplesVersionPacked(
+        serializeTerm(subject),
+        serializeTerm(predicate),
+        serializeTerm(object),
+        offset,
+        limit,
+        (error, batch, totalCount, hasExactCount, truncated) => {
+          this._operations--;
+          dispose();
+          this._finishOperation();
+          if (error) {
+            return reject(error);
+          }
+          resolve({
+            triples: new TripleBatch<IQuadVersion>(batch, this.dataFactory),
+            cardinality: totalCount,
+            exactCardinality: hasExactCount,
+            truncated,
           });
         },
+        undefined,
+        cancellation,
       );
     });
   }
@@ -302,25 +595,519 @@ export class OstrichStore {
   }
 
   /**
-   * Appends the given triples.
-   * @param triples The triples to append, annotated with addition: true or false as the given version.
-   * @param version The version to append at, defaults to the last version
+   * Searches the document for triples with the given subject, predicate, object and version
+   * for a version materialized query, and only returns their dictionary ids.
+   * Ids are grouped per three (subject, predicate, object) for each matching triple,
+   * and can be decoded using decodeTripleIds.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public searchTripleIdsVersionMaterialized(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options?: { offset?: number; limit?: number; version?: number } & IQueryCancellationOptions,
+  ): Promise<{ ids: Float64Array; cardinality: number; exactCardinality: boolean; truncated: boolean }> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to query a closed OSTRICH store'));
+      }
+      if (this.maxVersion < 0) {
+        return reject(new Error('Attempted to query an OSTRICH store without versions'));
+      }
+      const offset = options && options.offset ? Math.max(0, options.offset) : 0;
+      const limit = options && options.limit ? Math.max(0, options.limit) : 0;
+      const version = options && (options.version || options.version === 0) ? options.version : -1;
+      const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
+      this._operations++;
+      this.native._searchTripleIdsVersionMaterialized(
+        serializeTerm(subject),
+        serializeTerm(predicate),
+        serializeTerm(object),
+        offset,
+        limit,
+        version,
+        (error, ids, totalCount, hasExactCount, truncated) => {
+          this._operations--;
+          dispose();
+          this._finishOperation();
+          if (error) {
+            return reject(error);
+          }
+          resolve({
+            ids: tripleIdsFromBuffer(ids),
+            cardinality: totalCount,
+            exactCardinality: hasExactCount,
+            truncated,
+          });
+        },
+        undefined,
+        cancellation,
+      );
+    });
+  }
+
+  /**
+   * Decodes dictionary ids, as returned by searchTripleIdsVersionMaterialized, into triples.
+   * Decoded terms are cached by the store, so frequently occurring terms are only decoded once.
+   * Rejects if an id is not the id of a term in the given version.
+   * @param ids Subject, predicate and object ids for each triple.
+   * @param version The version the ids were obtained from.
    */
-  public append(triples: IQuadDelta[], version = -1): Promise<number> {
-    // Make sure our triples are sorted
-    triples = triples.sort((left, right) => {
-      const compS = strcmp(termToString(left.subject), termToString(right.subject));
-      if (compS === 0) {
-        const compP = strcmp(termToString(left.predicate), termToString(right.predicate));
-        if (compP === 0) {
-          return strcmp(termToString(left.object), termToString(right.object));
+  public decodeTripleIds(ids: Float64Array, version = -1): Promise<RDF.Quad[]> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to query a closed OSTRICH store'));
+      }
+      if (this.maxVersion < 0) {
+        return reject(new Error('Attempted to query an OSTRICH store without versions'));
+      }
+      this._operations++;
+      this.native._decodeTripleIds(
+        tripleIdsToBuffer(ids),
+        version,
+        (error, triples) => {
+          this._operations--;
+          this._finishOperation();
+          if (error) {
+            return reject(error);
+          }
+          resolve(triples.map(triple => stringQuadToQuad(triple)));
+        },
+      );
+    });
+  }
+
+  /**
+   * Executes the given search and count queries at once.
+   * All queries are handled by a single native worker, and their results are returned together,
+   * in the same order as the queries.
+   * Search results are returned as packed batches.
+   * @param queries The queries to execute.
+   * @param options Options, where parallelism is the maximum number of threads that execute queries (defaults to 1),
+   *                which are idle threads of the query pool.
+   *                A signal or timeout applies to the batch as a whole, and truncates the searches that have not finished.
+   */
+  public searchBatch(
+    queries: IBatchQuery[],
+    options?: { parallelism?: number } & IQueryCancellationOptions,
+  ): Promise<IBatchQueryResult[]> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to query a closed OSTRICH store'));
+      }
+      if (this.maxVersion < 0) {
+        return reject(new Error('Attempted to query an OSTRICH store without versions'));
+      }
+      const nativeQueries: IBatchQueryNative[] = [];
+      for (const query of queries) {
+        const versionStart = query.versionStart || 0;
+        const versionEnd = query.versionEnd || query.versionEnd === 0 ? query.versionEnd : -1;
+        if (query.type === BatchQueryType.SearchDeltaMaterialized ||
+          query.type === BatchQueryType.CountDeltaMaterialized) {
+          if (versionStart >= versionEnd) {
+            return reject(new Error(`'versionStart' must be strictly smaller than 'versionEnd'`));
+          }
+          if (versionEnd > this.maxVersion) {
+            return reject(new Error(`'versionEnd' can not be larger than the maximum version (${this.maxVersion})`));
+          }
         }
-        return compP;
+        nativeQueries.push({
+          type: query.type,
+          subject: serializeTerm(query.subject),
+          predicate: serializeTerm(query.predicate),
+          object: serializeTerm(query.object),
+          offset: query.offset ? Math.max(0, query.offset) : 0,
+          limit: query.limit ? Math.max(0, query.limit) : 0,
+          version: query.version || query.version === 0 ? query.version : -1,
+          versionStart,
+          versionEnd,
+        });
       }
-      return compS;
+      const parallelism = options && options.parallelism ? Math.max(1, options.parallelism) : 1;
+      const { cancellation, dispose } = createQueryCancellation(ostrichNative.QueryCancellation, options);
+
+      this._operations++;
+      this.native._searchBatch(nativeQueries, parallelism, (error, results) => {
+        this._operations--;
+        dispose();
+        this._finishOperation();
+        if (error) {
+          return reject(error);
+        }
+        resolve(results.map(result => ({
+          triples: result.batch ? new TripleBatch(result.batch, this.dataFactory) : undefined,
+          cardinality: result.totalCount,
+          exactCardinality: result.hasExactCount,
+          truncated: result.truncated,
+        })));
+      }, undefined, cancellation);
     });
+  }
+
+  /**
+   * Streams the triples with the given subject, predicate, object and version,
+   * by scanning consecutive partitions of the results in parallel on idle threads of the query pool.
+   * If ordered, triples are emitted in the same order as searchTriplesVersionMaterialized,
+   * and later partitions are buffered until the preceding ones are done.
+   * Otherwise, triples are emitted as soon as a partition produces them.
+   * Each partition pauses once queueSize of its chunks are buffered or have not been read from the stream,
+   * so at most partitions * queueSize * chunkSize triples are held in memory.
+   * Paused partitions do not hold up other queries or appends, and the stream fails if the store is closed.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options, where partitions is the number of partitions (defaults to the number of CPUs),
+   *                ordered indicates if the order of the results must be preserved (defaults to true),
+   *                chunkSize is the number of triples that are passed from a partition at once (defaults to 1024),
+   *                and queueSize is the number of chunks per partition that can be pending (defaults to 4).
+   */
+  public streamTriplesVersionMaterializedPartitioned(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options?: { version?: number; partitions?: number; ordered?: boolean; chunkSize?: number; queueSize?: number },
+  ): Readable {
+    let credits: IPartitionCredits | undefined;
+    // The partitions of chunks that were pushed while the stream was full, which are released once it is read again
+    const unreleased: number[] = [];
+    const stream = new Readable({
+      objectMode: true,
+      read() {
+        if (credits) {
+          for (const partition of unreleased.splice(0)) {
+            credits._release(partition);
+          }
+        }
+      },
+      destroy(error, callback) {
+        // Stop the partitions that are waiting for their chunks to be read
+        if (credits) {
+          credits._cancel();
+        }
+        callback(error);
+      },
+    });
+    const validationError = this._validateQuery();
+    if (validationError) {
+      stream.destroy(validationError);
+      return stream;
+    }
+    const version = options && (options.version || options.version === 0) ? options.version : -1;
+    const partitions = options && options.partitions ? Math.max(1, options.partitions) : os.cpus().length;
+    const ordered = !options || options.ordered !== false;
+    const chunkSize = options && options.chunkSize ? Math.max(1, options.chunkSize) : 1024;
+    const queueSize = options && options.queueSize ? Math.max(1, options.queueSize) : 4;
+
+    // The chunks of partitions after the current one are buffered if the order must be preserved
+    const buffered: TripleBatch[][] = [];
+    const done: boolean[] = [];
+    for (let partition = 0; partition < partitions; partition++) {
+      buffered.push([]);
+      done.push(false);
+    }
+    let current = 0;
+    const pushBatch = (partition: number, batch: TripleBatch): void => {
+      let reading = true;
+      for (const triple of batch) {
+        reading = stream.push(triple);
+      }
+      if (reading) {
+        credits!._release(partition);
+      } else {
+        unreleased.push(partition);
+      }
+    };
+
+    this._operations++;
+    credits = this.native._searchTriplesVersionMaterializedPartitioned(
+      serializeTerm(subject),
+      serializeTerm(predicate),
+      serializeTerm(object),
+      version,
+      partitions,
+      chunkSize,
+      queueSize,
+      (partition, buffer, partitionDone) => {
+        if (stream.destroyed) {
+          return;
+        }
+        const batch = buffer ? new TripleBatch(buffer, this.dataFactory) : undefined;
+        if (!ordered) {
+          if (batch) {
+            pushBatch(partition, batch);
+          }
+          return;
+        }
+        if (batch) {
+          buffered[partition].push(batch);
+        }
+        done[partition] = partitionDone;
+        while (current < partitions) {
+          for (const pending of buffered[current]) {
+            pushBatch(current, pending);
+          }
+          buffered[current] = [];
+          if (!done[current]) {
+            break;
+          }
+          current++;
+        }
+      },
+      error => {
+        this._operations--;
+        this._finishOperation();
+        if (error) {
+          stream.destroy(error);
+          return;
+        }
+        stream.push(null);
+      },
+    );
+    return stream;
+  }
+
+  /**
+   * Writes the triples with the given subject, predicate, object and version as N-Triples
+   * to a file or file descriptor.
+   * Triples are serialized natively, outside of the main thread, without creating any JavaScript objects.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param destination A file path, which will be overwritten, or an open file descriptor, which will not be closed.
+   * @param options Options
+   * @return The number of written triples.
+   */
+  public exportTriplesVersionMaterialized(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    destination: string | number,
+    options?: { offset?: number; limit?: number; version?: number },
+  ): Promise<number> {
+    const error = this._validateQuery();
+    if (error) {
+      return Promise.reject(error);
+    }
+    return this._exportInternal(destination, (fd, chunkCb, cb) => this.native._exportTriplesVersionMaterialized(
+      serializeTerm(subject),
+      serializeTerm(predicate),
+      serializeTerm(object),
+      options && options.offset ? Math.max(0, options.offset) : 0,
+      options && options.limit ? Math.max(0, options.limit) : 0,
+      options && (options.version || options.version === 0) ? options.version : -1,
+      fd,
+      chunkCb,
+      cb,
+    ));
+  }
+
+  /**
+   * Writes the triple differences with the given subject, predicate, object, versionStart and versionEnd
+   * to a file or file descriptor.
+   * Each difference is written as an N-Triples line, prefixed with '+ ' for additions and '- ' for deletions.
+   * Triples are serialized natively, outside of the main thread, without creating any JavaScript objects.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param destination A file path, which will be overwritten, or an open file descriptor, which will not be closed.
+   * @param options Options
+   * @return The number of written triple differences.
+   */
+  public exportTriplesDeltaMaterialized(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    destination: string | number,
+    options: { offset?: number; limit?: number; versionStart: number; versionEnd: number },
+  ): Promise<number> {
+    const error = this._validateQuery(options);
+    if (error) {
+      return Promise.reject(error);
+    }
+    return this._exportInternal(destination, (fd, chunkCb, cb) => this.native._exportTriplesDeltaMaterialized(
+      serializeTerm(subject),
+      serializeTerm(predicate),
+      serializeTerm(object),
+      options.offset ? Math.max(0, options.offset) : 0,
+      options.limit ? Math.max(0, options.limit) : 0,
+      options.versionStart,
+      options.versionEnd,
+      fd,
+      chunkCb,
+      cb,
+    ));
+  }
 
-    return this.appendSorted(triples, version);
+  /**
+   * Serializes the triples with the given subject, predicate, object and version as N-Triples
+   * into a stream of buffers.
+   * The export pauses once 4 chunks of 1MB have not been read from the stream,
+   * and the stream fails if the store is closed before it has been read.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public exportTriplesVersionMaterializedStream(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options?: { offset?: number; limit?: number; version?: number },
+  ): Readable {
+    return this._exportStreamInternal(this._validateQuery(), (fd, chunkCb, cb) =>
+      this.native._exportTriplesVersionMaterialized(
+        serializeTerm(subject),
+        serializeTerm(predicate),
+        serializeTerm(object),
+        options && options.offset ? Math.max(0, options.offset) : 0,
+        options && options.limit ? Math.max(0, options.limit) : 0,
+        options && (options.version || options.version === 0) ? options.version : -1,
+        fd,
+        chunkCb,
+        cb,
+      ));
+  }
+
+  /**
+   * Serializes the triple differences with the given subject, predicate, object, versionStart and versionEnd
+   * into a stream of buffers, in the same format as exportTriplesDeltaMaterialized.
+   * The export pauses like exportTriplesVersionMaterializedStream does when the stream is not read.
+   * @param subject An RDF term.
+   * @param predicate An RDF term.
+   * @param object An RDF term.
+   * @param options Options
+   */
+  public exportTriplesDeltaMaterializedStream(
+    subject: RDF.Term | undefined | null,
+    predicate: RDF.Term | undefined | null,
+    object: RDF.Term | undefined | null,
+    options: { offset?: number; limit?: number; versionStart: number; versionEnd: number },
+  ): Readable {
+    return this._exportStreamInternal(this._validateQuery(options), (fd, chunkCb, cb) =>
+      this.native._exportTriplesDeltaMaterialized(
+        serializeTerm(subject),
+        serializeTerm(predicate),
+        serializeTerm(object),
+        options.offset ? Math.max(0, options.offset) : 0,
+        options.limit ? Math.max(0, options.limit) : 0,
+        options.versionStart,
+        options.versionEnd,
+        fd,
+        chunkCb,
+        cb,
+      ));
+  }
+
+  protected _validateQuery(delta?: { versionStart: number; versionEnd: number }): Error | undefined {
+    if (this.closed) {
+      return new Error('Attempted to query a closed OSTRICH store');
+    }
+    if (this.maxVersion < 0) {
+      return new Error('Attempted to query an OSTRICH store without versions');
+    }
+    if (delta) {
+      if (delta.versionStart >= delta.versionEnd) {
+        return new Error(`'versionStart' must be strictly smaller than 'versionEnd'`);
+      }
+      if (delta.versionEnd > this.maxVersion) {
+        return new Error(`'versionEnd' can not be larger than the maximum version (${this.maxVersion})`);
+      }
+    }
+  }
+
+  protected _exportInternal(
+    destination: string | number,
+    exportNative: ExportNative,
+  ): Promise<number> {
+    return new Promise((resolve, reject) => {
+      let fd: number;
+      try {
+        fd = typeof destination === 'number' ? destination : fs.openSync(destination, 'w');
+      } catch (error: unknown) {
+        return reject(error);
+      }
+
+      this._operations++;
+      exportNative(fd, undefined, (error, count) => {
+        this._operations--;
+        this._finishOperation();
+        if (typeof destination !== 'number') {
+          try {
+            fs.closeSync(fd);
+          } catch (closeError: unknown) {
+            error = error || <Error> closeError;
+          }
+        }
+        if (error) {
+          return reject(error);
+        }
+        resolve(count);
+      });
+    });
+  }
+
+  protected _exportStreamInternal(validationError: Error | undefined, exportNative: ExportNative): Readable {
+    // Data is pushed by the native worker, which pauses once the chunks that were not read run out of credits
+    let credits: IPartitionCredits | undefined;
+    let unreleased = 0;
+    const stream = new Readable({
+      read() {
+        if (credits) {
+          for (; unreleased > 0; unreleased--) {
+            credits._release(0);
+          }
+        }
+      },
+      destroy(error, callback) {
+        if (credits) {
+          credits._cancel();
+        }
+        callback(error);
+      },
+    });
+    if (validationError) {
+      stream.destroy(validationError);
+      return stream;
+    }
+
+    this._operations++;
+    credits = exportNative(-1, chunk => {
+      if (stream.destroyed) {
+        return;
+      }
+      if (stream.push(chunk)) {
+        credits!._release(0);
+      } else {
+        unreleased++;
+      }
+    }, error => {
+      this._operations--;
+      this._finishOperation();
+      if (error) {
+        stream.destroy(error);
+        return;
+      }
+      stream.push(null);
+    });
+    return stream;
+  }
+
+  /**
+   * Appends the given triples.
+   * Triples are sorted natively, outside of the main thread,
+   * and are spilled to temporary files in the store directory if they exceed the sort memory.
+   * @param triples The triples to append, annotated with addition: true or false as the given version.
+   * @param version The version to append at, defaults to the last version
+   * @param options Options, where sortMemory is the maximum number of bytes of triples that are sorted in memory
+   *                (defaults to 256MB).
+   */
+  public append(triples: IQuadDelta[], version = -1, options?: { sortMemory?: number }): Promise<number> {
+    const sortMemory = options && options.sortMemory ? Math.max(1, options.sortMemory) : DEFAULT_SORT_MEMORY;
+    return this._appendInternal(triples, version, (version, stringTriples, callback) =>
+      this.native._appendUnsorted(version, stringTriples, sortMemory, callback));
   }
 
   /**
@@ -330,6 +1117,19 @@ export class OstrichStore {
    * @param version The version to append at, defaults to the last version
    */
   public appendSorted(triples: IQuadDelta[], version = -1): Promise<number> {
+    return this._appendInternal(triples, version, (version, stringTriples, callback) =>
+      this.native._append(version, stringTriples, callback));
+  }
+
+  protected _appendInternal(
+    triples: IQuadDelta[],
+    version: number,
+    appendNative: (
+      version: number,
+      triples: IStringQuadDelta[],
+      callback: (error: Error | undefined, insertedCount: number) => void,
+    ) => void,
+  ): Promise<number> {
     return new Promise((resolve, reject) => {
       if (this.closed) {
         return reject(new Error('Attempted to append to a closed OSTRICH store'));
@@ -342,7 +1142,7 @@ export class OstrichStore {
       if (version === -1) {
         version = this.maxVersion + 1;
       }
-      this.native._append(
+      appendNative(
         version,
         triples.map(triple => ({ addition: triple.addition, ...quadToStringQuad(triple) })),
         (error, insertedCount) => {
@@ -357,6 +1157,138 @@ export class OstrichStore {
     });
   }
 
+  /**
+   * Appends triples that are written to the returned stream.
+   * Triples must be written in SPO-order, as for appendSorted,
+   * and are passed to OSTRICH in chunks while the append is running,
+   * so that the full version never has to be in memory at once.
+   * The number of inserted triples is available in insertedCount once the stream has emitted 'finish'.
+   * @param version The version to append at, defaults to the last version
+   * @param options Options, where chunkSize is the number of triples per chunk (defaults to 10000),
+   *                queueSize the maximum number of chunks that are waiting to be appended (defaults to 4),
+   *                and sort indicates that triples may be written in any order, in which case they are sorted natively
+   *                using at most sortMemory bytes of memory (defaults to 256MB) before being appended.
+   */
+  public appendStream(
+    version = -1,
+    options?: { chunkSize?: number; queueSize?: number; sort?: boolean; sortMemory?: number },
+  ): AppendStream {
+    if (this.closed) {
+      throw new Error('Attempted to append to a closed OSTRICH store');
+    }
+    if (this.readOnly) {
+      throw new Error('Attempted to append to an OSTRICH store in read-only mode');
+    }
+    const chunkSize = options && options.chunkSize ? Math.max(1, options.chunkSize) : 10000;
+    const queueSize = options && options.queueSize ? Math.max(1, options.queueSize) : 4;
+    let sortMemory = 0;
+    if (options && options.sort) {
+      sortMemory = options.sortMemory ? Math.max(1, options.sortMemory) : DEFAULT_SORT_MEMORY;
+    }
+
+    this._operations++;
+    return new AppendStream(onAppended => this.native._appendStream(version, queueSize, sortMemory, (error, insertedCount) => {
+      this._operations--;
+      this._finishOperation();
+      onAppended(error, insertedCount);
+    }), chunkSize);
+  }
+
+  /**
+   * Appends a new version that contains exactly the given triples.
+   * The changes with respect to the latest version are computed natively, outside of the main thread,
+   * by sorting both versions and merging them,
+   * where sorted runs are spilled to temporary files in the store directory if they exceed the sort memory.
+   * @param triples The triples of the new version, in any order.
+   * @param options Options, where sortMemory is the maximum number of bytes of triples that are sorted in memory
+   *                per version (defaults to 256MB).
+   * @return The number of appended changes, or the number of triples if the store was empty.
+   */
+  public appendFullVersion(triples: RDF.Quad[], options?: { sortMemory?: number }): Promise<number> {
+    const sortMemory = options && options.sortMemory ? Math.max(1, options.sortMemory) : DEFAULT_SORT_MEMORY;
+    return this._appendFullVersionInternal(callback => this.native._appendFullVersion(
+      triples.map(triple => ({ addition: true, ...quadToStringQuad(triple) })),
+      sortMemory,
+      callback,
+    ));
+  }
+
+  /**
+   * Appends a new version that contains exactly the triples in the given N-Triples or N-Quads file.
+   * The file is read natively, and the changes are computed in the same way as for appendFullVersion.
+   * @param path The path of the file.
+   * @param options Options, where sortMemory is the maximum number of bytes of triples that are sorted in memory
+   *                per version (defaults to 256MB).
+   * @return The number of appended changes, or the number of triples if the store was empty.
+   */
+  public appendFromFile(path: string, options?: { sortMemory?: number }): Promise<number> {
+    const sortMemory = options && options.sortMemory ? Math.max(1, options.sortMemory) : DEFAULT_SORT_MEMORY;
+    return this._appendFullVersionInternal(callback => this.native._appendFromFile(path, sortMemory, callback));
+  }
+
+  protected _appendFullVersionInternal(
+    appendNative: (callback: (error: Error | undefined, insertedCount: number) => void) => void,
+  ): Promise<number> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to append to a closed OSTRICH store'));
+      }
+      if (this.readOnly) {
+        return reject(new Error('Attempted to append to an OSTRICH store in read-only mode'));
+      }
+
+      this._operations++;
+      appendNative((error, insertedCount) => {
+        this._operations--;
+        this._finishOperation();
+        if (error) {
+          return reject(error);
+        }
+        resolve(insertedCount);
+      });
+    });
+  }
+
+  /**
+   * Ingests N-Triples or N-Quads files as consecutive versions after the latest version.
+   * Each file contains the full contents of its version.
+   * Files are parsed natively on multiple threads, where the next file is parsed while the previous one is appended,
+   * and only the changes with respect to the previous version are appended.
+   * Each version is sorted natively, and spilled to temporary files in the store directory if it exceeds the sort memory.
+   * @param paths The paths of the files, in the order of their versions.
+   * @param options Options, where threads is the number of threads that parse a single file
+   *                (defaults to the number of CPUs),
+   *                sortMemory is the maximum number of bytes of triples of a version that are sorted in memory
+   *                (defaults to 256MB),
+   *                and onProgress is invoked with the statistics of each version once it has been ingested.
+   * @return The number of ingested versions.
+   */
+  public ingest(
+    paths: string[],
+    options?: { threads?: number; sortMemory?: number; onProgress?: (progress: IIngestProgress) => void },
+  ): Promise<number> {
+    return new Promise((resolve, reject) => {
+      if (this.closed) {
+        return reject(new Error('Attempted to ingest into a closed OSTRICH store'));
+      }
+      if (this.readOnly) {
+        return reject(new Error('Attempted to ingest into an OSTRICH store in read-only mode'));
+      }
+      const threads = options && options.threads ? Math.max(1, options.threads) : os.cpus().length;
+      const sortMemory = options && options.sortMemory ? Math.max(1, options.sortMemory) : DEFAULT_SORT_MEMORY;
+
+      this._operations++;
+      this.native._ingest(paths, threads, sortMemory, options && options.onProgress, (error, versionCount) => {
+        this._operations--;
+        this._finishOperation();
+        if (error) {
+          return reject(error);
+        }
+        resolve(versionCount);
+      });
+    });
+  }
+
   protected _finishOperation(): void {
     // Call the operations-callbacks if no operations are going on anymore.
     if (!this._operations) {
@@ -385,6 +1317,8 @@ export class OstrichStore {
       return;
     }
     this._isClosingCallbacks = [ callbackSafe ];
+    // Partitioned scans only finish once they are read, so they are cancelled instead of waited for
+    this.native._cancelScans();
     // If no appends are being done, close immediately,
     // otherwise wait for appends to finish.
     if (!this._operations) {
@@ -411,16 +1345,20 @@ export class OstrichStore {
 /**
  * Creates an Ostrich store for the given path.
  * @param path Path to an OSTRICH store.
- * @param options Options for opening the store.
+ * @param options Options for opening the store, and for its query thread pool.
  */
 export function fromPath(
   path: string,
   options?: {
     readOnly?: boolean;
+    shared?: boolean;
     strategyName?: string;
     strategyParameter?: string;
     dataFactory?: RDF.DataFactory;
-  },
+    termCacheSize?: number;
+    resultCacheSize?: number;
+    checkpointCount?: number;
+  } & IQueryPoolOptions,
 ): Promise<OstrichStore> {
   return new Promise((resolve, reject) => {
     if (typeof path !== 'string' || path.length === 0) {
@@ -434,6 +1372,13 @@ export function fromPath(
       options = {};
     }
 
+    if (options.shared) {
+      if (options.readOnly === false) {
+        return reject(new Error('A shared OSTRICH store can only be opened in read-only mode'));
+      }
+      options = { ...options, readOnly: true };
+    }
+
     if (typeof options.strategyName !== 'string') {
       options.strategyName = 'never';
       options.strategyParameter = '0';
@@ -455,6 +1400,15 @@ export function fromPath(
       options.readOnly,
       options.strategyName,
       options.strategyParameter,
+      {
+        termCacheSize: options.termCacheSize,
+        shared: Boolean(options.shared),
+        resultCacheSize: options.resultCacheSize,
+        checkpointCount: options.checkpointCount,
+        queryThreads: options.queryThreads,
+        queryQueueDepth: options.queryQueueDepth,
+        queryPriorities: options.queryPriorities,
+      },
       (error: Error, native: IOstrichStoreNative) => {
         // Abort the creation if any error occurred
         if (error) {
@@ -473,6 +1427,7 @@ export function fromPath(
             countTriplesVersion: true,
             appendVersionedTriples: !options!.readOnly,
           }),
+          options!.resultCacheSize || 0,
         );
         resolve(document);
       },
@@ -0,0 +1,89 @@
+#include "PartitionCredits.h"
+
+#include <algorithm>
+
+PartitionCredits::PartitionCredits(uint32_t partitions, uint32_t capacity)
+        : capacity(std::max(capacity, (uint32_t) 1)), in_flight(partitions, 0), cancelled(false) {}
+
+bool PartitionCredits::try_acquire(uint32_t partition) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cancelled || in_flight[partition] >= capacity) {
+        return false;
+    }
+    in_flight[partition]++;
+    return true;
+}
+
+bool PartitionCredits::wait(const std::vector<uint32_t> &partitions) {
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [this, &partitions]() {
+        return cancelled || std::any_of(partitions.begin(), partitions.end(),
+                                        [this](uint32_t partition) { return in_flight[partition] < capacity; });
+    });
+    return !cancelled;
+}
+
+void PartitionCredits::release(uint32_t partition) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (partition >= in_flight.size() || in_flight[partition] == 0) {
+            return;
+        }
+        in_flight[partition]--;
+    }
+    available.notify_all();
+}
+
+void PartitionCredits::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    available.notify_all();
+}
+
+bool PartitionCredits::is_cancelled() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cancelled;
+}
+
+Nan::Persistent<v8::Function> PartitionCreditsHandle::constructor;
+
+PartitionCreditsHandle::PartitionCreditsHandle(std::shared_ptr<PartitionCredits> credits, const v8::Local<v8::Object> &handle)
+        : credits(std::move(credits)) {
+    this->Wrap(handle);
+}
+
+PartitionCreditsHandle::~PartitionCreditsHandle() {
+    credits->cancel();
+}
+
+NAN_METHOD(PartitionCreditsHandle::New) {
+    assert(info.IsConstructCall());
+    info.GetReturnValue().Set(info.This());
+}
+
+const Nan::Persistent<v8::Function> &PartitionCreditsHandle::GetConstructor() {
+    if (constructor.IsEmpty()) {
+        // Create constructor template
+        v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+        tpl->SetClassName(Nan::New("PartitionCredits").ToLocalChecked());
+        tpl->InstanceTemplate()->SetInternalFieldCount(1);
+        // Create prototype
+        Nan::SetPrototypeMethod(tpl, "_release", Release);
+        Nan::SetPrototypeMethod(tpl, "_cancel", Cancel);
+        // Set constructor
+        constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
+    }
+    return constructor;
+}
+
+// JavaScript signature: PartitionCredits#_release(partition)
+NAN_METHOD(PartitionCreditsHandle::Release) {
+    Unwrap<PartitionCreditsHandle>(info.This())->credits->release(info[0]->Uint32Value(Nan::GetCurrentContext()).FromJust());
+}
+
+// JavaScript signature: PartitionCredits#_cancel()
+NAN_METHOD(PartitionCreditsHandle::Cancel) {
+    Unwrap<PartitionCreditsHandle>(info.This())->credits->cancel();
+}
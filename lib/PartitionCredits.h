@@ -0,0 +1,61 @@
+#ifndef OSTRICH_PARTITIONCREDITS_H
+#define OSTRICH_PARTITIONCREDITS_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <nan.h>
+
+// The default number of chunks per partition that can be sent to JavaScript before they are consumed
+const uint32_t PARTITION_CREDITS_DEFAULT_CAPACITY = 4;
+
+// Bounds the number of chunks of each partition of a scan that have been sent but not consumed yet,
+// so that partitions are only scanned as fast as their results are read.
+// Partitions never wait for a credit themselves, so that a scan that is not read does not occupy any threads that scan;
+// instead, a single thread waits until one of the partitions that ran out of credits may continue.
+class PartitionCredits {
+public:
+    PartitionCredits(uint32_t partitions, uint32_t capacity);
+
+    // Takes a credit if the partition may send another chunk, returns false otherwise or if the scan was cancelled
+    bool try_acquire(uint32_t partition);
+    // Waits until one of the given partitions may send another chunk, returns false if the scan was cancelled
+    bool wait(const std::vector<uint32_t> &partitions);
+    // Indicates that a chunk of the partition has been consumed
+    void release(uint32_t partition);
+    // Makes all pending and future acquisitions fail, e.g. because the results are no longer read
+    void cancel();
+    [[nodiscard]] bool is_cancelled();
+
+private:
+    const uint32_t capacity;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::vector<uint32_t> in_flight;
+    bool cancelled;
+};
+
+// The JavaScript handle of the credits of a partitioned scan, which is returned when the scan is started
+class PartitionCreditsHandle : public Nan::ObjectWrap {
+public:
+    PartitionCreditsHandle(std::shared_ptr<PartitionCredits> credits, const v8::Local<v8::Object> &handle);
+
+    static const Nan::Persistent<v8::Function> &GetConstructor();
+
+private:
+    std::shared_ptr<PartitionCredits> credits;
+
+    // A scan of which the handle is no longer reachable can never be read again
+    ~PartitionCreditsHandle() override;
+
+    static NAN_METHOD(New);
+    // PartitionCredits#_release(partition)
+    static NAN_METHOD(Release);
+    // PartitionCredits#_cancel()
+    static NAN_METHOD(Cancel);
+
+    static Nan::Persistent<v8::Function> constructor;
+};
+
+#endif //OSTRICH_PARTITIONCREDITS_H
@@ -0,0 +1,69 @@
+#include "PatchElementStream.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+PatchElementStream::PatchElementStream(size_t queue_size)
+        : queue_size(std::max(queue_size, (size_t) 1)), ended(false), current_index(0) {}
+
+bool PatchElementStream::try_push(std::vector<AppendTriple> &chunk) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!abort_reason.empty()) {
+        throw std::runtime_error(abort_reason);
+    }
+    if (ended) {
+        throw std::runtime_error("Attempted to push to an append stream that has ended");
+    }
+    if (chunks.size() >= queue_size) {
+        return false;
+    }
+    chunks.push_back(std::move(chunk));
+    not_empty.notify_one();
+    return true;
+}
+
+void PatchElementStream::set_listener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->listener = std::move(listener);
+}
+
+void PatchElementStream::end() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ended = true;
+    not_empty.notify_all();
+}
+
+void PatchElementStream::abort(const std::string &reason) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ended) {
+        return;
+    }
+    if (abort_reason.empty()) {
+        abort_reason = reason;
+    }
+    not_empty.notify_all();
+    if (listener) {
+        listener();
+    }
+}
+
+bool PatchElementStream::next_triple(AppendTriple *triple) {
+    while (current_index >= current.size()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return !chunks.empty() || ended || !abort_reason.empty(); });
+        if (!abort_reason.empty()) {
+            throw std::runtime_error(abort_reason);
+        }
+        if (chunks.empty()) {
+            return false;
+        }
+        current = std::move(chunks.front());
+        chunks.pop_front();
+        current_index = 0;
+        if (listener) {
+            listener();
+        }
+    }
+    *triple = std::move(current[current_index++]);
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef OSTRICH_PATCHELEMENTSTREAM_H
+#define OSTRICH_PATCHELEMENTSTREAM_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AppendTriple.h"
+
+// The default maximum number of chunks that can be queued in a patch element stream
+const size_t PATCH_ELEMENT_STREAM_DEFAULT_QUEUE_SIZE = 4;
+
+// A bounded queue of triple chunks, which is filled by a producer and consumed by an append.
+// Pushing never blocks, so that it can be done from the loop thread, but fails while the queue is full,
+// and the producer is notified through a listener once a chunk has been consumed.
+// Consuming blocks until a chunk is available or the stream has ended, so that only a few chunks are in memory at any time.
+// Triples are only encoded into patch elements by the consumer, once they have been sorted.
+class PatchElementStream {
+public:
+    explicit PatchElementStream(size_t queue_size);
+
+    // Adds a chunk of triples, which is moved from if it was added, and returns false if the queue is full.
+    // Throws if the stream was ended or aborted.
+    bool try_push(std::vector<AppendTriple> &chunk);
+    // Sets the listener that is invoked once a chunk has been consumed or the stream has been aborted,
+    // after which a push may succeed or fail. The listener is invoked while the stream is locked,
+    // on the thread of the consumer, so it must only signal the producer.
+    void set_listener(std::function<void()> listener);
+    // Indicates that no more chunks will be pushed
+    void end();
+    // Makes all pending and future pushes and reads fail, unless the stream has already ended
+    void abort(const std::string &reason);
+
+    // Reads the next triple, returns false if the stream has ended
+    bool next_triple(AppendTriple *triple);
+
+private:
+    const size_t queue_size;
+
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::function<void()> listener;
+    std::deque<std::vector<AppendTriple>> chunks;
+    bool ended;
+    std::string abort_reason;
+
+    // The chunk that is being consumed, only accessed by the consumer
+    std::vector<AppendTriple> current;
+    size_t current_index;
+};
+
+#endif //OSTRICH_PATCHELEMENTSTREAM_H
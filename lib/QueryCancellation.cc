@@ -0,0 +1,53 @@
+#include "QueryCancellation.h"
+
+QueryCancellation::QueryCancellation(uint32_t timeout)
+        : cancelled(false), has_deadline(timeout > 0),
+          deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout)) {}
+
+bool QueryCancellation::is_stopped() {
+    if (cancelled.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (has_deadline && std::chrono::steady_clock::now() >= deadline) {
+        cancel();
+        return true;
+    }
+    return false;
+}
+
+Nan::Persistent<v8::FunctionTemplate> QueryCancellationHandle::constructorTemplate;
+Nan::Persistent<v8::Function> QueryCancellationHandle::constructor;
+
+NAN_METHOD(QueryCancellationHandle::New) {
+    assert(info.IsConstructCall());
+    uint32_t timeout = info[0]->IsNumber() ? info[0]->Uint32Value(Nan::GetCurrentContext()).FromJust() : 0;
+    auto *handle = new QueryCancellationHandle(timeout);
+    handle->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(QueryCancellationHandle::Cancel) {
+    Unwrap<QueryCancellationHandle>(info.This())->cancellation->cancel();
+}
+
+const Nan::Persistent<v8::Function> &QueryCancellationHandle::GetConstructor() {
+    if (constructor.IsEmpty()) {
+        // Create constructor template
+        v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+        tpl->SetClassName(Nan::New("QueryCancellation").ToLocalChecked());
+        tpl->InstanceTemplate()->SetInternalFieldCount(1);
+        // Create prototype
+        Nan::SetPrototypeMethod(tpl, "_cancel", Cancel);
+        // Set constructor
+        constructorTemplate.Reset(tpl);
+        constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
+    }
+    return constructor;
+}
+
+std::shared_ptr<QueryCancellation> QueryCancellationHandle::FromValue(const v8::Local<v8::Value> &value) {
+    if (constructorTemplate.IsEmpty() || !value->IsObject() || !Nan::New(constructorTemplate)->HasInstance(value)) {
+        return nullptr;
+    }
+    return Unwrap<QueryCancellationHandle>(value.As<v8::Object>())->cancellation;
+}
@@ -0,0 +1,72 @@
+#ifndef OSTRICH_QUERYCANCELLATION_H
+#define OSTRICH_QUERYCANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <nan.h>
+
+// The number of checks after which a QueryStopCheck reads the cancellation again
+const uint32_t QUERY_STOP_CHECK_INTERVAL = 256;
+
+// Tells the workers of a query to stop, either because it was cancelled or because its deadline has passed.
+// Workers check this cooperatively in between results, and return the results they had so far.
+class QueryCancellation {
+public:
+    // A timeout of 0 milliseconds means that the query has no deadline
+    explicit QueryCancellation(uint32_t timeout);
+
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    // Checks if the query was cancelled or has passed its deadline
+    bool is_stopped();
+
+private:
+    std::atomic<bool> cancelled;
+    bool has_deadline;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// Checks an optional cancellation from a single worker,
+// where the cancellation is read at the first check, and then once every QUERY_STOP_CHECK_INTERVAL checks.
+class QueryStopCheck {
+public:
+    explicit QueryStopCheck(std::shared_ptr<QueryCancellation> cancellation) : cancellation(std::move(cancellation)) {}
+
+    // Returns true once the query must stop
+    bool operator()() {
+        if (!stopped && cancellation != nullptr && checks++ % QUERY_STOP_CHECK_INTERVAL == 0) {
+            stopped = cancellation->is_stopped();
+        }
+        return stopped;
+    }
+
+    [[nodiscard]] bool is_stopped() const { return stopped; }
+
+private:
+    std::shared_ptr<QueryCancellation> cancellation;
+    uint32_t checks{0};
+    bool stopped{false};
+};
+
+// The JavaScript handle of a QueryCancellation, which is passed along with queries.
+// JavaScript signature: new QueryCancellation(timeout)
+class QueryCancellationHandle : public Nan::ObjectWrap {
+public:
+    static const Nan::Persistent<v8::Function> &GetConstructor();
+    // Returns the cancellation of the given handle, or nullptr if the value is not a handle
+    static std::shared_ptr<QueryCancellation> FromValue(const v8::Local<v8::Value> &value);
+
+private:
+    std::shared_ptr<QueryCancellation> cancellation;
+
+    explicit QueryCancellationHandle(uint32_t timeout) : cancellation(std::make_shared<QueryCancellation>(timeout)) {}
+
+    static NAN_METHOD(New);
+    // QueryCancellation#_cancel()
+    static NAN_METHOD(Cancel);
+
+    static Nan::Persistent<v8::FunctionTemplate> constructorTemplate;
+    static Nan::Persistent<v8::Function> constructor;
+};
+
+#endif //OSTRICH_QUERYCANCELLATION_H
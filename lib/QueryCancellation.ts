@@ -0,0 +1,55 @@
+/**
+ * Options for stopping a query before all of its results have been found.
+ * A stopped query is not rejected, but returns the results it found so far, flagged as truncated.
+ */
+export interface IQueryCancellationOptions {
+  /**
+   * A signal that stops the query once it is aborted.
+   */
+  signal?: AbortSignal;
+  /**
+   * The number of milliseconds after which the query stops.
+   */
+  timeout?: number;
+}
+
+/**
+ * A native cancellation handle that corresponds to QueryCancellationHandle in QueryCancellation.h
+ */
+export interface IQueryCancellationNative {
+  _cancel: () => void;
+}
+
+/**
+ * The constructor of native cancellation handles, of which the timeout 0 means that there is no deadline.
+ */
+export type QueryCancellationNativeConstructor = new(timeout: number) => IQueryCancellationNative;
+
+/**
+ * Create a native cancellation handle for the given options.
+ * The handle is undefined if the options can not stop the query.
+ * Dispose must be called once the query has finished, so that the abort listener is removed.
+ * @param QueryCancellation The native constructor.
+ * @param options Cancellation options.
+ */
+export function createQueryCancellation(
+  QueryCancellation: QueryCancellationNativeConstructor,
+  options?: IQueryCancellationOptions,
+): { cancellation?: IQueryCancellationNative; dispose: () => void } {
+  const signal = options && options.signal;
+  const timeout = options && options.timeout ? Math.max(1, Math.ceil(options.timeout)) : 0;
+  if (!signal && !timeout) {
+    return { cancellation: undefined, dispose: () => undefined };
+  }
+  const cancellation = new QueryCancellation(timeout);
+  if (!signal) {
+    return { cancellation, dispose: () => undefined };
+  }
+  if (signal.aborted) {
+    cancellation._cancel();
+    return { cancellation, dispose: () => undefined };
+  }
+  const onAbort = (): void => cancellation._cancel();
+  signal.addEventListener('abort', onAbort);
+  return { cancellation, dispose: () => signal.removeEventListener('abort', onAbort) };
+}
@@ -0,0 +1,151 @@
+#include "QueryPool.h"
+
+#include <algorithm>
+#include <memory>
+
+QueryPool::QueryPool(uv_loop_t *loop, const QueryPoolOptions &options)
+        : queue_depth(options.queue_depth), priorities(options.priorities), queued(0), stopping(false), async(new uv_async_t),
+          pending(0) {
+    async->data = this;
+    uv_async_init(loop, async, [](uv_async_t *handle) {
+        static_cast<QueryPool *>(handle->data)->complete();
+    });
+    // Idle pools must not keep the process alive, so the handle is only referenced while queries are pending
+    uv_unref((uv_handle_t *) async);
+    for (size_t i = 0; i < options.threads; i++) {
+        threads.emplace_back(&QueryPool::run, this);
+    }
+}
+
+QueryPool::~QueryPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    // Complete the workers of which the completion has not been handled yet
+    complete();
+    uv_close((uv_handle_t *) async, [](uv_handle_t *handle) {
+        delete (uv_async_t *) handle;
+    });
+}
+
+bool QueryPool::queue(Nan::AsyncWorker *worker, QueryType type) {
+    if (threads.empty()) {
+        Nan::AsyncQueueWorker(worker);
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue_depth > 0 && queued >= queue_depth) {
+            return false;
+        }
+        queues[priorities[type]].push_back(worker);
+        queued++;
+    }
+    if (pending++ == 0) {
+        uv_ref((uv_handle_t *) async);
+    }
+    available.notify_one();
+    return true;
+}
+
+size_t QueryPool::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queued;
+}
+
+// The state of the parallel work of a single query
+struct ParallelWork {
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t running{0};
+    bool closed{false};
+};
+
+void QueryPool::run_parallel(size_t parallelism, const std::function<void()> &work) {
+    size_t helper_count = std::min(std::max(parallelism, (size_t) 1), threads.size() + 1) - 1;
+    auto state = std::make_shared<ParallelWork>();
+    if (helper_count > 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < helper_count; i++) {
+                // The work is only referenced while the calling thread waits for the helpers that have started
+                helpers.emplace_back([state, &work]() {
+                    {
+                        std::lock_guard<std::mutex> state_lock(state->mutex);
+                        if (state->closed) {
+                            return;
+                        }
+                        state->running++;
+                    }
+                    work();
+                    std::lock_guard<std::mutex> state_lock(state->mutex);
+                    if (--state->running == 0) {
+                        state->finished.notify_all();
+                    }
+                });
+            }
+        }
+        available.notify_all();
+    }
+    work();
+    std::unique_lock<std::mutex> state_lock(state->mutex);
+    state->closed = true;
+    state->finished.wait(state_lock, [&state]() { return state->running == 0; });
+}
+
+void QueryPool::run() {
+    while (true) {
+        Nan::AsyncWorker *worker = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]() { return stopping || queued > 0 || !helpers.empty(); });
+            if (!helpers.empty()) {
+                std::function<void()> helper = std::move(helpers.front());
+                helpers.pop_front();
+                lock.unlock();
+                helper();
+                continue;
+            }
+            // Queued workers are still executed when stopping, so that all of them are completed
+            if (queued == 0) {
+                return;
+            }
+            for (auto &queue : queues) {
+                if (!queue.empty()) {
+                    worker = queue.front();
+                    queue.pop_front();
+                    queued--;
+                    break;
+                }
+            }
+        }
+        worker->Execute();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            executed.push_back(worker);
+        }
+        uv_async_send(async);
+    }
+}
+
+void QueryPool::complete() {
+    std::vector<Nan::AsyncWorker *> workers;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        workers.swap(executed);
+    }
+    // This corresponds to the completion of workers in Nan::AsyncQueueWorker
+    for (Nan::AsyncWorker *worker : workers) {
+        worker->WorkComplete();
+        worker->Destroy();
+    }
+    pending -= workers.size();
+    if (!workers.empty() && pending == 0) {
+        uv_unref((uv_handle_t *) async);
+    }
+}
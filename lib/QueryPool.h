@@ -0,0 +1,92 @@
+#ifndef OSTRICH_QUERYPOOL_H
+#define OSTRICH_QUERYPOOL_H
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <nan.h>
+
+// The priority of a query in the pool, where queries of a higher priority are always started first
+enum QueryPriority {
+    QUERY_PRIORITY_HIGH = 0,
+    QUERY_PRIORITY_NORMAL = 1,
+    QUERY_PRIORITY_LOW = 2,
+};
+const size_t QUERY_PRIORITIES = 3;
+
+// The type of a query, which determines its priority
+enum QueryType {
+    QUERY_TYPE_VERSION_MATERIALIZED = 0,
+    QUERY_TYPE_DELTA_MATERIALIZED = 1,
+    QUERY_TYPE_VERSION = 2,
+    QUERY_TYPE_COUNT = 3,
+    QUERY_TYPE_BATCH = 4,
+    QUERY_TYPE_EXPORT = 5,
+};
+const size_t QUERY_TYPES = 6;
+
+// The default number of threads of a pool, where 0 runs queries on the default libuv thread pool
+const size_t QUERY_POOL_DEFAULT_THREADS = 4;
+// The default maximum number of queries that wait for a thread, where 0 is unbounded
+const size_t QUERY_POOL_DEFAULT_QUEUE_DEPTH = 0;
+
+struct QueryPoolOptions {
+    size_t threads = QUERY_POOL_DEFAULT_THREADS;
+    size_t queue_depth = QUERY_POOL_DEFAULT_QUEUE_DEPTH;
+    // The priority of each query type
+    std::array<QueryPriority, QUERY_TYPES> priorities{QUERY_PRIORITY_NORMAL, QUERY_PRIORITY_NORMAL, QUERY_PRIORITY_NORMAL,
+                                                      QUERY_PRIORITY_NORMAL, QUERY_PRIORITY_NORMAL, QUERY_PRIORITY_NORMAL};
+};
+
+// A pool of threads that executes query workers, separately from the default libuv thread pool,
+// so that slow queries do not hold up file system or DNS operations, and vice versa.
+// Workers are executed like Nan::AsyncQueueWorker does, and are completed on the loop thread.
+class QueryPool {
+public:
+    // Must be constructed on the loop thread
+    QueryPool(uv_loop_t *loop, const QueryPoolOptions &options);
+    // Must be destroyed on the loop thread, and waits for all running queries
+    ~QueryPool();
+
+    // Queues a worker, of which the pool becomes the owner.
+    // If the queue is full, false is returned, and the caller remains the owner of the worker.
+    bool queue(Nan::AsyncWorker *worker, QueryType type);
+
+    // Executes work on the calling thread, and on up to parallelism - 1 threads of the pool that become idle before it returns.
+    // Work must be safe to execute concurrently, and each execution must return once no work is left.
+    // Threads that have not started the work by the time the calling thread has finished it are skipped,
+    // so that a worker never waits for queued work, and the parallelism of queries is bounded by the pool.
+    void run_parallel(size_t parallelism, const std::function<void()> &work);
+
+    [[nodiscard]] size_t get_threads() const { return threads.size(); }
+    [[nodiscard]] size_t get_queue_depth() const { return queue_depth; }
+    // The number of queries that are waiting for a thread
+    [[nodiscard]] size_t size();
+
+private:
+    const size_t queue_depth;
+    const std::array<QueryPriority, QUERY_TYPES> priorities;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::array<std::deque<Nan::AsyncWorker *>, QUERY_PRIORITIES> queues;
+    size_t queued;
+    // Parallel work of queries that are already running, which is started before queued workers
+    std::deque<std::function<void()>> helpers;
+    bool stopping;
+    // Workers that have been executed, and still have to be completed on the loop thread
+    std::vector<Nan::AsyncWorker *> executed;
+    uv_async_t *async;
+    // The number of queued workers that have not been completed yet, which is only accessed on the loop thread.
+    // The completion handle keeps the loop alive while this is not 0, as the queries hold no libuv requests.
+    size_t pending;
+
+    void run();
+    void complete();
+};
+
+#endif //OSTRICH_QUERYPOOL_H
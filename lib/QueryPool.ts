@@ -0,0 +1,38 @@
+/**
+ * The priority of a type of query in the query thread pool of a store,
+ * where queries of a higher priority are always started first.
+ * This corresponds to QueryPriority in QueryPool.h
+ */
+export enum QueryPriority {
+  High = 0,
+  Normal = 1,
+  Low = 2,
+}
+
+/**
+ * The types of queries that can be given a priority.
+ * versionMaterialized, deltaMaterialized and version apply to searches of the corresponding type,
+ * count applies to all counts, batch applies to searchBatch and partitioned scans,
+ * and export applies to exports.
+ */
+export type QueryPoolType = 'versionMaterialized' | 'deltaMaterialized' | 'version' | 'count' | 'batch' | 'export';
+
+/**
+ * Options for the query thread pool of a store.
+ */
+export interface IQueryPoolOptions {
+  /**
+   * The number of threads that execute queries, where 0 executes them on the default libuv thread pool.
+   * Defaults to 4.
+   */
+  queryThreads?: number;
+  /**
+   * The maximum number of queries that wait for a thread, after which queries are rejected.
+   * Defaults to 0, which is unbounded.
+   */
+  queryQueueDepth?: number;
+  /**
+   * The priority of each type of query, which defaults to normal.
+   */
+  queryPriorities?: Partial<Record<QueryPoolType, QueryPriority>>;
+}
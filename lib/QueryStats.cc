@@ -0,0 +1,152 @@
+#include "QueryStats.h"
+
+#include <algorithm>
+#include <utility>
+
+static const char *STATS_OPERATION_NAMES[STATS_OPERATIONS] = {"versionMaterialized", "deltaMaterialized", "version",
+                                                              "count", "batch", "export", "append", "decode"};
+
+static uint64_t ToMicroseconds(std::chrono::steady_clock::duration duration) {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+size_t LatencyHistogram::bucket_of(uint64_t microseconds) {
+    microseconds = std::min(microseconds, ((uint64_t) 1 << LATENCY_HISTOGRAM_MAX_EXPONENT) - 1);
+    if (microseconds < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return microseconds;
+    }
+    // The sub-bucket is determined by the three bits after the highest bit
+    uint64_t exponent = 63 - __builtin_clzll(microseconds);
+    uint64_t sub_bucket = (microseconds >> (exponent - 3)) - LATENCY_HISTOGRAM_SUB_BUCKETS;
+    return LATENCY_HISTOGRAM_SUB_BUCKETS * (exponent - 2) + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucket_max(size_t bucket) {
+    if (bucket < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    uint64_t exponent = bucket / LATENCY_HISTOGRAM_SUB_BUCKETS + 2;
+    uint64_t sub_bucket = bucket % LATENCY_HISTOGRAM_SUB_BUCKETS;
+    return ((LATENCY_HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) << (exponent - 3)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t microseconds) {
+    buckets[bucket_of(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(microseconds, std::memory_order_relaxed);
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (microseconds > current && !max.compare_exchange_weak(current, microseconds, std::memory_order_relaxed)) {}
+}
+
+LatencySummary LatencyHistogram::summarize() const {
+    LatencySummary summary{};
+    summary.sum = sum.load(std::memory_order_relaxed);
+    summary.max = max.load(std::memory_order_relaxed);
+    std::array<uint64_t, LATENCY_HISTOGRAM_BUCKETS> counts{};
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    const std::pair<double, uint64_t *> percentiles[] = {{0.5,   &summary.p50},
+                                                         {0.9,   &summary.p90},
+                                                         {0.99,  &summary.p99},
+                                                         {0.999, &summary.p999}};
+    uint64_t cumulative = 0;
+    size_t bucket = 0;
+    for (auto &percentile : percentiles) {
+        auto rank = std::max((uint64_t) 1, (uint64_t) (percentile.first * (double) summary.count + 0.5));
+        while (cumulative + counts[bucket] < rank) {
+            cumulative += counts[bucket++];
+        }
+        *percentile.second = std::min(bucket_max(bucket), summary.max);
+    }
+    return summary;
+}
+
+static v8::Local<v8::Object> SummaryToObject(const LatencySummary &summary) {
+    v8::Local<v8::Object> object = Nan::New<v8::Object>();
+    Nan::Set(object, Nan::New("count").ToLocalChecked(), Nan::New<v8::Number>((double) summary.count));
+    Nan::Set(object, Nan::New("sum").ToLocalChecked(), Nan::New<v8::Number>((double) summary.sum));
+    Nan::Set(object, Nan::New("max").ToLocalChecked(), Nan::New<v8::Number>((double) summary.max));
+    Nan::Set(object, Nan::New("p50").ToLocalChecked(), Nan::New<v8::Number>((double) summary.p50));
+    Nan::Set(object, Nan::New("p90").ToLocalChecked(), Nan::New<v8::Number>((double) summary.p90));
+    Nan::Set(object, Nan::New("p99").ToLocalChecked(), Nan::New<v8::Number>((double) summary.p99));
+    Nan::Set(object, Nan::New("p999").ToLocalChecked(), Nan::New<v8::Number>((double) summary.p999));
+    return object;
+}
+
+v8::Local<v8::Object> QueryStats::ToObject() const {
+    v8::Local<v8::Object> object = Nan::New<v8::Object>();
+    for (size_t i = 0; i < STATS_OPERATIONS; i++) {
+        const OperationStats &operation = operations[i];
+        v8::Local<v8::Object> operationObject = Nan::New<v8::Object>();
+        Nan::Set(operationObject, Nan::New("count").ToLocalChecked(),
+                 Nan::New<v8::Number>((double) operation.count.load(std::memory_order_relaxed)));
+        Nan::Set(operationObject, Nan::New("errors").ToLocalChecked(),
+                 Nan::New<v8::Number>((double) operation.errors.load(std::memory_order_relaxed)));
+        Nan::Set(operationObject, Nan::New("results").ToLocalChecked(),
+                 Nan::New<v8::Number>((double) operation.results.load(std::memory_order_relaxed)));
+        Nan::Set(operationObject, Nan::New("bytes").ToLocalChecked(),
+                 Nan::New<v8::Number>((double) operation.bytes.load(std::memory_order_relaxed)));
+        Nan::Set(operationObject, Nan::New("queueWait").ToLocalChecked(), SummaryToObject(operation.queue_wait.summarize()));
+        Nan::Set(operationObject, Nan::New("execute").ToLocalChecked(), SummaryToObject(operation.execute.summarize()));
+        Nan::Set(operationObject, Nan::New("marshal").ToLocalChecked(), SummaryToObject(operation.marshal.summarize()));
+        Nan::Set(object, Nan::New(STATS_OPERATION_NAMES[i]).ToLocalChecked(), operationObject);
+    }
+    return object;
+}
+
+OperationTimer::OperationTimer(std::shared_ptr<QueryStats> stats, StatsOperation operation)
+        : stats(std::move(stats)), operation(operation), queued(std::chrono::steady_clock::now()),
+          queue_wait(0), execute_time(0), marshal_time(0), started(false), marshalling(false) {}
+
+OperationTimer::ExecutePhase OperationTimer::execute() {
+    if (!started) {
+        started = true;
+        queue_wait = std::chrono::steady_clock::now() - queued;
+    }
+    return ExecutePhase(*this);
+}
+
+void OperationTimer::start_marshal() {
+    marshalling = true;
+    marshal_start = std::chrono::steady_clock::now();
+}
+
+void OperationTimer::end_marshal() {
+    if (marshalling) {
+        marshalling = false;
+        marshal_time += std::chrono::steady_clock::now() - marshal_start;
+    }
+}
+
+void OperationTimer::finish(uint64_t results, uint64_t bytes) {
+    end_marshal();
+    OperationStats &operation_stats = stats->get(operation);
+    operation_stats.results.fetch_add(results, std::memory_order_relaxed);
+    operation_stats.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    record(operation_stats, true);
+}
+
+void OperationTimer::fail() {
+    end_marshal();
+    OperationStats &operation_stats = stats->get(operation);
+    operation_stats.errors.fetch_add(1, std::memory_order_relaxed);
+    record(operation_stats, marshal_time.count() > 0);
+}
+
+void OperationTimer::record(OperationStats &operation_stats, bool marshalled) {
+    operation_stats.count.fetch_add(1, std::memory_order_relaxed);
+    // Operations that were rejected before they started have no queue wait or execution to record
+    if (started) {
+        operation_stats.queue_wait.record(ToMicroseconds(queue_wait));
+        operation_stats.execute.record(ToMicroseconds(execute_time));
+    }
+    // Failed operations only have a conversion time if they failed after producing some results
+    if (marshalled) {
+        operation_stats.marshal.record(ToMicroseconds(marshal_time));
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef OSTRICH_QUERYSTATS_H
+#define OSTRICH_QUERYSTATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <nan.h>
+
+// The types of operations of which stats are recorded separately
+enum StatsOperation {
+    STATS_OPERATION_VERSION_MATERIALIZED = 0,
+    STATS_OPERATION_DELTA_MATERIALIZED = 1,
+    STATS_OPERATION_VERSION = 2,
+    STATS_OPERATION_COUNT = 3,
+    STATS_OPERATION_BATCH = 4,
+    STATS_OPERATION_EXPORT = 5,
+    STATS_OPERATION_APPEND = 6,
+    STATS_OPERATION_DECODE = 7,
+};
+const size_t STATS_OPERATIONS = 8;
+
+// The number of linear sub-buckets per power of two in a latency histogram, which bounds the relative error to 1/8
+const uint64_t LATENCY_HISTOGRAM_SUB_BUCKETS = 8;
+// Latencies are recorded in microseconds, and larger latencies than 2^40 microseconds (about 12 days) are capped
+const uint64_t LATENCY_HISTOGRAM_MAX_EXPONENT = 40;
+// Values below the sub-bucket count have a bucket of their own, and every next power of two is split into sub-buckets
+const size_t LATENCY_HISTOGRAM_BUCKETS = LATENCY_HISTOGRAM_SUB_BUCKETS * (LATENCY_HISTOGRAM_MAX_EXPONENT - 2);
+
+// A summary of the latencies in a histogram, in microseconds
+struct LatencySummary {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+};
+
+// A histogram of latencies with logarithmic buckets that are each split into linear sub-buckets, as in HDR histograms.
+// Latencies can be recorded from any thread without locking.
+class LatencyHistogram {
+public:
+    void record(uint64_t microseconds);
+    // Percentiles are the largest latency of the bucket that contains them, and are never larger than the maximum
+    [[nodiscard]] LatencySummary summarize() const;
+
+private:
+    std::array<std::atomic<uint64_t>, LATENCY_HISTOGRAM_BUCKETS> buckets{};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+
+    static size_t bucket_of(uint64_t microseconds);
+    static uint64_t bucket_max(size_t bucket);
+};
+
+// The counters and latencies of one type of operation
+struct OperationStats {
+    // The number of completed operations, including failed ones
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> errors{0};
+    // The number of triples or bindings that were produced
+    std::atomic<uint64_t> results{0};
+    // The number of bytes of terms, packed batches or serializations that were produced
+    std::atomic<uint64_t> bytes{0};
+    // The time between queueing an operation and the start of its execution on a worker thread
+    LatencyHistogram queue_wait;
+    // The time of the execution on a worker thread
+    LatencyHistogram execute;
+    // The time of converting results into JavaScript values on the main thread
+    LatencyHistogram marshal;
+};
+
+// The stats of all operations of a store, which are shared by the store and its running operations
+class QueryStats {
+public:
+    OperationStats &get(StatsOperation operation) { return operations[operation]; }
+    // Converts the stats into a JavaScript object with an entry per operation type
+    v8::Local<v8::Object> ToObject() const;
+
+private:
+    std::array<OperationStats, STATS_OPERATIONS> operations;
+};
+
+// Measures the phases of a single operation, from the moment it is queued until its results have been converted,
+// and records them in the stats once the operation has finished.
+class OperationTimer {
+public:
+    // The queue wait starts when the timer is constructed
+    OperationTimer(std::shared_ptr<QueryStats> stats, StatsOperation operation);
+
+    // Measures the execution while it exists
+    class ExecutePhase {
+    public:
+        explicit ExecutePhase(OperationTimer &timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+        ~ExecutePhase() { timer.execute_time += std::chrono::steady_clock::now() - start; }
+        // The time of this execution so far
+        [[nodiscard]] std::chrono::steady_clock::duration elapsed() const { return std::chrono::steady_clock::now() - start; }
+
+    private:
+        OperationTimer &timer;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Ends the queue wait, and measures the execution until the returned phase is destroyed
+    [[nodiscard]] ExecutePhase execute();
+    // Starts measuring the conversion of results, which may happen multiple times for operations with progress
+    void start_marshal();
+    void end_marshal();
+    // Ends the conversion of results if it was started, and records the operation
+    void finish(uint64_t results, uint64_t bytes);
+    // Records the operation as failed
+    void fail();
+    // The queue wait, which is known once the execution has started
+    [[nodiscard]] std::chrono::steady_clock::duration get_queue_wait() const { return queue_wait; }
+
+private:
+    std::shared_ptr<QueryStats> stats;
+    StatsOperation operation;
+    std::chrono::steady_clock::time_point queued;
+    std::chrono::steady_clock::duration queue_wait;
+    std::chrono::steady_clock::duration execute_time;
+    std::chrono::steady_clock::duration marshal_time;
+    std::chrono::steady_clock::time_point marshal_start;
+    bool started;
+    bool marshalling;
+
+    void record(OperationStats &operation_stats, bool marshalled);
+};
+
+#endif //OSTRICH_QUERYSTATS_H
@@ -0,0 +1,59 @@
+import type { QueryPoolType } from './QueryPool';
+
+/**
+ * A summary of the latencies of a phase of an operation, in microseconds.
+ * Percentiles are approximated by logarithmic buckets with a relative error of at most 1/8,
+ * and are never larger than the maximum.
+ */
+export interface ILatencySummary {
+  count: number;
+  sum: number;
+  max: number;
+  p50: number;
+  p90: number;
+  p99: number;
+  p999: number;
+}
+
+/**
+ * The counters and latencies of one type of operation.
+ */
+export interface IOperationStats {
+  /**
+   * The number of completed operations, including failed ones.
+   */
+  count: number;
+  errors: number;
+  /**
+   * The number of triples, bindings or inserted triples that were produced.
+   */
+  results: number;
+  /**
+   * The number of bytes of terms, packed batches or serializations that were produced.
+   */
+  bytes: number;
+  /**
+   * The time between queueing an operation and the start of its execution on a worker thread.
+   */
+  queueWait: ILatencySummary;
+  /**
+   * The time of the execution on a worker thread.
+   */
+  execute: ILatencySummary;
+  /**
+   * The time of converting results into JavaScript values on the main thread.
+   */
+  marshal: ILatencySummary;
+}
+
+/**
+ * The types of operations of which stats are recorded.
+ * These are the query types of the query thread pool, where batch also applies to joins and BGPs,
+ * append applies to all appends and ingests, and decode applies to decoding triple ids.
+ */
+export type StatsOperation = QueryPoolType | 'append' | 'decode';
+
+/**
+ * The stats of all operations of a store since it was opened.
+ */
+export type IStoreStats = Record<StatsOperation, IOperationStats>;
@@ -0,0 +1,59 @@
+import { Readable } from 'stream';
+import type { QueryIterator } from './BufferedOstrichStore';
+
+/**
+ * A readable object mode stream of the quads of a buffered query iterator.
+ * Batches are only requested from OSTRICH while fewer than highWaterMark quads are buffered,
+ * so slow consumers do not cause all results to be materialized in memory.
+ *
+ * Destroying the stream before it has ended closes the iterator, after which the store can be closed.
+ */
+export class QueryStream extends Readable {
+  private reading = false;
+  private remaining: number;
+
+  /**
+   * @param iterator The iterator to read from.
+   * @param options The maximum number of buffered quads (defaults to the iterator's buffer size),
+   *                and the maximum number of quads to read (defaults to all).
+   */
+  public constructor(
+    protected readonly iterator: QueryIterator,
+    options?: { highWaterMark?: number; limit?: number },
+  ) {
+    super({
+      objectMode: true,
+      highWaterMark: options && options.highWaterMark ? options.highWaterMark : iterator.bufferSize,
+    });
+    this.remaining = options && (options.limit || options.limit === 0) ? options.limit : Number.POSITIVE_INFINITY;
+  }
+
+  public _read(): void {
+    if (this.reading) {
+      return;
+    }
+    if (this.remaining <= 0) {
+      this.push(null);
+      return;
+    }
+    this.reading = true;
+    this.iterator.next().then(([ done, quads ]) => {
+      this.reading = false;
+      const returned = quads.length > this.remaining ? quads.slice(0, this.remaining) : quads;
+      this.remaining -= returned.length;
+      for (const quad of returned) {
+        this.push(quad);
+      }
+      if (done || this.remaining <= 0) {
+        this.push(null);
+      }
+    }, (error: Error) => {
+      this.reading = false;
+      this.destroy(error);
+    });
+  }
+
+  public _destroy(error: Error | null, callback: (error?: Error | null) => void): void {
+    this.iterator.close().then(() => callback(error), callback);
+  }
+}
@@ -0,0 +1,180 @@
+#include "QueryTrace.h"
+
+#include <algorithm>
+#include <unistd.h>
+
+QueryTracer::QueryTracer()
+        : enabled(false), origin(std::chrono::steady_clock::now()), main_thread(current_thread()), dropped(0) {}
+
+void QueryTracer::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+    dropped = 0;
+    main_thread = current_thread();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void QueryTracer::record(TraceEvent &&event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (events.size() < QUERY_TRACE_MAX_EVENTS) {
+        events.push_back(std::move(event));
+    } else {
+        dropped++;
+    }
+}
+
+uint64_t QueryTracer::now() const {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+uint32_t QueryTracer::current_thread() {
+    static std::atomic<uint32_t> next_thread{1};
+    thread_local uint32_t thread = next_thread.fetch_add(1, std::memory_order_relaxed);
+    return thread;
+}
+
+// Creates a metadata event that names a thread in trace viewers
+static v8::Local<v8::Object> ThreadNameToObject(double pid, uint32_t thread, const char *name) {
+    v8::Local<v8::Object> object = Nan::New<v8::Object>();
+    v8::Local<v8::Object> args = Nan::New<v8::Object>();
+    Nan::Set(args, Nan::New("name").ToLocalChecked(), Nan::New(name).ToLocalChecked());
+    Nan::Set(object, Nan::New("name").ToLocalChecked(), Nan::New("thread_name").ToLocalChecked());
+    Nan::Set(object, Nan::New("ph").ToLocalChecked(), Nan::New("M").ToLocalChecked());
+    Nan::Set(object, Nan::New("pid").ToLocalChecked(), Nan::New<v8::Number>(pid));
+    Nan::Set(object, Nan::New("tid").ToLocalChecked(), Nan::New<v8::Number>(thread));
+    Nan::Set(object, Nan::New("args").ToLocalChecked(), args);
+    return object;
+}
+
+v8::Local<v8::Object> QueryTracer::stop() {
+    enabled.store(false, std::memory_order_relaxed);
+    std::vector<TraceEvent> recorded;
+    uint64_t recorded_dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        recorded.swap(events);
+        recorded_dropped = dropped;
+    }
+
+    const v8::Local<v8::String> NAME = Nan::New("name").ToLocalChecked();
+    const v8::Local<v8::String> CATEGORY = Nan::New("cat").ToLocalChecked();
+    const v8::Local<v8::String> PHASE = Nan::New("ph").ToLocalChecked();
+    const v8::Local<v8::String> COMPLETE = Nan::New("X").ToLocalChecked();
+    const v8::Local<v8::String> TIMESTAMP = Nan::New("ts").ToLocalChecked();
+    const v8::Local<v8::String> DURATION = Nan::New("dur").ToLocalChecked();
+    const v8::Local<v8::String> PID = Nan::New("pid").ToLocalChecked();
+    const v8::Local<v8::String> TID = Nan::New("tid").ToLocalChecked();
+    const v8::Local<v8::String> ARGS = Nan::New("args").ToLocalChecked();
+    double pid = getpid();
+
+    // Name the main thread and all threads that recorded spans
+    std::vector<uint32_t> threads;
+    threads.push_back(main_thread);
+    for (auto &event : recorded) {
+        if (std::find(threads.begin(), threads.end(), event.thread) == threads.end()) {
+            threads.push_back(event.thread);
+        }
+    }
+    v8::Local<v8::Array> eventsArray = Nan::New<v8::Array>(threads.size() + recorded.size());
+    uint32_t count = 0;
+    for (uint32_t thread : threads) {
+        Nan::Set(eventsArray, count++, ThreadNameToObject(pid, thread, thread == main_thread ? "main" : "worker"));
+    }
+    for (auto &event : recorded) {
+        v8::Local<v8::Object> eventObject = Nan::New<v8::Object>();
+        Nan::Set(eventObject, NAME, Nan::New(event.name).ToLocalChecked());
+        Nan::Set(eventObject, CATEGORY, Nan::New(event.category).ToLocalChecked());
+        Nan::Set(eventObject, PHASE, COMPLETE);
+        Nan::Set(eventObject, TIMESTAMP, Nan::New<v8::Number>((double) event.start));
+        Nan::Set(eventObject, DURATION, Nan::New<v8::Number>((double) event.duration));
+        Nan::Set(eventObject, PID, Nan::New<v8::Number>(pid));
+        Nan::Set(eventObject, TID, Nan::New<v8::Number>(event.thread));
+        v8::Local<v8::Object> argsObject = Nan::New<v8::Object>();
+        for (auto &arg : event.args->strings) {
+            Nan::Set(argsObject, Nan::New(arg.first).ToLocalChecked(), Nan::New(arg.second).ToLocalChecked());
+        }
+        for (auto &arg : event.args->numbers) {
+            Nan::Set(argsObject, Nan::New(arg.first).ToLocalChecked(), Nan::New<v8::Number>((double) arg.second));
+        }
+        for (auto &arg : event.counts) {
+            Nan::Set(argsObject, Nan::New(arg.first).ToLocalChecked(), Nan::New<v8::Number>((double) arg.second));
+        }
+        Nan::Set(eventObject, ARGS, argsObject);
+        Nan::Set(eventsArray, count++, eventObject);
+    }
+
+    v8::Local<v8::Object> trace = Nan::New<v8::Object>();
+    Nan::Set(trace, Nan::New("traceEvents").ToLocalChecked(), eventsArray);
+    Nan::Set(trace, Nan::New("displayTimeUnit").ToLocalChecked(), Nan::New("ms").ToLocalChecked());
+    Nan::Set(trace, Nan::New("droppedEvents").ToLocalChecked(), Nan::New<v8::Number>((double) recorded_dropped));
+    return trace;
+}
+
+OperationTrace::OperationTrace(const std::shared_ptr<QueryTracer> &tracer, const char *operation)
+        : operation(operation), created(0) {
+    // Operations that are not traced do not keep the tracer, so all their spans are no-ops
+    if (tracer->is_enabled()) {
+        this->tracer = tracer;
+        created = tracer->now();
+        args = std::make_shared<TraceArgs>();
+    }
+}
+
+OperationTrace &OperationTrace::arg(const char *key, const std::string &value) {
+    if (args != nullptr) {
+        args->strings.emplace_back(key, value);
+    }
+    return *this;
+}
+
+OperationTrace &OperationTrace::arg(const char *key, int64_t value) {
+    if (args != nullptr) {
+        args->numbers.emplace_back(key, value);
+    }
+    return *this;
+}
+
+OperationTrace &OperationTrace::pattern(const std::string &subject, const std::string &predicate, const std::string &object) {
+    return arg("subject", subject).arg("predicate", predicate).arg("object", object);
+}
+
+uint64_t OperationTrace::since_created() const {
+    return tracer != nullptr ? tracer->now() - created : 0;
+}
+
+OperationTrace::Span::Span(OperationTrace *trace, const char *name) : trace(trace), event{name, nullptr, 0, 0, 0, nullptr, {}} {
+    if (trace != nullptr) {
+        event.category = trace->operation;
+        event.start = trace->tracer->now();
+        event.thread = QueryTracer::current_thread();
+        event.args = trace->args;
+    }
+}
+
+OperationTrace::Span::Span(Span &&other) noexcept : trace(other.trace), event(std::move(other.event)) {
+    other.trace = nullptr;
+}
+
+void OperationTrace::Span::count(const char *key, int64_t value) {
+    if (trace != nullptr) {
+        event.counts.emplace_back(key, value);
+    }
+}
+
+void OperationTrace::Span::end() {
+    if (trace != nullptr) {
+        event.duration = trace->tracer->now() - event.start;
+        trace->tracer->record(std::move(event));
+        trace = nullptr;
+    }
+}
+
+OperationTrace::Accumulator::Accumulator(OperationTrace *trace, const char *name) : trace(trace), name(name) {}
+
+OperationTrace::Accumulator::~Accumulator() {
+    if (trace != nullptr && intervals > 0) {
+        auto microseconds = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        trace->tracer->record(TraceEvent{name, trace->operation, first_start, microseconds, QueryTracer::current_thread(), trace->args,
+                                         {{"intervals", intervals}}});
+    }
+}
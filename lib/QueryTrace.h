@@ -0,0 +1,138 @@
+#ifndef OSTRICH_QUERYTRACE_H
+#define OSTRICH_QUERYTRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <nan.h>
+
+// The maximum number of spans that are kept while tracing, after which spans are dropped
+const size_t QUERY_TRACE_MAX_EVENTS = 1 << 20;
+
+// The arguments of an operation, such as its pattern and versions, which are shown on each of its spans
+struct TraceArgs {
+    std::vector<std::pair<const char *, std::string>> strings;
+    std::vector<std::pair<const char *, int64_t>> numbers;
+};
+
+// A span of an operation, which is written as a complete event in the Chrome trace event format
+struct TraceEvent {
+    const char *name;
+    const char *category;
+    // The start and duration in microseconds, where the start is relative to the creation of the tracer
+    uint64_t start;
+    uint64_t duration;
+    uint32_t thread;
+    std::shared_ptr<const TraceArgs> args;
+    // Counters of this span only, such as the number of results
+    std::vector<std::pair<const char *, int64_t>> counts;
+};
+
+// Collects the spans of the operations of a store while tracing is enabled.
+// Spans can be recorded from any thread.
+class QueryTracer {
+public:
+    QueryTracer();
+
+    // Removes all spans, and starts recording new ones
+    void start();
+    // Stops recording spans, and converts the spans that were recorded into a Chrome trace object
+    v8::Local<v8::Object> stop();
+    bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void record(TraceEvent &&event);
+    // The number of microseconds since the creation of the tracer
+    uint64_t now() const;
+    // A small number that identifies the current thread in traces
+    static uint32_t current_thread();
+
+private:
+    std::atomic<bool> enabled;
+    std::chrono::steady_clock::time_point origin;
+    uint32_t main_thread;
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    uint64_t dropped;
+};
+
+// Records the spans of a single operation if tracing was enabled when the operation was created
+class OperationTrace {
+public:
+    OperationTrace(const std::shared_ptr<QueryTracer> &tracer, const char *operation);
+
+    bool is_enabled() const { return args != nullptr; }
+    // Adds an argument to all spans of this operation, which must happen before the first span is started
+    OperationTrace &arg(const char *key, const std::string &value);
+    OperationTrace &arg(const char *key, int64_t value);
+    // Adds the subject, predicate and object of a triple pattern as arguments
+    OperationTrace &pattern(const std::string &subject, const std::string &predicate, const std::string &object);
+    // The number of microseconds since the operation was created
+    uint64_t since_created() const;
+
+    // Measures a phase of the operation on the current thread until it ends or is destroyed
+    class Span {
+    public:
+        Span(OperationTrace *trace, const char *name);
+        Span(Span &&other) noexcept;
+        ~Span() { end(); }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+        void count(const char *key, int64_t value);
+        void end();
+
+    private:
+        OperationTrace *trace;
+        TraceEvent event;
+    };
+
+    // Measures a phase that is interleaved with another one, such as decoding terms while iterating,
+    // as a single span that starts at the first interval and lasts as long as all intervals together
+    class Accumulator {
+    public:
+        Accumulator(OperationTrace *trace, const char *name);
+        ~Accumulator();
+        Accumulator(const Accumulator &) = delete;
+        Accumulator &operator=(const Accumulator &) = delete;
+
+        // Intervals are often shorter than a microsecond, so they are summed at the precision of the clock
+        void begin() {
+            if (trace != nullptr) {
+                if (intervals == 0) {
+                    first_start = trace->tracer->now();
+                }
+                interval_start = std::chrono::steady_clock::now();
+            }
+        }
+        void end() {
+            if (trace != nullptr) {
+                duration += std::chrono::steady_clock::now() - interval_start;
+                intervals++;
+            }
+        }
+
+    private:
+        OperationTrace *trace;
+        const char *name;
+        uint64_t first_start{0};
+        std::chrono::steady_clock::time_point interval_start;
+        std::chrono::steady_clock::duration duration{0};
+        int64_t intervals{0};
+    };
+
+    [[nodiscard]] Span span(const char *name) { return Span(is_enabled() ? this : nullptr, name); }
+    [[nodiscard]] Accumulator accumulate(const char *name) { return {is_enabled() ? this : nullptr, name}; }
+
+private:
+    std::shared_ptr<QueryTracer> tracer;
+    const char *operation;
+    uint64_t created;
+    std::shared_ptr<TraceArgs> args;
+};
+
+#endif //OSTRICH_QUERYTRACE_H
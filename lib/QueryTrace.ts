@@ -0,0 +1,39 @@
+/**
+ * A span of an operation in the Chrome trace event format,
+ * or the name of a thread when its phase is 'M'.
+ */
+export interface ITraceEvent {
+  name: string;
+  /**
+   * The type of operation, such as 'versionMaterialized' or 'append'.
+   */
+  cat?: string;
+  ph: 'X' | 'M';
+  /**
+   * The start in microseconds, relative to the opening of the store.
+   */
+  ts?: number;
+  /**
+   * The duration in microseconds.
+   */
+  dur?: number;
+  pid: number;
+  tid: number;
+  /**
+   * The arguments of the operation, such as its pattern and versions, and the counters of this span.
+   */
+  args: Record<string, string | number>;
+}
+
+/**
+ * The spans that were recorded while tracing, which can be loaded in Perfetto or chrome://tracing
+ * after serializing it as JSON.
+ */
+export interface ITrace {
+  traceEvents: ITraceEvent[];
+  displayTimeUnit: 'ms';
+  /**
+   * The number of spans that were not kept because the maximum number of spans was reached.
+   */
+  droppedEvents: number;
+}
@@ -0,0 +1,63 @@
+#include "ResultCache.h"
+
+ResultCache::ResultCache(size_t capacity) : max_bytes(capacity), generation(0), bytes(0) {}
+
+bool ResultCache::get(const ResultCacheKey &key, ResultCacheEntry &entry) {
+    if (max_bytes == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    entry = it->second->second;
+    return true;
+}
+
+void ResultCache::put(ResultCacheKey key, ResultCacheEntry entry, uint64_t query_generation) {
+    if (max_bytes == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (query_generation != generation || index.find(key) != index.end()) {
+        return;
+    }
+    entries.emplace_front(std::move(key), std::move(entry));
+    size_t added_bytes = entry_bytes(entries.front());
+    if (added_bytes > max_bytes) {
+        entries.pop_front();
+        return;
+    }
+    index.emplace(entries.front().first, entries.begin());
+    bytes += added_bytes;
+    while (bytes > max_bytes) {
+        bytes -= entry_bytes(entries.back());
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+uint64_t ResultCache::get_generation() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return generation;
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    generation++;
+    index.clear();
+    entries.clear();
+    bytes = 0;
+}
+
+size_t ResultCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t ResultCache::entry_bytes(const Entry &entry) {
+    return sizeof(Entry) + entry.first.subject.size() + entry.first.predicate.size() + entry.first.object.size()
+           + entry.second.batch->size();
+}
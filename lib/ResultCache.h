@@ -0,0 +1,81 @@
+#ifndef OSTRICH_RESULTCACHE_H
+#define OSTRICH_RESULTCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Identifies a page of version materialized results
+struct ResultCacheKey {
+    std::string subject;
+    std::string predicate;
+    std::string object;
+    int version;
+    uint32_t offset;
+    uint32_t limit;
+
+    bool operator==(const ResultCacheKey &other) const {
+        return version == other.version && offset == other.offset && limit == other.limit
+               && subject == other.subject && predicate == other.predicate && object == other.object;
+    }
+};
+
+struct ResultCacheKeyHash {
+    size_t operator()(const ResultCacheKey &key) const {
+        size_t hash = std::hash<std::string>()(key.subject);
+        hash ^= std::hash<std::string>()(key.predicate) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<std::string>()(key.object) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<uint64_t>()(((uint64_t) key.offset << 32) | key.limit) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash ^ ((size_t) key.version << 1);
+    }
+};
+
+// A page of results as a packed triple batch, together with its counts
+struct ResultCacheEntry {
+    std::shared_ptr<const std::string> batch;
+    uint32_t totalCount;
+    bool hasExactCount;
+};
+
+// The default number of bytes of pages that are cached per store, where 0 disables the cache
+const size_t RESULT_CACHE_DEFAULT_SIZE = 0;
+
+// A bounded, thread-safe LRU cache of pages of packed query results, so that repeated pages are served
+// without evaluating the query again.
+// The cache is cleared when a version is appended, and pages of queries that started before that are not cached.
+class ResultCache {
+public:
+    // A capacity of 0 disables caching
+    explicit ResultCache(size_t capacity);
+
+    // Returns true and sets the entry if the page is cached
+    bool get(const ResultCacheKey &key, ResultCacheEntry &entry);
+    // Caches a page of a query that started at the given generation
+    void put(ResultCacheKey key, ResultCacheEntry entry, uint64_t generation);
+    // The generation that is passed to put for a query that starts now
+    uint64_t get_generation();
+
+    // Removes all cached pages, and ignores pages of queries that are still running
+    void clear();
+
+    [[nodiscard]] size_t capacity() const { return max_bytes; }
+    [[nodiscard]] size_t size();
+
+private:
+    typedef std::pair<ResultCacheKey, ResultCacheEntry> Entry;
+
+    const size_t max_bytes;
+    std::mutex mutex;
+    uint64_t generation;
+    size_t bytes;
+    // Most recently used entries first
+    std::list<Entry> entries;
+    std::unordered_map<ResultCacheKey, std::list<Entry>::iterator, ResultCacheKeyHash> index;
+
+    static size_t entry_bytes(const Entry &entry);
+};
+
+#endif //OSTRICH_RESULTCACHE_H
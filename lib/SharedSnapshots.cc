@@ -0,0 +1,100 @@
+#include "SharedSnapshots.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <HDTManager.hpp>
+
+static const std::string SNAPSHOT_EXTENSION = ".hdt";
+// HDT stores the index of a snapshot next to it, with a name that starts with this suffix and may end with a version
+static const std::string INDEX_SUFFIX = ".index";
+
+static bool EndsWith(const std::string &value, const std::string &suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::vector<std::string> ListDirectory(const std::string &path) {
+    std::vector<std::string> names;
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        throw std::runtime_error("Unable to read the OSTRICH store at '" + path + "': " + std::strerror(errno));
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        names.emplace_back(entry->d_name);
+    }
+    closedir(dir);
+    return names;
+}
+
+std::vector<std::string> FindUnindexedSnapshots(const std::string &path) {
+    std::vector<std::string> names = ListDirectory(path);
+    std::sort(names.begin(), names.end());
+    std::vector<std::string> unindexed;
+    for (auto &name : names) {
+        if (!EndsWith(name, SNAPSHOT_EXTENSION)) {
+            continue;
+        }
+        // Index names sort before all other names that are not smaller than their prefix
+        std::string index_prefix = name + INDEX_SUFFIX;
+        auto index = std::lower_bound(names.begin(), names.end(), index_prefix);
+        if (index == names.end() || index->compare(0, index_prefix.size(), index_prefix) != 0) {
+            unindexed.push_back(path + name);
+        }
+    }
+    return unindexed;
+}
+
+// Holds a shared or exclusive advisory lock on a directory for as long as it exists
+class DirectoryLock {
+public:
+    DirectoryLock(const std::string &path, int operation) : fd(open(path.c_str(), O_RDONLY)) {
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open the OSTRICH store at '" + path + "': " + std::strerror(errno));
+        }
+        while (flock(fd, operation) != 0) {
+            if (errno != EINTR) {
+                int error = errno;
+                close(fd);
+                throw std::runtime_error("Unable to lock the OSTRICH store at '" + path + "': " + std::strerror(error));
+            }
+        }
+    }
+
+    ~DirectoryLock() {
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+
+private:
+    int fd;
+};
+
+void PrepareSharedSnapshots(const std::string &path) {
+    // Most of the time, all indexes already exist, which only requires a shared lock to check.
+    // Indexes are written while the exclusive lock is held, so an index that exists here is complete.
+    {
+        DirectoryLock lock(path, LOCK_SH);
+        if (FindUnindexedSnapshots(path).empty()) {
+            return;
+        }
+    }
+
+    DirectoryLock lock(path, LOCK_EX);
+    // Another process may have built the indexes while we were waiting for the lock
+    for (auto &snapshot : FindUnindexedSnapshots(path)) {
+        // Mapping a snapshot builds its index and saves it next to the snapshot
+        std::unique_ptr<hdt::HDT> hdt(hdt::HDTManager::mapIndexedHDT(snapshot.c_str()));
+    }
+    std::vector<std::string> unindexed = FindUnindexedSnapshots(path);
+    if (!unindexed.empty()) {
+        throw std::runtime_error("Unable to save the index of the snapshot '" + unindexed.front()
+                                 + "', so it can not be shared between processes");
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef OSTRICH_SHAREDSNAPSHOTS_H
+#define OSTRICH_SHAREDSNAPSHOTS_H
+
+#include <string>
+#include <vector>
+
+// Finds the HDT snapshot files in the given store directory that have no persisted index yet
+std::vector<std::string> FindUnindexedSnapshots(const std::string &path);
+
+// Makes sure that every HDT snapshot in the given store directory has a persisted index,
+// so that processes that share the store only map the snapshots and their indexes,
+// instead of each building the indexes in memory.
+// Missing indexes are built once, while an exclusive lock on the store directory is held,
+// so that concurrently starting processes wait for the first one instead of building them as well.
+// Existing indexes are only checked while holding a shared lock, so that an index that is still being written is never used.
+// Throws a runtime_error if an index can not be persisted, e.g. because the directory is not writable.
+void PrepareSharedSnapshots(const std::string &path);
+
+#endif //OSTRICH_SHAREDSNAPSHOTS_H
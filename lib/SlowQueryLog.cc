@@ -0,0 +1,156 @@
+#include "SlowQueryLog.h"
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "LiteralsUtils.h"
+
+static const char *SLOW_QUERY_TYPES[] = {"versionMaterialized", "deltaMaterialized", "version"};
+
+static uint64_t ToMicroseconds(std::chrono::steady_clock::duration duration) {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+// Converts a term of a pattern back into its JavaScript representation, where the empty string is a variable
+static std::string ToJavaScriptTerm(std::string term) {
+    return term.empty() ? term : fromHdtLiteral(term);
+}
+
+// Writes a string as a JSON string literal
+static void WriteJsonString(std::ostream &out, const std::string &value) {
+    static const char *HEX = "0123456789abcdef";
+    out << '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if ((unsigned char) c < 0x20) {
+                    out << "\\u00" << HEX[(c >> 4) & 0xF] << HEX[c & 0xF];
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+// Writes a slow query as a single line of JSON, with the same keys as its JavaScript object
+static void WriteJsonLine(std::ostream &out, const SlowQuery &query) {
+    out << "{\"type\":\"" << SLOW_QUERY_TYPES[query.operation] << "\",\"subject\":";
+    WriteJsonString(out, query.subject);
+    out << ",\"predicate\":";
+    WriteJsonString(out, query.predicate);
+    out << ",\"object\":";
+    WriteJsonString(out, ToJavaScriptTerm(query.object));
+    out << ",\"offset\":" << query.offset << ",\"limit\":" << query.limit;
+    if (query.operation == STATS_OPERATION_VERSION_MATERIALIZED) {
+        out << ",\"version\":" << query.version_start;
+    } else if (query.operation == STATS_OPERATION_DELTA_MATERIALIZED) {
+        out << ",\"versionStart\":" << query.version_start << ",\"versionEnd\":" << query.version_end;
+    }
+    out << ",\"results\":" << query.results
+        << ",\"queueWait\":" << ToMicroseconds(query.queue_wait)
+        << ",\"execute\":" << ToMicroseconds(query.execute)
+        << ",\"snapshotElements\":" << query.snapshot_elements
+        << ",\"patchElements\":" << query.patch_elements
+        << ",\"time\":" << query.time << "}\n";
+}
+
+SlowQueryLog::SlowQueryLog(Controller *controller)
+        : controller(controller), threshold(-1), capacity(SLOW_QUERY_LOG_DEFAULT_CAPACITY) {}
+
+void SlowQueryLog::configure(int64_t threshold, size_t capacity, std::string file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->capacity = capacity;
+    this->file = std::move(file);
+    while (queries.size() > capacity) {
+        queries.pop_front();
+    }
+    this->threshold.store(threshold, std::memory_order_relaxed);
+}
+
+// OSTRICH iterators do not count the elements they read, so these are estimated with the count indexes instead.
+// The snapshot of a store is at version 0, and every later version is stored as the changes since that snapshot.
+void SlowQueryLog::count_elements(SlowQuery &query) const {
+    StringTriple pattern(query.subject, query.predicate, query.object);
+    auto patch_count = [&](int version) -> size_t {
+        return version > 0 ? controller->get_delta_materialized_count(pattern, 0, version, true).first : 0;
+    };
+    switch (query.operation) {
+        case STATS_OPERATION_VERSION_MATERIALIZED:
+            // The snapshot is merged with the changes of the version
+            query.snapshot_elements = controller->get_version_materialized_count(pattern, 0, true).first;
+            query.patch_elements = patch_count(query.version_start);
+            break;
+        case STATS_OPERATION_DELTA_MATERIALIZED:
+            // The changes of both versions are compared, without reading the snapshot
+            query.snapshot_elements = 0;
+            query.patch_elements = patch_count(query.version_start) + patch_count(query.version_end);
+            break;
+        default:
+            // The snapshot is annotated with the changes of all versions
+            query.snapshot_elements = controller->get_version_materialized_count(pattern, 0, true).first;
+            query.patch_elements = patch_count(controller->get_max_patch_id());
+    }
+}
+
+void SlowQueryLog::record(SlowQuery &&query, const OperationTimer &timer, const OperationTimer::ExecutePhase &executing) {
+    query.queue_wait = timer.get_queue_wait();
+    query.execute = executing.elapsed();
+    query.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    try {
+        count_elements(query);
+    } catch (const std::runtime_error &) {
+        query.snapshot_elements = 0;
+        query.patch_elements = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file.empty()) {
+        // Slow queries are rare, so the file is only opened while one is appended
+        std::ostringstream line;
+        WriteJsonLine(line, query);
+        std::ofstream out(file, std::ios::app);
+        out << line.str();
+    }
+    if (capacity > 0) {
+        if (queries.size() >= capacity) {
+            queries.pop_front();
+        }
+        queries.push_back(std::move(query));
+    }
+}
+
+v8::Local<v8::Array> SlowQueryLog::ToArray() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    v8::Local<v8::Array> array = Nan::New<v8::Array>(queries.size());
+    uint32_t count = 0;
+    for (auto &query : queries) {
+        v8::Local<v8::Object> object = Nan::New<v8::Object>();
+        Nan::Set(object, Nan::New("type").ToLocalChecked(), Nan::New(SLOW_QUERY_TYPES[query.operation]).ToLocalChecked());
+        Nan::Set(object, Nan::New("subject").ToLocalChecked(), Nan::New(query.subject).ToLocalChecked());
+        Nan::Set(object, Nan::New("predicate").ToLocalChecked(), Nan::New(query.predicate).ToLocalChecked());
+        Nan::Set(object, Nan::New("object").ToLocalChecked(), Nan::New(ToJavaScriptTerm(query.object)).ToLocalChecked());
+        Nan::Set(object, Nan::New("offset").ToLocalChecked(), Nan::New<v8::Number>(query.offset));
+        Nan::Set(object, Nan::New("limit").ToLocalChecked(), Nan::New<v8::Number>(query.limit));
+        if (query.operation == STATS_OPERATION_VERSION_MATERIALIZED) {
+            Nan::Set(object, Nan::New("version").ToLocalChecked(), Nan::New<v8::Number>(query.version_start));
+        } else if (query.operation == STATS_OPERATION_DELTA_MATERIALIZED) {
+            Nan::Set(object, Nan::New("versionStart").ToLocalChecked(), Nan::New<v8::Number>(query.version_start));
+            Nan::Set(object, Nan::New("versionEnd").ToLocalChecked(), Nan::New<v8::Number>(query.version_end));
+        }
+        Nan::Set(object, Nan::New("results").ToLocalChecked(), Nan::New<v8::Number>((double) query.results));
+        Nan::Set(object, Nan::New("queueWait").ToLocalChecked(), Nan::New<v8::Number>((double) ToMicroseconds(query.queue_wait)));
+        Nan::Set(object, Nan::New("execute").ToLocalChecked(), Nan::New<v8::Number>((double) ToMicroseconds(query.execute)));
+        Nan::Set(object, Nan::New("snapshotElements").ToLocalChecked(), Nan::New<v8::Number>((double) query.snapshot_elements));
+        Nan::Set(object, Nan::New("patchElements").ToLocalChecked(), Nan::New<v8::Number>((double) query.patch_elements));
+        Nan::Set(object, Nan::New("time").ToLocalChecked(), Nan::New<v8::Number>((double) query.time));
+        Nan::Set(array, count++, object);
+    }
+    return array;
+}
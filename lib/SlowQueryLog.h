@@ -0,0 +1,72 @@
+#ifndef OSTRICH_SLOWQUERYLOG_H
+#define OSTRICH_SLOWQUERYLOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <nan.h>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "QueryStats.h"
+
+// The number of slow queries that are kept if no capacity is configured
+const size_t SLOW_QUERY_LOG_DEFAULT_CAPACITY = 100;
+
+// A version-materialized, delta-materialized or version query that executed longer than the threshold of the log
+struct SlowQuery {
+    StatsOperation operation;
+    // The pattern in its HDT representation, as it was matched by OSTRICH
+    std::string subject, predicate, object;
+    uint32_t offset;
+    uint32_t limit;
+    // The version of a version-materialized query, or the versions of a delta-materialized query,
+    // which are -1 for version queries
+    int version_start;
+    int version_end;
+    uint64_t results;
+    std::chrono::steady_clock::duration queue_wait;
+    std::chrono::steady_clock::duration execute;
+    // Estimations of the number of snapshot triples and patch elements that match the pattern in the queried versions
+    size_t snapshot_elements;
+    size_t patch_elements;
+    // The number of milliseconds since the Unix epoch at which the query was logged
+    int64_t time;
+};
+
+// Keeps the latest queries that executed longer than a threshold, and optionally appends them to a file.
+// Queries can be logged from any thread.
+class SlowQueryLog {
+public:
+    explicit SlowQueryLog(Controller *controller);
+
+    // Logs queries that execute for at least the threshold in microseconds, or no queries if the threshold is negative.
+    // The latest queries up to the capacity are kept, and each query is also appended to the file as a line of JSON
+    // if the file is not empty.
+    void configure(int64_t threshold, size_t capacity, std::string file);
+    [[nodiscard]] bool is_slow(std::chrono::steady_clock::duration execute) const {
+        int64_t microseconds = threshold.load(std::memory_order_relaxed);
+        return microseconds >= 0 && std::chrono::duration_cast<std::chrono::microseconds>(execute).count() >= microseconds;
+    }
+
+    // Logs a query that is still executing, and counts the elements of its pattern,
+    // so the controller must not be modified by an append in the meantime
+    void record(SlowQuery &&query, const OperationTimer &timer, const OperationTimer::ExecutePhase &executing);
+    // Converts the queries that are kept into a JavaScript array, from the oldest to the latest
+    v8::Local<v8::Array> ToArray() const;
+
+private:
+    Controller *controller;
+    std::atomic<int64_t> threshold;
+    mutable std::mutex mutex;
+    size_t capacity;
+    std::string file;
+    std::deque<SlowQuery> queries;
+
+    void count_elements(SlowQuery &query) const;
+};
+
+#endif //OSTRICH_SLOWQUERYLOG_H
@@ -0,0 +1,62 @@
+/**
+ * Options for logging the queries that execute longer than a threshold.
+ */
+export interface ISlowQueryLogOptions {
+  /**
+   * The execution time in milliseconds from which queries are logged.
+   */
+  threshold: number;
+  /**
+   * The number of latest slow queries that are kept in memory, which defaults to 100.
+   */
+  capacity?: number;
+  /**
+   * A file to which each slow query is appended as a line of JSON.
+   */
+  file?: string;
+}
+
+/**
+ * A version-materialized, delta-materialized or version query that executed longer than the threshold.
+ */
+export interface ISlowQuery {
+  type: 'versionMaterialized' | 'deltaMaterialized' | 'version';
+  /**
+   * The terms of the pattern, where the empty string is a variable.
+   */
+  subject: string;
+  predicate: string;
+  object: string;
+  offset: number;
+  limit: number;
+  /**
+   * The version of a version-materialized query.
+   */
+  version?: number;
+  /**
+   * The versions of a delta-materialized query.
+   */
+  versionStart?: number;
+  versionEnd?: number;
+  results: number;
+  /**
+   * The time between queueing the query and the start of its execution, in microseconds.
+   */
+  queueWait: number;
+  /**
+   * The time of the execution, in microseconds.
+   */
+  execute: number;
+  /**
+   * An estimation of the number of snapshot triples that match the pattern.
+   */
+  snapshotElements: number;
+  /**
+   * An estimation of the number of changes in the queried versions that match the pattern.
+   */
+  patchElements: number;
+  /**
+   * The number of milliseconds since the Unix epoch at which the query was logged.
+   */
+  time: number;
+}
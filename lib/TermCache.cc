@@ -0,0 +1,61 @@
+#include "TermCache.h"
+#include "LiteralsUtils.h"
+
+#include <cmath>
+
+TermCache::TermCache(size_t capacity) : max_size(capacity) {}
+
+std::string TermCache::get(DictionaryManager &dict, size_t id, hdt::TripleComponentRole role) {
+    if (max_size == 0) {
+        return decode(dict, id, role);
+    }
+
+    TermCacheKey key{&dict, id, role};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->second;
+        }
+    }
+
+    // Decode outside of the lock, so that concurrent misses do not block each other
+    std::string term = decode(dict, id, role);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index.find(key) == index.end()) {
+        entries.emplace_front(key, term);
+        index.emplace(key, entries.begin());
+        if (entries.size() > max_size) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+    return term;
+}
+
+void TermCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    index.clear();
+    entries.clear();
+}
+
+size_t TermCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+bool TermCache::is_valid_id(DictionaryManager &dict, double id, hdt::TripleComponentRole role) {
+    size_t max_id = role == hdt::SUBJECT ? dict.getMaxSubjectID()
+                    : role == hdt::PREDICATE ? dict.getMaxPredicateID() : dict.getMaxObjectID();
+    return id >= 1 && id <= (double) max_id && std::floor(id) == id;
+}
+
+std::string TermCache::decode(DictionaryManager &dict, size_t id, hdt::TripleComponentRole role) {
+    std::string term = dict.idToString(id, role);
+    if (role == hdt::OBJECT) {
+        fromHdtLiteral(term);
+    }
+    return term;
+}
@@ -0,0 +1,65 @@
+#ifndef OSTRICH_TERMCACHE_H
+#define OSTRICH_TERMCACHE_H
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <HDTEnums.hpp>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+
+// Identifies a term by its id in a certain dictionary
+struct TermCacheKey {
+    const DictionaryManager *dict;
+    size_t id;
+    hdt::TripleComponentRole role;
+
+    bool operator==(const TermCacheKey &other) const {
+        return dict == other.dict && id == other.id && role == other.role;
+    }
+};
+
+struct TermCacheKeyHash {
+    size_t operator()(const TermCacheKey &key) const {
+        size_t hash = std::hash<size_t>()(key.id);
+        hash ^= std::hash<const void *>()(key.dict) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash ^ ((size_t) key.role << 1);
+    }
+};
+
+// The default number of terms that are cached per store
+const size_t TERM_CACHE_DEFAULT_CAPACITY = 65536;
+
+// A bounded, thread-safe LRU cache of decoded dictionary terms, in their JavaScript representation.
+// A single cache is shared by all queries on a store, so frequently occurring terms are only decoded once.
+class TermCache {
+public:
+    // A capacity of 0 disables caching
+    explicit TermCache(size_t capacity);
+
+    // Returns the term with the given id, decoding it from the dictionary if it is not cached yet
+    std::string get(DictionaryManager &dict, size_t id, hdt::TripleComponentRole role);
+
+    // Removes all cached terms
+    void clear();
+
+    // Returns whether the value is an integer id of a term in the given role, so that it can be decoded safely
+    static bool is_valid_id(DictionaryManager &dict, double id, hdt::TripleComponentRole role);
+
+    [[nodiscard]] size_t capacity() const { return max_size; }
+    [[nodiscard]] size_t size();
+
+private:
+    typedef std::pair<TermCacheKey, std::string> Entry;
+
+    const size_t max_size;
+    std::mutex mutex;
+    // Most recently used entries first
+    std::list<Entry> entries;
+    std::unordered_map<TermCacheKey, std::list<Entry>::iterator, TermCacheKeyHash> index;
+
+    static std::string decode(DictionaryManager &dict, size_t id, hdt::TripleComponentRole role);
+};
+
+#endif //OSTRICH_TERMCACHE_H
@@ -0,0 +1,83 @@
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "TripleBatch.h"
+
+TripleBatchBuilder::TripleBatchBuilder(TripleBatchKind kind, TermCache &cache) : kind(kind), cache(cache), term_offsets({0}) {
+    if (kind == TRIPLE_BATCH_VERSION) {
+        version_offsets.push_back(0);
+    }
+}
+
+void TripleBatchBuilder::add(const Triple &triple, DictionaryManager &dict) {
+    add_terms(triple, dict);
+}
+
+void TripleBatchBuilder::add(const Triple &triple, DictionaryManager &dict, bool addition) {
+    add_terms(triple, dict);
+    additions.push_back(addition ? 1 : 0);
+}
+
+void TripleBatchBuilder::add(const Triple &triple, DictionaryManager &dict, const std::vector<int> &triple_versions) {
+    add_terms(triple, dict);
+    versions.insert(versions.end(), triple_versions.begin(), triple_versions.end());
+    version_offsets.push_back((uint32_t) versions.size());
+}
+
+void TripleBatchBuilder::add_terms(const Triple &triple, DictionaryManager &dict) {
+    triple_terms.push_back(intern(triple, dict, hdt::SUBJECT));
+    triple_terms.push_back(intern(triple, dict, hdt::PREDICATE));
+    triple_terms.push_back(intern(triple, dict, hdt::OBJECT));
+}
+
+// Returns the index of the given triple component in the string table,
+// so that each distinct term is only stored once per batch.
+uint32_t TripleBatchBuilder::intern(const Triple &triple, DictionaryManager &dict, hdt::TripleComponentRole role) {
+    size_t id = role == hdt::SUBJECT ? triple.get_subject() : role == hdt::PREDICATE ? triple.get_predicate() : triple.get_object();
+    TermCacheKey key{&dict, id, role};
+    auto it = term_indexes.find(key);
+    if (it != term_indexes.end()) {
+        return it->second;
+    }
+
+    terms += cache.get(dict, id, role);
+    auto index = (uint32_t) (term_offsets.size() - 1);
+    term_offsets.push_back((uint32_t) terms.size());
+    term_indexes.emplace(key, index);
+    return index;
+}
+
+char *TripleBatchBuilder::release(size_t &length) {
+    const uint32_t header[4] = {(uint32_t) kind, (uint32_t) size(), (uint32_t) (term_offsets.size() - 1), (uint32_t) terms.size()};
+    size_t additions_length = (additions.size() + 3) & ~((size_t) 3);
+
+    length = sizeof(header)
+             + term_offsets.size() * sizeof(uint32_t)
+             + triple_terms.size() * sizeof(uint32_t)
+             + additions_length
+             + version_offsets.size() * sizeof(uint32_t)
+             + versions.size() * sizeof(int32_t)
+             + terms.size();
+    char *data = (char *) malloc(length);
+    if (data == nullptr) {
+        throw std::runtime_error("Could not allocate a triple batch of " + std::to_string(length) + " bytes");
+    }
+
+    char *position = data;
+    auto write = [&position](const void *source, size_t bytes) {
+        if (bytes > 0) {
+            memcpy(position, source, bytes);
+            position += bytes;
+        }
+    };
+    write(header, sizeof(header));
+    write(term_offsets.data(), term_offsets.size() * sizeof(uint32_t));
+    write(triple_terms.data(), triple_terms.size() * sizeof(uint32_t));
+    write(additions.data(), additions.size());
+    memset(position, 0, additions_length - additions.size());
+    position += additions_length - additions.size();
+    write(version_offsets.data(), version_offsets.size() * sizeof(uint32_t));
+    write(versions.data(), versions.size() * sizeof(int32_t));
+    write(terms.data(), terms.size());
+    return data;
+}
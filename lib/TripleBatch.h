@@ -0,0 +1,62 @@
+#ifndef OSTRICH_TRIPLEBATCH_H
+#define OSTRICH_TRIPLEBATCH_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <HDTEnums.hpp>
+
+#include "../deps/ostrich/src/main/cpp/controller/controller.h"
+#include "TermCache.h"
+
+// The type of query results that are contained in a triple batch
+enum TripleBatchKind {
+    TRIPLE_BATCH_VERSION_MATERIALIZED = 0,
+    TRIPLE_BATCH_DELTA_MATERIALIZED = 1,
+    TRIPLE_BATCH_VERSION = 2,
+};
+
+// Packs query results into a single binary buffer,
+// so that it can be handed over to JavaScript without creating an object per triple.
+//
+// Layout (all integers are uint32 in host byte order, i.e. little-endian on all supported platforms):
+//   header:         kind, triple count, term count, string table length
+//   term offsets:   term count + 1 byte offsets into the string table
+//   triples:        subject, predicate and object term index for each triple
+//   additions:      (delta materialized only) one byte per triple, padded to 4 bytes
+//   versions:       (version only) triple count + 1 offsets into the version list, followed by the int32 versions
+//   string table:   the UTF-8 encoded terms, in their JavaScript representation
+class TripleBatchBuilder {
+public:
+    TripleBatchBuilder(TripleBatchKind kind, TermCache &cache);
+
+    // Adds a version materialized triple
+    void add(const Triple &triple, DictionaryManager &dict);
+    // Adds a delta materialized triple
+    void add(const Triple &triple, DictionaryManager &dict, bool addition);
+    // Adds a version triple
+    void add(const Triple &triple, DictionaryManager &dict, const std::vector<int> &triple_versions);
+
+    // The number of triples that were added
+    [[nodiscard]] size_t size() const { return triple_terms.size() / 3; }
+
+    // Serializes the batch into a newly malloc'ed buffer, the caller becomes the owner of it.
+    char *release(size_t &length);
+
+private:
+    TripleBatchKind kind;
+    TermCache &cache;
+    std::unordered_map<TermCacheKey, uint32_t, TermCacheKeyHash> term_indexes;
+    std::vector<uint32_t> term_offsets;
+    std::string terms;
+    std::vector<uint32_t> triple_terms;
+    std::vector<uint8_t> additions;
+    std::vector<uint32_t> version_offsets;
+    std::vector<int32_t> versions;
+
+    void add_terms(const Triple &triple, DictionaryManager &dict);
+    uint32_t intern(const Triple &triple, DictionaryManager &dict, hdt::TripleComponentRole role);
+};
+
+#endif //OSTRICH_TRIPLEBATCH_H
@@ -0,0 +1,117 @@
+import type * as RDF from '@rdfjs/types';
+import { stringToTerm } from 'rdf-string';
+
+/**
+ * The type of query results that are contained in a triple batch.
+ * This corresponds to TripleBatchKind in TripleBatch.h
+ */
+export enum TripleBatchKind {
+  VersionMaterialized = 0,
+  DeltaMaterialized = 1,
+  Version = 2,
+}
+
+const HEADER_SIZE = 16;
+
+/**
+ * A read-only view over a packed buffer of triples, as produced by TripleBatchBuilder in TripleBatch.cc.
+ *
+ * RDF/JS terms are only created once a triple is accessed,
+ * and every distinct term in the batch is created at most once.
+ */
+export class TripleBatch<Q extends RDF.Quad = RDF.Quad> implements Iterable<Q> {
+  public readonly kind: TripleBatchKind;
+  public readonly length: number;
+
+  private readonly termCount: number;
+  private readonly termOffsetsStart: number;
+  private readonly triplesStart: number;
+  private readonly additionsStart: number;
+  private readonly versionOffsetsStart: number;
+  private readonly versionsStart: number;
+  private readonly stringsStart: number;
+  private readonly terms: (RDF.Term | undefined)[];
+
+  public constructor(
+    public readonly buffer: Buffer,
+    public readonly dataFactory: RDF.DataFactory,
+  ) {
+    this.kind = buffer.readUInt32LE(0);
+    this.length = buffer.readUInt32LE(4);
+    this.termCount = buffer.readUInt32LE(8);
+    this.terms = new Array(this.termCount);
+
+    this.termOffsetsStart = HEADER_SIZE;
+    this.triplesStart = this.termOffsetsStart + (this.termCount + 1) * 4;
+    this.additionsStart = this.triplesStart + this.length * 12;
+    // Additions are stored as single bytes, padded to a multiple of 4
+    this.versionOffsetsStart = this.additionsStart +
+      (this.kind === TripleBatchKind.DeltaMaterialized ? (this.length + 3) & ~3 : 0);
+    if (this.kind === TripleBatchKind.Version) {
+      this.versionsStart = this.versionOffsetsStart + (this.length + 1) * 4;
+      this.stringsStart = this.versionsStart + buffer.readUInt32LE(this.versionOffsetsStart + this.length * 4) * 4;
+    } else {
+      this.versionsStart = this.versionOffsetsStart;
+      this.stringsStart = this.versionOffsetsStart;
+    }
+  }
+
+  /**
+   * Get the term at the given index of the string table.
+   * @param index A term index.
+   */
+  public getTerm(index: number): RDF.Term {
+    let term = this.terms[index];
+    if (!term) {
+      const start = this.buffer.readUInt32LE(this.termOffsetsStart + index * 4);
+      const end = this.buffer.readUInt32LE(this.termOffsetsStart + (index + 1) * 4);
+      term = stringToTerm(this.buffer.toString('utf8', this.stringsStart + start, this.stringsStart + end),
+        this.dataFactory);
+      this.terms[index] = term;
+    }
+    return term;
+  }
+
+  /**
+   * Get the triple at the given index.
+   * Delta materialized triples are annotated with `addition`, and version triples with `versions`.
+   * @param index A triple index.
+   */
+  public get(index: number): Q {
+    if (index < 0 || index >= this.length) {
+      throw new RangeError(`Triple index ${index} is out of range for a batch of ${this.length} triples`);
+    }
+    const offset = this.triplesStart + index * 12;
+    const quad = this.dataFactory.quad(
+      <RDF.Quad_Subject> this.getTerm(this.buffer.readUInt32LE(offset)),
+      <RDF.Quad_Predicate> this.getTerm(this.buffer.readUInt32LE(offset + 4)),
+      <RDF.Quad_Object> this.getTerm(this.buffer.readUInt32LE(offset + 8)),
+      this.dataFactory.defaultGraph(),
+    );
+    if (this.kind === TripleBatchKind.DeltaMaterialized) {
+      Object.assign(quad, { addition: this.buffer.readUInt8(this.additionsStart + index) === 1 });
+    } else if (this.kind === TripleBatchKind.Version) {
+      const start = this.buffer.readUInt32LE(this.versionOffsetsStart + index * 4);
+      const end = this.buffer.readUInt32LE(this.versionOffsetsStart + (index + 1) * 4);
+      const versions: number[] = [];
+      for (let i = start; i < end; i++) {
+        versions.push(this.buffer.readInt32LE(this.versionsStart + i * 4));
+      }
+      Object.assign(quad, { versions });
+    }
+    return <Q> quad;
+  }
+
+  public * [Symbol.iterator](): Iterator<Q> {
+    for (let i = 0; i < this.length; i++) {
+      yield this.get(i);
+    }
+  }
+
+  /**
+   * Materialize all triples in this batch into an array.
+   */
+  public toArray(): Q[] {
+    return [ ...this ];
+  }
+}
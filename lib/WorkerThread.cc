@@ -0,0 +1,30 @@
+#include "WorkerThread.h"
+
+#include <thread>
+
+// A worker that is executed on its own thread, and the handle through which its completion is signalled
+struct WorkerThread {
+    uv_async_t async;
+    Nan::AsyncWorker *worker;
+    std::thread thread;
+};
+
+void QueueWorkerOnOwnThread(Nan::AsyncWorker *worker) {
+    auto *work = new WorkerThread;
+    work->worker = worker;
+    work->async.data = work;
+    uv_async_init(Nan::GetCurrentEventLoop(), &work->async, [](uv_async_t *handle) {
+        auto *work = static_cast<WorkerThread *>(handle->data);
+        work->thread.join();
+        // This corresponds to the completion of workers in Nan::AsyncQueueWorker
+        work->worker->WorkComplete();
+        work->worker->Destroy();
+        uv_close((uv_handle_t *) handle, [](uv_handle_t *handle) {
+            delete static_cast<WorkerThread *>(handle->data);
+        });
+    });
+    work->thread = std::thread([work] {
+        work->worker->Execute();
+        uv_async_send(&work->async);
+    });
+}
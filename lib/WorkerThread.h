@@ -0,0 +1,13 @@
+#ifndef OSTRICH_WORKERTHREAD_H
+#define OSTRICH_WORKERTHREAD_H
+
+#include <nan.h>
+
+// Executes a worker on a thread of its own, of which the worker becomes the owner, instead of on the default libuv thread pool.
+// This is meant for workers that wait for JavaScript for a long time, such as streaming appends,
+// which would otherwise hold up file system or DNS operations, or each other when the thread pool is exhausted.
+// Must be called on the loop thread, which is kept alive until the worker has been completed,
+// like Nan::AsyncQueueWorker does.
+void QueueWorkerOnOwnThread(Nan::AsyncWorker *worker);
+
+#endif //OSTRICH_WORKERTHREAD_H
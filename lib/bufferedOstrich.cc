@@ -1,5 +1,6 @@
 #include <nan.h>
 #include "BufferedOstrichStore.h"
+#include "QueryCancellation.h"
 
 NAN_MODULE_INIT(InitOstrichModule) {
     Nan::Set(target, Nan::New("BufferedOstrichStore").ToLocalChecked(),
@@ -12,6 +13,8 @@ NAN_MODULE_INIT(InitOstrichModule) {
              Nan::New(DeltaMaterializationProcessor::GetConstructor()));
     Nan::Set(target, Nan::New("VersionQueryProcessor").ToLocalChecked(),
              Nan::New(VersionQueryProcessor::GetConstructor()));
+    Nan::Set(target, Nan::New("QueryCancellation").ToLocalChecked(),
+             Nan::New(QueryCancellationHandle::GetConstructor()));
 }
 
 NODE_MODULE(ostrich, InitOstrichModule)
@@ -1,5 +1,14 @@
+export * from './AppendStream';
+export * from './BatchQuery';
 export * from './IOstrichStoreNative';
 export * from './OstrichStore';
+export * from './QueryCancellation';
+export * from './QueryPool';
+export * from './QueryStats';
+export * from './QueryTrace';
+export * from './SlowQueryLog';
+export * from './QueryStream';
+export * from './TripleBatch';
 export * from './utils';
 export * from './IBufferedOstrichStoreNative';
 export * from './BufferedOstrichStore';
@@ -1,12 +1,15 @@
 #include <node.h>
 #include <nan.h>
 #include "OstrichStore.h"
+#include "QueryCancellation.h"
 
 NAN_MODULE_INIT(InitOstrichModule) {
     Nan::Set(target, Nan::New("OstrichStore").ToLocalChecked(),
              Nan::New(OstrichStore::GetConstructor()));
     Nan::Set(target, Nan::New("createOstrichStore").ToLocalChecked(),
              Nan::GetFunction(Nan::New<v8::FunctionTemplate>(OstrichStore::Create)).ToLocalChecked());
+    Nan::Set(target, Nan::New("QueryCancellation").ToLocalChecked(),
+             Nan::New(QueryCancellationHandle::GetConstructor()));
 }
 
 NODE_MODULE(ostrich, InitOstrichModule)
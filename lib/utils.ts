@@ -50,6 +50,28 @@ export function quadVersion(quad: RDF.Quad, versions: number[]): IQuadVersion {
   return <IQuadVersion> quad;
 }
 
+/**
+ * Create a view of subject, predicate and object dictionary ids over a buffer that was returned by OSTRICH.
+ * @param buffer A buffer of 64-bit floats.
+ */
+export function tripleIdsFromBuffer(buffer: Buffer): Float64Array {
+  return new Float64Array(buffer.buffer, buffer.byteOffset, buffer.length / Float64Array.BYTES_PER_ELEMENT);
+}
+
+/**
+ * Create a buffer over subject, predicate and object dictionary ids, so that it can be passed to OSTRICH.
+ * @param ids Dictionary ids.
+ */
+export function tripleIdsToBuffer(ids: Float64Array): Buffer {
+  return Buffer.from(ids.buffer, ids.byteOffset, ids.byteLength);
+}
+
+export interface ITriplePattern {
+  subject?: RDF.Term | null;
+  predicate?: RDF.Term | null;
+  object?: RDF.Term | null;
+}
+
 export interface IStringQuadDelta extends IStringQuad {
   addition: boolean;
 }
@@ -65,3 +87,15 @@ export interface IQuadDelta extends RDF.Quad {
 export interface IQuadVersion extends RDF.Quad {
   versions: number[];
 }
+
+/**
+ * The statistics of a version that was ingested from a dump.
+ */
+export interface IIngestProgress {
+  version: number;
+  tripleCount: number;
+  additionCount: number;
+  deletionCount: number;
+  parseSeconds: number;
+  appendSeconds: number;
+}
@@ -302,10 +302,88 @@ describe('append', () => {
           const { triples, cardinality } = await document
             .searchTriplesVersionMaterialized(null, null, null, { version: 0 });
 
+          expect(triples).toHaveLength(3);
+          expect(triples[0]).toEqual(_.omit(triples0[1], [ 'addition' ]));
+          expect(triples[1]).toEqual(_.omit(triples0[2], [ 'addition' ]));
+          expect(triples[2]).toEqual(_.omit(triples0[0], [ 'addition' ]));
+          expect(cardinality).toEqual(3);
+        });
+
+        it('should have 3 triples for version 1', async() => {
+          const { triples, cardinality } = await document
+            .searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+
           expect(triples).toHaveLength(3);
           expect(triples[0]).toEqual(_.omit(triples0[0], [ 'addition' ]));
-          expect(triples[1]).toEqual(_.omit(triples0[1], [ 'addition' ]));
-          expect(triples[2]).toEqual(_.omit(triples0[2], [ 'addition' ]));
+          expect(triples[1]).toEqual(_.omit(triples1[2], [ 'addition' ]));
+          expect(triples[2]).toEqual(_.omit(triples1[0], [ 'addition' ]));
+          expect(cardinality).toEqual(3);
+        });
+      });
+
+      describe('with more triples that are sorted on disk than runs that are merged at once', () => {
+        let document: OstrichStore;
+        // Each triple is spilled to a run of its own, so the runs are merged in multiple passes
+        const objects = [ ...new Array(200).keys() ].map(i => `o${String(i).padStart(3, '0')}`);
+
+        beforeEach(async() => {
+          document = await fromPath('./test/test-temp.ostrich', { readOnly: false });
+          await document.append([ quadDelta(quad('a', 'a', 'a'), true) ], 0);
+        });
+
+        afterEach(async() => {
+          // We completely remove the store
+          await document.close(true);
+        });
+
+        it('should append all triples', async() => {
+          expect(await document.append([ ...objects ].reverse().map(object => quadDelta(quad('b', 'b', object), true)), 1,
+            { sortMemory: 1 })).toEqual(200);
+
+          const { triples } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+          expect(triples.filter(triple => triple.subject.value === 'b').map(triple => triple.object.value).sort())
+            .toEqual(objects);
+        });
+      });
+
+      describe('with 3 non-sorted triples for version 0 and 4 triples for version 1 that are sorted on disk', () => {
+        let document: OstrichStore;
+        let count = 0;
+        const triples0 = [
+          quadDelta(quad('a', 'a', 'c'), true),
+          quadDelta(quad('a', 'a', 'a'), true),
+          quadDelta(quad('a', 'a', 'b'), true),
+        ];
+        const triples1 = [
+          quadDelta(quad('a', 'a', 'e'), true),
+          quadDelta(quad('a', 'a', 'a'), false),
+          quadDelta(quad('a', 'a', 'd'), true),
+          quadDelta(quad('a', 'a', 'b'), false),
+        ];
+
+        beforeEach(async() => {
+          document = await fromPath('./test/test-temp.ostrich', { readOnly: false });
+          count += await document.append(triples0, 0);
+          count += await document.append(triples1, 1, { sortMemory: 1 });
+        });
+
+        afterEach(async() => {
+          // We completely remove the store
+          await document.close(true);
+        });
+
+        it('should have inserted 7 triples', () => {
+          expect(count).toEqual(7);
+        });
+
+        it('should have 3 triples for version 0', async() => {
+          const { triples, cardinality } = await document
+            .searchTriplesVersionMaterialized(null, null, null, { version: 0 });
+
+          expect(triples).toHaveLength(3);
+          expect(triples[0]).toEqual(_.omit(triples0[1], [ 'addition' ]));
+          expect(triples[1]).toEqual(_.omit(triples0[2], [ 'addition' ]));
+          expect(triples[2]).toEqual(_.omit(triples0[0], [ 'addition' ]));
           expect(cardinality).toEqual(3);
         });
 
@@ -314,9 +392,9 @@ describe('append', () => {
             .searchTriplesVersionMaterialized(null, null, null, { version: 1 });
 
           expect(triples).toHaveLength(3);
-          expect(triples[0]).toEqual(_.omit(triples0[2], [ 'addition' ]));
+          expect(triples[0]).toEqual(_.omit(triples0[0], [ 'addition' ]));
           expect(triples[1]).toEqual(_.omit(triples1[2], [ 'addition' ]));
-          expect(triples[2]).toEqual(_.omit(triples1[3], [ 'addition' ]));
+          expect(triples[2]).toEqual(_.omit(triples1[0], [ 'addition' ]));
           expect(cardinality).toEqual(3);
         });
       });
@@ -0,0 +1,83 @@
+import 'jest-rdf';
+import * as fs from 'fs';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+const quad = require('rdf-quad');
+
+const DUMP = './test/test-temp-full-version.nt';
+
+describe('append full version', () => {
+  let document: OstrichStore;
+
+  beforeAll(() => {
+    // eslint-disable-next-line no-sync
+    fs.writeFileSync(DUMP, `<c> <a> <a> .
+<a> <a> <c> .
+<c> <a> <a> .
+`);
+  });
+
+  afterAll(() => {
+    // eslint-disable-next-line no-sync
+    fs.unlinkSync(DUMP);
+  });
+
+  afterEach(async() => {
+    await document.close(true);
+  });
+
+  it('should reject if the store is closed', async() => {
+    document = await fromPath('./test/test-temp-full.ostrich', { readOnly: false });
+    await document.close();
+
+    await expect(document.appendFullVersion([])).rejects.toThrow('Attempted to append to a closed OSTRICH store');
+    await expect(document.appendFromFile(DUMP)).rejects.toThrow('Attempted to append to a closed OSTRICH store');
+  });
+
+  it('should reject if the store is read-only', async() => {
+    document = await fromPath('./test/test-temp-full.ostrich', { readOnly: true });
+
+    await expect(document.appendFullVersion([]))
+      .rejects.toThrow('Attempted to append to an OSTRICH store in read-only mode');
+  });
+
+  it('should reject for a missing file', async() => {
+    document = await fromPath('./test/test-temp-full.ostrich', { readOnly: false });
+
+    await expect(document.appendFromFile('./test/missing.nt'))
+      .rejects.toThrow('Could not open the version dump ./test/missing.nt');
+  });
+
+  for (const sortMemory of [ undefined, 1 ]) {
+    it(`should append the changes with respect to the latest version with sort memory ${sortMemory}`, async() => {
+      document = await fromPath('./test/test-temp-full.ostrich', { readOnly: false });
+
+      expect(await document.appendFullVersion([
+        quad('b', 'a', 'a'),
+        quad('a', 'a', 'a'),
+        quad('a', 'a', 'b'),
+        quad('a', 'a', 'a'),
+      ], { sortMemory })).toEqual(3);
+      expect(await document.appendFullVersion([
+        quad('a', 'a', 'b'),
+        quad('a', 'a', 'c'),
+      ], { sortMemory })).toEqual(3);
+      expect(await document.appendFromFile(DUMP, { sortMemory })).toEqual(2);
+
+      expect(document.maxVersion).toEqual(2);
+      expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 0 })).triples)
+        .toEqualRdfQuadArray([
+          quad('a', 'a', 'a'),
+          quad('a', 'a', 'b'),
+          quad('b', 'a', 'a'),
+        ]);
+      expect((await document.searchTriplesDeltaMaterialized(null, null, null, { versionStart: 0, versionEnd: 1 })).triples
+        .map(triple => triple.addition)).toEqual([ false, true, false ]);
+      expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 2 })).triples)
+        .toBeRdfIsomorphic([
+          quad('a', 'a', 'c'),
+          quad('c', 'a', 'a'),
+        ]);
+    });
+  }
+});
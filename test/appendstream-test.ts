@@ -0,0 +1,216 @@
+import 'jest-rdf';
+import { promises as fs } from 'fs';
+import type { AppendStream } from '../lib/AppendStream';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+import type { IQuadDelta } from '../lib/utils';
+import { quadDelta } from '../lib/utils';
+const quad = require('rdf-quad');
+
+function writeAll(stream: AppendStream, triples: IQuadDelta[]): Promise<number> {
+  return new Promise((resolve, reject) => {
+    stream.on('error', reject);
+    stream.on('finish', () => resolve(stream.insertedCount!));
+    for (const triple of triples) {
+      stream.write(triple);
+    }
+    stream.end();
+  });
+}
+
+describe('append stream', () => {
+  describe('for a store that will cause errors', () => {
+    let document: OstrichStore;
+
+    it('should throw if the store is closed', async() => {
+      document = await fromPath('./test/test-temp-stream.ostrich', { readOnly: false });
+      await document.close();
+
+      expect(() => document.appendStream(0))
+        .toThrow('Attempted to append to a closed OSTRICH store');
+
+      await document.close(true);
+    });
+
+    it('should throw if the store is read-only', async() => {
+      document = await fromPath('./test/test-temp-stream.ostrich', { readOnly: true });
+
+      expect(() => document.appendStream(0))
+        .toThrow('Attempted to append to an OSTRICH store in read-only mode');
+
+      await document.close(true);
+    });
+
+    it('should emit an error for deletions in version 0', async() => {
+      document = await fromPath('./test/test-temp-stream.ostrich', { readOnly: false });
+
+      await expect(writeAll(document.appendStream(0, { chunkSize: 1 }), [
+        quadDelta(quad('a', 'a', 'a'), false),
+        quadDelta(quad('a', 'a', 'b'), true),
+      ])).rejects.toThrow('All triples of the initial snapshot MUST be additions, but a deletion was found.');
+
+      await document.close(true);
+    });
+
+    it('should emit an error if a chunk can not be pushed', async() => {
+      document = await fromPath('./test/test-temp-stream.ostrich', { readOnly: false });
+      let onAppended: any;
+      jest.spyOn(document.native, '_appendStream').mockImplementation((version, queueSize, sortMemory, cb) => {
+        onAppended = cb;
+        return {
+          _push: (triples, pushCb) => pushCb(new Error('Push error')),
+          _end: jest.fn(),
+          _abort: jest.fn(),
+        };
+      });
+
+      await expect(writeAll(document.appendStream(0), [
+        quadDelta(quad('a', 'a', 'a'), true),
+      ])).rejects.toThrow('Push error');
+      onAppended(new Error('Aborted'), 0);
+
+      await document.close(true);
+    });
+
+    it('should abort the native append when destroyed', async() => {
+      document = await fromPath('./test/test-temp-stream.ostrich', { readOnly: false });
+      const processor = {
+        _push: jest.fn(),
+        _end: jest.fn(),
+        _abort: jest.fn(),
+      };
+      const onAppended: any[] = [];
+      jest.spyOn(document.native, '_appendStream').mockImplementation((version, queueSize, sortMemory, cb) => {
+        onAppended.push(cb);
+        return processor;
+      });
+
+      document.appendStream(0).destroy();
+      expect(processor._abort).toHaveBeenCalledWith('The append stream was destroyed before it ended');
+      const stream = document.appendStream(0);
+      stream.on('error', () => {
+        // Ignore the error
+      });
+      stream.destroy(new Error('Stream error'));
+      expect(processor._abort).toHaveBeenCalledWith('Stream error');
+      for (const cb of onAppended) {
+        cb(new Error('Aborted'), 0);
+      }
+
+      await document.close(true);
+    });
+
+    it('should finish if the native append finishes before the stream ends', async() => {
+      document = await fromPath('./test/test-temp-stream.ostrich', { readOnly: false });
+      jest.spyOn(document.native, '_appendStream').mockImplementation((version, queueSize, sortMemory, cb) => {
+        cb(undefined, 0);
+        return {
+          _push: jest.fn(),
+          _end: jest.fn(),
+          _abort: jest.fn(),
+        };
+      });
+
+      expect(await writeAll(document.appendStream(0), [])).toEqual(0);
+
+      await document.close(true);
+    });
+  });
+
+  describe('with sorting', () => {
+    let document: OstrichStore;
+
+    beforeEach(async() => {
+      document = await fromPath('./test/test-temp-stream.ostrich', { readOnly: false });
+    });
+
+    afterEach(async() => {
+      await document.close(true);
+    });
+
+    for (const sortMemory of [ undefined, 1 ]) {
+      it(`should sort triples that are written in any order with sort memory ${sortMemory}`, async() => {
+        expect(await writeAll(document.appendStream(0), [
+          quadDelta(quad('a', 'a', 'a'), true),
+        ])).toEqual(1);
+        expect(await writeAll(document.appendStream(1, { chunkSize: 1, sort: true, sortMemory }), [
+          quadDelta(quad('c', 'a', 'a'), true),
+          quadDelta(quad('a', 'a', 'a'), false),
+          quadDelta(quad('b', 'a', 'a'), true),
+        ])).toEqual(3);
+
+        expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })).triples)
+          .toEqualRdfQuadArray([
+            quad('b', 'a', 'a'),
+            quad('c', 'a', 'a'),
+          ]);
+      });
+    }
+  });
+
+  describe('with concurrent streams', () => {
+    const paths = [ 0, 1, 2, 3, 4 ].map(i => `./test/test-temp-stream-${i}.ostrich`);
+    let documents: OstrichStore[];
+
+    beforeEach(async() => {
+      documents = await Promise.all(paths.map(path => fromPath(path, { readOnly: false })));
+    });
+
+    afterEach(async() => {
+      await Promise.all(documents.map(document => document.close(true)));
+    });
+
+    it('should not occupy the libuv thread pool while waiting for triples', async() => {
+      // More streams than the default number of libuv threads, of which the queues are full
+      const triples = [ 0, 1, 2, 3, 4, 5, 6, 7 ].map(i => quadDelta(quad('a', 'a', `o${i}`), true));
+      const appends = documents.map(document => writeAll(document.appendStream(0, { chunkSize: 1, queueSize: 1 }), triples));
+
+      expect((await fs.readFile(__filename)).length).toBeGreaterThan(0);
+      expect(await Promise.all(appends)).toEqual(documents.map(() => triples.length));
+    });
+  });
+
+  for (const chunkSize of [ undefined, 1, 2 ]) {
+    describe(`with chunk size ${chunkSize}`, () => {
+      let document: OstrichStore;
+      const triples0 = [
+        quadDelta(quad('a', 'a', 'a'), true),
+        quadDelta(quad('a', 'a', 'b'), true),
+        quadDelta(quad('a', 'a', 'c'), true),
+      ];
+      const triples1 = [
+        quadDelta(quad('a', 'a', 'a'), false),
+        quadDelta(quad('a', 'a', 'b'), false),
+        quadDelta(quad('a', 'a', 'd'), true),
+        quadDelta(quad('a', 'a', 'e'), true),
+      ];
+
+      beforeEach(async() => {
+        document = await fromPath('./test/test-temp-stream.ostrich', { readOnly: false });
+      });
+
+      afterEach(async() => {
+        await document.close(true);
+      });
+
+      it('should append the same triples as append', async() => {
+        expect(await writeAll(document.appendStream(0, { chunkSize }), triples0)).toEqual(3);
+        expect(await writeAll(document.appendStream(-1, { chunkSize, queueSize: 1 }), triples1)).toEqual(4);
+        expect(document.maxVersion).toEqual(1);
+
+        expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 0 })).triples)
+          .toEqualRdfQuadArray([
+            quad('a', 'a', 'a'),
+            quad('a', 'a', 'b'),
+            quad('a', 'a', 'c'),
+          ]);
+        expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })).triples)
+          .toEqualRdfQuadArray([
+            quad('a', 'a', 'c'),
+            quad('a', 'a', 'd'),
+            quad('a', 'a', 'e'),
+          ]);
+      });
+    });
+  }
+});
@@ -0,0 +1,149 @@
+import 'jest-rdf';
+import { DataFactory } from 'rdf-data-factory';
+import { BatchQueryType } from '../lib/BatchQuery';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+const DF = new DataFactory();
+
+describe('batch query', () => {
+  describe('An ostrich store for an example ostrich path that will cause errors', () => {
+    let document: OstrichStore;
+
+    it('should throw when the store is closed', async() => {
+      cleanUp('batchquery');
+      document = await initializeThreeVersions('batchquery');
+      await document.close();
+
+      await expect(document.searchBatch([]))
+        .rejects.toThrow('Attempted to query a closed OSTRICH store');
+
+      await closeAndCleanUp(document, 'batchquery');
+    });
+
+    it('should throw when the store has no versions', async() => {
+      cleanUp('batchquery');
+      document = await fromPath(`./test/test-batchquery.ostrich`, { readOnly: false });
+
+      await expect(document.searchBatch([]))
+        .rejects.toThrow('Attempted to query an OSTRICH store without versions');
+
+      await closeAndCleanUp(document, 'batchquery');
+    });
+
+    it('should throw on invalid delta materialized version ranges', async() => {
+      cleanUp('batchquery');
+      document = await initializeThreeVersions('batchquery');
+
+      await expect(document.searchBatch([
+        { type: BatchQueryType.SearchDeltaMaterialized, versionStart: 1, versionEnd: 0 },
+      ])).rejects.toThrow(`'versionStart' must be strictly smaller than 'versionEnd'`);
+      await expect(document.searchBatch([
+        { type: BatchQueryType.CountDeltaMaterialized, versionStart: 0, versionEnd: 10 },
+      ])).rejects.toThrow(`'versionEnd' can not be larger than the maximum version (2)`);
+
+      await closeAndCleanUp(document, 'batchquery');
+    });
+
+    it('should throw when an internal error is thrown', async() => {
+      cleanUp('batchquery');
+      document = await initializeThreeVersions('batchquery');
+
+      jest.spyOn(document.native, '_searchBatch')
+        .mockImplementation((queries, parallelism, cb: any) => cb(new Error('Internal error')));
+
+      await expect(document.searchBatch([])).rejects.toThrow('Internal error');
+
+      await closeAndCleanUp(document, 'batchquery');
+    });
+  });
+
+  for (const parallelism of [ undefined, 1, 4 ]) {
+    describe(`An ostrich store for an example ostrich path with parallelism ${parallelism}`, () => {
+      let document: OstrichStore;
+      beforeAll(async() => {
+        cleanUp('batchquery');
+        document = await initializeThreeVersions('batchquery');
+      });
+      afterAll(async() => {
+        await closeAndCleanUp(document, 'batchquery');
+      });
+
+      it('should return no results for no queries', async() => {
+        expect(await document.searchBatch([], { parallelism })).toEqual([]);
+      });
+
+      it('should return the same results as the individual queries', async() => {
+        const results = await document.searchBatch([
+          { type: BatchQueryType.SearchVersionMaterialized, subject: DF.namedNode('a'), version: 1 },
+          { type: BatchQueryType.SearchVersionMaterialized, offset: 1, limit: 2 },
+          { type: BatchQueryType.SearchDeltaMaterialized, versionStart: 0, versionEnd: 2 },
+          { type: BatchQueryType.SearchVersion, predicate: DF.namedNode('b') },
+          { type: BatchQueryType.CountVersionMaterialized, version: 0 },
+          { type: BatchQueryType.CountDeltaMaterialized, versionStart: 0, versionEnd: 1 },
+          { type: BatchQueryType.CountVersion, object: DF.namedNode('c') },
+        ], { parallelism });
+        expect(results).toHaveLength(7);
+
+        const vm1 = await document.searchTriplesVersionMaterialized(DF.namedNode('a'), null, null, { version: 1 });
+        expect(results[0].triples!.toArray()).toEqualRdfQuadArray(vm1.triples);
+        expect(results[0].cardinality).toEqual(vm1.cardinality);
+
+        const vm2 = await document.searchTriplesVersionMaterialized(null, null, null, { offset: 1, limit: 2 });
+        expect(results[1].triples!.toArray()).toEqualRdfQuadArray(vm2.triples);
+        expect(results[1].cardinality).toEqual(vm2.cardinality);
+
+        const dm = await document
+          .searchTriplesDeltaMaterialized(null, null, null, { versionStart: 0, versionEnd: 2 });
+        expect(results[2].triples!.toArray()).toEqualRdfQuadArray(dm.triples);
+
+        const vq = await document.searchTriplesVersion(null, DF.namedNode('b'), null);
+        expect(results[3].triples!.toArray()).toEqualRdfQuadArray(vq.triples);
+
+        expect(results[4].triples).toBeUndefined();
+        expect(results[4].cardinality)
+          .toEqual((await document.countTriplesVersionMaterialized(null, null, null, 0)).cardinality);
+        expect(results[5].triples).toBeUndefined();
+        expect(results[5].cardinality)
+          .toEqual((await document.countTriplesDeltaMaterialized(null, null, null, 0, 1)).cardinality);
+        expect(results[6].triples).toBeUndefined();
+        expect(results[6].cardinality)
+          .toEqual((await document.countTriplesVersion(null, null, DF.namedNode('c'))).cardinality);
+      });
+
+      it('should report exact counts in the same way as the individual queries', async() => {
+        const results = await document.searchBatch([
+          { type: BatchQueryType.SearchVersionMaterialized, version: 1 },
+          { type: BatchQueryType.SearchVersionMaterialized, version: 1, limit: 2 },
+          { type: BatchQueryType.SearchVersionMaterialized, predicate: DF.namedNode('unknown'), version: 1 },
+        ], { parallelism });
+        const expected = [
+          await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 }),
+          await document.searchTriplesVersionMaterialized(null, null, null, { version: 1, limit: 2 }),
+          await document.searchTriplesVersionMaterialized(null, DF.namedNode('unknown'), null, { version: 1 }),
+        ];
+        expect(results.map(result => result.exactCardinality))
+          .toEqual(expected.map(result => result.exactCardinality));
+        expect(results.map(result => result.truncated)).toEqual([ false, false, false ]);
+      });
+
+      it('should truncate the searches of a cancelled batch', async() => {
+        const controller = new AbortController();
+        controller.abort();
+        const results = await document.searchBatch([
+          { type: BatchQueryType.SearchVersionMaterialized, version: 1 },
+          { type: BatchQueryType.SearchDeltaMaterialized, versionStart: 0, versionEnd: 2 },
+          { type: BatchQueryType.CountVersionMaterialized, version: 1 },
+        ], { parallelism, signal: controller.signal });
+        expect(results[0].triples!.length).toBe(0);
+        expect(results[0].truncated).toBe(true);
+        expect(results[1].triples!.length).toBe(0);
+        expect(results[1].truncated).toBe(true);
+        expect(results[2].truncated).toBe(false);
+        expect(results[2].cardinality)
+          .toEqual((await document.countTriplesVersionMaterialized(null, null, null, 1)).cardinality);
+      });
+    });
+  }
+});
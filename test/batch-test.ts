@@ -0,0 +1,215 @@
+import 'jest-rdf';
+import { DataFactory } from 'rdf-data-factory';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+import { TripleBatch, TripleBatchKind } from '../lib/TripleBatch';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+const quad = require('rdf-quad');
+
+const DF = new DataFactory();
+
+function packBatch(kind: TripleBatchKind, terms: string[], triples: number[][],
+  additions: boolean[], versions: number[][]): Buffer {
+  const strings = terms.map(term => Buffer.from(term, 'utf8'));
+  const uint32s: number[] = [ kind, triples.length, terms.length, strings.reduce((sum, str) => sum + str.length, 0) ];
+  let offset = 0;
+  uint32s.push(offset);
+  for (const str of strings) {
+    offset += str.length;
+    uint32s.push(offset);
+  }
+  for (const triple of triples) {
+    uint32s.push(...triple);
+  }
+  const parts = [ Buffer.from(new Uint32Array(uint32s).buffer) ];
+  if (kind === TripleBatchKind.DeltaMaterialized) {
+    const additionsBuffer = Buffer.alloc((additions.length + 3) & ~3);
+    additions.forEach((addition, i) => additionsBuffer.writeUInt8(addition ? 1 : 0, i));
+    parts.push(additionsBuffer);
+  }
+  if (kind === TripleBatchKind.Version) {
+    const versionOffsets = [ 0 ];
+    for (const tripleVersions of versions) {
+      versionOffsets.push(versionOffsets[versionOffsets.length - 1] + tripleVersions.length);
+    }
+    parts.push(Buffer.from(new Uint32Array(versionOffsets).buffer));
+    parts.push(Buffer.from(new Int32Array((<number[]> []).concat(...versions)).buffer));
+  }
+  parts.push(...strings);
+  return Buffer.concat(parts);
+}
+
+describe('packed triple batches', () => {
+  describe('A TripleBatch', () => {
+    it('should decode version materialized triples', () => {
+      const batch = new TripleBatch(packBatch(TripleBatchKind.VersionMaterialized,
+        [ 'a', 'b', '"c"@en' ],
+        [[ 0, 1, 2 ], [ 0, 1, 0 ]],
+        [],
+        []), DF);
+      expect(batch.kind).toEqual(TripleBatchKind.VersionMaterialized);
+      expect(batch).toHaveLength(2);
+      expect(batch.toArray()).toEqualRdfQuadArray([
+        quad('a', 'b', '"c"@en'),
+        quad('a', 'b', 'a'),
+      ]);
+    });
+
+    it('should reuse terms that occur multiple times', () => {
+      const batch = new TripleBatch(packBatch(TripleBatchKind.VersionMaterialized,
+        [ 'a' ],
+        [[ 0, 0, 0 ], [ 0, 0, 0 ]],
+        [],
+        []), DF);
+      expect(batch.get(0).subject).toBe(batch.get(1).object);
+    });
+
+    it('should decode delta materialized triples', () => {
+      const batch = new TripleBatch(packBatch(TripleBatchKind.DeltaMaterialized,
+        [ 'a', 'b', 'c' ],
+        [[ 0, 1, 2 ], [ 2, 1, 0 ]],
+        [ true, false ],
+        []), DF);
+      expect(batch.get(0)).toEqualRdfQuad(quad('a', 'b', 'c'));
+      expect((<any> batch.get(0)).addition).toBe(true);
+      expect(batch.get(1)).toEqualRdfQuad(quad('c', 'b', 'a'));
+      expect((<any> batch.get(1)).addition).toBe(false);
+    });
+
+    it('should decode version triples', () => {
+      const batch = new TripleBatch(packBatch(TripleBatchKind.Version,
+        [ 'a', 'b', 'c' ],
+        [[ 0, 1, 2 ], [ 2, 1, 0 ]],
+        [],
+        [[ 0, 1 ], [ 2 ]]), DF);
+      expect(batch.get(0)).toEqualRdfQuad(quad('a', 'b', 'c'));
+      expect((<any> batch.get(0)).versions).toEqual([ 0, 1 ]);
+      expect(batch.get(1)).toEqualRdfQuad(quad('c', 'b', 'a'));
+      expect((<any> batch.get(1)).versions).toEqual([ 2 ]);
+    });
+
+    it('should throw on an out-of-range index', () => {
+      const batch = new TripleBatch(packBatch(TripleBatchKind.VersionMaterialized, [], [], [], []), DF);
+      expect(() => batch.get(0)).toThrow('Triple index 0 is out of range for a batch of 0 triples');
+      expect(() => batch.get(-1)).toThrow('Triple index -1 is out of range for a batch of 0 triples');
+    });
+  });
+
+  describe('An ostrich store for an example ostrich path that will cause errors', () => {
+    let document: OstrichStore;
+
+    it('should throw when the store is closed', async() => {
+      cleanUp('batch');
+      document = await initializeThreeVersions('batch');
+      await document.close();
+
+      await expect(document.searchTriplesVersionMaterializedBatch(null, null, null))
+        .rejects.toThrow('Attempted to query a closed OSTRICH store');
+      await expect(document.searchTriplesDeltaMaterializedBatch(null, null, null, { versionStart: 0, versionEnd: 1 }))
+        .rejects.toThrow('Attempted to query a closed OSTRICH store');
+      await expect(document.searchTriplesVersionBatch(null, null, null))
+        .rejects.toThrow('Attempted to query a closed OSTRICH store');
+
+      await closeAndCleanUp(document, 'batch');
+    });
+
+    it('should throw when the store has no versions', async() => {
+      cleanUp('batch');
+      document = await fromPath(`./test/test-batch.ostrich`, { readOnly: false });
+
+      await expect(document.searchTriplesVersionMaterializedBatch(null, null, null))
+        .rejects.toThrow('Attempted to query an OSTRICH store without versions');
+      await expect(document.searchTriplesDeltaMaterializedBatch(null, null, null, { versionStart: 0, versionEnd: 1 }))
+        .rejects.toThrow('Attempted to query an OSTRICH store without versions');
+      await expect(document.searchTriplesVersionBatch(null, null, null))
+        .rejects.toThrow('Attempted to query an OSTRICH store without versions');
+
+      await closeAndCleanUp(document, 'batch');
+    });
+
+    it('should throw on invalid delta versions', async() => {
+      cleanUp('batch');
+      document = await initializeThreeVersions('batch');
+
+      await expect(document.searchTriplesDeltaMaterializedBatch(null, null, null, { versionStart: 1, versionEnd: 0 }))
+        .rejects.toThrow(`'versionStart' must be strictly smaller than 'versionEnd'`);
+      await expect(document.searchTriplesDeltaMaterializedBatch(null, null, null, { versionStart: 0, versionEnd: 10 }))
+        .rejects.toThrow(`'versionEnd' can not be larger than the maximum version (2)`);
+
+      await closeAndCleanUp(document, 'batch');
+    });
+
+    it('should throw when an internal error is thrown', async() => {
+      cleanUp('batch');
+      document = await initializeThreeVersions('batch');
+
+      jest.spyOn(document.native, '_searchTriplesVersionMaterializedPacked')
+        .mockImplementation((subject, predicate, object, offset, limit, version, cb: any) =>
+          cb(new Error('Internal error')));
+      jest.spyOn(document.native, '_searchTriplesDeltaMaterializedPacked')
+        .mockImplementation((subject, predicate, object, offset, limit, versionStart, versionEnd, cb: any) =>
+          cb(new Error('Internal error')));
+      jest.spyOn(document.native, '_searchTriplesVersionPacked')
+        .mockImplementation((subject, predicate, object, offset, limit, cb: any) =>
+          cb(new Error('Internal error')));
+
+      await expect(document.searchTriplesVersionMaterializedBatch(null, null, null))
+        .rejects.toThrow('Internal error');
+      await expect(document.searchTriplesDeltaMaterializedBatch(null, null, null, { versionStart: 0, versionEnd: 1 }))
+        .rejects.toThrow('Internal error');
+      await expect(document.searchTriplesVersionBatch(null, null, null))
+        .rejects.toThrow('Internal error');
+
+      await closeAndCleanUp(document, 'batch');
+    });
+  });
+
+  describe('An ostrich store for an example ostrich path', () => {
+    let document: OstrichStore;
+    beforeAll(async() => {
+      cleanUp('batch');
+      document = await initializeThreeVersions('batch');
+    });
+    afterAll(async() => {
+      await closeAndCleanUp(document, 'batch');
+    });
+
+    it('should return the same version materialized triples as the unpacked search', async() => {
+      for (const version of [ 0, 1, 2 ]) {
+        const expected = await document.searchTriplesVersionMaterialized(null, null, null, { version });
+        const actual = await document.searchTriplesVersionMaterializedBatch(null, null, null, { version });
+        expect(actual.triples.toArray()).toEqualRdfQuadArray(expected.triples);
+        expect(actual.cardinality).toEqual(expected.cardinality);
+        expect(actual.exactCardinality).toEqual(expected.exactCardinality);
+      }
+    });
+
+    it('should return the same version materialized triples for a pattern with offset and limit', async() => {
+      const options = { offset: 1, limit: 2 };
+      const expected = await document.searchTriplesVersionMaterialized(DF.namedNode('a'), null, null, options);
+      const actual = await document.searchTriplesVersionMaterializedBatch(DF.namedNode('a'), null, null, options);
+      expect(actual.triples.toArray()).toEqualRdfQuadArray(expected.triples);
+      expect(actual.cardinality).toEqual(expected.cardinality);
+      expect(actual.exactCardinality).toEqual(expected.exactCardinality);
+    });
+
+    it('should return the same delta materialized triples as the unpacked search', async() => {
+      const options = { versionStart: 0, versionEnd: 2 };
+      const expected = await document.searchTriplesDeltaMaterialized(null, null, null, options);
+      const actual = await document.searchTriplesDeltaMaterializedBatch(null, null, null, options);
+      expect(actual.triples.toArray()).toEqualRdfQuadArray(expected.triples);
+      expect(actual.triples.toArray().map(triple => triple.addition))
+        .toEqual(expected.triples.map(triple => triple.addition));
+      expect(actual.cardinality).toEqual(expected.cardinality);
+    });
+
+    it('should return the same version triples as the unpacked search', async() => {
+      const expected = await document.searchTriplesVersion(null, null, null, { limit: 5 });
+      const actual = await document.searchTriplesVersionBatch(null, null, null, { limit: 5 });
+      expect(actual.triples.toArray()).toEqualRdfQuadArray(expected.triples);
+      expect(actual.triples.toArray().map(triple => triple.versions))
+        .toEqual(expected.triples.map(triple => triple.versions));
+      expect(actual.cardinality).toEqual(expected.cardinality);
+    });
+  });
+});
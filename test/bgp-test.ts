@@ -0,0 +1,101 @@
+import 'jest-rdf';
+import { DataFactory } from 'rdf-data-factory';
+import { termToString } from 'rdf-string';
+import type { BindingsIterator, BufferedOstrichStore } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import { cleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+const DF = new DataFactory();
+
+// Reads all bindings, with their terms as strings and their variables in the order in which they were bound
+async function readBindings(iterator: BindingsIterator): Promise<Record<string, string>[]> {
+  const bindings: Record<string, string>[] = [];
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    for (const binding of batch) {
+      const stringBinding: Record<string, string> = {};
+      for (const variable of Object.keys(binding)) {
+        stringBinding[variable] = termToString(binding[variable]);
+      }
+      bindings.push(stringBinding);
+    }
+    done = batchDone;
+  }
+  return bindings.sort((left, right) => JSON.stringify(left).localeCompare(JSON.stringify(right)));
+}
+
+describe('basic graph patterns', () => {
+  let document: BufferedOstrichStore;
+  beforeEach(async() => {
+    cleanUp('bgp');
+    await (await initializeThreeVersions('bgp', { readOnly: false })).close();
+    document = await fromPathBuffered('./test/test-bgp.ostrich', 2, { readOnly: true });
+  });
+  afterEach(async() => {
+    if (!document.closed) {
+      await document.close();
+    }
+    cleanUp('bgp');
+  });
+
+  it('should evaluate the pattern with the fewest matches first', async() => {
+    const bindings = await readBindings(document.searchBgpVersionMaterialized([
+      { subject: DF.variable('x'), predicate: DF.variable('p'), object: DF.variable('y') },
+      { subject: DF.variable('x'), predicate: DF.namedNode('b'), object: DF.variable('o') },
+    ], { version: 2 }));
+    expect(bindings).toHaveLength(20);
+    // Variables are bound in the order in which the patterns are evaluated
+    expect(Object.keys(bindings[0])).toEqual([ 'x', 'o', 'p', 'y' ]);
+  });
+
+  it('should prefer patterns that are connected to the previous ones over cartesian products', async() => {
+    const bindings = await readBindings(document.searchBgpVersionMaterialized([
+      { subject: DF.namedNode('a'), predicate: DF.namedNode('b'), object: DF.variable('y') },
+      { subject: DF.variable('x'), predicate: DF.variable('p'), object: DF.variable('o') },
+      { subject: DF.namedNode('q'), predicate: DF.namedNode('q'), object: DF.variable('x') },
+    ], { version: 2 }));
+    expect(bindings).toEqual([
+      { x: 'q', p: 'q', o: 'q', y: 'c' },
+      { x: 'q', p: 'q', o: 'q', y: 'd' },
+      { x: 'q', p: 'q', o: 'q', y: 'f' },
+      { x: 'q', p: 'q', o: 'q', y: 'g' },
+    ]);
+    expect(Object.keys(bindings[0])).toEqual([ 'x', 'p', 'o', 'y' ]);
+  });
+
+  it('should join a variable that is bound as an object on the subjects of a later pattern', async() => {
+    expect(await readBindings(document.searchBgpVersionMaterialized([
+      { subject: DF.namedNode('a'), predicate: DF.namedNode('b'), object: DF.variable('y') },
+      { subject: DF.variable('y'), predicate: DF.variable('p'), object: DF.variable('z') },
+    ], { version: 2 }))).toEqual([
+      { y: 'c', p: 'c', z: 'c' },
+      { y: 'f', p: 'r', z: 's' },
+    ]);
+  });
+
+  it('should compare a variable that occurs as both subject and object of a pattern by its term', async() => {
+    expect(await readBindings(document.searchBgpVersionMaterialized([
+      { subject: DF.variable('x'), predicate: DF.variable('p'), object: DF.variable('x') },
+    ], { version: 2 }))).toEqual([
+      { x: 'c', p: 'c' },
+      { x: 'q', p: 'q' },
+      { x: 'r', p: 'r' },
+      { x: 'z', p: 'z' },
+    ]);
+  });
+
+  it('should produce a single empty binding for an empty pattern', async() => {
+    expect(await document.searchBgpVersionMaterialized([], { version: 2 }).next()).toEqual([ true, [{}]]);
+  });
+
+  it('should produce no bindings if a pattern has no matches', async() => {
+    expect(await readBindings(document.searchBgpVersionMaterialized([
+      { subject: DF.variable('x'), predicate: DF.namedNode('b'), object: DF.variable('y') },
+      { subject: DF.variable('y'), predicate: DF.namedNode('unknown'), object: DF.variable('z') },
+    ], { version: 2 }))).toEqual([]);
+    expect(await document.searchBgpVersionMaterialized([
+      { subject: DF.namedNode('unknown'), predicate: DF.variable('p'), object: DF.variable('o') },
+    ], { version: 2 }).next()).toEqual([ true, []]);
+  });
+});
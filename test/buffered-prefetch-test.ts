@@ -0,0 +1,87 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import type { BufferedOstrichStore, QueryIterator } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import { cleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+async function readAll(iterator: QueryIterator): Promise<RDF.Quad[]> {
+  const quads: RDF.Quad[] = [];
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    quads.push(...batch);
+    done = batchDone;
+  }
+  return quads;
+}
+
+describe('buffered iterator prefetching', () => {
+  let reference: BufferedOstrichStore;
+  let document: BufferedOstrichStore;
+  beforeEach(async() => {
+    cleanUp('prefetch');
+    await (await initializeThreeVersions('prefetch', { readOnly: false })).close();
+    reference = await fromPathBuffered('./test/test-prefetch.ostrich', 100, { readOnly: true, prefetch: false });
+    document = await fromPathBuffered('./test/test-prefetch.ostrich', 1, { readOnly: true, maxBufferSize: 4 });
+  });
+  afterEach(async() => {
+    await reference.close();
+    await document.close();
+    cleanUp('prefetch');
+  });
+
+  it('should return the same version materialized results as without prefetching', async() => {
+    expect(await readAll(document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })))
+      .toEqualRdfQuadArray(await readAll(reference.searchTriplesVersionMaterialized(null, null, null, { version: 1 })));
+  });
+
+  it('should return the same delta materialized results as without prefetching', async() => {
+    const options = { versionStart: 0, versionEnd: 2 };
+    expect(await readAll(document.searchTriplesDeltaMaterialized(null, null, null, options)))
+      .toEqualRdfQuadArray(await readAll(reference.searchTriplesDeltaMaterialized(null, null, null, options)));
+  });
+
+  it('should return the same version results as without prefetching', async() => {
+    expect(await readAll(document.searchTriplesVersion(null, null, null)))
+      .toEqualRdfQuadArray(await readAll(reference.searchTriplesVersion(null, null, null)));
+  });
+
+  it('should grow batches up to the maximum buffer size while the consumer waits', async() => {
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+    const sizes: number[] = [];
+    let done = false;
+    while (!done) {
+      const [ batchDone, batch ] = await iterator.next();
+      sizes.push(batch.length);
+      done = batchDone;
+    }
+    expect(sizes[0]).toEqual(1);
+    expect(Math.max(...sizes)).toBeLessThanOrEqual(4);
+    expect(iterator.currentBufferSize).toBeLessThanOrEqual(4);
+  });
+
+  it('should shrink batches that exceed the maximum number of bytes', async() => {
+    const store = await fromPathBuffered('./test/test-prefetch.ostrich', 4, { readOnly: true, maxBufferBytes: 1 });
+    const iterator = store.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+    const [ , first ] = await iterator.next();
+    expect(first).toHaveLength(4);
+    expect(iterator.currentBufferSize).toEqual(1);
+    await readAll(iterator);
+    await store.close();
+  });
+
+  it('should not skip prefetched results in continuation tokens', async() => {
+    const expected = await readAll(reference.searchTriplesVersionMaterialized(null, null, null, { version: 1 }));
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+    const [ , first ] = await iterator.next();
+    const rest = await readAll(document.resume(iterator.continuationToken()));
+    await readAll(iterator);
+    expect([ ...first, ...rest ]).toEqualRdfQuadArray(expected);
+  });
+
+  it('should return no more results after being done', async() => {
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 0 });
+    await readAll(iterator);
+    expect(await iterator.next()).toEqual([ true, []]);
+  });
+});
@@ -0,0 +1,139 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import type { BufferedOstrichStore, QueryIterator } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+function abortedSignal(): AbortSignal {
+  const controller = new AbortController();
+  controller.abort();
+  return controller.signal;
+}
+
+async function readAll(iterator: QueryIterator): Promise<RDF.Quad[]> {
+  const quads: RDF.Quad[] = [];
+  let done = false;
+  while (!done) {
+    let batch: RDF.Quad[];
+    [ done, batch ] = await iterator.next();
+    quads.push(...batch);
+  }
+  return quads;
+}
+
+describe('cancellation', () => {
+  describe('of queries', () => {
+    let document: OstrichStore;
+    beforeEach(async() => {
+      cleanUp('cancellation');
+      document = await initializeThreeVersions('cancellation');
+    });
+    afterEach(async() => {
+      await closeAndCleanUp(document, 'cancellation');
+    });
+
+    it('should not truncate queries without a signal or timeout', async() => {
+      const { triples, truncated } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      expect(triples).toHaveLength(9);
+      expect(truncated).toBe(false);
+    });
+
+    it('should not truncate queries of which the signal is not aborted within the timeout', async() => {
+      const controller = new AbortController();
+      const { triples, truncated } = await document.searchTriplesVersionMaterialized(null, null, null,
+        { version: 1, signal: controller.signal, timeout: 60_000 });
+      expect(triples).toHaveLength(9);
+      expect(truncated).toBe(false);
+    });
+
+    it('should truncate version materialized queries of which the signal is aborted', async() => {
+      const { triples, exactCardinality, truncated } = await document
+        .searchTriplesVersionMaterialized(null, null, null, { version: 1, signal: abortedSignal() });
+      expect(triples).toHaveLength(0);
+      expect(exactCardinality).toBe(false);
+      expect(truncated).toBe(true);
+    });
+
+    it('should truncate packed version materialized queries of which the signal is aborted', async() => {
+      const { triples, truncated } = await document
+        .searchTriplesVersionMaterializedBatch(null, null, null, { version: 1, signal: abortedSignal() });
+      expect(triples.length).toBe(0);
+      expect(truncated).toBe(true);
+    });
+
+    it('should truncate triple id queries of which the signal is aborted', async() => {
+      const { ids, exactCardinality, truncated } = await document
+        .searchTripleIdsVersionMaterialized(null, null, null, { version: 1, signal: abortedSignal() });
+      expect(ids).toHaveLength(0);
+      expect(exactCardinality).toBe(false);
+      expect(truncated).toBe(true);
+    });
+
+    it('should truncate delta materialized queries of which the signal is aborted', async() => {
+      const { triples, truncated } = await document.searchTriplesDeltaMaterialized(null, null, null,
+        { versionStart: 0, versionEnd: 1, signal: abortedSignal() });
+      expect(triples).toHaveLength(0);
+      expect(truncated).toBe(true);
+    });
+
+    it('should truncate version queries of which the signal is aborted', async() => {
+      const { triples, truncated } = await document.searchTriplesVersion(null, null, null,
+        { signal: abortedSignal() });
+      expect(triples).toHaveLength(0);
+      expect(truncated).toBe(true);
+    });
+  });
+
+  describe('of buffered queries', () => {
+    let document: BufferedOstrichStore;
+    beforeEach(async() => {
+      cleanUp('cancellation-buffered');
+      await (await initializeThreeVersions('cancellation-buffered', { readOnly: false })).close();
+      document = await fromPathBuffered('./test/test-cancellation-buffered.ostrich', 2,
+        { readOnly: true, prefetch: false });
+    });
+    afterEach(async() => {
+      if (!document.closed) {
+        await document.close();
+      }
+      cleanUp('cancellation-buffered');
+    });
+
+    it('should not truncate iterators without a signal or timeout', async() => {
+      const iterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      expect(await readAll(iterator)).toHaveLength(9);
+      expect(iterator.truncated).toBe(false);
+    });
+
+    it('should truncate iterators of which the signal is aborted', async() => {
+      const iterator = document.searchTriplesDeltaMaterialized(null, null, null,
+        { versionStart: 0, versionEnd: 1, signal: abortedSignal() });
+      expect(await readAll(iterator)).toHaveLength(0);
+      expect(iterator.truncated).toBe(true);
+    });
+
+    it('should stop iterators once their signal is aborted', async() => {
+      const controller = new AbortController();
+      const iterator = document.searchTriplesVersionMaterialized(null, null, null,
+        { version: 1, signal: controller.signal });
+      const [ , first ] = await iterator.next();
+      expect(first).toHaveLength(2);
+      controller.abort();
+      expect(await readAll(iterator)).toHaveLength(0);
+      expect(iterator.truncated).toBe(true);
+    });
+
+    it('should resume truncated iterators from their continuation token', async() => {
+      const all = await readAll(document.searchTriplesVersionMaterialized(null, null, null, { version: 1 }));
+      const controller = new AbortController();
+      const iterator = document.searchTriplesVersionMaterialized(null, null, null,
+        { version: 1, signal: controller.signal });
+      const [ , first ] = await iterator.next();
+      controller.abort();
+      await readAll(iterator);
+      const token = iterator.continuationToken();
+      expect(await readAll(document.resume(token))).toEqualRdfQuadArray(all.slice(first.length));
+    });
+  });
+});
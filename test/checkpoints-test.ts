@@ -0,0 +1,59 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { quadDelta } from '../lib/utils';
+import { closeAndCleanUp, cleanUp, initializeThreeVersions } from './prepare-ostrich';
+const quad = require('rdf-quad');
+
+describe('iterator checkpoints', () => {
+  for (const checkpointCount of [ undefined, 1, 16 ]) {
+    describe(`An ostrich store with checkpoint count ${checkpointCount}`, () => {
+      let document: OstrichStore;
+      beforeEach(async() => {
+        cleanUp('checkpoints');
+        document = await initializeThreeVersions('checkpoints', { readOnly: false, checkpointCount });
+      });
+      afterEach(async() => {
+        await closeAndCleanUp(document, 'checkpoints');
+      });
+
+      for (const limit of [ 1, 2, 3 ]) {
+        it(`should return the same version materialized pages of size ${limit} as a full search`, async() => {
+          const expected = (await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })).triples;
+          const pages: RDF.Quad[] = [];
+          for (let offset = 0; offset < expected.length; offset += limit) {
+            pages.push(...(await document
+              .searchTriplesVersionMaterialized(null, null, null, { version: 1, offset, limit })).triples);
+          }
+          expect(pages).toEqualRdfQuadArray(expected);
+        });
+
+        it(`should return the same delta materialized pages of size ${limit} as a full search`, async() => {
+          const options = { versionStart: 0, versionEnd: 2 };
+          const expected = (await document.searchTriplesDeltaMaterialized(null, null, null, options)).triples;
+          const pages: RDF.Quad[] = [];
+          for (let offset = 0; offset < expected.length; offset += limit) {
+            pages.push(...(await document
+              .searchTriplesDeltaMaterialized(null, null, null, { ...options, offset, limit })).triples);
+          }
+          expect(pages).toEqualRdfQuadArray(expected);
+        });
+      }
+
+      it('should return pages that skip over an earlier page', async() => {
+        const expected = (await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })).triples;
+        await document.searchTriplesVersionMaterialized(null, null, null, { version: 1, offset: 0, limit: 2 });
+        expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 1, offset: 5, limit: 2 }))
+          .triples).toEqualRdfQuadArray(expected.slice(5, 7));
+      });
+
+      it('should not resume pages of the previous latest version after an append', async() => {
+        await document.searchTriplesVersionMaterialized(null, null, null, { offset: 0, limit: 1 });
+        await document.append([ quadDelta(quad('a', 'a', '"a"^^http://example.org/literal'), false) ]);
+        const expected = (await document.searchTriplesVersionMaterialized(null, null, null)).triples;
+        expect((await document.searchTriplesVersionMaterialized(null, null, null, { offset: 1, limit: 1 })).triples)
+          .toEqualRdfQuadArray(expected.slice(1, 2));
+      });
+    });
+  }
+});
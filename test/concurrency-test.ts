@@ -0,0 +1,135 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import type { BufferedOstrichStore, QueryIterator } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { quadDelta } from '../lib/utils';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+const quad = require('rdf-quad');
+
+const dataV3 = [
+  quadDelta(quad('z', 'z', 'z'), false),
+  quadDelta(quad('z', 'z', '"z"^^<http://example.org/literal>'), true),
+];
+
+async function readAll(iterator: QueryIterator): Promise<RDF.Quad[]> {
+  const quads: RDF.Quad[] = [];
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    quads.push(...batch);
+    done = batchDone;
+  }
+  return quads;
+}
+
+describe('concurrency', () => {
+  let document: OstrichStore;
+  beforeEach(async() => {
+    cleanUp('concurrency');
+    document = await initializeThreeVersions('concurrency');
+  });
+  afterEach(async() => {
+    await closeAndCleanUp(document, 'concurrency');
+  });
+
+  it('should only expose a new version once it has been appended', async() => {
+    // The append can not complete before its stream has ended, so the queries below deterministically precede it
+    const stream = document.appendStream();
+    const appended = new Promise((resolve, reject) => stream.on('finish', resolve).on('error', reject));
+    for (let i = 0; i < 1_000; i++) {
+      stream.write(quadDelta(quad(`s${i}`, 'p', `o${i}`), true));
+    }
+    const { triples: previous } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 2 });
+    const { triples } = await document.searchTriplesVersionMaterialized(null, null, null);
+    expect(document.maxVersion).toEqual(2);
+    expect(triples).toEqualRdfQuadArray(previous);
+    stream.end();
+    await appended;
+    expect(document.maxVersion).toEqual(3);
+    const { triples: next } = await document.searchTriplesVersionMaterialized(null, null, null);
+    expect(next).toHaveLength(previous.length + 1_000);
+  });
+
+  it('should answer queries during an append with a complete version', async() => {
+    const { triples: previous } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 2 });
+    const appended = document.append(dataV3);
+    const queries = [ ...new Array(10).keys() ]
+      .map(() => document.searchTriplesVersionMaterialized(null, null, null));
+    await appended;
+    const { triples: next } = await document.searchTriplesVersionMaterialized(null, null, null);
+    for (const { triples } of await Promise.all(queries)) {
+      expect(triples).toEqualRdfQuadArray(triples.some(triple => triple.object.value === 'z' &&
+        triple.object.termType === 'Literal' && triple.subject.value === 'z') ? next : previous);
+    }
+    expect(next).toEqualRdfQuadArray((await document
+      .searchTriplesVersionMaterialized(null, null, null, { version: 3 })).triples);
+  });
+
+  it('should answer queries while an append stream has not ended', async() => {
+    const stream = document.appendStream();
+    const appended = new Promise((resolve, reject) => stream.on('finish', resolve).on('error', reject));
+    stream.write(dataV3[0]);
+    const { triples } = await document.searchTriplesVersionMaterialized(null, null, null);
+    expect(document.maxVersion).toEqual(2);
+    expect(triples).toEqualRdfQuadArray((await document
+      .searchTriplesVersionMaterialized(null, null, null, { version: 2 })).triples);
+    stream.end();
+    await appended;
+    expect(document.maxVersion).toEqual(3);
+  });
+
+  it('should answer delta queries on existing versions during an append', async() => {
+    const appended = document.append(dataV3);
+    const { triples } = await document.searchTriplesDeltaMaterialized(null, null, null,
+      { versionStart: 0, versionEnd: 2 });
+    await appended;
+    expect(triples).toEqualRdfQuadArray((await document.searchTriplesDeltaMaterialized(null, null, null,
+      { versionStart: 0, versionEnd: 2 })).triples);
+  });
+});
+
+describe('concurrency of a buffered store', () => {
+  let document: BufferedOstrichStore;
+  beforeEach(async() => {
+    cleanUp('concurrency-buffered');
+    await (await initializeThreeVersions('concurrency-buffered', { readOnly: false })).close();
+    document = await fromPathBuffered('./test/test-concurrency-buffered.ostrich', 1,
+      { readOnly: false, prefetch: false });
+  });
+  afterEach(async() => {
+    await document.close();
+    cleanUp('concurrency-buffered');
+  });
+
+  it('should continue iterators that were started before an append', async() => {
+    const vm = await readAll(document.searchTriplesVersionMaterialized(null, null, null, { version: 2 }));
+    const dm = await readAll(document.searchTriplesDeltaMaterialized(null, null, null,
+      { versionStart: 0, versionEnd: 2 }));
+    const vmIterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 2 });
+    const dmIterator = document.searchTriplesDeltaMaterialized(null, null, null, { versionStart: 0, versionEnd: 2 });
+    const [ , vmFirst ] = await vmIterator.next();
+    const [ , dmFirst ] = await dmIterator.next();
+    await document.append(dataV3);
+    expect(document.maxVersion).toEqual(3);
+    expect([ ...vmFirst, ...await readAll(vmIterator) ]).toEqualRdfQuadArray(vm);
+    expect([ ...dmFirst, ...await readAll(dmIterator) ]).toEqualRdfQuadArray(dm);
+  });
+
+  it('should fail version iterators that were started before an append', async() => {
+    const iterator = document.searchTriplesVersion(null, null, null);
+    await iterator.next();
+    await document.append(dataV3);
+    await expect(readAll(iterator)).rejects
+      .toThrow('The version query is outdated, as versions have been appended since');
+  });
+
+  it('should pin queries without a version to the last complete version', async() => {
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null);
+    await document.append(dataV3);
+    expect(document.maxVersion).toEqual(3);
+    expect(await readAll(iterator)).toEqualRdfQuadArray(await readAll(document
+      .searchTriplesVersionMaterialized(null, null, null, { version: 2 })));
+  });
+});
@@ -0,0 +1,103 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import type { BufferedOstrichStore, QueryIterator } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import { cleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+async function readAll(iterator: QueryIterator): Promise<RDF.Quad[]> {
+  const quads: RDF.Quad[] = [];
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    quads.push(...batch);
+    done = batchDone;
+  }
+  return quads;
+}
+
+describe('continuation tokens', () => {
+  let document: BufferedOstrichStore;
+  beforeEach(async() => {
+    cleanUp('continuation');
+    await (await initializeThreeVersions('continuation', { readOnly: false })).close();
+    document = await fromPathBuffered('./test/test-continuation.ostrich', 2, { readOnly: true });
+  });
+  afterEach(async() => {
+    await document.close();
+    cleanUp('continuation');
+  });
+
+  it('should continue a version materialized query after its first batch', async() => {
+    const expected = await readAll(document.searchTriplesVersionMaterialized(null, null, null, { version: 1 }));
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+    const [ , first ] = await iterator.next();
+    const rest = await readAll(document.resume(iterator.continuationToken()));
+    await readAll(iterator);
+    expect([ ...first, ...rest ]).toEqualRdfQuadArray(expected);
+  });
+
+  it('should continue a version materialized query with an offset', async() => {
+    const expected = await readAll(document.searchTriplesVersionMaterialized(null, null, null, { version: 1 }));
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 1, offset: 3 });
+    await iterator.next();
+    expect(await readAll(document.resume(iterator.continuationToken()))).toEqualRdfQuadArray(expected.slice(5));
+    await readAll(iterator);
+  });
+
+  it('should continue a delta materialized query', async() => {
+    const options = { versionStart: 0, versionEnd: 2 };
+    const expected = await readAll(document.searchTriplesDeltaMaterialized(null, null, null, options));
+    const iterator = document.searchTriplesDeltaMaterialized(null, null, null, options);
+    const [ , first ] = await iterator.next();
+    const rest = await readAll(document.resume(iterator.continuationToken()));
+    await readAll(iterator);
+    expect([ ...first, ...rest ]).toEqualRdfQuadArray(expected);
+    expect(rest.map(quad => (<any> quad).addition)).toEqual(expected.slice(2).map(quad => (<any> quad).addition));
+  });
+
+  it('should continue a version query', async() => {
+    const expected = await readAll(document.searchTriplesVersion(null, null, null));
+    const iterator = document.searchTriplesVersion(null, null, null);
+    const [ , first ] = await iterator.next();
+    const rest = await readAll(document.resume(iterator.continuationToken()));
+    await readAll(iterator);
+    expect([ ...first, ...rest ]).toEqualRdfQuadArray(expected);
+    expect(rest.map(quad => (<any> quad).versions)).toEqual(expected.slice(2).map(quad => (<any> quad).versions));
+  });
+
+  it('should continue a token more than once', async() => {
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 2 });
+    await iterator.next();
+    const token = iterator.continuationToken();
+    expect(await readAll(document.resume(token))).toEqualRdfQuadArray(await readAll(document.resume(token)));
+    await readAll(iterator);
+  });
+
+  it('should continue a token in another store that opened the same archive', async() => {
+    const expected = await readAll(document.searchTriplesVersionMaterialized(null, null, null));
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null);
+    await iterator.next();
+    const other = await fromPathBuffered('./test/test-continuation.ostrich', 3, { readOnly: true });
+    expect(await readAll(other.resume(iterator.continuationToken()))).toEqualRdfQuadArray(expected.slice(2));
+    await other.close();
+    await readAll(iterator);
+  });
+
+  it('should return an empty iterator for a token of a finished query', async() => {
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null, { version: 0 });
+    await readAll(iterator);
+    expect(await readAll(document.resume(iterator.continuationToken()))).toEqual([]);
+  });
+
+  it('should throw on an invalid token', () => {
+    expect(() => document.resume('abc')).toThrow('Invalid continuation token');
+  });
+
+  it('should throw on a modified token', async() => {
+    const iterator = document.searchTriplesVersionMaterialized(null, null, null);
+    const token = iterator.continuationToken();
+    const modified = `${token.slice(0, 10)}${token[10] === 'A' ? 'B' : 'A'}${token.slice(11)}`;
+    expect(() => document.resume(modified)).toThrow('Invalid continuation token');
+    await readAll(iterator);
+  });
+});
@@ -0,0 +1,126 @@
+import 'jest-rdf';
+import * as fs from 'fs';
+import type * as RDF from '@rdfjs/types';
+import { DataFactory } from 'rdf-data-factory';
+import type { Readable } from 'stream';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { quadDelta } from '../lib/utils';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+const DF = new DataFactory();
+const exportPath = './test/test-export.nt';
+
+function termToNTriples(term: RDF.Term): string {
+  if (term.termType === 'Literal') {
+    return `"${term.value}"${term.language ? `@${term.language}` : `^^<${term.datatype.value}>`}`;
+  }
+  return term.termType === 'BlankNode' ? `_:${term.value}` : `<${term.value}>`;
+}
+
+function quadToNTriples(quad: RDF.Quad): string {
+  return `${termToNTriples(quad.subject)} ${termToNTriples(quad.predicate)} ${termToNTriples(quad.object)} .`;
+}
+
+function readLines(contents: string): string[] {
+  return contents.split('\n').filter(line => line.length > 0).sort();
+}
+
+function readStream(stream: Readable): Promise<string> {
+  return new Promise((resolve, reject) => {
+    const chunks: Buffer[] = [];
+    stream.on('data', chunk => chunks.push(chunk));
+    stream.on('error', reject);
+    stream.on('end', () => resolve(Buffer.concat(chunks).toString()));
+  });
+}
+
+describe('export', () => {
+  let document: OstrichStore;
+  beforeEach(async() => {
+    cleanUp('export');
+    document = await initializeThreeVersions('export');
+  });
+  afterEach(async() => {
+    await closeAndCleanUp(document, 'export');
+    if (fs.existsSync(exportPath)) {
+      fs.unlinkSync(exportPath);
+    }
+  });
+
+  it('should export version materialized results to a file', async() => {
+    const { triples } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+    expect(await document.exportTriplesVersionMaterialized(null, null, null, exportPath, { version: 1 }))
+      .toEqual(triples.length);
+    expect(readLines(fs.readFileSync(exportPath, 'utf8'))).toEqual(triples.map(quadToNTriples).sort());
+  });
+
+  it('should export version materialized results with an offset and limit', async() => {
+    const { triples } = await document.searchTriplesVersionMaterialized(null, null, null,
+      { version: 1, offset: 2, limit: 3 });
+    expect(await document.exportTriplesVersionMaterialized(null, null, null, exportPath,
+      { version: 1, offset: 2, limit: 3 })).toEqual(3);
+    expect(readLines(fs.readFileSync(exportPath, 'utf8'))).toEqual(triples.map(quadToNTriples).sort());
+  });
+
+  it('should export delta materialized results to a file descriptor', async() => {
+    const fd = fs.openSync(exportPath, 'w');
+    expect(await document.exportTriplesDeltaMaterialized(null, null, null, fd, { versionStart: 0, versionEnd: 1 }))
+      .toEqual(7);
+    fs.closeSync(fd);
+    expect(readLines(fs.readFileSync(exportPath, 'utf8'))).toEqual([
+      '+ <a> <a> "z"^^<http://example.org/literal> .',
+      '+ <a> <b> <g> .',
+      '+ <f> <f> <f> .',
+      '+ <z> <z> <z> .',
+      '- <a> <a> "b"^^<http://example.org/literal> .',
+      '- <a> <b> <a> .',
+      '- <a> <b> <z> .',
+    ]);
+  });
+
+  it('should export version materialized results as a stream of buffers', async() => {
+    const { triples } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 2 });
+    expect(readLines(await readStream(document
+      .exportTriplesVersionMaterializedStream(null, null, null, { version: 2 }))))
+      .toEqual(triples.map(quadToNTriples).sort());
+  });
+
+  it('should export delta materialized results as a stream of buffers', async() => {
+    expect(readLines(await readStream(document
+      .exportTriplesDeltaMaterializedStream(null, null, null, { versionStart: 1, versionEnd: 2 })))).toEqual([
+      '+ <f> <r> <s> .',
+      '+ <q> <q> <q> .',
+      '+ <r> <r> <r> .',
+      '- <a> <a> "z"^^<http://example.org/literal> .',
+      '- <f> <f> <f> .',
+    ]);
+  });
+
+  it('should not hold up closing the store when a stream is destroyed before it is read', async() => {
+    const stream = document.exportTriplesVersionMaterializedStream(null, null, null, { version: 2 });
+    stream.destroy();
+    await document.close();
+    expect(document.closed).toBeTruthy();
+  });
+
+  it('should not hold up appends while a stream is not read', async() => {
+    const stream = document.exportTriplesVersionMaterializedStream(null, null, null, { version: 2 });
+    const { triples } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 2 });
+    await document.append([ quadDelta(DF.quad(DF.namedNode('new'), DF.namedNode('new'), DF.namedNode('new')), true) ]);
+    expect(document.maxVersion).toEqual(3);
+    expect(readLines(await readStream(stream))).toEqual(triples.map(quadToNTriples).sort());
+  });
+
+  it('should reject invalid version ranges', async() => {
+    await expect(document.exportTriplesDeltaMaterialized(null, null, null, exportPath,
+      { versionStart: 1, versionEnd: 1 })).rejects.toThrow(`'versionStart' must be strictly smaller than 'versionEnd'`);
+    await expect(readStream(document.exportTriplesDeltaMaterializedStream(null, null, null,
+      { versionStart: 0, versionEnd: 3 }))).rejects.toThrow(`'versionEnd' can not be larger than the maximum version (2)`);
+  });
+
+  it('should reject when the store is closed', async() => {
+    await document.close();
+    await expect(document.exportTriplesVersionMaterialized(null, null, null, exportPath))
+      .rejects.toThrow('Attempted to query a closed OSTRICH store');
+  });
+});
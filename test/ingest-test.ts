@@ -0,0 +1,147 @@
+import 'jest-rdf';
+import * as fs from 'fs';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+import type { IIngestProgress } from '../lib/utils';
+const quad = require('rdf-quad');
+
+const DUMPS = './test/test-temp-ingest-dumps/';
+
+describe('ingest', () => {
+  let document: OstrichStore;
+
+  beforeAll(() => {
+    // eslint-disable-next-line no-sync
+    fs.mkdirSync(DUMPS, { recursive: true });
+    // eslint-disable-next-line no-sync
+    fs.writeFileSync(`${DUMPS}0.nt`, `<a> <a> <a> .
+<a> <a> <b> .
+# A comment
+<a> <a> "c"@en .
+<a> <a> <b> .
+`);
+    // eslint-disable-next-line no-sync
+    fs.writeFileSync(`${DUMPS}1.nq`, `<a> <a> "c"@en <g> .
+
+<a> <a> "d"^^<http://example.org/t> .
+<b> <a> "e\\n" .
+`);
+    // eslint-disable-next-line no-sync
+    fs.writeFileSync(`${DUMPS}invalid.nt`, `<a> <a> <a> .
+<a> <a> .
+`);
+  });
+
+  afterAll(() => {
+    // eslint-disable-next-line no-sync
+    fs.rmSync(DUMPS, { recursive: true, force: true });
+  });
+
+  afterEach(async() => {
+    await document.close(true);
+  });
+
+  it('should reject if the store is closed', async() => {
+    document = await fromPath('./test/test-temp-ingest.ostrich', { readOnly: false });
+    await document.close();
+
+    await expect(document.ingest([ `${DUMPS}0.nt` ]))
+      .rejects.toThrow('Attempted to ingest into a closed OSTRICH store');
+  });
+
+  it('should reject if the store is read-only', async() => {
+    document = await fromPath('./test/test-temp-ingest.ostrich', { readOnly: true });
+
+    await expect(document.ingest([ `${DUMPS}0.nt` ]))
+      .rejects.toThrow('Attempted to ingest into an OSTRICH store in read-only mode');
+  });
+
+  it('should ingest after the versions that are already in the store', async() => {
+    document = await fromPath('./test/test-temp-ingest.ostrich', { readOnly: false });
+    expect(await document.ingest([ `${DUMPS}0.nt` ])).toEqual(1);
+    const progress: IIngestProgress[] = [];
+
+    expect(await document.ingest([ `${DUMPS}1.nq` ], { onProgress: stats => progress.push(stats) })).toEqual(1);
+
+    expect(document.maxVersion).toEqual(1);
+    expect(progress.map(({ version, additionCount, deletionCount }) => ({ version, additionCount, deletionCount })))
+      .toEqual([{ version: 1, additionCount: 2, deletionCount: 2 }]);
+    expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })).triples)
+      .toBeRdfIsomorphic([
+        quad('a', 'a', '"c"@en'),
+        quad('a', 'a', '"d"^^http://example.org/t'),
+        quad('b', 'a', '"e\n"'),
+      ]);
+  });
+
+  it('should reject for an invalid dump', async() => {
+    document = await fromPath('./test/test-temp-ingest.ostrich', { readOnly: false });
+
+    await expect(document.ingest([ `${DUMPS}invalid.nt` ], { threads: 2 }))
+      .rejects.toThrow('Expected \'<\' in N-Triples line: <a> <a> .');
+  });
+
+  it('should reject for a missing dump', async() => {
+    document = await fromPath('./test/test-temp-ingest.ostrich', { readOnly: false });
+
+    await expect(document.ingest([ `${DUMPS}missing.nt` ]))
+      .rejects.toThrow(`Could not open the version dump ${DUMPS}missing.nt`);
+  });
+
+  it('should ingest consecutive versions that do not fit in the sort memory', async() => {
+    document = await fromPath('./test/test-temp-ingest.ostrich', { readOnly: false });
+    const progress: IIngestProgress[] = [];
+
+    expect(await document.ingest([ `${DUMPS}0.nt`, `${DUMPS}1.nq`, `${DUMPS}0.nt` ], {
+      threads: 2,
+      sortMemory: 1,
+      onProgress: stats => progress.push(stats),
+    })).toEqual(3);
+
+    expect(progress.map(({ version, tripleCount, additionCount, deletionCount }) =>
+      ({ version, tripleCount, additionCount, deletionCount }))).toEqual([
+      { version: 0, tripleCount: 3, additionCount: 3, deletionCount: 0 },
+      { version: 1, tripleCount: 3, additionCount: 2, deletionCount: 2 },
+      { version: 2, tripleCount: 3, additionCount: 2, deletionCount: 2 },
+    ]);
+    expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 2 })).triples)
+      .toBeRdfIsomorphic([
+        quad('a', 'a', 'a'),
+        quad('a', 'a', 'b'),
+        quad('a', 'a', '"c"@en'),
+      ]);
+    // eslint-disable-next-line no-sync
+    expect(fs.readdirSync('./test/test-temp-ingest.ostrich').filter(file => file.includes('.ingest-sort-'))).toEqual([]);
+  });
+
+  for (const threads of [ undefined, 1, 4 ]) {
+    it(`should ingest consecutive versions with ${threads} threads`, async() => {
+      document = await fromPath('./test/test-temp-ingest.ostrich', { readOnly: false });
+      const progress: IIngestProgress[] = [];
+
+      expect(await document.ingest([ `${DUMPS}0.nt`, `${DUMPS}1.nq` ], {
+        threads,
+        onProgress: stats => progress.push(stats),
+      })).toEqual(2);
+
+      expect(document.maxVersion).toEqual(1);
+      expect(progress.map(({ version, tripleCount, additionCount, deletionCount }) =>
+        ({ version, tripleCount, additionCount, deletionCount }))).toEqual([
+        { version: 0, tripleCount: 3, additionCount: 3, deletionCount: 0 },
+        { version: 1, tripleCount: 3, additionCount: 2, deletionCount: 2 },
+      ]);
+      expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 0 })).triples)
+        .toBeRdfIsomorphic([
+          quad('a', 'a', 'a'),
+          quad('a', 'a', 'b'),
+          quad('a', 'a', '"c"@en'),
+        ]);
+      expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })).triples)
+        .toBeRdfIsomorphic([
+          quad('a', 'a', '"c"@en'),
+          quad('a', 'a', '"d"^^http://example.org/t'),
+          quad('b', 'a', '"e\n"'),
+        ]);
+    });
+  }
+});
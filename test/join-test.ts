@@ -0,0 +1,111 @@
+import 'jest-rdf';
+import { DataFactory } from 'rdf-data-factory';
+import { termToString } from 'rdf-string';
+import type { BindingsIterator, BufferedOstrichStore } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import { cleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+const DF = new DataFactory();
+
+// Reads all bindings, with their terms as strings, in a deterministic order
+async function readBindings(iterator: BindingsIterator): Promise<Record<string, string>[]> {
+  const bindings: Record<string, string>[] = [];
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    for (const binding of batch) {
+      const stringBinding: Record<string, string> = {};
+      for (const variable of Object.keys(binding)) {
+        stringBinding[variable] = termToString(binding[variable]);
+      }
+      bindings.push(stringBinding);
+    }
+    done = batchDone;
+  }
+  return bindings.sort((left, right) => JSON.stringify(left).localeCompare(JSON.stringify(right)));
+}
+
+describe('joins', () => {
+  let document: BufferedOstrichStore;
+  beforeEach(async() => {
+    cleanUp('join');
+    await (await initializeThreeVersions('join', { readOnly: false })).close();
+    document = await fromPathBuffered('./test/test-join.ostrich', 2, { readOnly: true });
+  });
+  afterEach(async() => {
+    if (!document.closed) {
+      await document.close();
+    }
+    cleanUp('join');
+  });
+
+  it('should join patterns on a shared variable', async() => {
+    expect(await readBindings(document.joinVersionMaterialized(
+      { subject: DF.variable('x'), predicate: DF.namedNode('b'), object: DF.variable('y') },
+      { subject: DF.variable('y'), predicate: DF.variable('p'), object: DF.variable('z') },
+      { version: 2 },
+    ))).toEqual([
+      { x: 'a', y: 'c', p: 'c', z: 'c' },
+      { x: 'a', y: 'f', p: 'r', z: 's' },
+    ]);
+  });
+
+  it('should bind variables that only occur in the right pattern', async() => {
+    expect(await readBindings(document.joinVersionMaterialized(
+      { subject: DF.variable('x'), predicate: DF.namedNode('b'), object: DF.namedNode('c') },
+      { subject: DF.variable('x'), predicate: DF.namedNode('a'), object: DF.variable('o') },
+      { version: 2 },
+    ))).toEqual([
+      { x: 'a', o: '"a"^^http://example.org/literal' },
+    ]);
+  });
+
+  it('should skip literals that are bound into the subject of the right pattern', async() => {
+    expect(await readBindings(document.joinVersionMaterialized(
+      { subject: DF.namedNode('a'), predicate: DF.namedNode('a'), object: DF.variable('o') },
+      { subject: DF.variable('o'), predicate: DF.variable('p'), object: DF.variable('q') },
+      { version: 2 },
+    ))).toEqual([]);
+  });
+
+  it('should skip literals that are bound into the predicate of the right pattern', async() => {
+    expect(await readBindings(document.joinVersionMaterialized(
+      { subject: DF.namedNode('a'), predicate: DF.namedNode('a'), object: DF.variable('o') },
+      { subject: DF.variable('s'), predicate: DF.variable('o'), object: DF.variable('q') },
+      { version: 2 },
+    ))).toEqual([]);
+  });
+
+  it('should only match triples with equal terms for a variable that is repeated within a pattern', async() => {
+    expect(await readBindings(document.joinVersionMaterialized(
+      { subject: DF.variable('x'), predicate: DF.variable('x'), object: DF.variable('x') },
+      { subject: DF.variable('x'), predicate: DF.variable('p'), object: DF.variable('o') },
+      { version: 2 },
+    ))).toEqual([
+      { x: 'c', p: 'c', o: 'c' },
+      { x: 'q', p: 'q', o: 'q' },
+      { x: 'r', p: 'r', o: 'r' },
+      { x: 'z', p: 'z', o: 'z' },
+    ]);
+  });
+
+  it('should produce no bindings if the left pattern has no matches', async() => {
+    const iterator = document.joinVersionMaterialized(
+      { subject: DF.variable('x'), predicate: DF.namedNode('unknown'), object: DF.variable('y') },
+      { subject: DF.variable('y'), predicate: DF.variable('p'), object: DF.variable('z') },
+      { version: 2 },
+    );
+    expect(await iterator.next()).toEqual([ true, []]);
+  });
+
+  it('should join in the given version', async() => {
+    expect(await readBindings(document.joinVersionMaterialized(
+      { subject: DF.variable('x'), predicate: DF.namedNode('b'), object: DF.variable('y') },
+      { subject: DF.variable('y'), predicate: DF.variable('p'), object: DF.variable('z') },
+      { version: 1 },
+    ))).toEqual([
+      { x: 'a', y: 'c', p: 'c', z: 'c' },
+      { x: 'a', y: 'f', p: 'f', z: 'f' },
+    ]);
+  });
+});
@@ -30,6 +30,7 @@ describe('ostrich', () => {
             readOnly,
             strategyName,
             strategyParameter,
+            options,
             cb: any,
           ) => cb(new Error('Internal error')));
 
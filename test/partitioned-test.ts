@@ -0,0 +1,139 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import { DataFactory } from 'rdf-data-factory';
+import type { Readable } from 'stream';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { quadDelta } from '../lib/utils';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+const DF = new DataFactory();
+
+function readStream(stream: Readable): Promise<RDF.Quad[]> {
+  return new Promise((resolve, reject) => {
+    const quads: RDF.Quad[] = [];
+    stream.on('data', quad => quads.push(quad));
+    stream.on('error', reject);
+    stream.on('end', () => resolve(quads));
+  });
+}
+
+// Reads the first triple, after which the stream is paused
+function readFirst(stream: Readable): Promise<RDF.Quad> {
+  return new Promise(resolve => stream.once('data', quad => {
+    stream.pause();
+    resolve(quad);
+  }));
+}
+
+// Reads one triple at a time, so that the stream is paused in between triples
+function readStreamSlowly(stream: Readable): Promise<RDF.Quad[]> {
+  return new Promise((resolve, reject) => {
+    const quads: RDF.Quad[] = [];
+    stream.on('data', quad => {
+      quads.push(quad);
+      stream.pause();
+      setImmediate(() => stream.resume());
+    });
+    stream.on('error', reject);
+    stream.on('end', () => resolve(quads));
+  });
+}
+
+describe('partitioned version materialized scans', () => {
+  let document: OstrichStore;
+  beforeEach(async() => {
+    cleanUp('partitioned');
+    document = await initializeThreeVersions('partitioned');
+  });
+  afterEach(async() => {
+    await closeAndCleanUp(document, 'partitioned');
+  });
+
+  for (const partitions of [ 1, 2, 3, 16 ]) {
+    it(`should return all triples in order over ${partitions} partitions`, async() => {
+      const { triples } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      expect(await readStream(document.streamTriplesVersionMaterializedPartitioned(null, null, null,
+        { version: 1, partitions, chunkSize: 2 }))).toEqualRdfQuadArray(triples);
+    });
+  }
+
+  it('should return all triples without order', async() => {
+    const { triples } = await document.searchTriplesVersionMaterialized(null, null, null);
+    const quads = await readStream(document.streamTriplesVersionMaterializedPartitioned(null, null, null,
+      { partitions: 4, ordered: false, chunkSize: 1 }));
+    expect(quads).toHaveLength(triples.length);
+    expect(quads).toBeRdfIsomorphic(triples);
+  });
+
+  for (const ordered of [ true, false ]) {
+    it(`should return all triples to a slow consumer with a queue size of 1 ${ordered ? 'in' : 'without'} order`,
+      async() => {
+        const { triples } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+        const quads = await readStreamSlowly(document.streamTriplesVersionMaterializedPartitioned(null, null, null,
+          { version: 1, partitions: 3, ordered, chunkSize: 1, queueSize: 1 }));
+        if (ordered) {
+          expect(quads).toEqualRdfQuadArray(triples);
+        } else {
+          expect(quads).toBeRdfIsomorphic(triples);
+        }
+      });
+  }
+
+  it('should stop the scan when the stream is destroyed', async() => {
+    const stream = document.streamTriplesVersionMaterializedPartitioned(null, null, null,
+      { version: 1, partitions: 3, chunkSize: 1, queueSize: 1 });
+    await new Promise(resolve => stream.once('data', resolve));
+    stream.destroy();
+    // Closing waits for all operations, so it only resolves once the scan has stopped
+    await document.close();
+    expect(document.closed).toBe(true);
+  });
+
+  it('should not hold up queries or appends while the stream is not read', async() => {
+    const { triples } = await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+    // More partitions than query threads, of which all run out of credits
+    const stream = document.streamTriplesVersionMaterializedPartitioned(null, null, null,
+      { version: 1, partitions: 16, chunkSize: 1, queueSize: 1 });
+    const quads = [ await readFirst(stream) ];
+
+    await document.append([ quadDelta(DF.quad(DF.namedNode('new'), DF.namedNode('new'), DF.namedNode('new')), true) ]);
+    expect(document.maxVersion).toEqual(3);
+    expect((await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })).triples)
+      .toEqualRdfQuadArray(triples);
+
+    // The scan continues on the version it started on
+    const rest = readStream(stream);
+    stream.resume();
+    quads.push(...await rest);
+    expect(quads).toEqualRdfQuadArray(triples);
+  });
+
+  it('should make the stream fail when the store is closed while it is not read', async() => {
+    const stream = document.streamTriplesVersionMaterializedPartitioned(null, null, null,
+      { version: 1, partitions: 3, chunkSize: 1, queueSize: 1 });
+    await readFirst(stream);
+    const failed = new Promise<Error>(resolve => stream.on('error', resolve));
+
+    await document.close();
+    expect((await failed).message)
+      .toEqual('The partitioned scan was cancelled, as its stream was destroyed or its store was closed');
+  });
+
+  it('should return the triples matching a pattern', async() => {
+    const { triples } = await document.searchTriplesVersionMaterialized(DF.namedNode('a'), null, null,
+      { version: 0 });
+    expect(await readStream(document.streamTriplesVersionMaterializedPartitioned(DF.namedNode('a'), null, null,
+      { version: 0, partitions: 3 }))).toEqualRdfQuadArray(triples);
+  });
+
+  it('should return no triples for a pattern without matches', async() => {
+    expect(await readStream(document.streamTriplesVersionMaterializedPartitioned(DF.namedNode('none'), null, null,
+      { partitions: 3 }))).toEqual([]);
+  });
+
+  it('should emit an error when the store is closed', async() => {
+    await document.close();
+    await expect(readStream(document.streamTriplesVersionMaterializedPartitioned(null, null, null)))
+      .rejects.toThrow('Attempted to query a closed OSTRICH store');
+  });
+});
@@ -108,8 +108,8 @@ const dataV3 = [
   quadDelta(quad('z', 'z', '"z"^^<http://example.org/literal>'), true),
 ];
 
-export async function initializeThreeVersions(tag: string): Promise<OstrichStore> {
-  const ostrichStore = await ostrich.fromPath(`./test/test-${tag}.ostrich`, false);
+export async function initializeThreeVersions(tag: string, options?: Record<string, any>): Promise<OstrichStore> {
+  const ostrichStore = await ostrich.fromPath(`./test/test-${tag}.ostrich`, options || false);
   await ostrichStore.append(dataV0, 0);
   await ostrichStore.append(dataV1, 1);
   await ostrichStore.append(dataV2, 2);
@@ -0,0 +1,76 @@
+import 'jest-rdf';
+import { execFile } from 'child_process';
+import * as Path from 'path';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+import { QueryPriority } from '../lib/QueryPool';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+describe('query pool', () => {
+  let reference: OstrichStore;
+  beforeAll(async() => {
+    cleanUp('pool');
+    await (await initializeThreeVersions('pool', { readOnly: false })).close();
+    reference = await fromPath('./test/test-pool.ostrich', { readOnly: true });
+  });
+  afterAll(async() => {
+    await closeAndCleanUp(reference, 'pool');
+  });
+
+  for (const queryThreads of [ 0, 1, 3 ]) {
+    it(`should return the same results with ${queryThreads} query threads`, async() => {
+      const store = await fromPath('./test/test-pool.ostrich', { readOnly: true, queryThreads });
+      const results = await Promise.all([ 0, 1, 2 ].map(version =>
+        store.searchTriplesVersionMaterialized(null, null, null, { version })));
+      for (const [ version, result ] of results.entries()) {
+        expect(result.triples).toEqualRdfQuadArray((await reference
+          .searchTriplesVersionMaterialized(null, null, null, { version })).triples);
+      }
+      expect(await store.countTriplesVersion(null, null, null))
+        .toEqual(await reference.countTriplesVersion(null, null, null));
+      await store.close();
+    });
+  }
+
+  it('should execute all queries with priorities', async() => {
+    const store = await fromPath('./test/test-pool.ostrich', {
+      readOnly: true,
+      queryThreads: 1,
+      queryPriorities: { count: QueryPriority.High, versionMaterialized: QueryPriority.Low },
+    });
+    const [ search, count ] = await Promise.all([
+      store.searchTriplesVersionMaterialized(null, null, null, { version: 1 }),
+      store.countTriplesVersionMaterialized(null, null, null, 1),
+    ]);
+    expect(search.triples).toHaveLength(count.cardinality);
+    await store.close();
+  });
+
+  it('should keep a process alive until its queries have completed', async() => {
+    // Jest keeps the event loop alive by itself, so the query is executed in a separate process
+    const script = `
+      const { fromPath } = require(${JSON.stringify(Path.join(__dirname, '..', 'lib', 'OstrichStore'))});
+      fromPath('./test/test-pool.ostrich', { readOnly: true, queryThreads: 2 })
+        .then(store => store.searchTriplesVersionMaterialized(null, null, null, { version: 1 }))
+        .then(({ triples }) => process.stdout.write(String(triples.length)));
+    `;
+    const output = await new Promise<string>((resolve, reject) => {
+      execFile(process.execPath, [ '-e', script ], (error, stdout) => error ? reject(error) : resolve(stdout));
+    });
+    expect(output).toEqual(String((await reference
+      .searchTriplesVersionMaterialized(null, null, null, { version: 1 })).triples.length));
+  });
+
+  it('should reject queries once the queue is full', async() => {
+    const store = await fromPath('./test/test-pool.ostrich', { readOnly: true, queryThreads: 1, queryQueueDepth: 1 });
+    const results = await Promise.allSettled([ 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 ].map(version =>
+      store.searchTriplesVersionMaterialized(null, null, null, { version })));
+    const rejected = <PromiseRejectedResult[]> results.filter(result => result.status === 'rejected');
+    expect(rejected.length).toBeGreaterThan(0);
+    expect(rejected.length).toBeLessThan(results.length);
+    for (const result of rejected) {
+      expect(result.reason.message).toEqual('The query queue is full, as 1 queries are already waiting');
+    }
+    await store.close();
+  });
+});
@@ -0,0 +1,85 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import type { BufferedOstrichStore } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import type { QueryStream } from '../lib/QueryStream';
+import { cleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+function readStream(stream: QueryStream): Promise<RDF.Quad[]> {
+  return new Promise((resolve, reject) => {
+    const quads: RDF.Quad[] = [];
+    stream.on('data', quad => quads.push(quad));
+    stream.on('error', reject);
+    stream.on('end', () => resolve(quads));
+  });
+}
+
+describe('query streams', () => {
+  let document: BufferedOstrichStore;
+  beforeEach(async() => {
+    cleanUp('stream');
+    await (await initializeThreeVersions('stream', { readOnly: false })).close();
+    document = await fromPathBuffered('./test/test-stream.ostrich', 2, { readOnly: true });
+  });
+  afterEach(async() => {
+    if (!document.closed) {
+      await document.close();
+    }
+    cleanUp('stream');
+  });
+
+  it('should stream version materialized results', async() => {
+    const expected = await readStream(document.streamTriplesVersionMaterialized(null, null, null, {
+      version: 1,
+      highWaterMark: 100,
+    }));
+    expect(expected).toHaveLength(9);
+    expect(await readStream(document.streamTriplesVersionMaterialized(null, null, null, { version: 1 })))
+      .toEqualRdfQuadArray(expected);
+  });
+
+  it('should stream delta materialized results', async() => {
+    const quads = await readStream(document
+      .streamTriplesDeltaMaterialized(null, null, null, { versionStart: 0, versionEnd: 1 }));
+    expect(quads).toHaveLength(7);
+    expect(quads.filter(quad => (<any> quad).addition)).toHaveLength(4);
+  });
+
+  it('should stream version results', async() => {
+    const quads = await readStream(document.streamTriplesVersion(null, null, null));
+    for (const quad of quads) {
+      expect((<any> quad).versions.length).toBeGreaterThan(0);
+    }
+  });
+
+  it('should stream results with an offset and limit', async() => {
+    const all = await readStream(document.streamTriplesVersionMaterialized(null, null, null, { version: 1 }));
+    expect(await readStream(document.streamTriplesVersionMaterialized(null, null, null, {
+      version: 1,
+      offset: 2,
+      limit: 3,
+    }))).toEqualRdfQuadArray(all.slice(2, 5));
+  });
+
+  it('should stream no results with a limit of 0', async() => {
+    expect(await readStream(document.streamTriplesVersionMaterialized(null, null, null, { limit: 0 }))).toEqual([]);
+  });
+
+  it('should only buffer up to the highWaterMark while not being read', async() => {
+    const stream = document.streamTriplesVersionMaterialized(null, null, null, { version: 1, highWaterMark: 2 });
+    stream.read(0);
+    await new Promise(resolve => setTimeout(resolve, 50));
+    expect(stream.readableLength).toBeLessThanOrEqual(2);
+    await readStream(stream);
+  });
+
+  it('should allow the store to be closed after being destroyed early', async() => {
+    const stream = document.streamTriplesVersionMaterialized(null, null, null, { version: 1 });
+    await new Promise(resolve => stream.once('data', resolve));
+    await new Promise<void>(resolve => {
+      stream.on('close', resolve);
+      stream.destroy();
+    });
+    await expect(document.close()).resolves.toBeUndefined();
+  });
+});
@@ -0,0 +1,46 @@
+import 'jest-rdf';
+import { DataFactory } from 'rdf-data-factory';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { quadDelta } from '../lib/utils';
+import { closeAndCleanUp, cleanUp, initializeThreeVersions } from './prepare-ostrich';
+const quad = require('rdf-quad');
+
+const DF = new DataFactory();
+
+describe('result cache', () => {
+  for (const resultCacheSize of [ 0, 200, 1024 * 1024 ]) {
+    describe(`An ostrich store with result cache size ${resultCacheSize}`, () => {
+      let document: OstrichStore;
+      beforeEach(async() => {
+        cleanUp('results');
+        document = await initializeThreeVersions('results', { readOnly: false, resultCacheSize });
+      });
+      afterEach(async() => {
+        await closeAndCleanUp(document, 'results');
+      });
+
+      it('should return the same pages repeatedly', async() => {
+        const options = { offset: 1, limit: 2, version: 1 };
+        const expected = await document.searchTriplesVersionMaterialized(DF.namedNode('a'), null, null, options);
+        expect(expected.triples).toHaveLength(2);
+        for (let i = 0; i < 3; i++) {
+          const { triples, cardinality, exactCardinality } = await document
+            .searchTriplesVersionMaterialized(DF.namedNode('a'), null, null, options);
+          expect(triples).toEqualRdfQuadArray(expected.triples);
+          expect(cardinality).toEqual(expected.cardinality);
+          expect(exactCardinality).toEqual(expected.exactCardinality);
+          const batch = await document.searchTriplesVersionMaterializedBatch(DF.namedNode('a'), null, null, options);
+          expect(batch.triples.toArray()).toEqualRdfQuadArray(expected.triples);
+        }
+      });
+
+      it('should not return pages of the previous latest version after an append', async() => {
+        expect((await document.searchTriplesVersionMaterialized(DF.namedNode('q'), null, null)).triples)
+          .toEqualRdfQuadArray([ quad('q', 'q', 'q') ]);
+        await document.append([ quadDelta(quad('q', 'q', 'q'), false) ]);
+        expect((await document.searchTriplesVersionMaterialized(DF.namedNode('q'), null, null)).triples)
+          .toEqualRdfQuadArray([]);
+      });
+    });
+  }
+});
@@ -0,0 +1,67 @@
+import 'jest-rdf';
+import * as fs from 'fs';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+import { cleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+const storePath = './test/test-shared.ostrich';
+
+function removeIndexes(): void {
+  // eslint-disable-next-line no-sync
+  for (const file of fs.readdirSync(storePath).filter(name => name.includes('.hdt.index'))) {
+    // eslint-disable-next-line no-sync
+    fs.unlinkSync(`${storePath}/${file}`);
+  }
+}
+
+function hasIndexes(): boolean {
+  // eslint-disable-next-line no-sync
+  return fs.readdirSync(storePath).some(name => name.includes('.hdt.index'));
+}
+
+describe('shared', () => {
+  beforeEach(async() => {
+    cleanUp('shared');
+    await (await initializeThreeVersions('shared', { readOnly: false })).close();
+  });
+  afterEach(() => {
+    cleanUp('shared');
+  });
+
+  it('should open a store in read-only mode', async() => {
+    const document = await fromPath(storePath, { shared: true });
+    expect(document.readOnly).toBe(true);
+    expect(document.features.appendVersionedTriples).toBe(false);
+    await document.close();
+  });
+
+  it('should reject opening a shared store in write mode', async() => {
+    await expect(fromPath(storePath, { shared: true, readOnly: false }))
+      .rejects.toThrow('A shared OSTRICH store can only be opened in read-only mode');
+    await expect(fromPathBuffered(storePath, 2, { shared: true, readOnly: false }))
+      .rejects.toThrow('A shared OSTRICH store can only be opened in read-only mode');
+  });
+
+  it('should save missing snapshot indexes once when opened concurrently', async() => {
+    removeIndexes();
+    const documents: OstrichStore[] = await Promise.all([ ...new Array(4).keys() ]
+      .map(() => fromPath(storePath, { shared: true })));
+    expect(hasIndexes()).toBe(true);
+    const results = await Promise.all(documents
+      .map(document => document.searchTriplesVersionMaterialized(null, null, null, { version: 1 })));
+    for (const { triples } of results) {
+      expect(triples).toHaveLength(9);
+      expect(triples).toEqualRdfQuadArray(results[0].triples);
+    }
+    await Promise.all(documents.map(document => document.close()));
+  });
+
+  it('should open a buffered store in shared mode', async() => {
+    removeIndexes();
+    const document = await fromPathBuffered(storePath, 2, { shared: true });
+    expect(hasIndexes()).toBe(true);
+    expect(document.maxVersion).toEqual(2);
+    await document.close();
+  });
+});
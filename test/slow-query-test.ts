@@ -0,0 +1,135 @@
+import 'jest-rdf';
+import * as fs from 'fs';
+import type * as RDF from '@rdfjs/types';
+import { DataFactory } from 'rdf-data-factory';
+import type { BufferedOstrichStore, QueryIterator } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+const DF = new DataFactory();
+
+async function readAll(iterator: QueryIterator): Promise<RDF.Quad[]> {
+  const quads: RDF.Quad[] = [];
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    quads.push(...batch);
+    done = batchDone;
+  }
+  return quads;
+}
+
+describe('slow query log', () => {
+  describe('of a store', () => {
+    const file = './test/slow-queries.log';
+    let document: OstrichStore;
+    beforeEach(async() => {
+      cleanUp('slow-query');
+      document = await initializeThreeVersions('slow-query');
+    });
+    afterEach(async() => {
+      await closeAndCleanUp(document, 'slow-query');
+      if (fs.existsSync(file)) {
+        fs.unlinkSync(file);
+      }
+    });
+
+    it('should not log queries by default', async() => {
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      expect(document.slowQueries()).toEqual([]);
+    });
+
+    it('should not log queries that are faster than the threshold', async() => {
+      document.setSlowQueryLog({ threshold: 60000 });
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      expect(document.slowQueries()).toEqual([]);
+    });
+
+    it('should log a delta-materialized query with its versions and elements', async() => {
+      document.setSlowQueryLog({ threshold: 0 });
+      await document.searchTriplesDeltaMaterialized(null, null, null, { versionStart: 0, versionEnd: 1, limit: 5 });
+      const queries = document.slowQueries();
+      expect(queries).toHaveLength(1);
+      expect(queries[0]).toMatchObject({
+        type: 'deltaMaterialized',
+        subject: '',
+        predicate: '',
+        object: '',
+        offset: 0,
+        limit: 5,
+        versionStart: 0,
+        versionEnd: 1,
+        results: 5,
+        snapshotElements: 0,
+      });
+      expect(queries[0].patchElements).toBeGreaterThan(0);
+      expect(queries[0].execute).toBeGreaterThanOrEqual(0);
+      expect(queries[0].time).toBeLessThanOrEqual(Date.now());
+    });
+
+    it('should log version-materialized and version queries', async() => {
+      document.setSlowQueryLog({ threshold: 0 });
+      await document.searchTriplesVersionMaterialized(DF.namedNode('a'), null, null, { version: 1 });
+      await document.searchTriplesVersion(null, null, null);
+      const [ versionMaterialized, version ] = document.slowQueries();
+      expect(versionMaterialized).toMatchObject({ type: 'versionMaterialized', subject: 'a', version: 1 });
+      expect(versionMaterialized.snapshotElements).toBeGreaterThan(0);
+      expect(version.type).toEqual('version');
+      expect(version.version).toBeUndefined();
+      expect(version.versionStart).toBeUndefined();
+    });
+
+    it('should only keep the latest queries', async() => {
+      document.setSlowQueryLog({ threshold: 0, capacity: 2 });
+      for (let version = 0; version < 3; version++) {
+        await document.searchTriplesVersionMaterialized(null, null, null, { version });
+      }
+      expect(document.slowQueries().map(query => query.version)).toEqual([ 1, 2 ]);
+    });
+
+    it('should append queries to a file', async() => {
+      document.setSlowQueryLog({ threshold: 0, capacity: 0, file });
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      await document.searchTriplesDeltaMaterialized(null, null, null, { versionStart: 0, versionEnd: 2 });
+      expect(document.slowQueries()).toEqual([]);
+      const lines = fs.readFileSync(file, 'utf8').trim().split('\n').map(line => JSON.parse(line));
+      expect(lines).toHaveLength(2);
+      expect(lines[0]).toMatchObject({ type: 'versionMaterialized', version: 1 });
+      expect(lines[1]).toMatchObject({ type: 'deltaMaterialized', versionStart: 0, versionEnd: 2 });
+    });
+
+    it('should stop logging without options', async() => {
+      document.setSlowQueryLog({ threshold: 0 });
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      document.setSlowQueryLog();
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      expect(document.slowQueries()).toEqual([]);
+    });
+  });
+
+  describe('of a buffered store', () => {
+    let document: BufferedOstrichStore;
+    beforeEach(async() => {
+      cleanUp('slow-query-buffered');
+      await (await initializeThreeVersions('slow-query-buffered', { readOnly: false })).close();
+      document = await fromPathBuffered('./test/test-slow-query-buffered.ostrich', 100, { readOnly: true, prefetch: false });
+    });
+    afterEach(async() => {
+      await document.close();
+      cleanUp('slow-query-buffered');
+    });
+
+    it('should log each batch of an iterator', async() => {
+      document.setSlowQueryLog({ threshold: 0 });
+      const triples = await readAll(document.searchTriplesDeltaMaterialized(null, null, null, {
+        versionStart: 0,
+        versionEnd: 1,
+      }));
+      const queries = document.slowQueries();
+      expect(queries.length).toBeGreaterThan(0);
+      expect(queries[0]).toMatchObject({ type: 'deltaMaterialized', offset: 0, versionStart: 0, versionEnd: 1 });
+      expect(queries.reduce((sum, query) => sum + query.results, 0)).toEqual(triples.length);
+    });
+  });
+});
@@ -0,0 +1,105 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import type { BufferedOstrichStore, QueryIterator } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+async function readAll(iterator: QueryIterator): Promise<RDF.Quad[]> {
+  const quads: RDF.Quad[] = [];
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    quads.push(...batch);
+    done = batchDone;
+  }
+  return quads;
+}
+
+describe('stats', () => {
+  describe('of a store', () => {
+    let document: OstrichStore;
+    beforeEach(async() => {
+      cleanUp('stats');
+      document = await initializeThreeVersions('stats');
+    });
+    afterEach(async() => {
+      await closeAndCleanUp(document, 'stats');
+    });
+
+    it('should count the appends of all versions', () => {
+      const { append } = document.stats();
+      expect(append.count).toEqual(3);
+      expect(append.errors).toEqual(0);
+      expect(append.results).toBeGreaterThan(0);
+      expect(append.execute.count).toEqual(3);
+    });
+
+    it('should not count operations that were not executed', () => {
+      const { versionMaterialized, deltaMaterialized, version } = document.stats();
+      for (const stats of [ versionMaterialized, deltaMaterialized, version ]) {
+        expect(stats.count).toEqual(0);
+        expect(stats.queueWait).toEqual({ count: 0, sum: 0, max: 0, p50: 0, p90: 0, p99: 0, p999: 0 });
+      }
+    });
+
+    it('should record the results and phases of searches', async() => {
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 2 });
+      const { versionMaterialized } = document.stats();
+      expect(versionMaterialized.count).toEqual(2);
+      expect(versionMaterialized.errors).toEqual(0);
+      expect(versionMaterialized.results).toEqual(19);
+      expect(versionMaterialized.bytes).toBeGreaterThan(0);
+      expect(versionMaterialized.queueWait.count).toEqual(2);
+      expect(versionMaterialized.execute.count).toEqual(2);
+      expect(versionMaterialized.marshal.count).toEqual(2);
+      expect(versionMaterialized.execute.p50).toBeLessThanOrEqual(versionMaterialized.execute.p99);
+      expect(versionMaterialized.execute.p99).toBeLessThanOrEqual(versionMaterialized.execute.max);
+      expect(versionMaterialized.execute.max).toBeLessThanOrEqual(versionMaterialized.execute.sum);
+    });
+
+    it('should record each type of query separately', async() => {
+      await document.searchTriplesDeltaMaterialized(null, null, null, { versionStart: 0, versionEnd: 1 });
+      await document.searchTriplesVersion(null, null, null);
+      await document.countTriplesVersionMaterialized(null, null, null, 1);
+      const stats = document.stats();
+      expect(stats.versionMaterialized.count).toEqual(0);
+      expect(stats.deltaMaterialized.count).toEqual(1);
+      expect(stats.deltaMaterialized.results).toEqual(7);
+      expect(stats.version.count).toEqual(1);
+      expect(stats.version.results).toBeGreaterThan(0);
+      expect(stats.count.count).toEqual(1);
+      expect(stats.count.results).toEqual(0);
+    });
+
+    it('should remain readable after closing', async() => {
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      await document.close();
+      expect(document.stats().versionMaterialized.count).toEqual(1);
+    });
+  });
+
+  describe('of a buffered store', () => {
+    let document: BufferedOstrichStore;
+    beforeEach(async() => {
+      cleanUp('stats-buffered');
+      await (await initializeThreeVersions('stats-buffered', { readOnly: false })).close();
+      document = await fromPathBuffered('./test/test-stats-buffered.ostrich', 100, { readOnly: true, prefetch: false });
+    });
+    afterEach(async() => {
+      await document.close();
+      cleanUp('stats-buffered');
+    });
+
+    it('should record the results of iterators', async() => {
+      const triples = await readAll(document.searchTriplesVersionMaterialized(null, null, null, { version: 1 }));
+      const { versionMaterialized } = document.stats();
+      expect(versionMaterialized.count).toBeGreaterThan(0);
+      expect(versionMaterialized.errors).toEqual(0);
+      expect(versionMaterialized.results).toEqual(triples.length);
+      expect(versionMaterialized.bytes).toBeGreaterThan(0);
+      expect(versionMaterialized.marshal.count).toEqual(versionMaterialized.count);
+    });
+  });
+});
@@ -0,0 +1,103 @@
+import 'jest-rdf';
+import type * as RDF from '@rdfjs/types';
+import type { BufferedOstrichStore, QueryIterator } from '../lib/BufferedOstrichStore';
+import { fromPathBuffered } from '../lib/BufferedOstrichStore';
+import type { OstrichStore } from '../lib/OstrichStore';
+import type { ITraceEvent } from '../lib/QueryTrace';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+
+async function readAll(iterator: QueryIterator): Promise<RDF.Quad[]> {
+  const quads: RDF.Quad[] = [];
+  let done = false;
+  while (!done) {
+    const [ batchDone, batch ] = await iterator.next();
+    quads.push(...batch);
+    done = batchDone;
+  }
+  return quads;
+}
+
+function spans(events: ITraceEvent[], category: string): ITraceEvent[] {
+  return events.filter(event => event.ph === 'X' && event.cat === category);
+}
+
+describe('tracing', () => {
+  describe('of a store', () => {
+    let document: OstrichStore;
+    beforeEach(async() => {
+      cleanUp('trace');
+      document = await initializeThreeVersions('trace');
+    });
+    afterEach(async() => {
+      await closeAndCleanUp(document, 'trace');
+    });
+
+    it('should not record spans when not tracing', async() => {
+      await document.searchTriplesVersionMaterialized(null, null, null, { version: 1 });
+      document.startTracing();
+      const trace = document.stopTracing();
+      expect(trace.displayTimeUnit).toEqual('ms');
+      expect(trace.droppedEvents).toEqual(0);
+      expect(trace.traceEvents.filter(event => event.ph === 'X')).toEqual([]);
+    });
+
+    it('should record the phases of a search', async() => {
+      document.startTracing();
+      await document.searchTriplesDeltaMaterialized(null, null, null, { versionStart: 0, versionEnd: 1 });
+      const events = spans(document.stopTracing().traceEvents, 'deltaMaterialized');
+      expect(events.map(event => event.name)).toEqual(expect.arrayContaining([
+        'execute',
+        'lock',
+        'lookup',
+        'iterate',
+        'marshal',
+      ]));
+      for (const event of events) {
+        expect(event.args.subject).toEqual('');
+        expect(event.args.versionStart).toEqual(0);
+        expect(event.args.versionEnd).toEqual(1);
+        expect(event.dur).toBeGreaterThanOrEqual(0);
+      }
+      expect(events.find(event => event.name === 'iterate')!.args.results).toEqual(7);
+    });
+
+    it('should record the phases of an append', async() => {
+      document.startTracing();
+      await document.append([], 3);
+      const events = spans(document.stopTracing().traceEvents, 'append');
+      expect(events.map(event => event.name)).toEqual(expect.arrayContaining([ 'execute', 'write', 'marshal' ]));
+    });
+
+    it('should name the threads of spans', async() => {
+      document.startTracing();
+      await document.searchTriplesVersion(null, null, null);
+      const { traceEvents } = document.stopTracing();
+      const names = traceEvents.filter(event => event.ph === 'M').map(event => event.args.name);
+      expect(names).toContain('main');
+      expect(names).toContain('worker');
+    });
+  });
+
+  describe('of a buffered store', () => {
+    let document: BufferedOstrichStore;
+    beforeEach(async() => {
+      cleanUp('trace-buffered');
+      await (await initializeThreeVersions('trace-buffered', { readOnly: false })).close();
+      document = await fromPathBuffered('./test/test-trace-buffered.ostrich', 100, { readOnly: true, prefetch: false });
+    });
+    afterEach(async() => {
+      await document.close();
+      cleanUp('trace-buffered');
+    });
+
+    it('should record the phases of each batch', async() => {
+      document.startTracing();
+      const triples = await readAll(document.searchTriplesVersionMaterialized(null, null, null, { version: 1 }));
+      const events = spans(document.stopTracing().traceEvents, 'versionMaterialized');
+      expect(events.map(event => event.name)).toEqual(expect.arrayContaining([ 'execute', 'iterate', 'marshal' ]));
+      const results = events.filter(event => event.name === 'iterate')
+        .reduce((sum, event) => sum + <number> event.args.results, 0);
+      expect(results).toEqual(triples.length);
+    });
+  });
+});
@@ -0,0 +1,137 @@
+import 'jest-rdf';
+import { DataFactory } from 'rdf-data-factory';
+import type { OstrichStore } from '../lib/OstrichStore';
+import { fromPath } from '../lib/OstrichStore';
+import { cleanUp, closeAndCleanUp, initializeThreeVersions } from './prepare-ostrich';
+const quad = require('rdf-quad');
+
+const DF = new DataFactory();
+
+describe('triple ids', () => {
+  describe('An ostrich store for an example ostrich path that will cause errors', () => {
+    let document: OstrichStore;
+
+    it('should throw when the store is closed', async() => {
+      cleanUp('ids');
+      document = await initializeThreeVersions('ids');
+      await document.close();
+
+      await expect(document.searchTripleIdsVersionMaterialized(null, null, null))
+        .rejects.toThrow('Attempted to query a closed OSTRICH store');
+      await expect(document.decodeTripleIds(new Float64Array(0)))
+        .rejects.toThrow('Attempted to query a closed OSTRICH store');
+
+      await closeAndCleanUp(document, 'ids');
+    });
+
+    it('should throw when the store has no versions', async() => {
+      cleanUp('ids');
+      document = await fromPath(`./test/test-ids.ostrich`, { readOnly: false });
+
+      await expect(document.searchTripleIdsVersionMaterialized(null, null, null))
+        .rejects.toThrow('Attempted to query an OSTRICH store without versions');
+      await expect(document.decodeTripleIds(new Float64Array(0)))
+        .rejects.toThrow('Attempted to query an OSTRICH store without versions');
+
+      await closeAndCleanUp(document, 'ids');
+    });
+
+    it('should throw when an internal error is thrown', async() => {
+      cleanUp('ids');
+      document = await initializeThreeVersions('ids');
+
+      jest.spyOn(document.native, '_searchTripleIdsVersionMaterialized')
+        .mockImplementation((subject, predicate, object, offset, limit, version, cb: any) =>
+          cb(new Error('Internal error')));
+      jest.spyOn(document.native, '_decodeTripleIds')
+        .mockImplementation((ids, version, cb: any) => cb(new Error('Internal error')));
+
+      await expect(document.searchTripleIdsVersionMaterialized(null, null, null))
+        .rejects.toThrow('Internal error');
+      await expect(document.decodeTripleIds(new Float64Array(0)))
+        .rejects.toThrow('Internal error');
+
+      await closeAndCleanUp(document, 'ids');
+    });
+  });
+
+  for (const termCacheSize of [ undefined, 0, 2 ]) {
+    describe(`An ostrich store for an example ostrich path with term cache size ${termCacheSize}`, () => {
+      let document: OstrichStore;
+      beforeAll(async() => {
+        cleanUp('ids');
+        document = await initializeThreeVersions('ids', { termCacheSize });
+      });
+      afterAll(async() => {
+        await closeAndCleanUp(document, 'ids');
+      });
+
+      it('should return three ids per matching triple', async() => {
+        const { ids, cardinality, exactCardinality } = await document
+          .searchTripleIdsVersionMaterialized(null, null, null, { version: 0 });
+        expect(ids).toHaveLength(24);
+        expect(cardinality).toEqual(8);
+        expect(exactCardinality).toBe(true);
+      });
+
+      it('should decode ids into the same triples as the regular search', async() => {
+        for (const version of [ 0, 1, 2 ]) {
+          const { ids } = await document.searchTripleIdsVersionMaterialized(null, null, null, { version });
+          const expected = await document.searchTriplesVersionMaterialized(null, null, null, { version });
+          expect(await document.decodeTripleIds(ids, version)).toEqualRdfQuadArray(expected.triples);
+        }
+      });
+
+      it('should decode ids for a pattern with offset and limit repeatedly', async() => {
+        const options = { offset: 1, limit: 2, version: 1 };
+        const { ids, cardinality } = await document
+          .searchTripleIdsVersionMaterialized(DF.namedNode('a'), null, null, options);
+        const expected = await document.searchTriplesVersionMaterialized(DF.namedNode('a'), null, null, options);
+        expect(cardinality).toEqual(expected.cardinality);
+        expect(await document.decodeTripleIds(ids, 1)).toEqualRdfQuadArray(expected.triples);
+        expect(await document.decodeTripleIds(ids, 1)).toEqualRdfQuadArray(expected.triples);
+      });
+
+      it('should decode ids for the latest version by default', async() => {
+        const { ids } = await document.searchTripleIdsVersionMaterialized(DF.namedNode('q'), null, null);
+        expect(await document.decodeTripleIds(ids)).toEqualRdfQuadArray([
+          quad('q', 'q', 'q'),
+        ]);
+      });
+
+      it('should return consecutive pages for consecutive offsets', async() => {
+        const { ids: all } = await document.searchTripleIdsVersionMaterialized(null, null, null, { version: 1 });
+        const { ids: first, exactCardinality, truncated } = await document
+          .searchTripleIdsVersionMaterialized(null, null, null, { version: 1, limit: 3 });
+        const { ids: second } = await document
+          .searchTripleIdsVersionMaterialized(null, null, null, { version: 1, offset: 3, limit: 3 });
+        expect(exactCardinality).toBe(false);
+        expect(truncated).toBe(false);
+        expect([ ...first, ...second ]).toEqual([ ...all.slice(0, 18) ]);
+      });
+
+      it('should reject ids that are not term ids', async() => {
+        const { ids } = await document.searchTripleIdsVersionMaterialized(null, null, null, { version: 1, limit: 1 });
+        for (const invalid of [ 0, -1, 1.5, Number.NaN, 1e12 ]) {
+          const invalidIds = Float64Array.from(ids);
+          invalidIds[2] = invalid;
+          await expect(document.decodeTripleIds(invalidIds, 1)).rejects.toThrow('Invalid triple id at index 2');
+        }
+      });
+
+      it('should record decoded ids in their own stats', async() => {
+        const { ids } = await document.searchTripleIdsVersionMaterialized(null, null, null, { version: 1 });
+        const { versionMaterialized } = document.stats();
+        await document.decodeTripleIds(ids, 1);
+        expect(document.stats().versionMaterialized.count).toEqual(versionMaterialized.count);
+        expect(document.stats().decode.results).toBeGreaterThanOrEqual(ids.length / 3);
+      });
+
+      it('should decode the same triples as the packed search', async() => {
+        const expected = await document.searchTriplesVersionMaterializedBatch(null, null, null);
+        const { ids } = await document.searchTripleIdsVersionMaterialized(null, null, null);
+        expect(await document.decodeTripleIds(ids)).toEqualRdfQuadArray(expected.triples.toArray());
+      });
+    });
+  }
+});